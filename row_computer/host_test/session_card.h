@@ -0,0 +1,106 @@
+#ifndef SESSION_CARD_H
+#define SESSION_CARD_H
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "session_log.h"
+
+// SD card stand-in for the session log tests. Each test target sets its own
+// SESSION_LOG_DIR (a directory in the build tree), so tests can run in parallel.
+
+// Create the card directory, or empty it
+static inline void card_reset(void) {
+    mkdir(SESSION_LOG_DIR, 0755);
+    DIR *dir = opendir(SESSION_LOG_DIR);
+    struct dirent *entry;
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        char path[300];
+        snprintf(path, sizeof(path), "%s/%s", SESSION_LOG_DIR, entry->d_name);
+        if (entry->d_name[0] != '.') {
+            unlink(path);
+        }
+    }
+    if (dir != NULL) {
+        closedir(dir);
+    }
+}
+
+static inline long card_file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+// Copy the first length bytes of src (all of it if length < 0) to dst
+static inline void card_copy(const char *src, const char *dst, long length) {
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dst, "wb");
+    char buf[4096];
+    size_t got;
+    while (in != NULL && out != NULL && length != 0 &&
+           (got = fread(buf, 1, length > 0 && length < (long)sizeof(buf) ? (size_t)length : sizeof(buf), in)) > 0) {
+        fwrite(buf, 1, got, out);
+        length -= length > 0 ? (long)got : 0;
+    }
+    if (in != NULL) {
+        fclose(in);
+    }
+    if (out != NULL) {
+        fclose(out);
+    }
+}
+
+// Called after every append and tick of card_row_outing
+typedef void (*card_step_fn)(timebase_us_t now_us);
+
+#define CARD_STEP_MS        50
+#define CARD_STROKE_MS      2000    // 30 spm
+#define CARD_METRES_PER_S   4
+
+// A synthetic outing from start_us: pieces of rowing_s (a stroke every 2 s) with
+// rest_s between them, a GPS fix and a motion summary every second, and
+// session_log_tick() every CARD_STEP_MS as the logging task does. Returns the
+// time after the last rest. The session is left open.
+static inline timebase_us_t card_row_outing(timebase_us_t start_us, uint32_t pieces, uint32_t rowing_s,
+                                            uint32_t rest_s, card_step_fn after_step) {
+    static uint32_t distance_m = 0;
+    timebase_us_t now_us = start_us;
+    for (uint32_t piece = 0; piece < pieces; piece++) {
+        timebase_us_t rowing_end_us = now_us + (timebase_us_t)rowing_s * 1000000;
+        timebase_us_t rest_end_us = rowing_end_us + (timebase_us_t)rest_s * 1000000;
+        for (; now_us < rest_end_us; now_us += CARD_STEP_MS * 1000) {
+            uint32_t elapsed_ms = (uint32_t)((now_us - start_us) / 1000);
+            bool rowing = now_us < rowing_end_us;
+            if (rowing && elapsed_ms % CARD_STROKE_MS == 0) {
+                session_stroke_t stroke = { .peak_cg = 150, .rate_spm = 30 };
+                session_log_append(SESSION_REC_STROKE, now_us, &stroke, sizeof(stroke));
+                if (after_step != NULL) {
+                    after_step(now_us);
+                }
+            }
+            if (elapsed_ms % 1000 == 0) {
+                distance_m += rowing ? CARD_METRES_PER_S : 0;
+                session_fix_t fix = {
+                    .speed_mm_s = rowing ? CARD_METRES_PER_S * 1000 : 0,
+                    .distance_m = distance_m,
+                    .split_ds = rowing ? 1250 : 0,
+                };
+                session_log_append(SESSION_REC_FIX, now_us, &fix, sizeof(fix));
+                session_summary_t summary = { .accel_mg = { 10, -20, 1000 }, .gyro_cdps = { 5, 0, -5 } };
+                session_log_append(SESSION_REC_SUMMARY, now_us, &summary, sizeof(summary));
+                if (after_step != NULL) {
+                    after_step(now_us);
+                }
+            }
+            session_log_tick(timebase_ms(now_us));
+            if (after_step != NULL) {
+                after_step(now_us);
+            }
+        }
+    }
+    return now_us;
+}
+
+#endif // SESSION_CARD_H
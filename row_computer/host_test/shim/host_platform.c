@@ -0,0 +1,411 @@
+// ESP-IDF services on the host: log, heap, CRC, NVS in memory, and drivers that
+// succeed without hardware. Driver entry points are weak so a test can supply a
+// fake device by defining the same function.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "esp_rom_sys.h"
+#include "esp_random.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_vfs_fat.h"
+#include "esp_vfs_dev.h"
+#include "nvs_flash.h"
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "driver/spi_master.h"
+#include "driver/uart.h"
+#include "host_sim.h"
+
+#define WEAK __attribute__((weak))
+
+// ---- Errors ----
+const char *esp_err_to_name(esp_err_t err) {
+    switch (err) {
+        case ESP_OK:                        return "ESP_OK";
+        case ESP_FAIL:                      return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:         return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE:      return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC:           return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION:       return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NOT_FINISHED:          return "ESP_ERR_NOT_FINISHED";
+        case ESP_ERR_NVS_NOT_FOUND:         return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_NO_FREE_PAGES:     return "ESP_ERR_NVS_NO_FREE_PAGES";
+        default:                            return "ESP_ERR_UNKNOWN";
+    }
+}
+
+// ---- Log ----
+static esp_log_level_t log_level = ESP_LOG_WARN;
+static unsigned long log_counts[ESP_LOG_VERBOSE + 1];
+static host_log_hook_t log_hook = NULL;
+static vprintf_like_t log_vprintf = vprintf;
+static const char log_letters[] = "NEWIDV";
+
+void host_log_set_level(esp_log_level_t level) {
+    log_level = level;
+}
+
+unsigned long host_log_count(esp_log_level_t level) {
+    return __atomic_load_n(&log_counts[level], __ATOMIC_RELAXED);
+}
+
+void host_log_set_hook(host_log_hook_t hook) {
+    log_hook = hook;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func) {
+    vprintf_like_t previous = log_vprintf;
+    log_vprintf = func;
+    return previous;
+}
+
+static int log_emit(vprintf_like_t func, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int written = func(format, args);
+    va_end(args);
+    return written;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    __atomic_add_fetch(&log_counts[level], 1, __ATOMIC_RELAXED);
+    va_list args;
+    if (log_hook != NULL) {
+        va_start(args, format);
+        bool keep = log_hook(level, tag, format, args);
+        va_end(args);
+        if (!keep) {
+            return;
+        }
+    }
+    if (level > log_level) {
+        return;
+    }
+
+    // Formatted first so the installed vprintf sees one line, like the IDF output
+    char line[512];
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    log_emit(log_vprintf, "%c (%llu) %s: %s\n", log_letters[level],
+             (unsigned long long)(host_time_us() / 1000), tag, line);
+}
+
+// ---- Heap ----
+static bool heap_counting = false;
+static unsigned long heap_allocations = 0;
+
+void host_heap_count(bool enable) {
+    heap_counting = enable;
+    heap_allocations = 0;
+}
+
+unsigned long host_heap_allocations(void) {
+    return __atomic_load_n(&heap_allocations, __ATOMIC_RELAXED);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    if (heap_counting) {
+        __atomic_add_fetch(&heap_allocations, 1, __ATOMIC_RELAXED);
+    }
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    if (heap_counting) {
+        __atomic_add_fetch(&heap_allocations, 1, __ATOMIC_RELAXED);
+    }
+    return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr) {
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return 200 * 1024;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return 100 * 1024;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    return 150 * 1024;
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return 200 * 1024;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void) {
+    return 150 * 1024;
+}
+
+// ---- ROM ----
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    // Same convention as the ROM: the caller's running value, inverted in and out
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+WEAK void esp_rom_delay_us(uint32_t us) {
+}
+
+WEAK uint32_t esp_random(void) {
+    return (uint32_t)rand() ^ ((uint32_t)rand() << 16);
+}
+
+// ---- Power ----
+WEAK esp_err_t esp_pm_configure(const void *config) {
+    return ESP_OK;
+}
+
+WEAK esp_err_t esp_sleep_enable_gpio_wakeup(void) {
+    return ESP_OK;
+}
+
+// ---- NVS (one namespace-less key table) ----
+#define HOST_NVS_KEYS 16
+
+typedef struct {
+    char key[16];
+    uint8_t *data;
+    size_t size;
+} host_nvs_entry_t;
+
+static host_nvs_entry_t nvs_entries[HOST_NVS_KEYS];
+
+static host_nvs_entry_t *nvs_find(const char *key, bool create) {
+    for (int i = 0; i < HOST_NVS_KEYS; i++) {
+        if (nvs_entries[i].data != NULL && strcmp(nvs_entries[i].key, key) == 0) {
+            return &nvs_entries[i];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    for (int i = 0; i < HOST_NVS_KEYS; i++) {
+        if (nvs_entries[i].data == NULL) {
+            snprintf(nvs_entries[i].key, sizeof(nvs_entries[i].key), "%s", key);
+            return &nvs_entries[i];
+        }
+    }
+    return NULL;
+}
+
+void host_nvs_erase_all(void) {
+    for (int i = 0; i < HOST_NVS_KEYS; i++) {
+        free(nvs_entries[i].data);
+        nvs_entries[i].data = NULL;
+    }
+}
+
+WEAK esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+WEAK esp_err_t nvs_flash_erase(void) {
+    host_nvs_erase_all();
+    return ESP_OK;
+}
+
+WEAK esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+    *handle = 1;
+    return ESP_OK;
+}
+
+WEAK void nvs_close(nvs_handle_t handle) {
+}
+
+WEAK esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+WEAK esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    host_nvs_entry_t *entry = nvs_find(key, true);
+    if (entry == NULL) {
+        return ESP_ERR_NVS_NO_FREE_PAGES;
+    }
+    free(entry->data);
+    entry->data = malloc(length > 0 ? length : 1);
+    memcpy(entry->data, value, length);
+    entry->size = length;
+    return ESP_OK;
+}
+
+WEAK esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *length) {
+    host_nvs_entry_t *entry = nvs_find(key, false);
+    if (entry == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out == NULL) {
+        *length = entry->size;
+        return ESP_OK;
+    }
+    if (*length < entry->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(out, entry->data, entry->size);
+    *length = entry->size;
+    return ESP_OK;
+}
+
+WEAK esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+WEAK esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value) {
+    size_t length = sizeof(*value);
+    return nvs_get_blob(handle, key, value, &length);
+}
+
+WEAK esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    host_nvs_entry_t *entry = nvs_find(key, false);
+    if (entry == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    free(entry->data);
+    entry->data = NULL;
+    return ESP_OK;
+}
+
+// ---- Storage: SESSION_LOG_DIR is a host directory, nothing to mount ----
+WEAK esp_err_t esp_vfs_fat_sdspi_mount(const char *base, const sdmmc_host_t *host,
+                                       const sdspi_device_config_t *slot,
+                                       const esp_vfs_fat_mount_config_t *config, sdmmc_card_t **card) {
+    return ESP_OK;
+}
+
+WEAK esp_err_t esp_vfs_dev_uart_use_driver(int port) {
+    return ESP_OK;
+}
+
+// ---- GPIO ----
+WEAK esp_err_t gpio_config(const gpio_config_t *config) { return ESP_OK; }
+WEAK esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) { return ESP_OK; }
+WEAK int gpio_get_level(gpio_num_t pin) { return 0; }
+WEAK esp_err_t gpio_set_direction(gpio_num_t pin, int mode) { return ESP_OK; }
+WEAK esp_err_t gpio_reset_pin(gpio_num_t pin) { return ESP_OK; }
+WEAK esp_err_t gpio_wakeup_enable(gpio_num_t pin, int type) { return ESP_OK; }
+WEAK esp_err_t gpio_wakeup_disable(gpio_num_t pin) { return ESP_OK; }
+WEAK esp_err_t gpio_install_isr_service(int flags) { return ESP_OK; }
+WEAK esp_err_t gpio_isr_handler_add(gpio_num_t pin, void (*handler)(void *), void *arg) { return ESP_OK; }
+WEAK esp_err_t gpio_intr_enable(gpio_num_t pin) { return ESP_OK; }
+WEAK esp_err_t gpio_intr_disable(gpio_num_t pin) { return ESP_OK; }
+
+// ---- I2C: no device answers unless a test provides one ----
+WEAK esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *config) { return ESP_OK; }
+WEAK esp_err_t i2c_driver_install(i2c_port_t port, int mode, size_t rx, size_t tx, int flags) { return ESP_OK; }
+WEAK esp_err_t i2c_driver_delete(i2c_port_t port) { return ESP_OK; }
+WEAK i2c_cmd_handle_t i2c_cmd_link_create(void) { return malloc(1); }
+WEAK void i2c_cmd_link_delete(i2c_cmd_handle_t cmd) { free(cmd); }
+WEAK esp_err_t i2c_master_start(i2c_cmd_handle_t cmd) { return ESP_OK; }
+WEAK esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd) { return ESP_OK; }
+WEAK esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack) { return ESP_OK; }
+WEAK esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks) { return ESP_FAIL; }
+
+WEAK esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t addr, const uint8_t *data, size_t len,
+                                          TickType_t ticks) {
+    return ESP_FAIL;
+}
+
+WEAK esp_err_t i2c_master_write_read_device(i2c_port_t port, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                                            uint8_t *rx, size_t rx_len, TickType_t ticks) {
+    return ESP_FAIL;
+}
+
+WEAK esp_err_t i2c_master_read_from_device(i2c_port_t port, uint8_t addr, uint8_t *rx, size_t rx_len,
+                                           TickType_t ticks) {
+    return ESP_FAIL;
+}
+
+// ---- SPI: transactions complete and read zeros unless a test provides a device ----
+WEAK esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *config, int dma) { return ESP_OK; }
+WEAK esp_err_t spi_bus_free(spi_host_device_t host) { return ESP_OK; }
+
+WEAK esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+                                  spi_device_handle_t *handle) {
+    *handle = malloc(1);
+    return ESP_OK;
+}
+
+WEAK esp_err_t spi_bus_remove_device(spi_device_handle_t handle) {
+    free(handle);
+    return ESP_OK;
+}
+
+WEAK esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans) {
+    if (trans->rxlength > 0 || trans->rx_buffer != NULL) {
+        size_t bytes = ((trans->rxlength > 0 ? trans->rxlength : trans->length) + 7) / 8;
+        if (trans->flags & SPI_TRANS_USE_RXDATA) {
+            memset(trans->rx_data, 0, sizeof(trans->rx_data));
+        } else if (trans->rx_buffer != NULL) {
+            memset(trans->rx_buffer, 0, bytes);
+        }
+    }
+    return ESP_OK;
+}
+
+WEAK esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans) {
+    return spi_device_polling_transmit(handle, trans);
+}
+
+static spi_transaction_t *spi_last_queued = NULL;
+
+WEAK esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t ticks) {
+    spi_last_queued = trans;
+    return spi_device_polling_transmit(handle, trans);
+}
+
+WEAK esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans, TickType_t ticks) {
+    *trans = spi_last_queued;
+    return ESP_OK;
+}
+
+WEAK esp_err_t spi_device_acquire_bus(spi_device_handle_t handle, TickType_t ticks) { return ESP_OK; }
+WEAK void spi_device_release_bus(spi_device_handle_t handle) {}
+
+// ---- UART: a sink that never answers unless a test provides a peer ----
+WEAK esp_err_t uart_driver_install(uart_port_t port, int rx, int tx, int depth, void *queue, int flags) { return ESP_OK; }
+WEAK esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config) { return ESP_OK; }
+WEAK esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts) { return ESP_OK; }
+WEAK int uart_write_bytes(uart_port_t port, const void *data, size_t len) { return (int)len; }
+
+WEAK esp_err_t uart_get_tx_buffer_free_size(uart_port_t port, size_t *size) {
+    *size = 1024;
+    return ESP_OK;
+}
+
+WEAK int uart_read_bytes(uart_port_t port, void *buf, uint32_t len, TickType_t ticks) { return 0; }
+WEAK esp_err_t uart_flush(uart_port_t port) { return ESP_OK; }
+WEAK esp_err_t uart_flush_input(uart_port_t port) { return ESP_OK; }
+
+WEAK esp_err_t uart_get_buffered_data_len(uart_port_t port, size_t *size) {
+    *size = 0;
+    return ESP_OK;
+}
+
+WEAK esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t ticks) { return ESP_OK; }
+WEAK esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baud) { return ESP_OK; }
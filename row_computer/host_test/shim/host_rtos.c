@@ -0,0 +1,410 @@
+// Lockstep FreeRTOS emulation on pthreads with a virtual clock (see host_sim.h).
+// One big lock keeps it simple and deterministic.
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "host_sim.h"
+
+static pthread_mutex_t big = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+static uint64_t now_us = 0;
+uint64_t host_timer_offset_us = 0;
+
+typedef struct host_task {
+    const char *name;
+    pthread_t thread;
+    pthread_cond_t cond;
+    uint32_t bits;
+    bool pending;
+    bool blocked;
+    bool has_deadline;
+    bool sleep_only;                        // vTaskDelay: notifications do not wake
+    uint64_t deadline_us;
+    TaskFunction_t fn;
+    void *arg;
+    bool managed;                           // Counts for the idle check
+    uint32_t notify_count;                  // ulTaskNotifyTake
+} host_task_t;
+
+#define HOST_MAX_TASKS 12
+static host_task_t tasks[HOST_MAX_TASKS];
+static int task_count = 0;
+static __thread host_task_t *self = NULL;
+static host_task_t producer = { .name = "producer" };
+
+static bool runnable(const host_task_t *t) {
+    if (!t->blocked) {
+        return true;
+    }
+    if (t->pending && !t->sleep_only) {
+        return true;
+    }
+    return t->has_deadline && t->deadline_us <= now_us;
+}
+
+static void wake_expired(void) {
+    for (int i = 0; i < task_count; i++) {
+        if (tasks[i].blocked && runnable(&tasks[i])) {
+            pthread_cond_signal(&tasks[i].cond);
+        }
+    }
+}
+
+void host_wait_idle(void) {
+    pthread_mutex_lock(&big);
+    for (;;) {
+        bool busy = false;
+        for (int i = 0; i < task_count; i++) {
+            busy |= tasks[i].managed && runnable(&tasks[i]);
+        }
+        if (!busy) {
+            break;
+        }
+        wake_expired();
+        pthread_cond_wait(&idle_cond, &big);
+    }
+    pthread_mutex_unlock(&big);
+}
+
+void host_set_time_us(uint64_t us) {
+    pthread_mutex_lock(&big);
+    __atomic_store_n(&now_us, us, __ATOMIC_RELAXED);
+    wake_expired();
+    pthread_mutex_unlock(&big);
+}
+
+uint64_t host_time_us(void) {
+    return __atomic_load_n(&now_us, __ATOMIC_RELAXED);
+}
+
+void host_advance_ms(uint32_t ms) {
+    host_set_time_us(host_time_us() + (uint64_t)ms * 1000);
+    host_wait_idle();
+}
+
+int64_t esp_timer_get_time(void) {
+    return (int64_t)(host_time_us() + host_timer_offset_us);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(host_time_us() / 1000);
+}
+
+TickType_t xTaskGetTickCountFromISR(void) {
+    return xTaskGetTickCount();
+}
+
+// Block the calling task; returns with the lock held
+static void block(host_task_t *t, bool has_deadline, uint64_t deadline_us, bool sleep_only) {
+    t->blocked = true;
+    t->has_deadline = has_deadline;
+    t->deadline_us = deadline_us;
+    t->sleep_only = sleep_only;
+    pthread_cond_signal(&idle_cond);
+    while (!runnable(t)) {
+        pthread_cond_wait(&t->cond, &big);
+    }
+    t->blocked = false;
+}
+
+static uint64_t deadline_for(TickType_t ticks) {
+    return now_us + (uint64_t)ticks * 1000;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_entry, uint32_t clear_exit, uint32_t *value, TickType_t ticks) {
+    host_task_t *t = self != NULL ? self : &producer;
+    pthread_mutex_lock(&big);
+    if (!t->pending) {
+        t->bits &= ~clear_entry;
+        if (ticks > 0 && self != NULL) {
+            block(t, ticks != portMAX_DELAY, deadline_for(ticks), false);
+        }
+    }
+    BaseType_t got = t->pending;
+    if (value != NULL) {
+        *value = t->bits;
+    }
+    if (got) {
+        t->bits &= ~clear_exit;
+        t->pending = false;
+    }
+    pthread_mutex_unlock(&big);
+    return got;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t handle, uint32_t value, eNotifyAction action) {
+    host_task_t *t = handle;
+    if (t == NULL) {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&big);
+    if (action == eSetBits) {
+        t->bits |= value;
+    } else if (action == eIncrement) {
+        t->notify_count++;
+    } else if (action != eNoAction) {
+        t->bits = value;
+    }
+    t->pending = true;
+    if (t->blocked && runnable(t)) {
+        pthread_cond_signal(&t->cond);
+    }
+    pthread_mutex_unlock(&big);
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+    return xTaskNotify(handle, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t handle, BaseType_t *woken) {
+    xTaskNotifyGive(handle);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    host_task_t *t = self != NULL ? self : &producer;
+    pthread_mutex_lock(&big);
+    if (t->notify_count == 0 && ticks > 0 && self != NULL) {
+        t->pending = false;
+        block(t, ticks != portMAX_DELAY, deadline_for(ticks), false);
+    }
+    uint32_t count = t->notify_count;
+    t->notify_count = clear ? 0 : (count > 0 ? count - 1 : 0);
+    t->pending = false;
+    pthread_mutex_unlock(&big);
+    return count;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (self == NULL) {
+        host_advance_ms(ticks);         // The producer owns the clock
+        return;
+    }
+    pthread_mutex_lock(&big);
+    block(self, true, deadline_for(ticks), true);
+    pthread_mutex_unlock(&big);
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+    TickType_t wake = *previous_wake + increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(wake - now) > 0) {
+        vTaskDelay(wake - now);
+    }
+    *previous_wake = wake;
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+    vTaskDelayUntil(previous_wake, increment);
+    return pdTRUE;
+}
+
+void host_sleep_until_us(uint64_t deadline_us) {
+    if (self == NULL) {
+        if (deadline_us > host_time_us()) {
+            host_set_time_us(deadline_us);
+        }
+        host_wait_idle();
+        return;
+    }
+    pthread_mutex_lock(&big);
+    if (deadline_us > now_us) {
+        block(self, true, deadline_us, true);
+    }
+    pthread_mutex_unlock(&big);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return self != NULL ? self : &producer;
+}
+
+const char *pcTaskGetName(TaskHandle_t handle) {
+    host_task_t *t = handle != NULL ? handle : xTaskGetCurrentTaskHandle();
+    return t->name;
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    if (handle == NULL && self != NULL) {
+        pthread_mutex_lock(&big);
+        self->managed = false;
+        pthread_cond_signal(&idle_cond);
+        pthread_mutex_unlock(&big);
+        pthread_exit(NULL);
+    }
+}
+
+static void *trampoline(void *arg) {
+    host_task_t *t = arg;
+    self = t;
+    t->fn(t->arg);
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+TaskHandle_t host_task_create(TaskFunction_t fn, const char *name, void *arg) {
+    pthread_mutex_lock(&big);
+    if (task_count == HOST_MAX_TASKS) {
+        pthread_mutex_unlock(&big);
+        fprintf(stderr, "host_rtos: too many tasks (%s)\n", name);
+        abort();
+    }
+    host_task_t *t = &tasks[task_count++];
+    memset(t, 0, sizeof(*t));
+    t->name = name;
+    t->fn = fn;
+    t->arg = arg;
+    t->managed = true;
+    pthread_cond_init(&t->cond, NULL);
+    pthread_mutex_unlock(&big);
+    pthread_create(&t->thread, NULL, trampoline, t);
+    return t;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+    TaskHandle_t created = host_task_create(fn, name, arg);
+    if (handle != NULL) {
+        *handle = created;
+    }
+    return pdPASS;
+}
+
+BaseType_t xPortGetCoreID(void) {
+    return 0;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle) {
+    return 1024;
+}
+
+// ---- Queues (copying ring; a full or empty queue never blocks) ----
+typedef struct {
+    uint8_t *items;
+    size_t item_size;
+    uint32_t length;
+    uint32_t head, count;
+    uint32_t high_water;
+    uint32_t send_failures;
+} host_queue_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    host_queue_t *q = calloc(1, sizeof(*q));
+    q->items = calloc(length, item_size > 0 ? item_size : 1);
+    q->item_size = item_size;
+    q->length = length;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    host_queue_t *q = queue;
+    if (q != NULL) {
+        free(q->items);
+        free(q);
+    }
+}
+
+static BaseType_t queue_put(host_queue_t *q, const void *item, bool overwrite) {
+    pthread_mutex_lock(&big);
+    if (q->count == q->length && !overwrite) {
+        q->send_failures++;
+        pthread_mutex_unlock(&big);
+        return pdFALSE;
+    }
+    if (q->count == q->length) {
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+    }
+    memcpy(q->items + ((q->head + q->count) % q->length) * q->item_size, item, q->item_size);
+    q->count++;
+    if (q->count > q->high_water) {
+        q->high_water = q->count;
+    }
+    pthread_mutex_unlock(&big);
+    return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return queue_put(queue, item, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return queue_put(queue, item, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+    return queue_put(queue, item, true);
+}
+
+static BaseType_t queue_get(host_queue_t *q, void *item, bool remove) {
+    pthread_mutex_lock(&big);
+    if (q->count == 0) {
+        pthread_mutex_unlock(&big);
+        return pdFALSE;
+    }
+    memcpy(item, q->items + q->head * q->item_size, q->item_size);
+    if (remove) {
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+    }
+    pthread_mutex_unlock(&big);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    return queue_get(queue, item, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks) {
+    return queue_get(queue, item, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    host_queue_t *q = queue;
+    return __atomic_load_n(&q->count, __ATOMIC_RELAXED);
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    host_queue_t *q = queue;
+    return q->length - uxQueueMessagesWaiting(queue);
+}
+
+void host_queue_stats(QueueHandle_t queue, uint32_t *high_water, uint32_t *send_failures) {
+    host_queue_t *q = queue;
+    *high_water = q->high_water;
+    *send_failures = q->send_failures;
+}
+
+// ---- Mutexes (recursive, real locks: tests may use plain threads too) ----
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    pthread_mutex_t *m = malloc(sizeof(*m));
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(m, &attr);
+    return m;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return pthread_mutex_lock(semaphore) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return pthread_mutex_unlock(semaphore) == 0 ? pdTRUE : pdFALSE;
+}
+
+// ---- Critical sections: one recursive lock for every portMUX ----
+static pthread_mutex_t critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+    pthread_mutex_lock(&critical);
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+    pthread_mutex_unlock(&critical);
+}
@@ -0,0 +1,58 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+// Host runtime for the firmware modules: FreeRTOS on pthreads in lockstep with a
+// virtual clock, plus the ESP-IDF services the modules call.
+//
+// The thread running main() is the producer. It owns time: the clock only moves
+// when it calls host_set_time_us() / host_advance_ms() / vTaskDelay(), and
+// host_wait_idle() returns once every emulated task is blocked (waiting for a
+// notification or sleeping until a virtual deadline). Tests that never create a
+// task just move the clock.
+
+// ---- Virtual clock ----
+void host_set_time_us(uint64_t us);
+uint64_t host_time_us(void);
+
+// Producer: move the clock forward and let every woken task run to its next block
+void host_advance_ms(uint32_t ms);
+
+// Added to esp_timer_get_time() only - boots the timebase close to a 32-bit ms wrap
+extern uint64_t host_timer_offset_us;
+
+// ---- Tasks ----
+TaskHandle_t host_task_create(TaskFunction_t fn, const char *name, void *arg);
+void host_wait_idle(void);
+
+// Task: block until the virtual clock reaches deadline_us (notifications do not wake)
+void host_sleep_until_us(uint64_t deadline_us);
+
+void host_queue_stats(QueueHandle_t queue, uint32_t *high_water, uint32_t *send_failures);
+
+// ---- Log ----
+// Lines at or above this level go to stderr (default: warnings). Counted either way.
+void host_log_set_level(esp_log_level_t level);
+unsigned long host_log_count(esp_log_level_t level);
+
+// Sees every line before the level filter; return false to drop it
+typedef bool (*host_log_hook_t)(esp_log_level_t level, const char *tag, const char *format, va_list args);
+void host_log_set_hook(host_log_hook_t hook);
+
+// ---- Heap ----
+// Count heap_caps allocations from now on (steady-state checks)
+void host_heap_count(bool enable);
+unsigned long host_heap_allocations(void);
+
+// ---- NVS ----
+// Forget every stored key (a fresh flash)
+void host_nvs_erase_all(void);
+
+#endif // HOST_SIM_H
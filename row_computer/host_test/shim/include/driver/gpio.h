@@ -0,0 +1,27 @@
+#pragma once
+// Host shim: the part of ESP-IDF <driver/gpio.h> the firmware uses
+#include "esp_err.h"
+typedef int gpio_num_t;
+#define GPIO_PULLUP_ENABLE 1
+#define GPIO_MODE_OUTPUT 2
+#define GPIO_MODE_INPUT 1
+#define GPIO_MODE_INPUT_OUTPUT_OD 7
+#define GPIO_MODE_OUTPUT_OD 6
+#define GPIO_PULLUP_DISABLE 0
+#define GPIO_PULLDOWN_DISABLE 0
+#define GPIO_INTR_DISABLE 0
+#define GPIO_INTR_POSEDGE 1
+#define GPIO_NUM_NC -1
+typedef struct { uint64_t pin_bit_mask; int mode; int pull_up_en; int pull_down_en; int intr_type; } gpio_config_t;
+esp_err_t gpio_config(const gpio_config_t*);
+esp_err_t gpio_set_level(gpio_num_t, uint32_t);
+int gpio_get_level(gpio_num_t);
+esp_err_t gpio_set_direction(gpio_num_t, int);
+esp_err_t gpio_reset_pin(gpio_num_t);
+esp_err_t gpio_wakeup_enable(gpio_num_t, int);
+#define GPIO_INTR_HIGH_LEVEL 5
+esp_err_t gpio_install_isr_service(int);
+esp_err_t gpio_isr_handler_add(gpio_num_t, void (*)(void*), void*);
+esp_err_t gpio_intr_enable(gpio_num_t);
+esp_err_t gpio_intr_disable(gpio_num_t);
+esp_err_t gpio_wakeup_disable(gpio_num_t);
@@ -0,0 +1,23 @@
+#pragma once
+// Host shim: the part of ESP-IDF <driver/i2c.h> the firmware uses
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+typedef int i2c_port_t;
+#define I2C_NUM_0 0
+#define I2C_MODE_MASTER 1
+#define I2C_MASTER_WRITE 0
+#define I2C_MASTER_READ 1
+typedef void *i2c_cmd_handle_t;
+typedef struct { int mode; int sda_io_num; int scl_io_num; int sda_pullup_en; int scl_pullup_en; struct { uint32_t clk_speed; } master; uint32_t clk_flags; } i2c_config_t;
+esp_err_t i2c_param_config(i2c_port_t, const i2c_config_t*);
+esp_err_t i2c_driver_install(i2c_port_t, int, size_t, size_t, int);
+esp_err_t i2c_driver_delete(i2c_port_t);
+i2c_cmd_handle_t i2c_cmd_link_create(void);
+void i2c_cmd_link_delete(i2c_cmd_handle_t);
+esp_err_t i2c_master_start(i2c_cmd_handle_t);
+esp_err_t i2c_master_stop(i2c_cmd_handle_t);
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t, uint8_t, bool);
+esp_err_t i2c_master_cmd_begin(i2c_port_t, i2c_cmd_handle_t, TickType_t);
+esp_err_t i2c_master_write_to_device(i2c_port_t, uint8_t, const uint8_t*, size_t, TickType_t);
+esp_err_t i2c_master_write_read_device(i2c_port_t, uint8_t, const uint8_t*, size_t, uint8_t*, size_t, TickType_t);
+esp_err_t i2c_master_read_from_device(i2c_port_t, uint8_t, uint8_t*, size_t, TickType_t);
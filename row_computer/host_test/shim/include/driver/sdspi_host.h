@@ -0,0 +1,7 @@
+#pragma once
+// Host shim: the part of ESP-IDF <driver/sdspi_host.h> the firmware uses
+#include "driver/spi_master.h"
+typedef struct { int slot; int max_freq_khz; } sdmmc_host_t;
+typedef struct { int host_id; int gpio_cs; int gpio_cd; int gpio_wp; int gpio_int; } sdspi_device_config_t;
+#define SDSPI_HOST_DEFAULT() ((sdmmc_host_t){ .slot = 1, .max_freq_khz = 20000 })
+#define SDSPI_DEVICE_CONFIG_DEFAULT() ((sdspi_device_config_t){ .host_id = 1, .gpio_cs = 13, .gpio_cd = -1, .gpio_wp = -1, .gpio_int = -1 })
@@ -0,0 +1,26 @@
+#pragma once
+// Host shim: the part of ESP-IDF <driver/uart.h> the firmware uses
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+typedef int uart_port_t;
+#define UART_NUM_0 0
+#define UART_NUM_2 2
+#define UART_PIN_NO_CHANGE -1
+#define UART_DATA_8_BITS 3
+#define UART_PARITY_DISABLE 0
+#define UART_STOP_BITS_1 1
+#define UART_HW_FLOWCTRL_DISABLE 0
+#define UART_SCLK_DEFAULT 0
+typedef struct { int baud_rate, data_bits, parity, stop_bits, flow_ctrl, source_clk; } uart_config_t;
+esp_err_t uart_driver_install(uart_port_t, int, int, int, void*, int);
+esp_err_t uart_param_config(uart_port_t, const uart_config_t*);
+esp_err_t uart_set_pin(uart_port_t, int, int, int, int);
+int uart_write_bytes(uart_port_t, const void*, size_t);
+esp_err_t uart_get_tx_buffer_free_size(uart_port_t, size_t*);
+int uart_read_bytes(uart_port_t, void*, uint32_t, TickType_t);
+esp_err_t uart_flush(uart_port_t);
+esp_err_t uart_flush_input(uart_port_t);
+esp_err_t uart_get_buffered_data_len(uart_port_t, size_t*);
+esp_err_t uart_wait_tx_done(uart_port_t, TickType_t);
+esp_err_t uart_set_baudrate(uart_port_t, uint32_t);
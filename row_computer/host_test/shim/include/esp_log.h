@@ -0,0 +1,18 @@
+#pragma once
+// Host shim: the part of ESP-IDF <esp_log.h> the firmware uses
+#include <stdio.h>
+#include "esp_err.h"
+typedef enum {ESP_LOG_NONE,ESP_LOG_ERROR,ESP_LOG_WARN,ESP_LOG_INFO,ESP_LOG_DEBUG,ESP_LOG_VERBOSE} esp_log_level_t;
+void esp_log_level_set(const char*, esp_log_level_t);
+void esp_log_write(esp_log_level_t, const char*, const char*, ...) __attribute__((format(printf,3,4)));
+#define ESP_LOGE(t, f, ...) esp_log_write(ESP_LOG_ERROR, t, f, ##__VA_ARGS__)
+#define ESP_LOGW(t, f, ...) esp_log_write(ESP_LOG_WARN, t, f, ##__VA_ARGS__)
+#define ESP_LOGI(t, f, ...) esp_log_write(ESP_LOG_INFO, t, f, ##__VA_ARGS__)
+#define ESP_LOGD(t, f, ...) esp_log_write(ESP_LOG_DEBUG, t, f, ##__VA_ARGS__)
+#define ESP_LOGV(t, f, ...) esp_log_write(ESP_LOG_VERBOSE, t, f, ##__VA_ARGS__)
+#ifndef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL ESP_LOG_INFO
+#endif
+#include <stdarg.h>
+typedef int (*vprintf_like_t)(const char *, va_list);
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
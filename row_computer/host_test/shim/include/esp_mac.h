@@ -0,0 +1,2 @@
+#pragma once
+// Host shim: the part of ESP-IDF <esp_mac.h> the firmware uses
@@ -0,0 +1,6 @@
+#pragma once
+// Host shim: the part of ESP-IDF <esp_pm.h> the firmware uses
+#include "esp_err.h"
+#include <stdbool.h>
+typedef struct { int max_freq_mhz; int min_freq_mhz; bool light_sleep_enable; } esp_pm_config_t;
+esp_err_t esp_pm_configure(const void*);
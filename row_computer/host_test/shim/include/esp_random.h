@@ -0,0 +1,4 @@
+#pragma once
+// Host shim: the part of ESP-IDF <esp_random.h> the firmware uses
+#include <stdint.h>
+uint32_t esp_random(void);
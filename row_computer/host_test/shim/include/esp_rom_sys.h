@@ -0,0 +1,4 @@
+#pragma once
+// Host shim: the part of ESP-IDF <esp_rom_sys.h> the firmware uses
+#include <stdint.h>
+void esp_rom_delay_us(uint32_t us);
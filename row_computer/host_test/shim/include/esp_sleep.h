@@ -0,0 +1,4 @@
+#pragma once
+// Host shim: the part of ESP-IDF <esp_sleep.h> the firmware uses
+#include "esp_err.h"
+esp_err_t esp_sleep_enable_gpio_wakeup(void);
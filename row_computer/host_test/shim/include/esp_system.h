@@ -0,0 +1,5 @@
+#pragma once
+// Host shim: the part of ESP-IDF <esp_system.h> the firmware uses
+#include <stdint.h>
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
@@ -0,0 +1,4 @@
+#pragma once
+// Host shim: the part of ESP-IDF <esp_timer.h> the firmware uses
+#include <stdint.h>
+int64_t esp_timer_get_time(void);
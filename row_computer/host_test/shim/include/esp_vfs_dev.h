@@ -0,0 +1,4 @@
+#pragma once
+// Host shim: the part of ESP-IDF <esp_vfs_dev.h> the firmware uses
+#include "esp_err.h"
+esp_err_t esp_vfs_dev_uart_use_driver(int);
@@ -0,0 +1,9 @@
+#pragma once
+// Host shim: the part of ESP-IDF <esp_vfs_fat.h> the firmware uses
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "driver/sdspi_host.h"
+#include "sdmmc_cmd.h"
+typedef struct { bool format_if_mount_failed; int max_files; size_t allocation_unit_size; } esp_vfs_fat_mount_config_t;
+esp_err_t esp_vfs_fat_sdspi_mount(const char*, const sdmmc_host_t*, const sdspi_device_config_t*, const esp_vfs_fat_mount_config_t*, sdmmc_card_t**);
@@ -0,0 +1,31 @@
+#pragma once
+// Host shim: the part of ESP-IDF <freertos/FreeRTOS.h> the firmware uses
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t StackType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define portNUM_PROCESSORS 2
+#define configNUM_CORES 2
+typedef struct { int owner; int count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0,0}
+void vPortEnterCritical(portMUX_TYPE*); void vPortExitCritical(portMUX_TYPE*);
+#define taskENTER_CRITICAL(m) vPortEnterCritical(m)
+#define taskEXIT_CRITICAL(m) vPortExitCritical(m)
+#define portENTER_CRITICAL(m) vPortEnterCritical(m)
+#define portEXIT_CRITICAL(m) vPortExitCritical(m)
+#define taskENTER_CRITICAL_ISR(m) vPortEnterCritical(m)
+#define taskEXIT_CRITICAL_ISR(m) vPortExitCritical(m)
+#define portYIELD_FROM_ISR(x) (void)(x)
+#define IRAM_ATTR
@@ -0,0 +1,18 @@
+#pragma once
+// Host shim: the part of ESP-IDF <freertos/queue.h> the firmware uses
+#include "freertos/FreeRTOS.h"
+typedef void *QueueHandle_t;
+typedef void *QueueSetHandle_t;
+typedef void *QueueSetMemberHandle_t;
+QueueHandle_t xQueueCreate(UBaseType_t, UBaseType_t);
+BaseType_t xQueueSend(QueueHandle_t, const void*, TickType_t);
+BaseType_t xQueueSendToBack(QueueHandle_t, const void*, TickType_t);
+BaseType_t xQueueOverwrite(QueueHandle_t, const void*);
+BaseType_t xQueueReceive(QueueHandle_t, void*, TickType_t);
+BaseType_t xQueuePeek(QueueHandle_t, void*, TickType_t);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t);
+void vQueueDelete(QueueHandle_t);
+QueueSetHandle_t xQueueCreateSet(UBaseType_t);
+BaseType_t xQueueAddToSet(QueueSetMemberHandle_t, QueueSetHandle_t);
+QueueSetMemberHandle_t xQueueSelectFromSet(QueueSetHandle_t, TickType_t);
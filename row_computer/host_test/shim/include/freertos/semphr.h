@@ -0,0 +1,8 @@
+#pragma once
+// Host shim: the part of ESP-IDF <freertos/semphr.h> the firmware uses
+#include "freertos/queue.h"
+typedef void *SemaphoreHandle_t;
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t);
@@ -0,0 +1,29 @@
+#pragma once
+// Host shim: the part of ESP-IDF <freertos/task.h> the firmware uses
+#include "freertos/FreeRTOS.h"
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef enum {eRunning,eReady,eBlocked,eSuspended,eDeleted,eInvalid} eTaskState;
+typedef enum {eNoAction,eSetBits,eIncrement,eSetValueWithOverwrite,eSetValueWithoutOverwrite} eNotifyAction;
+typedef struct { TaskHandle_t xHandle; const char *pcTaskName; UBaseType_t xTaskNumber; eTaskState eCurrentState; UBaseType_t uxCurrentPriority; UBaseType_t uxBasePriority; uint32_t ulRunTimeCounter; StackType_t *pxStackBase; uint32_t usStackHighWaterMark; BaseType_t xCoreID; } TaskStatus_t;
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*, BaseType_t);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+void vTaskDelay(TickType_t);
+void vTaskDelayUntil(TickType_t*, TickType_t);
+BaseType_t xTaskDelayUntil(TickType_t*, TickType_t);
+BaseType_t xTaskNotifyGive(TaskHandle_t);
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t*);
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t);
+BaseType_t xTaskNotify(TaskHandle_t, uint32_t, eNotifyAction);
+BaseType_t xTaskNotifyWait(uint32_t, uint32_t, uint32_t*, TickType_t);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t);
+UBaseType_t uxTaskGetNumberOfTasks(void);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t*, UBaseType_t, uint32_t*);
+const char *pcTaskGetName(TaskHandle_t);
+void vTaskDelete(TaskHandle_t);
+void vTaskSuspend(TaskHandle_t);
+void vTaskResume(TaskHandle_t);
+void vTaskPrioritySet(TaskHandle_t, UBaseType_t);
+BaseType_t xPortGetCoreID(void);
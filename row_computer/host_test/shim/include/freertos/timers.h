@@ -0,0 +1,11 @@
+#pragma once
+// Host shim: the part of ESP-IDF <freertos/timers.h> the firmware uses
+#include "freertos/FreeRTOS.h"
+typedef void *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+TimerHandle_t xTimerCreate(const char*, TickType_t, UBaseType_t, void*, TimerCallbackFunction_t);
+BaseType_t xTimerStart(TimerHandle_t, TickType_t);
+BaseType_t xTimerStop(TimerHandle_t, TickType_t);
+BaseType_t xTimerReset(TimerHandle_t, TickType_t);
+BaseType_t xTimerChangePeriod(TimerHandle_t, TickType_t, TickType_t);
+void *pvTimerGetTimerID(TimerHandle_t);
@@ -0,0 +1,5 @@
+#pragma once
+// Host shim: the part of ESP-IDF <nvs_flash.h> the firmware uses
+#include "nvs.h"
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
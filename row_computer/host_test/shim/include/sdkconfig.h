@@ -0,0 +1,9 @@
+#pragma once
+// Host build: no sdkconfig - the Kconfig options the firmware tests for.
+// Pulled in by esp_err.h, as the IDF headers do.
+
+// IMU backend: the MPU6050 unless a test selects an SPI part (host_test DEFINITIONS)
+#if !defined(CONFIG_ROW_IMU_ICM42688) && !defined(CONFIG_ROW_IMU_LSM6DSO)
+#define CONFIG_ROW_IMU_MPU6050 1
+#endif
+#define CONFIG_PM_ENABLE 1
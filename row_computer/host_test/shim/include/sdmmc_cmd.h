@@ -0,0 +1,3 @@
+#pragma once
+// Host shim: the part of ESP-IDF <sdmmc_cmd.h> the firmware uses
+typedef struct sdmmc_card_t sdmmc_card_t;
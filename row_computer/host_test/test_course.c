@@ -0,0 +1,389 @@
+// Course engine benchmark: a boat rowed along courses of 10k+ segments with GPS
+// noise (sigma 2.5 m, correlated over 5 s) at 1 and 10 Hz. Every matched fix must
+// land where a brute-force scan of all segments puts it, while testing only a
+// small fraction of them. Out-and-back lanes must not swap legs, finish times
+// must be close to the exact ones, and the ghost delta half way round a faster
+// run must match its pace. COURSE_BENCH_SEEDS sets the runs per course.
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "config/common_constants.h"
+#include "course.h"
+#include "geo.h"
+#include "test_support.h"
+
+#define ORIGIN_LAT_E7       515000000
+#define ORIGIN_LON_E7       -1250000
+#define GPS_SIGMA_M         2.5f
+#define GPS_NOISE_TAU_S     5.0f
+#define LEAD_IN_M           40.0f       // Rowing starts this far before the start line
+#define SAME_MATCH_M        0.05f
+#define COURSE_PATH         "test_course.txt"
+#define GHOST_PATH          "test_course.gho"
+
+// The course as written (metres east/north of the origin) and as the engine sees it
+static float shape_x[COURSE_MAX_POINTS], shape_y[COURSE_MAX_POINTS];
+static uint32_t shape_count = 0;
+static geo_ltp_t ref;
+static float ref_x[COURSE_MAX_POINTS], ref_y[COURSE_MAX_POINTS], ref_s[COURSE_MAX_POINTS];
+static uint32_t ref_count = 0;
+
+typedef struct {
+    unsigned long fixes;
+    unsigned long scanned;          // Fixes also matched by brute force
+    unsigned long compared;         // ... and within reach of the course
+    unsigned long differences;      // Matched elsewhere than the brute-force nearest
+    unsigned long leg_jumps;        // Tracked progress far from the boat's
+    double course_ns;
+    double brute_ns;
+    uint64_t candidates;
+    bool finished;
+    uint32_t finish_ms;
+    bool new_best;
+    bool have_half;
+    int32_t half_delta_ms;
+} row_result_t;
+
+static double now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static float gaussian(unsigned int *seed) {
+    float u1 = (rand_r(seed) + 1.0f) / (RAND_MAX + 2.0f);
+    float u2 = (rand_r(seed) + 1.0f) / (RAND_MAX + 2.0f);
+    return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+// ---- Course shapes ----
+static void add_point(float x, float y) {
+    shape_x[shape_count] = x;
+    shape_y[shape_count] = y;
+    shape_count++;
+}
+
+// Gentle S-bends (radius >= 160 m) in 0.5 m segments
+static void make_meander(uint32_t segments) {
+    float x = 0.0f, y = 0.0f;
+    shape_count = 0;
+    add_point(x, y);
+    for (uint32_t i = 1; i <= segments; i++) {
+        float heading = 0.6f * sinf(2.0f * (float)M_PI * (i * 0.5f) / 600.0f);
+        x += 0.5f * cosf(heading);
+        y += 0.5f * sinf(heading);
+        add_point(x, y);
+    }
+}
+
+// Legs of leg_m joined by half circles, lanes 2 * radius_m apart
+static void make_serpentine(uint32_t segments, float length_m, float leg_m, float radius_m) {
+    float period = leg_m + (float)M_PI * radius_m;
+    shape_count = 0;
+    for (uint32_t i = 0; i <= segments; i++) {
+        float s = length_m * i / segments;
+        uint32_t leg = (uint32_t)(s / period);
+        float r = s - leg * period;
+        float lane_y = 2.0f * radius_m * leg;
+        bool outward = leg % 2 == 0;
+        if (r < leg_m) {
+            add_point(outward ? r : leg_m - r, lane_y);
+        } else {
+            float phi = (r - leg_m) / radius_m;
+            float turn_x = outward ? leg_m + radius_m * sinf(phi) : -radius_m * sinf(phi);
+            add_point(turn_x, lane_y + radius_m - radius_m * cosf(phi));
+        }
+    }
+}
+
+static void make_straight(float length_m, float spacing_m) {
+    shape_count = 0;
+    for (float s = 0.0f; s < length_m + 0.5f * spacing_m; s += spacing_m) {
+        add_point(s, 0.4f * s);
+    }
+}
+
+static void to_e7(const geo_ltp_t *ltp, float x, float y, int32_t *lat_e7, int32_t *lon_e7) {
+    *lat_e7 = ltp->lat0_e7 + (int32_t)lroundf(y / ltp->north_m_per_e7);
+    *lon_e7 = ltp->lon0_e7 + (int32_t)lroundf(x / ltp->east_m_per_e7);
+}
+
+// Write the shape as a course file, and rebuild the polyline the engine will
+// see (same origin, same rounding) for the reference match
+static void write_course(const char *path) {
+    geo_ltp_t origin;
+    geo_ltp_init(&origin, ORIGIN_LAT_E7, ORIGIN_LON_E7);
+    FILE *f = fopen(path, "w");
+    fprintf(f, "# %lu points\n", (unsigned long)shape_count);
+    ref_count = 0;
+    for (uint32_t i = 0; i < shape_count; i++) {
+        int32_t lat_e7, lon_e7;
+        to_e7(&origin, shape_x[i], shape_y[i], &lat_e7, &lon_e7);
+        fprintf(f, "P %.7f %.7f\n", lat_e7 * 1e-7, lon_e7 * 1e-7);
+        if (i == 0) {
+            geo_ltp_init(&ref, lat_e7, lon_e7);
+        }
+        float x, y;
+        geo_ltp_project(&ref, lat_e7, lon_e7, &x, &y);
+        float step = ref_count > 0 ? hypotf(x - ref_x[ref_count - 1], y - ref_y[ref_count - 1]) : 0.0f;
+        if (ref_count > 0 && step < 0.01f) {
+            continue;
+        }
+        ref_x[ref_count] = x;
+        ref_y[ref_count] = y;
+        ref_s[ref_count] = ref_count > 0 ? ref_s[ref_count - 1] + step : 0.0f;
+        ref_count++;
+    }
+    fclose(f);
+}
+
+// ---- Reference ----
+// Point at progress s, the end segments continued straight on
+static void position_at(float s, float *x, float *y) {
+    uint32_t lo = 0, hi = ref_count - 1;
+    if (s <= 0.0f) {
+        hi = 1;
+    } else if (s >= ref_s[ref_count - 1]) {
+        lo = ref_count - 2;
+    } else {
+        while (hi - lo > 1) {
+            uint32_t mid = (lo + hi) / 2;
+            *(ref_s[mid] <= s ? &lo : &hi) = mid;
+        }
+    }
+    hi = lo + 1;
+    float t = (s - ref_s[lo]) / (ref_s[hi] - ref_s[lo]);
+    *x = ref_x[lo] + t * (ref_x[hi] - ref_x[lo]);
+    *y = ref_y[lo] + t * (ref_y[hi] - ref_y[lo]);
+}
+
+// Nearest point over every segment (end segments extended, as the engine does)
+static float brute_force(float x, float y, float *s_out) {
+    float best = INFINITY;
+    for (uint32_t i = 0; i + 1 < ref_count; i++) {
+        float dx = ref_x[i + 1] - ref_x[i];
+        float dy = ref_y[i + 1] - ref_y[i];
+        float length = ref_s[i + 1] - ref_s[i];
+        float px = x - ref_x[i];
+        float py = y - ref_y[i];
+        float t = (px * dx + py * dy) / (length * length);
+        if (t < 0.0f && i > 0) {
+            t = 0.0f;
+        } else if (t > 1.0f && i + 2 < ref_count) {
+            t = 1.0f;
+        }
+        float ex = px - t * dx;
+        float ey = py - t * dy;
+        float distance = sqrtf(ex * ex + ey * ey);
+        if (distance < best) {
+            best = distance;
+            *s_out = ref_s[i] + t * length;
+        }
+    }
+    return best;
+}
+
+static bool load(const char *ghost_path) {
+    esp_err_t err = course_load(COURSE_PATH, ghost_path);
+    CHECK(err == ESP_OK, "course_load: %s", esp_err_to_name(err));
+    return err == ESP_OK;
+}
+
+// ---- Rowing ----
+// Row from LEAD_IN_M before the start to as far past the finish. Every
+// compare_every-th fix is also matched by brute force (0: none).
+static void row(float speed_m_s, uint32_t period_ms, unsigned int seed, uint32_t compare_every, row_result_t *out) {
+    float length = ref_s[ref_count - 1];
+    float a = expf(-(period_ms * 1e-3f) / GPS_NOISE_TAU_S);
+    float noise_x = GPS_SIGMA_M * gaussian(&seed), noise_y = GPS_SIGMA_M * gaussian(&seed);
+    course_stats_t before;
+    course_get_stats(&before);
+    memset(out, 0, sizeof(*out));
+
+    for (uint32_t t_ms = 0;; t_ms += period_ms) {
+        float s_true = -LEAD_IN_M + speed_m_s * t_ms * 1e-3f;
+        if (s_true > length + LEAD_IN_M) {
+            break;
+        }
+        noise_x = a * noise_x + sqrtf(1.0f - a * a) * GPS_SIGMA_M * gaussian(&seed);
+        noise_y = a * noise_y + sqrtf(1.0f - a * a) * GPS_SIGMA_M * gaussian(&seed);
+        float x, y;
+        position_at(s_true, &x, &y);
+        x += noise_x;
+        y += noise_y;
+        int32_t lat_e7, lon_e7;
+        to_e7(&ref, x, y, &lat_e7, &lon_e7);
+
+        course_position_t position;
+        double start = now_ns();
+        course_event_t event = course_update(lat_e7, lon_e7, 1000000 + (timebase_us_t)t_ms * 1000, &position);
+        out->course_ns += now_ns() - start;
+        out->fixes++;
+
+        if (event == COURSE_EVENT_FINISH) {
+            course_result_t result;
+            out->finished = course_get_result(&result);
+            out->finish_ms = result.elapsed_ms;
+            out->new_best = result.new_best;
+        }
+        bool tracking = position.state == COURSE_TRACKING;
+        if (tracking && fabsf(position.progress_m - s_true) > COURSE_TRACK_WINDOW_M) {
+            out->leg_jumps++;
+        }
+        if (!out->have_half && position.running && position.has_ghost && position.progress_m >= 0.5f * length) {
+            out->have_half = true;
+            out->half_delta_ms = position.ghost_delta_ms;
+        }
+
+        if (compare_every > 0 && out->fixes % compare_every == 0) {
+            // Project the fix the way the engine does, then scan everything
+            float fx, fy, s = 0.0f;
+            geo_ltp_project(&ref, lat_e7, lon_e7, &fx, &fy);
+            start = now_ns();
+            float distance = brute_force(fx, fy, &s);
+            out->brute_ns += now_ns() - start;
+            out->scanned++;
+            if (distance <= COURSE_MATCH_RADIUS_M) {
+                out->compared++;
+                out->differences += !tracking || fabsf(position.progress_m - s) > SAME_MATCH_M;
+            }
+        }
+    }
+
+    course_stats_t after;
+    course_get_stats(&after);
+    out->candidates = after.candidates - before.candidates;
+}
+
+// Every seed at 1 and 10 Hz against the brute-force match (each fix at 1 Hz,
+// every tenth at 10 Hz), each run on a freshly loaded course
+static void benchmark(const char *name, unsigned long seeds, float speed_m_s, uint32_t max_candidates) {
+    write_course(COURSE_PATH);
+    course_stats_t stats = { 0 };
+    const uint32_t periods[] = { 1000, 100 };
+    for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        row_result_t total = { 0 };
+        unsigned long finished = 0;
+        for (unsigned long seed = 1; seed <= seeds; seed++) {
+            row_result_t r;
+            if (!load(NULL)) {
+                return;
+            }
+            course_get_stats(&stats);
+            row(speed_m_s, periods[p], (unsigned int)(seed * 7919 + p), periods[p] < 1000 ? 10 : 1, &r);
+            total.fixes += r.fixes;
+            total.scanned += r.scanned;
+            total.compared += r.compared;
+            total.differences += r.differences;
+            total.leg_jumps += r.leg_jumps;
+            total.course_ns += r.course_ns;
+            total.brute_ns += r.brute_ns;
+            total.candidates += r.candidates;
+            finished += r.finished;
+        }
+        double per_fix = (double)total.candidates / total.fixes;
+        printf("%s: %lu segments, %.0f m, grid %lu cells, %u bytes | %lu Hz: %.2f us/update (brute force %.1f us), "
+               "%.0f tests/update, %lu of %lu differ\n", name, (unsigned long)stats.points - 1, stats.length_m,
+               (unsigned long)stats.grid_cells, (unsigned)stats.memory_bytes, 1000 / (unsigned long)periods[p],
+               total.course_ns / total.fixes * 1e-3, total.brute_ns / total.scanned * 1e-3, per_fix,
+               total.differences, total.compared);
+        CHECK(total.differences == 0 && total.compared > total.scanned * 9 / 10, "%s: %lu of %lu matches differ",
+              name, total.differences, total.compared);
+        CHECK(total.leg_jumps == 0 && finished == seeds, "%s: %lu jumps, %lu of %lu finished", name,
+              total.leg_jumps, finished, seeds);
+        CHECK(per_fix <= max_candidates, "%s: %.0f segment tests per update", name, per_fix);
+        CHECK(total.course_ns / total.fixes * 5 < total.brute_ns / total.scanned, "%s: grid %.0f ns, brute force "
+              "%.0f ns per fix", name, total.course_ns / total.fixes, total.brute_ns / total.scanned);
+    }
+    course_unload();
+}
+
+// Finish times on courses where the nearest segment is not enough: lanes 30 m
+// apart on an out-and-back course
+static void out_and_back(unsigned long seeds) {
+    shape_count = 0;
+    for (int i = 0; i <= 1000; i++) {
+        add_point((float)i, 0.0f);
+    }
+    for (int i = 1; i < 48; i++) {
+        float phi = (float)M_PI * i / 48;
+        add_point(1000.0f + 15.0f * sinf(phi), 15.0f - 15.0f * cosf(phi));
+    }
+    for (int i = 1000; i >= 0; i--) {
+        add_point((float)i, 30.0f);
+    }
+    write_course(COURSE_PATH);
+
+    const float speed = 4.2f;
+    float exact_ms = ref_s[ref_count - 1] / speed * 1000.0f;
+    float worst_ms = 0.0f;
+    unsigned long jumps = 0, finished = 0;
+    for (unsigned long seed = 1; seed <= seeds; seed++) {
+        for (uint32_t period = 100; period <= 1000; period += 900) {
+            row_result_t r;
+            if (!load(NULL)) {
+                return;
+            }
+            row(speed, period, (unsigned int)seed * 31 + period, 0, &r);
+            jumps += r.leg_jumps;
+            finished += r.finished;
+            worst_ms = fmaxf(worst_ms, fabsf((float)r.finish_ms - exact_ms));
+        }
+    }
+    printf("out and back: finish within %.2f s of %.1f s, %lu leg jumps\n", worst_ms * 1e-3f, exact_ms * 1e-3f, jumps);
+    // Along-track noise at the start and the finish line: 0.85 s (sigma) together
+    CHECK(finished == 2 * seeds && jumps == 0 && worst_ms <= 3000.0f, "out and back: %lu finished, %lu jumps, "
+          "%.0f ms off", finished, jumps, worst_ms);
+    course_unload();
+}
+
+// A run becomes the ghost; a 5% faster run is ahead of it by the pace
+// difference half way; a slower one does not replace it
+static void ghost(void) {
+    make_straight(2000.0f, 5.0f);
+    write_course(COURSE_PATH);
+    remove(GHOST_PATH);
+    if (!load(GHOST_PATH)) {
+        return;
+    }
+    row_result_t first, faster, slower;
+    row(4.0f, 100, 11, 0, &first);
+    CHECK(first.finished && first.new_best && course_save_ghost(GHOST_PATH) == ESP_OK, "first run saved");
+
+    if (!load(GHOST_PATH)) {
+        return;
+    }
+    row(4.2f, 100, 12, 0, &faster);
+    float length = ref_s[ref_count - 1];
+    float expected_ms = (0.5f * length / 4.2f - 0.5f * length / 4.0f) * 1000.0f;
+    printf("ghost: %.1f s behind half way (expected %.1f s)\n", faster.half_delta_ms * 1e-3f, expected_ms * 1e-3f);
+    // GPS noise at the start line in both runs and here: about 1 s each (sigma)
+    CHECK(faster.have_half && fabsf(faster.half_delta_ms - expected_ms) < 3000.0f, "half way delta %d ms",
+          (int)faster.half_delta_ms);
+    CHECK(faster.finished && faster.new_best, "faster run is the new ghost");
+    row(3.8f, 100, 13, 0, &slower);
+    CHECK(slower.finished && !slower.new_best, "slower run kept the ghost");
+
+    // A ghost recorded on another course is ignored
+    make_straight(1500.0f, 5.0f);
+    write_course(COURSE_PATH);
+    unsigned long warnings = host_log_count(ESP_LOG_WARN);
+    CHECK(load(GHOST_PATH) && host_log_count(ESP_LOG_WARN) == warnings + 1, "ghost of another course accepted");
+    course_unload();
+}
+
+int main(void) {
+    host_log_set_level(ESP_LOG_ERROR);
+    unsigned long seeds = test_env_ul("COURSE_BENCH_SEEDS", 2);
+
+    make_meander(12000);
+    benchmark("meander", seeds, 4.5f, 1000);
+    make_serpentine(16000, 84000.0f, 2000.0f, 100.0f);
+    benchmark("serpentine", seeds, 5.0f, 200);
+    if (test_failures > 0) {
+        return test_report("test_course");
+    }
+    out_and_back(seeds);
+    ghost();
+    return test_report("test_course");
+}
@@ -0,0 +1,158 @@
+// Data bus fan-out at the IMU rate: one topic at the nominal depth, 1 to 8
+// subscriber tasks each woken through batch_notify at the DSP watermark, 1 kHz
+// publishing on the virtual clock. Every subscriber must see every item in order
+// with its lag well inside the ring. A second topic carries a subscriber that
+// reads far less often than the ring turns over: it must be lapped, the loss
+// must match the gap in what it read and be reported, and its fast neighbour on
+// the same topic must lose nothing. Publish cost per subscriber count is printed.
+#include <string.h>
+#include <time.h>
+#include "data_bus.h"
+#include "batch_notify.h"
+#include "config/common_constants.h"
+#include "sensors/sensors_common.h"
+#include "test_support.h"
+
+#define STEP_MS         2000
+#define SLOW_PERIOD_MS  300     // Over two rings at 1 kHz
+
+typedef struct {
+    bus_subscriber_t *subscriber;
+    uint32_t poll_ms;           // 0: woken by the watermark
+    uint32_t next_seq;
+    uint32_t received;
+    uint32_t missing;           // Sequence numbers skipped
+    uint32_t disorder;          // Sequence numbers repeated or out of order
+    uint32_t max_lag;           // Items waiting at a wakeup
+} reader_t;
+
+static const char *reader_names[BUS_MAX_SUBSCRIBERS] = { "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8" };
+static reader_t readers[BUS_MAX_SUBSCRIBERS];
+static reader_t fast_reader;
+static reader_t slow_reader;
+
+static void reader_task(void *arg) {
+    reader_t *r = arg;
+    while (1) {
+        if (r->poll_ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(r->poll_ms));
+        } else {
+            batch_notify_wait(DSP_MAX_LATENCY_MS);
+        }
+        bus_subscriber_stats_t stats;
+        bus_get_subscriber_stats(r->subscriber, &stats);
+        if (stats.lag > r->max_lag) {
+            r->max_lag = stats.lag;
+        }
+
+        imu_data_t item;
+        while (bus_receive(r->subscriber, &item)) {
+            uint32_t seq = (uint32_t)item.timestamp_us;
+            if (seq < r->next_seq) {
+                r->disorder++;
+            } else {
+                r->missing += seq - r->next_seq;
+            }
+            r->next_seq = seq + 1;
+            r->received++;
+        }
+    }
+}
+
+static void start_reader(reader_t *r, bus_topic_t *topic, const char *name, uint32_t poll_ms) {
+    memset(r, 0, sizeof(*r));
+    r->poll_ms = poll_ms;
+    r->next_seq = bus_topic_published(topic);   // Items are numbered from 0 in publish order
+    TaskHandle_t task = host_task_create(reader_task, name, r);
+    r->subscriber = bus_subscribe(topic, name, poll_ms > 0 ? NULL : task, IMU_BATCH_WATERMARK);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// One item per millisecond; returns the wall-clock cost of the publishes alone
+static double publish_for(bus_topic_t *topic, uint32_t duration_ms, uint32_t *seq) {
+    double publish_ns = 0.0;
+    for (uint32_t ms = 0; ms < duration_ms; ms++) {
+        imu_data_t item = { .timestamp_us = (*seq)++, .accel_z = 1.0f };
+        double start = now_ns();
+        bus_publish(topic, &item, false);
+        publish_ns += now_ns() - start;
+        host_advance_ms(1);
+    }
+    host_advance_ms(DSP_MAX_LATENCY_MS);   // Readers collect the tail of the batch
+    return publish_ns;
+}
+
+int main(void) {
+    host_set_time_us(1000000);
+
+    // Sweep: one more subscriber per step on the same topic
+    bus_topic_t *imu = bus_topic_create("imu", sizeof(imu_data_t), IMU_TOPIC_DEPTH);
+    REQUIRE(imu != NULL, "topic");
+    uint32_t seq = 0;
+    printf("%u-item topic, 1 kHz, watermark %u, max latency %u ms\n", (unsigned)IMU_TOPIC_DEPTH,
+           (unsigned)IMU_BATCH_WATERMARK, (unsigned)DSP_MAX_LATENCY_MS);
+    for (int n = 1; n <= BUS_MAX_SUBSCRIBERS; n++) {
+        start_reader(&readers[n - 1], imu, reader_names[n - 1], 0);
+        REQUIRE(readers[n - 1].subscriber != NULL, "subscriber %d", n);
+        uint32_t first_seq = seq;
+        for (int i = 0; i < n; i++) {
+            readers[i].max_lag = 0;
+        }
+        double publish_ns = publish_for(imu, STEP_MS, &seq);
+
+        printf("%d subscribers: publish %.0f ns/item |", n, publish_ns / STEP_MS);
+        for (int i = 0; i < n; i++) {
+            bus_subscriber_stats_t stats;
+            bus_get_subscriber_stats(readers[i].subscriber, &stats);
+            printf(" %s lag %u drop %u", reader_names[i], readers[i].max_lag, stats.dropped);
+            CHECK(stats.dropped == 0 && readers[i].missing == 0 && readers[i].disorder == 0,
+                  "%d subscribers: %s dropped %u, missed %u, %u out of order", n, reader_names[i], stats.dropped,
+                  readers[i].missing, readers[i].disorder);
+            CHECK(readers[i].next_seq == seq && stats.lag == 0, "%d subscribers: %s at %u of %u, lag %u", n,
+                  reader_names[i], readers[i].next_seq, seq, stats.lag);
+            CHECK(readers[i].max_lag <= IMU_TOPIC_DEPTH / 4, "%d subscribers: %s lag %u of a %u ring", n,
+                  reader_names[i], readers[i].max_lag, (unsigned)IMU_TOPIC_DEPTH);
+        }
+        printf("\n");
+        CHECK(readers[n - 1].received == seq - first_seq, "%d subscribers: newest received %u of %u", n,
+              readers[n - 1].received, seq - first_seq);
+    }
+
+    // A subscriber that reads every SLOW_PERIOD_MS is lapped; its neighbour is not
+    bus_topic_t *lapped = bus_topic_create("lapped", sizeof(imu_data_t), IMU_TOPIC_DEPTH);
+    REQUIRE(lapped != NULL, "second topic");
+    start_reader(&fast_reader, lapped, "fast", 0);
+    start_reader(&slow_reader, lapped, "slow", SLOW_PERIOD_MS);
+    uint32_t lapped_seq = 0;
+    publish_for(lapped, 10 * SLOW_PERIOD_MS, &lapped_seq);
+    host_advance_ms(SLOW_PERIOD_MS);
+
+    bus_subscriber_stats_t fast, slow;
+    bus_get_subscriber_stats(fast_reader.subscriber, &fast);
+    bus_get_subscriber_stats(slow_reader.subscriber, &slow);
+    printf("lapped: fast lag %u drop %u | slow lag %u drop %u, received %u of %u\n", fast_reader.max_lag,
+           fast.dropped, slow_reader.max_lag, slow.dropped, slow_reader.received, lapped_seq);
+    CHECK(fast.dropped == 0 && fast_reader.missing == 0 && fast_reader.received == lapped_seq,
+          "fast neighbour lost %u", fast.dropped);
+    CHECK(slow.dropped > 0 && slow.dropped == slow_reader.missing, "slow: %u dropped, %u missing from what it read",
+          slow.dropped, slow_reader.missing);
+    CHECK(slow_reader.disorder == 0 && slow_reader.received + slow.dropped == lapped_seq,
+          "slow: %u received + %u dropped of %u, %u out of order", slow_reader.received, slow.dropped, lapped_seq,
+          slow_reader.disorder);
+    CHECK(slow_reader.max_lag >= IMU_TOPIC_DEPTH, "slow lag %u never passed the ring", slow_reader.max_lag);
+
+    unsigned long info_before = host_log_count(ESP_LOG_INFO);
+    bus_log_stats();
+    CHECK(host_log_count(ESP_LOG_INFO) == info_before + 1, "the lapped subscriber is reported once, %lu lines",
+          host_log_count(ESP_LOG_INFO) - info_before);
+    info_before = host_log_count(ESP_LOG_INFO);
+    bus_log_stats();
+    CHECK(host_log_count(ESP_LOG_INFO) == info_before, "old drops reported again");
+
+    return test_report("test_data_bus");
+}
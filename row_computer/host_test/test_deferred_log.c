@@ -0,0 +1,234 @@
+// Deferred log under load. Cost: a stored DLOG call, a rate-limited one, and
+// the consumer's formatting per record. Multi-producer: DLOG_PRODUCERS threads
+// write numbered records from their own callsites while one consumer thread
+// formats, first with the consumer keeping up (nothing dropped, the ring never
+// full), then with it stalling (drops). Every line must come out in producer
+// order, each gap in the numbering matching the suppressed count the line
+// carries; written + dropped must equal the calls made, and high_water must
+// stay within the ring and reach it when records were dropped.
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "deferred_log.h"
+#include "config/common_constants.h"
+#include "test_support.h"
+
+#define DLOG_PRODUCERS  4
+#define COST_CALLS      200000
+
+static const char *TAG = "TEST";
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// ---- Lines as the consumer prints them ----
+
+static bool capture_lines = false;
+static uint32_t lines[DLOG_PRODUCERS];
+static uint32_t last_index[DLOG_PRODUCERS];
+static uint32_t suppressed_reported = 0;
+static uint32_t order_errors = 0;
+static uint32_t gap_errors = 0;
+
+static bool log_hook(esp_log_level_t level, const char *tag, const char *format, va_list args) {
+    if (!capture_lines || strcmp(tag, TAG) != 0) {
+        return true;
+    }
+    char line[DLOG_LINE_MAX + 64];
+    vsnprintf(line, sizeof(line), format, args);
+
+    unsigned producer = 0, index = 0;
+    unsigned long suppressed = 0;
+    const char *body = strstr(line, "producer ");
+    if (body == NULL || sscanf(body, "producer %u record %u", &producer, &index) != 2 ||
+        producer >= DLOG_PRODUCERS) {
+        order_errors++;
+        return false;
+    }
+    const char *extra = strstr(line, "(+");
+    if (extra != NULL) {
+        sscanf(extra, "(+%lu suppressed)", &suppressed);
+    }
+
+    // Records of one producer keep their order; a gap is exactly what was suppressed
+    uint32_t expected = lines[producer] == 0 ? 0 : last_index[producer] + 1;
+    if (index < expected) {
+        order_errors++;
+    } else if (index - expected != suppressed) {
+        gap_errors++;
+    }
+    lines[producer]++;
+    last_index[producer] = index;
+    suppressed_reported += (uint32_t)suppressed;
+    return false;
+}
+
+// ---- Producers ----
+
+typedef struct {
+    uint32_t id;
+    uint32_t records;
+    uint32_t pause_every;       // Yield after this many records (0: never)
+} producer_t;
+
+static volatile bool consumer_stop = false;
+static volatile bool consumer_stall = false;
+
+// One callsite per producer: a site's suppressed count belongs to one writer
+static void write_record(uint32_t id, uint32_t index) {
+    switch (id) {
+        case 0: DLOGI(TAG, "producer %u record %u (%.2f)", (unsigned)id, (unsigned)index, index * 0.5f); break;
+        case 1: DLOGI(TAG, "producer %u record %u (%.2f)", (unsigned)id, (unsigned)index, index * 0.5f); break;
+        case 2: DLOGI(TAG, "producer %u record %u (%.2f)", (unsigned)id, (unsigned)index, index * 0.5f); break;
+        default: DLOGI(TAG, "producer %u record %u (%.2f)", (unsigned)id, (unsigned)index, index * 0.5f); break;
+    }
+}
+
+static void *producer_thread(void *arg) {
+    producer_t *p = arg;
+    for (uint32_t i = 0; i < p->records; i++) {
+        write_record(p->id, i);
+        if (p->pause_every > 0 && i % p->pause_every == p->pause_every - 1) {
+            struct timespec pause = { 0, 20000 };
+            nanosleep(&pause, NULL);
+        }
+    }
+    return NULL;
+}
+
+static void *consumer_thread(void *arg) {
+    while (!consumer_stop) {
+        if (consumer_stall) {
+            struct timespec pause = { 0, 2000000 };
+            nanosleep(&pause, NULL);
+        }
+        deferred_log_flush();
+    }
+    return NULL;
+}
+
+static void reset_lines(void) {
+    memset(lines, 0, sizeof(lines));
+    memset(last_index, 0, sizeof(last_index));
+    suppressed_reported = order_errors = gap_errors = 0;
+}
+
+// Producers race each other and the consumer; then the consumer drains and every
+// producer writes one last record so its pending suppressed count is reported
+static void run_load(const char *name, uint32_t records, uint32_t pause_every, bool stall,
+                     deferred_log_stats_t *out) {
+    deferred_log_stats_t before;
+    deferred_log_get_stats(&before);
+    reset_lines();
+    consumer_stop = false;
+    consumer_stall = stall;
+
+    pthread_t consumer, producers[DLOG_PRODUCERS];
+    producer_t args[DLOG_PRODUCERS];
+    pthread_create(&consumer, NULL, consumer_thread, NULL);
+    double start = now_ns();
+    for (uint32_t i = 0; i < DLOG_PRODUCERS; i++) {
+        args[i] = (producer_t){ .id = i, .records = records, .pause_every = pause_every };
+        pthread_create(&producers[i], NULL, producer_thread, &args[i]);
+    }
+    for (uint32_t i = 0; i < DLOG_PRODUCERS; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    double elapsed = now_ns() - start;
+    consumer_stop = true;
+    pthread_join(consumer, NULL);
+    deferred_log_flush();
+    for (uint32_t i = 0; i < DLOG_PRODUCERS; i++) {
+        write_record(i, records);
+    }
+    deferred_log_flush();
+
+    deferred_log_stats_t after;
+    deferred_log_get_stats(&after);
+    out->written = after.written - before.written;
+    out->formatted = after.formatted - before.formatted;
+    out->dropped = after.dropped - before.dropped;
+    out->high_water = after.high_water;
+    uint32_t calls = DLOG_PRODUCERS * (records + 1);
+    uint32_t printed = 0;
+    for (uint32_t i = 0; i < DLOG_PRODUCERS; i++) {
+        printed += lines[i];
+        CHECK(lines[i] > 0 && last_index[i] == records, "%s: producer %u ended at record %u of %u", name, i,
+              last_index[i], records);
+    }
+    printf("%s: %u producers x %u records in %.1f ms: %u written, %u dropped, high water %u/%u\n", name,
+           DLOG_PRODUCERS, records + 1, elapsed / 1e6, out->written, out->dropped, out->high_water,
+           (unsigned)DLOG_RING_RECORDS);
+
+    CHECK(out->written + out->dropped == calls, "%s: %u written + %u dropped of %u calls", name, out->written,
+          out->dropped, calls);
+    CHECK(out->formatted == out->written && printed == out->written, "%s: %u written, %u formatted, %u printed",
+          name, out->written, out->formatted, printed);
+    CHECK(order_errors == 0 && gap_errors == 0, "%s: %u lines out of order, %u gaps not matching their count",
+          name, order_errors, gap_errors);
+    CHECK(suppressed_reported == out->dropped, "%s: %u reported suppressed, %u dropped", name,
+          suppressed_reported, out->dropped);
+    CHECK(out->high_water <= DLOG_RING_RECORDS, "%s: high water %u over a %u ring", name, out->high_water,
+          (unsigned)DLOG_RING_RECORDS);
+}
+
+int main(void) {
+    host_log_set_hook(log_hook);
+    REQUIRE(deferred_log_init() == ESP_OK, "ring");
+
+    // Cost of a stored call (flushed between timed bursts so the ring never fills)
+    double store_ns = 0.0;
+    for (uint32_t done = 0; done < COST_CALLS; done += DLOG_RING_RECORDS / 2) {
+        double start = now_ns();
+        for (uint32_t i = 0; i < DLOG_RING_RECORDS / 2; i++) {
+            DLOGI(TAG, "cost %u %d %.3f", (unsigned)i, -(int)done, i * 0.25f);
+        }
+        store_ns += now_ns() - start;
+        deferred_log_flush();
+    }
+    // Formatting on the consumer side, per record
+    double format_ns = 0.0;
+    for (uint32_t done = 0; done < COST_CALLS / 10; done += DLOG_RING_RECORDS / 2) {
+        for (uint32_t i = 0; i < DLOG_RING_RECORDS / 2; i++) {
+            DLOGI(TAG, "cost %u %d %.3f", (unsigned)i, -(int)done, i * 0.25f);
+        }
+        double start = now_ns();
+        deferred_log_flush();
+        format_ns += now_ns() - start;
+    }
+    // A rate-limited callsite inside its interval: the clock does not move
+    double limited_ns = 0.0;
+    {
+        double start = now_ns();
+        for (uint32_t i = 0; i < COST_CALLS; i++) {
+            DLOG_RATE(ESP_LOG_WARN, TAG, DLOG_WARN_INTERVAL_MS, "limited %u", (unsigned)i);
+        }
+        limited_ns = now_ns() - start;
+        deferred_log_flush();
+    }
+    printf("cost: %.0f ns per stored call (3 args), %.0f ns per rate-limited call, %.0f ns to format a record\n",
+           store_ns / COST_CALLS, limited_ns / COST_CALLS, format_ns / (COST_CALLS / 10));
+
+    deferred_log_stats_t stats;
+    deferred_log_get_stats(&stats);
+    CHECK(stats.dropped == 0 && stats.formatted == stats.written, "cost runs: %u dropped, %u of %u formatted",
+          stats.dropped, stats.formatted, stats.written);
+
+    // Consumer keeping up: producers pause briefly every few records
+    capture_lines = true;
+    uint32_t records = (uint32_t)test_env_ul("DLOG_RECORDS", 20000);
+    run_load("paced", records / 10, 4, false, &stats);
+    CHECK(stats.dropped == 0 && stats.high_water < DLOG_RING_RECORDS, "paced: %u dropped, high water %u",
+          stats.dropped, stats.high_water);
+
+    // Consumer stalling between flushes: the ring fills, drops are counted and reported
+    run_load("stalled", records, 4, true, &stats);
+    CHECK(stats.dropped > 0 && stats.high_water == DLOG_RING_RECORDS, "stalled: %u dropped, high water %u",
+          stats.dropped, stats.high_water);
+
+    return test_report("test_deferred_log");
+}
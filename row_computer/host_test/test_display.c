@@ -0,0 +1,162 @@
+// Display rendering through the PBM file backend: a fixed 40-frame piece
+// (standing start, rate changes, a course run, a ghost ahead and behind). The
+// backend is wrapped so a shadow panel receives only the dirty rectangles; at
+// every present it must equal the framebuffer, so nothing changed is left
+// unsent. The last frame written must match the golden image byte for byte
+// (DISPLAY_GOLDEN; DISPLAY_GOLDEN_UPDATE=1 rewrites it after a deliberate layout
+// change). The cost per frame of render + flush is printed for a longer run
+// without the file writes (DISPLAY_FRAMES).
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "display.h"
+#include "test_support.h"
+
+#define PIECE_FRAMES    40
+#define PBM_HEADER_MAX  16
+
+// ---- Shadow panel: what the dirty rectangles delivered ----
+static uint8_t panel[DISPLAY_FB_SIZE];
+static uint32_t presents = 0;
+static uint32_t stale_frames = 0;
+
+static esp_err_t shadow_init(void) {
+    memset(panel, 0, sizeof(panel));
+    return display_backend_file.init();
+}
+
+static esp_err_t shadow_flush(const uint8_t *fb, const display_rect_t *rect, size_t *bytes_sent) {
+    for (uint16_t row = rect->y; row < rect->y + rect->h; row++) {
+        size_t offset = (size_t)row * DISPLAY_FB_STRIDE + rect->x / 8;
+        memcpy(&panel[offset], &fb[offset], (rect->w + 7) / 8);
+    }
+    return display_backend_file.flush(fb, rect, bytes_sent);
+}
+
+static esp_err_t shadow_present(const uint8_t *fb) {
+    presents++;
+    stale_frames += memcmp(panel, fb, DISPLAY_FB_SIZE) != 0;
+    return display_backend_file.present(fb);
+}
+
+static const display_backend_t shadow_backend = {
+    .name = "shadow-pbm",
+    .init = shadow_init,
+    .flush = shadow_flush,
+    .present = shadow_present,
+};
+
+// The same without the file write, for the timing
+static esp_err_t timed_present(const uint8_t *fb) {
+    presents++;
+    stale_frames += memcmp(panel, fb, DISPLAY_FB_SIZE) != 0;
+    return ESP_OK;
+}
+
+static const display_backend_t timed_backend = {
+    .name = "shadow",
+    .init = shadow_init,
+    .flush = shadow_flush,
+    .present = timed_present,
+};
+
+// Frame n of the piece
+static display_metrics_t piece(uint32_t n) {
+    display_metrics_t m = { 0 };
+    if (n >= 3) {                                   // Standing start: nothing for three frames
+        m.split_ds = 1125 + (n % 7) * 3;
+        m.stroke_rate_spm = (uint16_t)(28 + n % 5);
+    }
+    m.distance_m = n * 4;
+    if (n >= 20) {
+        m.course_active = true;
+        m.course_remaining_m = 1000 - (n - 20) * 4;
+    }
+    if (n >= 25) {
+        m.has_ghost = true;
+        m.ghost_delta_ds = ((int32_t)n - 32) * 7;   // Ahead, level, then behind
+    }
+    return m;
+}
+
+static size_t read_file(const char *path, uint8_t *buffer, size_t size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return 0;
+    }
+    size_t length = fread(buffer, 1, size, f);
+    fclose(f);
+    return length;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void) {
+    REQUIRE(display_init(&shadow_backend) == ESP_OK, "init");
+    display_stats_t stats;
+    display_get_stats(&stats);
+    CHECK(stats.last_update_bytes == DISPLAY_FB_SIZE, "layout frame sent %u of %u bytes", stats.last_update_bytes,
+          (unsigned)DISPLAY_FB_SIZE);
+
+    // The piece, one PBM per frame that changed
+    uint32_t changed = 0;
+    for (uint32_t n = 0; n < PIECE_FRAMES; n++) {
+        display_metrics_t m = piece(n);
+        changed += display_render(&m) > 0;
+        CHECK(display_flush() == ESP_OK, "frame %u flush", n);
+    }
+    display_get_stats(&stats);
+    printf("piece: %u frames, %u changed, %u rectangles, %.0f bytes per frame after the layout\n", PIECE_FRAMES,
+           changed, stats.updates, (double)(stats.bytes_pushed - DISPLAY_FB_SIZE) / (stats.frames - 1));
+    CHECK(stale_frames == 0, "%u of %u frames left changed pixels unsent", stale_frames, presents);
+    CHECK(stats.frames == changed + 1 && presents == stats.frames && stats.flush_errors == 0,
+          "%u frames presented, %u changed, %u flush errors", presents, changed, stats.flush_errors);
+    CHECK(stats.bytes_pushed - DISPLAY_FB_SIZE < (uint64_t)changed * DISPLAY_FB_SIZE / 4,
+          "updates sent %llu bytes - partial updates should be far below whole frames",
+          (unsigned long long)(stats.bytes_pushed - DISPLAY_FB_SIZE));
+
+    // Golden image: the last frame written
+    static uint8_t output[DISPLAY_FB_SIZE + PBM_HEADER_MAX], golden[DISPLAY_FB_SIZE + PBM_HEADER_MAX];
+    char path[64];
+    snprintf(path, sizeof(path), "%s%05lu.pbm", DISPLAY_FILE_PREFIX, (unsigned long)(stats.frames - 1));
+    size_t output_length = read_file(path, output, sizeof(output));
+    REQUIRE(output_length > DISPLAY_FB_SIZE, "%s not written", path);
+    if (test_env_ul("DISPLAY_GOLDEN_UPDATE", 0) != 0) {
+        FILE *f = fopen(DISPLAY_GOLDEN, "wb");
+        REQUIRE(f != NULL && fwrite(output, 1, output_length, f) == output_length, "writing %s", DISPLAY_GOLDEN);
+        fclose(f);
+        printf("golden image rewritten from %s\n", path);
+    }
+    size_t golden_length = read_file(DISPLAY_GOLDEN, golden, sizeof(golden));
+    size_t differing = 0;
+    for (size_t i = 0; i < output_length && i < golden_length; i++) {
+        differing += output[i] != golden[i];
+    }
+    CHECK(golden_length == output_length && differing == 0, "%s: %zu of %zu bytes differ from %s (%zu bytes)",
+          path, differing, output_length, DISPLAY_GOLDEN, golden_length);
+
+    // Cost: render + flush of every frame, the piece on repeat
+    REQUIRE(display_init(&timed_backend) == ESP_OK, "timed init");
+    uint32_t frames = (uint32_t)test_env_ul("DISPLAY_FRAMES", 20000);
+    presents = stale_frames = 0;
+    double start = now_ns();
+    for (uint32_t n = 0; n < frames; n++) {
+        display_metrics_t m = piece(PIECE_FRAMES / 2 + n % (PIECE_FRAMES / 2));
+        m.distance_m += n / (PIECE_FRAMES / 2) * 80;
+        display_render(&m);
+        display_flush();
+    }
+    double elapsed = now_ns() - start;
+    display_stats_t timed;
+    display_get_stats(&timed);
+    printf("cost: %.1f us per frame (render + flush of %.0f bytes in %.1f rectangles) over %u frames\n",
+           elapsed / frames / 1000.0, (double)(timed.bytes_pushed - DISPLAY_FB_SIZE) / frames,
+           (double)(timed.updates - 1) / frames, frames);
+    CHECK(stale_frames == 0, "timed run: %u of %u frames left changed pixels unsent", stale_frames, presents);
+
+    return test_report("test_display");
+}
@@ -0,0 +1,264 @@
+// Event capture ring driven by hand: a numbered sample stream, triggers that
+// overlap, touch, follow each other and pile up behind an open window, a live
+// consumer releasing in small pieces and one that stalls. Every window must
+// stream as one contiguous run of sequence numbers, each sample exactly once and
+// holding the sample pushed at that point; refused samples must be counted and
+// mark the window they cut.
+#include <string.h>
+#include "event_capture.h"
+#include "test_support.h"
+
+#define RING        256
+#define MAX_WINDOWS 64
+#define MAX_SEQ     (1 << 16)
+
+typedef struct {
+    capture_window_t w;     // As last peeked: the end and the flag may move
+    uint32_t streamed;
+} seen_window_t;
+
+static uint32_t pushed = 0;             // Samples offered, refused ones included
+static uint32_t head_seq = 0;
+static uint32_t seq_index[MAX_SEQ];     // Push number held by each sequence number
+
+static seen_window_t seen[MAX_WINDOWS];
+static int seen_count = 0;
+static uint32_t last_seq = 0;
+static uint32_t content_errors = 0;
+
+static void reset(uint32_t pre, uint32_t post) {
+    CHECK(event_capture_init(RING, pre, post) == ESP_OK, "init %u + %u", pre, post);
+    head_seq = 0;
+    seen_count = 0;
+    content_errors = 0;
+}
+
+// The push number rides in the sample (15 bits per axis) and in its stamp. The
+// gyro axes stay at zero, so the crab threshold never fires.
+static void push(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        mpu6050_raw_t raw = { .v = { (int16_t)(pushed & 0x7fff), (int16_t)(pushed >> 15), 16384 } };
+        capture_stats_t before, after;
+        event_capture_get_stats(&before);
+        event_capture_push(&raw, (timebase_us_t)pushed * 1000);
+        event_capture_get_stats(&after);
+        if (after.samples != before.samples && head_seq < MAX_SEQ) {
+            seq_index[head_seq++] = pushed;
+        }
+        pushed++;
+    }
+}
+
+static void trigger(capture_trigger_t trigger) {
+    event_capture_trigger(trigger, (timebase_us_t)pushed * 1000);
+}
+
+// Stream up to limit samples (0: all that are ready), checking each run as it comes
+static uint32_t drain(uint32_t limit) {
+    const capture_sample_t *samples;
+    uint32_t first_seq;
+    capture_window_t window;
+    size_t count;
+    uint32_t total = 0;
+
+    while ((limit == 0 || total < limit) && (count = event_capture_peek(&samples, &first_seq, &window)) > 0) {
+        if (limit != 0 && count > limit - total) {
+            count = limit - total;
+        }
+        seen_window_t *s = seen_count > 0 ? &seen[seen_count - 1] : NULL;
+        if (s == NULL || s->w.id != window.id) {
+            CHECK(first_seq == window.first_seq, "window %u starts at %u, not %u", window.id, first_seq,
+                  window.first_seq);
+            CHECK(s == NULL || window.first_seq >= s->w.end_seq, "window %u from %u repeats window %u to %u",
+                  window.id, window.first_seq, s->w.id, s->w.end_seq);
+            if (seen_count == MAX_WINDOWS) {
+                CHECK(false, "more than %d windows", MAX_WINDOWS);
+                return total;
+            }
+            s = &seen[seen_count++];
+            s->streamed = 0;
+        } else {
+            CHECK(first_seq == last_seq + 1, "window %u: %u streamed after %u", window.id, first_seq, last_seq);
+        }
+        s->w = window;
+
+        for (size_t i = 0; i < count; i++) {
+            uint32_t index = (uint32_t)samples[i].v[0] | (uint32_t)samples[i].v[1] << 15;
+            content_errors += index != seq_index[first_seq + i] || samples[i].timestamp_ms != (uint16_t)index;
+        }
+        last_seq = first_seq + (uint32_t)count - 1;
+        s->streamed += (uint32_t)count;
+        event_capture_release(count);
+        total += (uint32_t)count;
+    }
+    return total;
+}
+
+// Everything drained: each window streamed whole, stats agree with what was seen
+static void finish(const char *name, int windows, uint32_t retriggers, uint32_t dropped) {
+    drain(0);
+    capture_stats_t stats;
+    event_capture_get_stats(&stats);
+    CHECK(!event_capture_window_open(), "%s: window left open", name);
+    CHECK(seen_count == windows && stats.windows == (uint32_t)windows, "%s: %d windows streamed, %u opened, %d expected",
+          name, seen_count, stats.windows, windows);
+    CHECK(stats.retriggers == retriggers && stats.dropped == dropped, "%s: %u merged, %u dropped", name,
+          stats.retriggers, stats.dropped);
+    uint32_t total = 0;
+    for (int i = 0; i < seen_count; i++) {
+        CHECK(seen[i].streamed == seen[i].w.end_seq - seen[i].w.first_seq, "%s: window %u streamed %u of %u..%u",
+              name, seen[i].w.id, seen[i].streamed, seen[i].w.first_seq, seen[i].w.end_seq);
+        total += seen[i].streamed;
+    }
+    CHECK(stats.streamed == total, "%s: %u streamed, %u seen", name, stats.streamed, total);
+    CHECK(content_errors == 0, "%s: %u samples out of place", name, content_errors);
+}
+
+int main(void) {
+    REQUIRE(event_capture_init(RING, 32, 48) == ESP_OK, "init");
+    REQUIRE(event_capture_init(RING, 200, 56) == ESP_ERR_INVALID_ARG, "window must leave room");
+
+    // One trigger: the pre-trigger history and the samples after it
+    reset(32, 48);
+    push(100);
+    trigger(CAPTURE_TRIGGER_MANUAL);
+    push(60);
+    finish("single", 1, 0, 0);
+    CHECK(seen[0].w.first_seq == 68 && seen[0].w.end_seq == 148 && seen[0].w.trigger == CAPTURE_TRIGGER_MANUAL,
+          "single: %u..%u", seen[0].w.first_seq, seen[0].w.end_seq);
+
+    // Overlapping, back-to-back and touching triggers extend the window
+    reset(32, 48);
+    push(100);
+    trigger(CAPTURE_TRIGGER_STROKE);
+    push(20);
+    trigger(CAPTURE_TRIGGER_THRESHOLD);         // Overlaps
+    trigger(CAPTURE_TRIGGER_MANUAL);            // Same sample
+    push(1);
+    trigger(CAPTURE_TRIGGER_STROKE);            // Next sample
+    push(80);                                   // End at 169: head 201 starts exactly there
+    trigger(CAPTURE_TRIGGER_STROKE);
+    push(60);
+    finish("overlapping", 1, 4, 0);
+    CHECK(seen[0].w.first_seq == 68 && seen[0].w.end_seq == 249 && seen[0].w.trigger == CAPTURE_TRIGGER_STROKE,
+          "overlapping: %u..%u", seen[0].w.first_seq, seen[0].w.end_seq);
+
+    // One sample past touching opens a second window right behind the first
+    reset(32, 48);
+    push(100);
+    trigger(CAPTURE_TRIGGER_STROKE);
+    push(81);
+    trigger(CAPTURE_TRIGGER_STROKE);
+    push(60);
+    finish("adjacent", 2, 0, 0);
+    CHECK(seen_count == 2 && seen[1].w.first_seq == seen[0].w.end_seq + 1, "adjacent: second window at %u",
+          seen[1].w.first_seq);
+
+    // A streamed window is not streamed again: the next one starts after it
+    reset(32, 48);
+    push(100);
+    trigger(CAPTURE_TRIGGER_STROKE);
+    push(48);
+    drain(0);
+    push(10);
+    trigger(CAPTURE_TRIGGER_STROKE);
+    push(60);
+    finish("after a closed window", 2, 0, 0);
+    CHECK(seen_count == 2 && seen[1].w.first_seq == seen[0].w.end_seq, "closed: second window at %u",
+          seen[1].w.first_seq);
+
+    // Triggers pile up behind an undrained window: one waits (and is extended),
+    // a later one is dropped and the waiting one keeps its own trigger
+    reset(32, 48);
+    push(100);
+    trigger(CAPTURE_TRIGGER_STROKE);
+    push(90);
+    trigger(CAPTURE_TRIGGER_MANUAL);
+    push(10);
+    trigger(CAPTURE_TRIGGER_STROKE);            // Extends the waiting window
+    push(90);
+    trigger(CAPTURE_TRIGGER_THRESHOLD);         // Past both: dropped
+    finish("pile-up", 2, 1, 1);
+    CHECK(seen_count == 2 && seen[1].w.trigger == CAPTURE_TRIGGER_MANUAL && seen[1].w.first_seq == 158 &&
+          seen[1].w.end_seq == 248, "pile-up: waiting window %u..%u", seen[1].w.first_seq, seen[1].w.end_seq);
+
+    // Live consumer releasing a few samples at a time while triggers land at
+    // irregular spacing: merged, adjacent and separate windows in one stream
+    reset(32, 48);
+    uint32_t rng = 7;
+    uint32_t next_trigger = 60;
+    for (uint32_t n = 0; n < 20000; n++) {
+        push(1);
+        if (n == next_trigger) {
+            trigger(CAPTURE_TRIGGER_STROKE);
+            rng = rng * 1664525u + 1013904223u;
+            next_trigger += 20 + (rng >> 24) % 300;
+        }
+        if (n % 2 == 0) {
+            drain(3);
+        }
+        if (seen_count == MAX_WINDOWS) {
+            for (int i = 0; i < seen_count - 1; i++) {
+                CHECK(seen[i].streamed == seen[i].w.end_seq - seen[i].w.first_seq, "live: window %u streamed %u",
+                      seen[i].w.id, seen[i].streamed);
+            }
+            seen[0] = seen[seen_count - 1];     // Only the last one is compared with what follows
+            seen_count = 1;
+        }
+    }
+    capture_stats_t live;
+    event_capture_get_stats(&live);
+    CHECK(live.overruns == 0 && live.windows > 0 && live.retriggers > 0, "live: %u windows, %u merged, %u overruns",
+          live.windows, live.retriggers, live.overruns);
+    drain(0);
+    CHECK(content_errors == 0, "live: %u samples out of place", content_errors);
+
+    // Stalled consumer, window waiting: the ring fills from the open window's
+    // tail and the samples refused inside the waiting window mark it truncated
+    reset(64, 96);
+    push(100);
+    trigger(CAPTURE_TRIGGER_STROKE);            // 36..196
+    push(165);
+    trigger(CAPTURE_TRIGGER_MANUAL);            // 201..361
+    push(27);                                   // Head 292: the ring holds 36..291
+    push(40);                                   // Refused
+    capture_stats_t stalled;
+    event_capture_get_stats(&stalled);
+    CHECK(stalled.overruns == 40, "stall: %u overruns, 40 refused", stalled.overruns);
+    drain(0);
+    push(120);
+    finish("stall", 2, 0, 0);
+    CHECK(seen_count == 2 && !seen[0].w.truncated && seen[1].w.truncated, "stall: truncated %d, %d",
+          seen[0].w.truncated, seen[1].w.truncated);
+    CHECK(seq_index[292] - seq_index[291] == 41, "stall: %u samples missing at the hole",
+          seq_index[292] - seq_index[291] - 1);
+
+    // Stalled past the window's end: the hole is in history a later trigger reaches back over
+    reset(64, 96);
+    push(100);
+    trigger(CAPTURE_TRIGGER_STROKE);            // 36..196
+    push(192);
+    push(10);                                   // Refused at 292
+    drain(0);
+    push(20);
+    trigger(CAPTURE_TRIGGER_MANUAL);            // 248..408, hole at 292
+    push(96);
+    finish("stall before the trigger", 2, 0, 0);
+    CHECK(seen_count == 2 && !seen[0].w.truncated && seen[1].w.truncated, "pre-trigger hole: truncated %d, %d",
+          seen[0].w.truncated, seen[1].w.truncated);
+
+    // The same history, a trigger after the hole has left the pre-trigger span
+    reset(64, 96);
+    push(100);
+    trigger(CAPTURE_TRIGGER_STROKE);
+    push(192);
+    push(10);
+    drain(0);
+    push(80);
+    trigger(CAPTURE_TRIGGER_MANUAL);            // 308..468
+    push(96);
+    finish("stall long before the trigger", 2, 0, 0);
+    CHECK(seen_count == 2 && !seen[1].w.truncated, "hole outside the window marked it truncated");
+
+    return test_report("test_event_capture");
+}
@@ -0,0 +1,346 @@
+// Ghost boat replay: pieces with a standing start written by the session log
+// writer, one loaded back as the reference through the session index and the
+// block reader, others replayed record by record the way the DSP stage feeds
+// the ghost (a catch carries the distance on from the last fix, so the next fix
+// often walks the cursor back). Deltas must follow the analytic time difference
+// at every stroke and fix, rate and split deltas must be exact, and the table
+// must behave at the standing start, when truncated and past the finish.
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "config/common_constants.h"
+#include "ghost_boat.h"
+#include "ghost_reference.h"
+#include "log_block.h"
+#include "session_card.h"
+#include "test_support.h"
+
+#define HOLD_S              2.5f        // Standing start: still through the first two catches
+#define RAMP_S              6.0f        // Then up to speed
+#define REST_S              30          // Before and after each piece (> SESSION_PIECE_GAP_MS)
+#define MAX_RECORDS         8192
+#define DELTA_TOLERANCE_MS  300         // Whole-metre fixes on both sides, catches carried on
+#define SETTLED_M           20.0f       // Past the standing start
+
+typedef struct {
+    float speed_m_s;
+    uint32_t stroke_ms;
+} piece_t;
+
+typedef struct {
+    uint8_t type;
+    timebase_us_t time_us;
+    union {
+        session_stroke_t stroke;
+        session_fix_t fix;
+    };
+} replay_record_t;
+
+typedef struct {
+    unsigned long strokes;
+    unsigned long fixes;
+    unsigned long off;              // Delta further than DELTA_TOLERANCE_MS from the analytic one
+    unsigned long wild;             // Not a time at all (a division by a zero-length step)
+    unsigned long rate_wrong;
+    unsigned long split_wrong;
+    unsigned long walked_back;      // Lookups at a shorter distance than the one before
+    float worst_ms;
+    bool have_final;
+    int32_t final_delta_ms;
+    float final_distance_m;
+} replay_result_t;
+
+static replay_record_t records[MAX_RECORDS];
+static uint32_t session_distance_m = 0;
+
+// ---- Writing ----
+static float distance_at(const piece_t *piece, float t_s) {
+    if (t_s <= HOLD_S) {
+        return 0.0f;
+    }
+    if (t_s <= HOLD_S + RAMP_S) {
+        return piece->speed_m_s * (t_s - HOLD_S) * (t_s - HOLD_S) / (2.0f * RAMP_S);
+    }
+    return piece->speed_m_s * (RAMP_S / 2.0f + t_s - HOLD_S - RAMP_S);
+}
+
+static float time_at(const piece_t *piece, float distance_m) {
+    float ramp_m = piece->speed_m_s * RAMP_S / 2.0f;
+    if (distance_m <= ramp_m) {
+        return HOLD_S + sqrtf(2.0f * RAMP_S * distance_m / piece->speed_m_s);
+    }
+    return HOLD_S + RAMP_S + (distance_m - ramp_m) / piece->speed_m_s;
+}
+
+static float speed_at(const piece_t *piece, float t_s) {
+    return piece->speed_m_s * fminf(fmaxf((t_s - HOLD_S) / RAMP_S, 0.0f), 1.0f);
+}
+
+static void fix_at(timebase_us_t time_us, float speed_m_s) {
+    uint32_t speed_mm_s = (uint32_t)lroundf(speed_m_s * 1000.0f);
+    session_fix_t fix = {
+        .speed_mm_s = speed_mm_s,
+        .distance_m = session_distance_m,
+        .split_ds = speed_mm_s >= SPLIT_MIN_SPEED_MM_S ? 5000000 / speed_mm_s : 0,
+    };
+    session_log_append(SESSION_REC_FIX, time_us, &fix, sizeof(fix));
+}
+
+// A rest, a piece of length_m from a standing start, a rest - one session
+static uint32_t write_session(timebase_us_t *now_us, const piece_t *piece, float length_m) {
+    timebase_us_t start_us = *now_us + (timebase_us_t)REST_S * 1000000;
+    uint32_t origin_m = session_distance_m;
+    bool rowing = true;
+    timebase_us_t end_us = 0;
+    for (timebase_us_t t_us = *now_us;; t_us += CARD_STEP_MS * 1000) {
+        float t_s = t_us >= start_us ? (float)(t_us - start_us) * 1e-6f : -1.0f;
+        float distance_m = t_s >= 0.0f ? distance_at(piece, t_s) : 0.0f;
+        uint32_t piece_ms = t_s >= 0.0f ? (uint32_t)((t_us - start_us) / 1000) : 1;
+        if (rowing && t_s >= 0.0f && piece_ms % piece->stroke_ms == 0) {
+            if (distance_m >= length_m) {
+                rowing = false;     // The catch that would start the next length
+                end_us = t_us;
+            } else {
+                session_stroke_t stroke = { .peak_cg = 180, .rate_spm = (uint16_t)(60000 / piece->stroke_ms) };
+                session_log_append(SESSION_REC_STROKE, t_us, &stroke, sizeof(stroke));
+            }
+        }
+        if ((t_us - *now_us) % 1000000 == 0) {
+            // Whole metres, as the DSP stage records them; the boat glides to a stop
+            float speed = !rowing ? 0.0f : t_s >= 0.0f ? speed_at(piece, t_s) : 0.0f;
+            if (rowing) {
+                session_distance_m = origin_m + (uint32_t)distance_m;
+            }
+            fix_at(t_us, speed);
+        }
+        session_log_tick(timebase_ms(t_us));
+        if (!rowing && t_us >= end_us + (timebase_us_t)REST_S * 1000000) {
+            *now_us = t_us + 1000000;
+            break;
+        }
+    }
+    uint32_t session_id = session_log_current_id();
+    session_log_close(timebase_ms(*now_us));
+    return session_id;
+}
+
+// ---- Reading ----
+static size_t read_session(uint32_t session_id) {
+    char log_path[SESSION_PATH_MAX], sidecar_path[SESSION_PATH_MAX];
+    session_log_path(session_id, log_path, sidecar_path);
+    int fd = open(log_path, O_RDONLY);
+    static log_block_t block;
+    size_t count = 0;
+    if (fd < 0 || pread(fd, &block.header, sizeof(block.header), 0) != (ssize_t)sizeof(block.header)) {
+        return 0;
+    }
+    uint32_t nonce = block.header.nonce;
+    for (uint32_t seq = 1; log_block_read(fd, nonce, seq, &block); seq++) {
+        timebase_us_t base_us = 0;
+        for (size_t at = 0; at + sizeof(session_rec_header_t) <= block.header.length;) {
+            session_rec_header_t rec;
+            memcpy(&rec, block.payload + at, sizeof(rec));
+            if (rec.type == 0) {
+                break;
+            }
+            const uint8_t *payload = block.payload + at + sizeof(rec);
+            timebase_us_t time_us = (timebase_us_t)timebase_delta_to_ms(base_us, rec.delta_ms) * 1000;
+            if (rec.type == SESSION_REC_TIMEBASE) {
+                session_timebase_t timebase;
+                memcpy(&timebase, payload, sizeof(timebase));
+                base_us = timebase.base_us;
+            } else if ((rec.type == SESSION_REC_STROKE || rec.type == SESSION_REC_FIX) && count < MAX_RECORDS) {
+                records[count] = (replay_record_t){ .type = rec.type, .time_us = time_us };
+                memcpy(&records[count].fix, payload, rec.length);
+                count++;
+            }
+            at += sizeof(rec) + rec.length;
+        }
+    }
+    close(fd);
+    return count;
+}
+
+// ---- Replay ----
+static void check_delta(const ghost_boat_delta_t *delta, float piece_m, const piece_t *live, const piece_t *reference,
+                        replay_result_t *out) {
+    float expected_ms = (time_at(live, piece_m) - time_at(reference, piece_m)) * 1000.0f;
+    float error_ms = fabsf((float)delta->delta_ms - expected_ms);
+    out->wild += delta->delta_ms < -60000 || delta->delta_ms > 60000;
+    if (piece_m >= SETTLED_M) {
+        out->off += error_ms > DELTA_TOLERANCE_MS;
+        out->worst_ms = fmaxf(out->worst_ms, error_ms);
+    }
+}
+
+// The records of a session through the ghost as dsp_task drives it
+static void replay(size_t count, const piece_t *live, const piece_t *reference, replay_result_t *out) {
+    float distance_m = 0.0f, speed_m_s = 0.0f, start_m = 0.0f, last_m = 0.0f;
+    timebase_us_t last_fix_us = 0, last_stroke_us = 0;
+    uint32_t split_ds = 0;
+    bool have_fix = false;
+    memset(out, 0, sizeof(*out));
+    // The session opens with its first stroke: the boat sat at the first fix's distance
+    for (size_t i = 0; i < count && !have_fix; i++) {
+        if (records[i].type == SESSION_REC_FIX) {
+            distance_m = last_m = (float)records[i].fix.distance_m;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const replay_record_t *rec = &records[i];
+        ghost_boat_delta_t delta;
+        if (rec->type == SESSION_REC_STROKE) {
+            bool piece_start = last_stroke_us == 0 ||
+                               rec->time_us - last_stroke_us >= (timebase_us_t)SESSION_PIECE_GAP_MS * 1000;
+            uint16_t rate_spm = piece_start ? 0 : (uint16_t)(60000000ULL / (rec->time_us - last_stroke_us));
+            last_stroke_us = rec->time_us;
+            float catch_m = distance_m;
+            float since_fix_s = (float)(int64_t)(rec->time_us - last_fix_us) * 1e-6f;
+            if (have_fix && fabsf(since_fix_s) * 1000.0f < GHOST_CATCH_EXTRAPOLATE_MS) {
+                catch_m += speed_m_s * since_fix_s;
+            }
+            if (piece_start) {
+                ghost_boat_start(catch_m, rec->time_us);
+                start_m = catch_m;
+            }
+            out->walked_back += !piece_start && catch_m < last_m;
+            last_m = catch_m;
+            if (ghost_boat_stroke(catch_m, rec->time_us, rate_spm, split_ds, &delta)) {
+                out->strokes++;
+                check_delta(&delta, catch_m - start_m, live, reference, out);
+                float piece_m = catch_m - start_m;
+                // Steady speed: the reference split at the catch is the one its fixes showed
+                if (piece_m >= reference->speed_m_s * RAMP_S) {
+                    uint16_t reference_split = (uint16_t)(5000000.0f / (reference->speed_m_s * 1000.0f));
+                    out->split_wrong += delta.split_delta_ds != (int32_t)split_ds - reference_split;
+                }
+                if (piece_m >= SETTLED_M && rate_spm != 0) {
+                    out->rate_wrong += delta.rate_delta_spm != (int32_t)rate_spm - (int32_t)(60000 / reference->stroke_ms);
+                }
+            }
+        } else {
+            distance_m = (float)rec->fix.distance_m;
+            speed_m_s = rec->fix.speed_mm_s >= SPLIT_MIN_SPEED_MM_S ? rec->fix.speed_mm_s / 1000.0f : 0.0f;
+            split_ds = rec->fix.speed_mm_s >= SPLIT_MIN_SPEED_MM_S ? 5000000 / rec->fix.speed_mm_s : 0;
+            last_fix_us = rec->time_us;
+            have_fix = true;
+            if (ghost_boat_active() &&
+                rec->time_us - last_stroke_us >= (timebase_us_t)SESSION_PIECE_GAP_MS * 1000) {
+                ghost_boat_stop();
+            }
+            out->walked_back += ghost_boat_active() && distance_m < last_m;
+            last_m = distance_m;
+            if (ghost_boat_update(distance_m, rec->time_us, &delta)) {
+                out->fixes++;
+                check_delta(&delta, distance_m - start_m, live, reference, out);
+                out->have_final = true;
+                out->final_delta_ms = delta.delta_ms;
+                out->final_distance_m = distance_m - start_m;
+            }
+        }
+    }
+}
+
+static double now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+int main(void) {
+    host_log_set_level(ESP_LOG_ERROR);
+    card_reset();
+    REQUIRE(session_log_init() == ESP_OK, "mount");
+
+    const piece_t reference = { 4.5f, 2000 };
+    const piece_t faster = { 4.6f, 1800 };
+    timebase_us_t now_us = 1000000;
+    uint32_t reference_id = write_session(&now_us, &reference, 2000.0f);
+    uint32_t faster_id = write_session(&now_us, &faster, 2000.0f);
+    uint32_t long_id = write_session(&now_us, &reference, 6000.0f);
+
+    // 2000 m reference: the still catches of the standing start fold into the first step
+    ghost_boat_stats_t stats;
+    REQUIRE(ghost_reference_load(reference_id, 0) == ESP_OK, "reference");
+    ghost_boat_get_stats(&stats);
+    size_t count = read_session(reference_id);
+    unsigned long recorded = 0;
+    for (size_t i = 0; i < count; i++) {
+        recorded += records[i].type == SESSION_REC_STROKE;
+    }
+    CHECK(fabsf(stats.length_m - 2000.0f) < 10.0f && stats.strokes + 1 < recorded,
+          "reference %lu of %lu strokes, %.1f m", (unsigned long)stats.strokes, recorded, stats.length_m);
+
+    // A faster piece at a higher rate against it
+    replay_result_t r;
+    count = read_session(faster_id);
+    replay(count, &faster, &reference, &r);
+    float expected_final_ms = (time_at(&faster, r.final_distance_m) - time_at(&reference, r.final_distance_m)) * 1000.0f;
+    printf("4.6 vs 4.5 m/s: %lu strokes, %lu fixes, %lu walks back, worst %.0f ms off, final %.1f s (expected %.1f s)\n",
+           r.strokes, r.fixes, r.walked_back, r.worst_ms, r.final_delta_ms * 1e-3f, expected_final_ms * 1e-3f);
+    CHECK(r.strokes > 200 && r.fixes > 400 && r.walked_back > 0, "%lu strokes, %lu fixes, %lu walks back", r.strokes,
+          r.fixes, r.walked_back);
+    CHECK(r.wild == 0 && r.off == 0, "%lu wild, %lu off (worst %.0f ms)", r.wild, r.off, r.worst_ms);
+    CHECK(r.rate_wrong == 0 && r.split_wrong == 0, "%lu rate and %lu split deltas wrong", r.rate_wrong, r.split_wrong);
+    CHECK(r.have_final && fabsf(r.final_delta_ms - expected_final_ms) < DELTA_TOLERANCE_MS, "final delta %d ms",
+          (int)r.final_delta_ms);
+
+    // The reference against itself
+    count = read_session(reference_id);
+    replay(count, &reference, &reference, &r);
+    printf("self: worst %.0f ms off\n", r.worst_ms);
+    CHECK(r.wild == 0 && r.off == 0 && r.rate_wrong == 0 && r.split_wrong == 0, "self replay: %lu off, %lu wild",
+          r.off, r.wild);
+
+    // 6 km: cost per lookup
+    REQUIRE(ghost_reference_load(long_id, 0) == ESP_OK, "6 km reference");
+    count = read_session(long_id);
+    double start = now_ns();
+    replay(count, &reference, &reference, &r);
+    double elapsed = now_ns() - start;
+    ghost_boat_get_stats(&stats);
+    printf("6 km: %lu strokes, %u bytes, %.2f cursor steps and %.0f ns a lookup, worst %.0f ms off\n",
+           (unsigned long)stats.strokes, (unsigned)stats.memory_bytes, (double)stats.cursor_steps / stats.lookups,
+           elapsed / stats.lookups, r.worst_ms);
+    CHECK(r.wild == 0 && r.off == 0, "6 km: %lu off, %lu wild", r.off, r.wild);
+    CHECK(stats.cursor_steps < 2 * (uint64_t)stats.lookups, "%llu cursor steps in %lu lookups",
+          (unsigned long long)stats.cursor_steps, (unsigned long)stats.lookups);
+
+    // Standing start: three catches at 0 m, then back to 0 after moving on
+    ghost_boat_delta_t d;
+    ghost_boat_reference_begin();
+    ghost_boat_reference_stroke(0.0f, 0, 0);
+    ghost_boat_reference_stroke(0.0f, 2000, 0);
+    ghost_boat_reference_stroke(0.0f, 4000, 0);
+    ghost_boat_reference_stroke(3.0f, 6000, 2000);
+    ghost_boat_reference_stroke(10.0f, 8000, 1200);
+    REQUIRE(ghost_boat_reference_end() == ESP_OK, "standing start reference");
+    ghost_boat_get_stats(&stats);
+    CHECK(stats.memory_bytes == 2 * 6, "still catches took %u bytes", (unsigned)stats.memory_bytes);
+    ghost_boat_start(100.0f, 1000000);
+    CHECK(ghost_boat_update(100.0f, 1000000, &d) && d.delta_ms == 0, "at the start: %d ms", (int)d.delta_ms);
+    CHECK(ghost_boat_update(103.0f, 7000000, &d) && d.delta_ms == 0, "3 m: %d ms", (int)d.delta_ms);
+    CHECK(ghost_boat_update(100.0f, 7100000, &d) && d.delta_ms == 6100, "back at 0 m: %d ms", (int)d.delta_ms);
+    CHECK(ghost_boat_update(101.5f, 7200000, &d) && d.delta_ms == 6200 - 3000, "1.5 m: %d ms", (int)d.delta_ms);
+    CHECK(!ghost_boat_update(110.5f, 9000000, &d), "past the reference finish");
+
+    // Truncated reference: the ghost ends with the table
+    ghost_boat_reference_begin();
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < GHOST_MAX_STROKES + 500; i++) {
+        kept += ghost_boat_reference_stroke(4.0f * i, 2000 * i, 1250);
+    }
+    REQUIRE(ghost_boat_reference_end() == ESP_OK, "long reference");
+    CHECK(kept == GHOST_MAX_STROKES + 1, "%lu strokes kept", (unsigned long)kept);
+    ghost_boat_start(0.0f, 0);
+    CHECK(ghost_boat_update(4.0f * GHOST_MAX_STROKES - 1.0f, 1000, &d), "inside the truncated reference");
+    CHECK(!ghost_boat_update(4.0f * GHOST_MAX_STROKES + 1.0f, 2000, &d), "past the truncated reference");
+    CHECK(ghost_boat_update(2.0f, 3000000, &d) && d.delta_ms == 3000 - 1000, "walked back to the start: %d ms",
+          (int)d.delta_ms);
+
+    return test_report("test_ghost_boat");
+}
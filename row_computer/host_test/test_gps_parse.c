@@ -0,0 +1,186 @@
+// UBX stream parsing through gps_read(), the UART scripted byte for byte: a
+// NAV-PVT frame cut at every point across two reads and fed one byte per read,
+// frames with a corrupted payload or checksum, and line noise that ends in a
+// sync byte right before a frame. Every whole frame must be parsed exactly once,
+// every corrupted one counted in gps.ubx_checksum_errors and left out of the fix.
+// The cost per NAV-PVT frame is printed, for full UART reads of back-to-back
+// frames (GPS_PARSE_FRAMES).
+#include <string.h>
+#include <time.h>
+#include "driver/uart.h"
+#include "config/pin_definitions.h"
+#include "sensors/gps.h"
+#include "sensors/ubx_command.h"
+#include "utils/stats.h"
+#include "test_support.h"
+
+#define NAV_PVT_LENGTH  92
+#define NAV_PVT_FRAME   (UBX_FRAME_OVERHEAD + NAV_PVT_LENGTH)
+#define FEED_SIZE       (64 * 1024)
+
+// ---- UART: what the next reads deliver, at most read_limit bytes each ----
+static uint8_t feed[FEED_SIZE];
+static size_t feed_length = 0;
+static size_t feed_pos = 0;
+static size_t read_limit = GPS_UART_BUF_SIZE;
+
+int uart_read_bytes(uart_port_t port, void *buf, uint32_t len, TickType_t ticks) {
+    size_t n = feed_length - feed_pos;
+    n = n < len ? n : len;
+    n = n < read_limit ? n : read_limit;
+    memcpy(buf, &feed[feed_pos], n);
+    feed_pos += n;
+    if (feed_pos == feed_length) {
+        feed_pos = feed_length = 0;
+    }
+    return (int)n;
+}
+
+static void put_u32(uint8_t *p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+// A fix identified by its iTOW; returns the frame's offset in the feed
+static size_t feed_nav_pvt(uint32_t itow_ms) {
+    uint8_t payload[NAV_PVT_LENGTH] = { 0 };
+    put_u32(&payload[0], itow_ms);
+    payload[20] = 3;                                        // 3D fix
+    payload[23] = 9;
+    put_u32(&payload[24], (uint32_t)-1200000 + itow_ms);    // lon
+    put_u32(&payload[28], 515000000);                       // lat
+    put_u32(&payload[60], 4000 + itow_ms % 1000);           // gSpeed
+    size_t offset = feed_length;
+    feed_length += ubx_frame_encode(UBX_CLASS_NAV, UBX_NAV_PVT, payload, sizeof(payload), &feed[offset]);
+    return offset;
+}
+
+static void feed_bytes(const uint8_t *bytes, size_t length) {
+    memcpy(&feed[feed_length], bytes, length);
+    feed_length += length;
+}
+
+// ---- Parser side ----
+static stats_metric_t *frames;
+static stats_metric_t *checksum_errors;
+
+// Read until the feed is empty; returns the iTOW of the last fix read (0: none)
+static uint32_t read_all(uint32_t *reads) {
+    uint32_t itow_ms = 0;
+    gps_data_t fix;
+    *reads = 0;
+    while (feed_length > 0) {
+        if (gps_read(&fix) == ESP_OK) {
+            itow_ms = fix.itow_ms;
+        }
+        (*reads)++;
+    }
+    return itow_ms;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void) {
+    host_log_set_level(ESP_LOG_ERROR);
+    feed_nav_pvt(1000);                             // Answers the communication test
+    REQUIRE(gps_init() == ESP_OK, "init");
+    frames = stats_register("gps.ubx_frames", STATS_COUNTER);
+    checksum_errors = stats_register("gps.ubx_checksum_errors", STATS_COUNTER);
+    REQUIRE(stats_value(frames) == 1, "boot frame: %u parsed", stats_value(frames));
+
+    // One frame cut at every byte: nothing is parsed until its last byte arrives
+    uint32_t itow_ms = 2000;
+    uint32_t split_errors = 0;
+    for (size_t cut = 1; cut < NAV_PVT_FRAME; cut++, itow_ms++) {
+        uint32_t before = stats_value(frames);
+        gps_data_t fix;
+        feed_nav_pvt(itow_ms);
+        read_limit = cut;
+        gps_read(&fix);
+        split_errors += stats_value(frames) != before || fix.itow_ms == itow_ms;
+        read_limit = GPS_UART_BUF_SIZE;
+        split_errors += gps_read(&fix) != ESP_OK || fix.itow_ms != itow_ms || stats_value(frames) != before + 1;
+    }
+    CHECK(split_errors == 0, "split frames: %u errors over %u cuts", split_errors, NAV_PVT_FRAME - 1);
+
+    // One byte per read, several frames in a row
+    uint32_t before = stats_value(frames), reads;
+    for (int i = 0; i < 4; i++) {
+        feed_nav_pvt(itow_ms + i);
+    }
+    read_limit = 1;
+    uint32_t last = read_all(&reads);
+    read_limit = GPS_UART_BUF_SIZE;
+    CHECK(last == itow_ms + 3 && stats_value(frames) == before + 4 && reads == 4 * NAV_PVT_FRAME,
+          "byte by byte: %u frames parsed, last fix %u in %u reads", stats_value(frames) - before, last, reads);
+    itow_ms += 4;
+
+    // Corrupted payload byte, corrupted checksum byte: counted, not parsed, and
+    // the next frame is read as usual
+    const size_t corrupted[] = { 6 + 30, NAV_PVT_FRAME - 1 };     // Payload byte 30, checksum high byte
+    for (size_t c = 0; c < sizeof(corrupted) / sizeof(corrupted[0]); c++) {
+        size_t corrupt = corrupted[c];
+        before = stats_value(frames);
+        uint32_t errors_before = stats_value(checksum_errors);
+        size_t bad = feed_nav_pvt(itow_ms);
+        feed[bad + corrupt] ^= 0x40;
+        last = read_all(&reads);
+        CHECK(stats_value(checksum_errors) == errors_before + 1 && stats_value(frames) == before &&
+              last != itow_ms, "byte %zu corrupted: %u checksum errors, %u frames, fix %u", corrupt,
+              stats_value(checksum_errors) - errors_before, stats_value(frames) - before, last);
+        feed_nav_pvt(itow_ms + 1);
+        last = read_all(&reads);
+        CHECK(last == itow_ms + 1 && stats_value(frames) == before + 1, "after byte %zu: fix %u", corrupt, last);
+        itow_ms += 2;
+    }
+
+    // Line noise ending in a sync byte (and a lone sync pair) before a frame
+    const uint8_t noise[][4] = {
+        { 0x00, 0x13, 0x7f, UBX_SYNC_1 },
+        { UBX_SYNC_1, UBX_SYNC_1, UBX_SYNC_1, UBX_SYNC_1 },
+        { 0x62, UBX_SYNC_1, 0x00, UBX_SYNC_1 },
+    };
+    for (size_t i = 0; i < sizeof(noise) / sizeof(noise[0]); i++) {
+        before = stats_value(frames);
+        feed_bytes(noise[i], sizeof(noise[i]));
+        feed_nav_pvt(itow_ms);
+        last = read_all(&reads);
+        CHECK(last == itow_ms && stats_value(frames) == before + 1, "noise %zu: fix %u, %u frames", i, last,
+              stats_value(frames) - before);
+        itow_ms++;
+    }
+
+    // Cost: back-to-back frames in full UART reads
+    uint32_t total = (uint32_t)test_env_ul("GPS_PARSE_FRAMES", 200000);
+    uint32_t per_feed = FEED_SIZE / NAV_PVT_FRAME;
+    uint32_t parsed = 0, total_reads = 0;
+    double parse_ns = 0.0;
+    before = stats_value(frames);
+    uint32_t errors_before = stats_value(checksum_errors);
+    while (parsed < total) {
+        uint32_t n = total - parsed < per_feed ? total - parsed : per_feed;
+        for (uint32_t i = 0; i < n; i++) {
+            feed_nav_pvt(itow_ms + i);
+        }
+        double start = now_ns();
+        last = read_all(&reads);
+        parse_ns += now_ns() - start;
+        CHECK(last == itow_ms + n - 1, "bulk: last fix %u, expected %u", last, itow_ms + n - 1);
+        itow_ms += n;
+        parsed += n;
+        total_reads += reads;
+    }
+    CHECK(stats_value(frames) - before == total && stats_value(checksum_errors) == errors_before,
+          "bulk: %u of %u frames, %u checksum errors", stats_value(frames) - before, total,
+          stats_value(checksum_errors) - errors_before);
+    printf("NAV-PVT parse: %.0f ns per frame (%.1f ns per byte) over %u frames in %u reads of up to %u bytes\n",
+           parse_ns / total, parse_ns / total / NAV_PVT_FRAME, total, total_reads, (unsigned)GPS_UART_BUF_SIZE);
+
+    return test_report("test_gps_parse");
+}
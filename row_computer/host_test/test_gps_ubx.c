@@ -0,0 +1,329 @@
+// The GPS task against a scripted u-blox receiver on the UART: the receiver
+// sends UBX-NAV-PVT at its navigation rate and answers commands as each scenario
+// scripts it (late, lost, rejected or not at all). Rate changes follow a stubbed
+// power governor. Whatever the navigation period, command resends and timeouts
+// must keep to UBX_ACK_TIMEOUT_MS, and fixes must keep flowing while commands
+// are outstanding.
+#include <string.h>
+#include "driver/uart.h"
+#include "config/common_constants.h"
+#include "config/pin_definitions.h"
+#include "tasks/tasks_common.h"
+#include "sensors/ubx_command.h"
+#include "utils/power_governor.h"
+#include "utils/sensor_health.h"
+#include "test_support.h"
+
+#define NAV_PVT_LENGTH      92
+#define MAX_ANSWERS         32
+#define MAX_COMMANDS        128
+#define RX_FIFO_SIZE        4096
+#define ANSWER_MS           50          // Answer latency of a healthy receiver
+#define SLICE_MS            (UBX_ACK_TIMEOUT_MS + UBX_POLL_MS + 1)     // Latest resend after a send
+
+TaskHandle_t gps_task_handle = NULL;
+bus_topic_t *gps_topic = NULL;
+
+// ---- Power governor stub: the test sets the navigation period ----
+static power_profile_t profile = { .imu_period_ms = 1, .gps_period_ms = GPS_TASK_PERIOD_MS };
+
+const power_profile_t* power_governor_profile(void) {
+    return &profile;
+}
+
+// ---- Scripted receiver ----
+typedef struct {
+    uint32_t answer_ms;             // Latency of ACK/NAK
+    uint32_t drop_answers;          // Leave the next n commands unanswered
+    bool silent;                    // Answer nothing
+    bool reject_rate;               // NAK every CFG-RATE
+} script_t;
+
+typedef struct {
+    uint64_t due_us;
+    uint8_t ack_id;                 // UBX_ACK_ACK / UBX_ACK_NAK
+    uint8_t msg_class;
+    uint8_t msg_id;
+    uint16_t period_ms;             // CFG-RATE: the period it sets
+} answer_t;
+
+typedef struct {
+    uint64_t time_us;
+    uint8_t msg_class;
+    uint8_t msg_id;
+    uint16_t period_ms;             // CFG-RATE only
+} command_t;
+
+static script_t script = { .answer_ms = ANSWER_MS };
+static uint32_t nav_period_ms = 1000;
+static uint64_t next_nav_us = 0;
+static answer_t answers[MAX_ANSWERS];
+static size_t answer_count = 0;
+static command_t commands[MAX_COMMANDS];
+static size_t command_count = 0;
+static uint8_t rx_fifo[RX_FIFO_SIZE];
+static size_t rx_length = 0;
+static uint32_t bad_frames = 0;
+
+static void put_u32(uint8_t *p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+static void emit(uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t length) {
+    if (rx_length + UBX_FRAME_OVERHEAD + length <= RX_FIFO_SIZE) {
+        rx_length += ubx_frame_encode(msg_class, msg_id, payload, length, &rx_fifo[rx_length]);
+    }
+}
+
+static void emit_nav_pvt(uint64_t time_us) {
+    uint8_t payload[NAV_PVT_LENGTH] = { 0 };
+    put_u32(&payload[0], (uint32_t)(time_us / 1000));      // iTOW
+    payload[20] = 3;                                        // 3D fix
+    payload[23] = 12;
+    put_u32(&payload[24], (uint32_t)-1200000);              // lon
+    put_u32(&payload[28], 515000000);                       // lat
+    put_u32(&payload[40], 1500);                            // hAcc
+    put_u32(&payload[60], 4000);                            // gSpeed
+    put_u32(&payload[68], 150);                             // sAcc
+    emit(UBX_CLASS_NAV, UBX_NAV_PVT, payload, sizeof(payload));
+}
+
+// Everything the receiver sends up to until_us, in time order
+static void receiver_run(uint64_t until_us) {
+    for (;;) {
+        size_t first = SIZE_MAX;
+        for (size_t i = 0; i < answer_count; i++) {
+            if (first == SIZE_MAX || answers[i].due_us < answers[first].due_us) {
+                first = i;
+            }
+        }
+        if (first != SIZE_MAX && answers[first].due_us <= until_us && answers[first].due_us <= next_nav_us) {
+            answer_t answer = answers[first];
+            answers[first] = answers[--answer_count];
+            emit(UBX_CLASS_ACK, answer.ack_id, (const uint8_t[]){ answer.msg_class, answer.msg_id }, 2);
+            if (answer.ack_id == UBX_ACK_ACK && answer.msg_id == UBX_CFG_RATE) {
+                nav_period_ms = answer.period_ms;
+                next_nav_us = answer.due_us + (uint64_t)nav_period_ms * 1000;
+            }
+        } else if (next_nav_us <= until_us) {
+            emit_nav_pvt(next_nav_us);
+            next_nav_us += (uint64_t)nav_period_ms * 1000;
+        } else {
+            return;
+        }
+    }
+}
+
+// Commands from the firmware: whole frames, logged and answered as scripted
+int uart_write_bytes(uart_port_t port, const void *data, size_t len) {
+    const uint8_t *frame = data;
+    uint16_t length = len >= UBX_FRAME_OVERHEAD ? (uint16_t)(frame[4] | (frame[5] << 8)) : 0;
+    uint16_t checksum = len >= UBX_FRAME_OVERHEAD ? ubx_checksum(&frame[2], 4 + length) : 0;
+    if (len != (size_t)UBX_FRAME_OVERHEAD + length || frame[0] != UBX_SYNC_1 || frame[1] != UBX_SYNC_2 ||
+        frame[6 + length] != (checksum & 0xFF) || frame[7 + length] != (checksum >> 8)) {
+        bad_frames++;
+        return (int)len;
+    }
+
+    uint8_t msg_class = frame[2], msg_id = frame[3];
+    uint16_t period_ms = msg_class == UBX_CLASS_CFG && msg_id == UBX_CFG_RATE ? frame[6] | (frame[7] << 8) : 0;
+    if (command_count < MAX_COMMANDS) {
+        commands[command_count++] = (command_t){ host_time_us(), msg_class, msg_id, period_ms };
+    }
+    if (script.silent) {
+        return (int)len;
+    }
+    if (script.drop_answers > 0) {
+        script.drop_answers--;
+        return (int)len;
+    }
+    if (answer_count < MAX_ANSWERS) {
+        bool reject = script.reject_rate && msg_id == UBX_CFG_RATE;
+        answers[answer_count++] = (answer_t){
+            host_time_us() + (uint64_t)script.answer_ms * 1000, reject ? UBX_ACK_NAK : UBX_ACK_ACK,
+            msg_class, msg_id, period_ms,
+        };
+    }
+    return (int)len;
+}
+
+// A blocking read: the caller sleeps out the timeout and gets what arrived meanwhile
+int uart_read_bytes(uart_port_t port, void *buf, uint32_t len, TickType_t ticks) {
+    host_sleep_until_us(host_time_us() + (uint64_t)ticks * portTICK_PERIOD_MS * 1000);
+    receiver_run(host_time_us());
+    size_t n = rx_length < len ? rx_length : len;
+    memcpy(buf, rx_fifo, n);
+    memmove(rx_fifo, rx_fifo + n, rx_length - n);
+    rx_length -= n;
+    return (int)n;
+}
+
+// ---- Producer side ----
+static bus_subscriber_t *fixes;
+static uint32_t fix_count = 0;
+
+static void run_until_ms(uint64_t end_ms) {
+    gps_data_t fix;
+    while (host_time_us() < end_ms * 1000) {
+        host_advance_ms(1);
+        while (bus_receive(fixes, &fix)) {
+            fix_count += fix.valid_fix;
+        }
+    }
+}
+
+static uint64_t now_ms(void) {
+    return host_time_us() / 1000;
+}
+
+// Run until the receiver has seen a CFG-RATE for period_ms (index into the log, or SIZE_MAX)
+static size_t run_until_rate_sent(uint16_t period_ms, uint32_t limit_ms) {
+    uint64_t end_ms = now_ms() + limit_ms;
+    size_t seen = command_count;
+    while (now_ms() < end_ms) {
+        for (; seen < command_count; seen++) {
+            if (commands[seen].msg_id == UBX_CFG_RATE && commands[seen].period_ms == period_ms) {
+                return seen;
+            }
+        }
+        run_until_ms(now_ms() + 1);
+    }
+    return SIZE_MAX;
+}
+
+// Sends of CFG-RATE period_ms from index first on, and the largest gap between them
+static size_t rate_sends(size_t first, uint16_t period_ms, uint64_t *max_gap_us) {
+    size_t sends = 0;
+    uint64_t last_us = 0;
+    *max_gap_us = 0;
+    for (size_t i = first; i < command_count; i++) {
+        if (commands[i].msg_id == UBX_CFG_RATE && commands[i].period_ms == period_ms) {
+            if (sends++ > 0 && commands[i].time_us - last_us > *max_gap_us) {
+                *max_gap_us = commands[i].time_us - last_us;
+            }
+            last_us = commands[i].time_us;
+        }
+    }
+    return sends;
+}
+
+static ubx_command_stats_t engine(void) {
+    ubx_command_stats_t stats;
+    ubx_command_get_stats(&stats);
+    return stats;
+}
+
+int main(void) {
+    host_log_set_level(ESP_LOG_ERROR);
+    REQUIRE(sensor_health_init() == ESP_OK, "health");
+    gps_topic = bus_topic_create("gps", sizeof(gps_data_t), GPS_TOPIC_DEPTH);
+    fixes = bus_subscribe(gps_topic, "test", NULL, 1);
+    REQUIRE(fixes != NULL, "subscribe");
+
+    // Boot as app_main does: the configuration is pipelined and answered at once
+    REQUIRE(gps_init() == ESP_OK, "init");
+    gps_task_handle = host_task_create(gps_task, "GPS_TASK", NULL);
+    run_until_ms(now_ms() + 10000);
+    ubx_command_stats_t stats = engine();
+    CHECK(command_count == 3 && commands[0].msg_id == UBX_CFG_PRT && commands[1].msg_id == UBX_CFG_MSG &&
+          commands[2].msg_id == UBX_CFG_RATE, "boot sent %zu commands", command_count);
+    CHECK(stats.acked == 3 && stats.retries == 0 && ubx_command_idle(), "boot: %lu acked, %lu retries",
+          (unsigned long)stats.acked, (unsigned long)stats.retries);
+    CHECK(fix_count >= 3, "%lu fixes while booting", (unsigned long)fix_count);
+
+    // Rest: the receiver slows to one solution in 30 s
+    profile.gps_period_ms = 30000;
+    size_t sent = run_until_rate_sent(30000, 2000);
+    run_until_ms(now_ms() + GPS_TIMEOUT_MS + ANSWER_MS);     // The answer is read with the next fix
+    CHECK(sent != SIZE_MAX && gps_measurement_period_ms() == 30000 && nav_period_ms == 30000,
+          "rest: period %u ms", gps_measurement_period_ms());
+    run_until_ms(now_ms() + 65000);
+
+    // Wake with the first two answers lost: the resends follow the answer deadline,
+    // not the 30 s navigation period
+    script.drop_answers = 2;
+    profile.gps_period_ms = 1000;
+    sent = run_until_rate_sent(1000, 31000);
+    REQUIRE(sent != SIZE_MAX, "wake rate never sent");
+    uint64_t wake_sent_us = commands[sent].time_us;
+    while (gps_measurement_period_ms() != 1000 && now_ms() < wake_sent_us / 1000 + 5000) {
+        run_until_ms(now_ms() + 1);
+    }
+    uint64_t max_gap_us = 0;
+    size_t sends = rate_sends(sent, 1000, &max_gap_us);
+    CHECK(sends == 3 && max_gap_us <= SLICE_MS * 1000ULL, "wake: %zu sends, longest gap %llu ms", sends,
+          (unsigned long long)(max_gap_us / 1000));
+    CHECK(gps_measurement_period_ms() == 1000 &&
+          host_time_us() - wake_sent_us <= (2 * SLICE_MS + ANSWER_MS + UBX_POLL_MS) * 1000ULL,
+          "wake: period %u ms after %llu ms", gps_measurement_period_ms(),
+          (unsigned long long)((host_time_us() - wake_sent_us) / 1000));
+    run_until_ms(now_ms() + 32000);
+
+    // A receiver that stopped answering: every retry, then the timeout, then the
+    // request is sent afresh by a later loop
+    script.silent = true;
+    stats = engine();
+    profile.gps_period_ms = 5000;
+    sent = run_until_rate_sent(5000, 3000);
+    REQUIRE(sent != SIZE_MAX, "rest rate never sent");
+    uint64_t silent_sent_us = commands[sent].time_us;
+    run_until_ms(silent_sent_us / 1000 + (UBX_CMD_RETRIES + 1) * SLICE_MS);
+    sends = rate_sends(sent, 5000, &max_gap_us);
+    ubx_command_stats_t after = engine();
+    CHECK(sends == UBX_CMD_RETRIES + 1 && max_gap_us <= SLICE_MS * 1000ULL && after.timeouts == stats.timeouts + 1,
+          "silent: %zu sends, longest gap %llu ms, %lu timeouts", sends, (unsigned long long)(max_gap_us / 1000),
+          (unsigned long)(after.timeouts - stats.timeouts));
+    CHECK(gps_measurement_period_ms() == 1000, "silent: period %u ms", gps_measurement_period_ms());
+    script.silent = false;
+    run_until_ms(now_ms() + 3000);
+    CHECK(rate_sends(sent, 5000, &max_gap_us) > UBX_CMD_RETRIES + 1 && gps_measurement_period_ms() == 5000,
+          "silent: not sent again (period %u ms)", gps_measurement_period_ms());
+    run_until_ms(now_ms() + 12000);
+
+    // A rejected rate is not retried and the receiver keeps its period
+    script.reject_rate = true;
+    stats = engine();
+    profile.gps_period_ms = 1000;
+    sent = run_until_rate_sent(1000, 6000);
+    REQUIRE(sent != SIZE_MAX, "rejected rate never sent");
+    run_until_ms(now_ms() + 20000);
+    after = engine();
+    CHECK(rate_sends(sent, 1000, &max_gap_us) == 1 && after.naked == stats.naked + 1 &&
+          after.retries == stats.retries && gps_measurement_period_ms() == 5000,
+          "rejected: %zu sends, %lu retries, period %u ms", rate_sends(sent, 1000, &max_gap_us),
+          (unsigned long)(after.retries - stats.retries), gps_measurement_period_ms());
+    script.reject_rate = false;
+
+    // Answers later than the deadline: the command is resent, the late answer to
+    // the first send completes it and the answer to the resend is absorbed
+    script.answer_ms = UBX_ACK_TIMEOUT_MS + 200;
+    stats = engine();
+    profile.gps_period_ms = 2000;
+    sent = run_until_rate_sent(2000, 6000);
+    REQUIRE(sent != SIZE_MAX, "late rate never sent");
+    run_until_ms(now_ms() + 10000);         // The second answer is read at the end of the wait
+    after = engine();
+    CHECK(rate_sends(sent, 2000, &max_gap_us) == 2 && after.acked == stats.acked + 1 &&
+          after.unmatched == stats.unmatched + 1 && gps_measurement_period_ms() == 2000,
+          "late: %zu sends, %lu acked, %lu unmatched, period %u ms", rate_sends(sent, 2000, &max_gap_us),
+          (unsigned long)(after.acked - stats.acked), (unsigned long)(after.unmatched - stats.unmatched),
+          gps_measurement_period_ms());
+    script.answer_ms = ANSWER_MS;
+
+    // Every loop found data, navigation frames read while commands were outstanding included
+    sensor_health_status_t position;
+    sensor_health_get_status(HEALTH_GPS_POSITION, &position);
+    CHECK(position.error_rate == 0.0f && position.samples > 0, "%lu of the reads failed (error rate %.3f)",
+          (unsigned long)position.samples, position.error_rate);
+    CHECK(bad_frames == 0, "%lu malformed frames written", (unsigned long)bad_frames);
+
+    after = engine();
+    printf("%zu commands in %llu s: %lu sent, %lu acked, %lu rejected, %lu retries, %lu timeouts; %lu fixes\n",
+           command_count, (unsigned long long)(now_ms() / 1000), (unsigned long)after.sent,
+           (unsigned long)after.acked, (unsigned long)after.naked, (unsigned long)after.retries,
+           (unsigned long)after.timeouts, (unsigned long)fix_count);
+    return test_report("test_gps_ubx");
+}
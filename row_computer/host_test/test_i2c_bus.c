@@ -0,0 +1,160 @@
+// I2C bus manager under injected faults: a fake bus with per-device NACKs, a
+// device that hangs for the full timeout, and a slave holding SDA low until it
+// is clocked out. Wire time and timeouts advance the virtual clock, so rates are
+// measured the way the 1kHz IMU loop would see them.
+#include "driver/i2c.h"
+#include "driver/gpio.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "i2c_bus.h"
+#include "test_support.h"
+
+typedef enum {
+    FAULT_NONE,
+    FAULT_NACK,             // Address not acknowledged - fails at once
+    FAULT_HANG,             // Clock stretched forever - the driver times out
+} fault_t;
+
+static fault_t faults[2];               // Indexed by i2c_device_t
+static int sda_held_clocks = 0;         // > 0: SDA low until this many SCL pulses
+static int scl_level = 1;
+static unsigned long scl_pulses = 0;
+static TickType_t last_timeout_ticks = 0;
+
+static void advance_us(uint64_t us) {
+    host_set_time_us(host_time_us() + us);
+}
+
+void esp_rom_delay_us(uint32_t us) {
+    advance_us(us);
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+    if (pin == I2C_MASTER_SCL_IO) {
+        if (scl_level == 0 && level == 1 && sda_held_clocks > 0) {
+            sda_held_clocks--;
+            scl_pulses++;
+        }
+        scl_level = (int)level;
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin) {
+    return pin == I2C_MASTER_SDA_IO && sda_held_clocks > 0 ? 0 : 1;
+}
+
+static esp_err_t transfer(uint8_t address, size_t bytes, TickType_t timeout_ticks) {
+    last_timeout_ticks = timeout_ticks;
+    fault_t fault = address == MPU6050_ADDR ? faults[I2C_DEV_MPU6050] : faults[I2C_DEV_MAG];
+    if (sda_held_clocks > 0 || fault == FAULT_HANG) {
+        advance_us((uint64_t)timeout_ticks * 1000);
+        return ESP_ERR_TIMEOUT;
+    }
+    if (fault == FAULT_NACK) {
+        advance_us(9 * 1000000ULL / I2C_MASTER_FREQ_HZ);
+        return ESP_FAIL;
+    }
+    advance_us((bytes * 9 + 4) * 1000000ULL / I2C_MASTER_FREQ_HZ);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_read_device(i2c_port_t port, uint8_t address, const uint8_t *tx, size_t tx_len,
+                                       uint8_t *rx, size_t rx_len, TickType_t ticks) {
+    return transfer(address, 2 + tx_len + rx_len, ticks);
+}
+
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t address, const uint8_t *tx, size_t tx_len,
+                                     TickType_t ticks) {
+    return transfer(address, 1 + tx_len, ticks);
+}
+
+typedef struct {
+    uint32_t mpu_ok;
+    uint32_t mag_ok;
+} loop_result_t;
+
+// The IMU task: a 14-byte MPU burst every 1ms, the magnetometer every 10th loop
+static loop_result_t run_imu_loop(uint32_t seconds) {
+    loop_result_t result = {0};
+    uint8_t buf[14];
+    uint64_t end_us = host_time_us() + (uint64_t)seconds * 1000000;
+    for (uint32_t n = 0; host_time_us() < end_us; n++) {
+        uint64_t next_us = host_time_us() + 1000;
+        result.mpu_ok += i2c_bus_read(I2C_DEV_MPU6050, 0x3B, buf, 14) == ESP_OK;
+        if (n % 10 == 0) {
+            result.mag_ok += i2c_bus_read(I2C_DEV_MAG, 0x03, buf, 6) == ESP_OK;
+        }
+        if (host_time_us() < next_us) {
+            host_set_time_us(next_us);      // vTaskDelayUntil
+        }
+    }
+    return result;
+}
+
+int main(void) {
+    REQUIRE(i2c_bus_init() == ESP_OK, "init");
+    i2c_device_stats_t mpu, mag;
+
+    // Timeouts are sized to the transfer, not the old fixed second
+    uint8_t buf[14];
+    i2c_bus_read(I2C_DEV_MPU6050, 0x3B, buf, 14);
+    CHECK(last_timeout_ticks >= 2 && last_timeout_ticks <= 5, "MPU burst timeout %u ticks", last_timeout_ticks);
+
+    // Healthy bus
+    loop_result_t healthy = run_imu_loop(10);
+    CHECK(healthy.mpu_ok >= 9990, "healthy MPU %u reads in 10 s", healthy.mpu_ok);
+    CHECK(healthy.mag_ok >= 999, "healthy mag %u reads in 10 s", healthy.mag_ok);
+
+    // Hanging magnetometer: the breaker keeps it from starving the MPU
+    faults[I2C_DEV_MAG] = FAULT_HANG;
+    uint32_t recoveries_before = i2c_bus_recoveries();
+    loop_result_t hung = run_imu_loop(10);
+    i2c_bus_get_stats(I2C_DEV_MAG, &mag);
+    CHECK(hung.mpu_ok >= 9900, "MPU %u reads in 10 s with the mag hanging", hung.mpu_ok);
+    CHECK(hung.mag_ok == 0, "hung mag read %u times", hung.mag_ok);
+    CHECK(mag.state != I2C_BREAKER_CLOSED, "mag breaker %s", i2c_breaker_state_name(mag.state));
+    CHECK(mag.rejected > 900, "mag fast-failed %u times", mag.rejected);
+    uint32_t doubled = I2C_BACKOFF_MIN_MS << (mag.trips - 1);
+    CHECK(mag.backoff_ms == (doubled < I2C_BACKOFF_MAX_MS ? doubled : I2C_BACKOFF_MAX_MS),
+          "backoff %u ms after %u trips", mag.backoff_ms, mag.trips);
+    CHECK(i2c_bus_recoveries() - recoveries_before <= 10 / (I2C_RECOVERY_INTERVAL_MS / 1000) + 1,
+          "%u recoveries in 10 s", i2c_bus_recoveries() - recoveries_before);
+    printf("mag hanging: MPU %.1f Hz, mag fast-failed %u, trips %u, backoff %u ms, recoveries %u\n",
+           hung.mpu_ok / 10.0, mag.rejected, mag.trips, mag.backoff_ms, i2c_bus_recoveries() - recoveries_before);
+
+    // The magnetometer comes back: the next probe closes the breaker and resets the backoff
+    faults[I2C_DEV_MAG] = FAULT_NONE;
+    loop_result_t back = run_imu_loop(I2C_BACKOFF_MAX_MS / 1000 + 1);
+    i2c_bus_get_stats(I2C_DEV_MAG, &mag);
+    CHECK(mag.state == I2C_BREAKER_CLOSED, "mag breaker %s after recovery", i2c_breaker_state_name(mag.state));
+    CHECK(mag.backoff_ms == I2C_BACKOFF_MIN_MS, "backoff reset to %u ms", mag.backoff_ms);
+    CHECK(back.mag_ok > 0, "mag read again");
+
+    // NACKing magnetometer: fails fast, trips without a bus recovery
+    faults[I2C_DEV_MAG] = FAULT_NACK;
+    recoveries_before = i2c_bus_recoveries();
+    uint32_t trips_before = mag.trips;
+    loop_result_t nack = run_imu_loop(2);
+    i2c_bus_get_stats(I2C_DEV_MAG, &mag);
+    CHECK(nack.mpu_ok >= 1990, "MPU %u reads in 2 s with the mag NACKing", nack.mpu_ok);
+    CHECK(mag.trips > trips_before, "NACKs trip the breaker");
+    CHECK(i2c_bus_recoveries() == recoveries_before, "NACKs do not recover the bus");
+    faults[I2C_DEV_MAG] = FAULT_NONE;
+    run_imu_loop(I2C_BACKOFF_MAX_MS / 1000 + 1);
+
+    // A slave holds SDA low: every device times out until the recovery clocks it free
+    sda_held_clocks = 5;
+    recoveries_before = i2c_bus_recoveries();
+    run_imu_loop(1);
+    i2c_bus_get_stats(I2C_DEV_MPU6050, &mpu);
+    CHECK(sda_held_clocks == 0 && scl_pulses == 5, "recovery clocked SDA free (%lu pulses)", scl_pulses);
+    CHECK(i2c_bus_recoveries() > recoveries_before, "stuck bus recovered");
+    loop_result_t after = run_imu_loop(2);
+    i2c_bus_get_stats(I2C_DEV_MPU6050, &mpu);
+    CHECK(mpu.state == I2C_BREAKER_CLOSED, "MPU breaker %s after the recovery", i2c_breaker_state_name(mpu.state));
+    CHECK(after.mpu_ok >= 1990, "MPU %u reads in 2 s after the recovery", after.mpu_ok);
+    CHECK(after.mag_ok >= 150, "mag %u reads in 2 s after the recovery", after.mag_ok);
+
+    return test_report("test_i2c_bus");
+}
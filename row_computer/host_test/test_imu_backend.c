@@ -0,0 +1,336 @@
+// SPI IMU backends against register-level fakes of the ICM-42688-P and LSM6DSO.
+// The fake answers SPI transactions the way the part does: register file, WHO_AM_I,
+// reset, and a FIFO fed with known motion. Built once per part (CONFIG_ROW_IMU_*).
+// Checks the configuration written, the decode into the canonical MPU6050 frame
+// (scale, channel order, temperature), bursts capped at IMU_FIFO_MAX_SAMPLES with
+// the rest kept queued, and thinning to a lower output rate.
+#include <math.h>
+#include <string.h>
+#include "driver/spi_master.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "imu.h"
+#include "imu_backend.h"
+#include "test_support.h"
+
+#define FAKE_FIFO_BYTES     8192
+
+typedef struct {
+    float accel_g[3];
+    float gyro_dps[3];
+    float temp_c;
+} motion_t;
+
+static uint8_t regs[128];
+static uint8_t fifo[FAKE_FIFO_BYTES];
+static size_t fifo_head = 0;
+static size_t fifo_tail = 0;
+static uint8_t who_am_i_value;
+static unsigned long resets = 0;
+
+static void fifo_push(const uint8_t *bytes, size_t len) {
+    memcpy(fifo + fifo_tail, bytes, len);
+    fifo_tail += len;
+}
+
+static size_t fifo_level(void) {
+    return fifo_tail - fifo_head;
+}
+
+static void fifo_clear(void) {
+    fifo_head = fifo_tail = 0;
+}
+
+static int16_t clamp16(float value) {
+    long rounded = lroundf(value);
+    return rounded > INT16_MAX ? INT16_MAX : rounded < INT16_MIN ? INT16_MIN : (int16_t)rounded;
+}
+
+// Sample n of a test signal that differs on every channel and sample
+static motion_t motion_at(int n) {
+    motion_t m = {
+        .accel_g = { 0.25f * sinf(0.3f * n), -0.5f + 0.01f * n, 1.0f - 0.02f * (n % 7) },
+        .gyro_dps = { 10.0f * cosf(0.2f * n), -3.5f, 0.25f * n - 20.0f },
+        .temp_c = 30.0f + 0.05f * n,
+    };
+    return m;
+}
+
+#if CONFIG_ROW_IMU_ICM42688
+
+// ---- ICM-42688-P: 16-byte packet 3, big endian, FIFO count in records ----
+#define PACKET_BYTES    16
+
+static void part_reset(void) {
+    memset(regs, 0, sizeof(regs));
+    regs[ICM42688_WHO_AM_I] = who_am_i_value;
+    fifo_clear();
+}
+
+static void part_write(uint8_t reg, uint8_t value) {
+    if (reg == ICM42688_DEVICE_CONFIG && (value & 0x01)) {
+        resets++;
+        part_reset();
+        return;
+    }
+    if (reg == ICM42688_SIGNAL_PATH_RESET && (value & 0x02)) {
+        fifo_clear();                       // FIFO flush
+        return;
+    }
+    regs[reg] = value;
+}
+
+static void part_read(uint8_t reg, uint8_t *out, size_t len) {
+    if (reg == ICM42688_FIFO_DATA) {
+        for (size_t i = 0; i < len; i++) {
+            out[i] = fifo_head < fifo_tail ? fifo[fifo_head++] : 0xFF;
+        }
+        return;
+    }
+    size_t records = fifo_level() / PACKET_BYTES;
+    regs[ICM42688_FIFO_COUNTH] = (uint8_t)(records >> 8);
+    regs[ICM42688_FIFO_COUNTH + 1] = (uint8_t)records;
+    memcpy(out, regs + reg, len);
+}
+
+static void push_motion(const motion_t *m) {
+    uint8_t p[PACKET_BYTES] = { 0x68 };     // Accel + gyro, 16-bit packet
+    int16_t v[6];
+    for (int i = 0; i < 3; i++) {
+        v[i] = clamp16(m->accel_g[i] * 16384.0f);
+        v[3 + i] = clamp16(m->gyro_dps[i] * 131.0f);
+    }
+    for (int i = 0; i < 6; i++) {
+        p[1 + 2 * i] = (uint8_t)(v[i] >> 8);
+        p[2 + 2 * i] = (uint8_t)v[i];
+    }
+    p[13] = (uint8_t)(int8_t)lroundf((m->temp_c - 25.0f) * 2.07f);
+    fifo_push(p, sizeof(p));
+}
+
+static void push_empty(void) {
+    uint8_t p[PACKET_BYTES] = { 0x80 };
+    fifo_push(p, sizeof(p));
+}
+
+static void check_config(uint16_t odr_hz) {
+    CHECK(odr_hz == 1000, "ODR %u Hz", odr_hz);
+    CHECK(regs[ICM42688_GYRO_CONFIG0] == ((3 << 5) | 0x06), "GYRO_CONFIG0 0x%02X", regs[ICM42688_GYRO_CONFIG0]);
+    CHECK(regs[ICM42688_ACCEL_CONFIG0] == ((3 << 5) | 0x06), "ACCEL_CONFIG0 0x%02X", regs[ICM42688_ACCEL_CONFIG0]);
+    CHECK(regs[ICM42688_FIFO_CONFIG1] == 0x07, "FIFO_CONFIG1 0x%02X", regs[ICM42688_FIFO_CONFIG1]);
+    CHECK(regs[ICM42688_FIFO_CONFIG] == 0x40, "stream-to-FIFO");
+    CHECK(regs[ICM42688_PWR_MGMT0] == 0x0F, "low-noise mode");
+    CHECK(regs[ICM42688_INTF_CONFIG0] == 0x70, "count in records, big endian");
+}
+
+#define PART_WHO_AM_I       ICM42688_WHO_AM_I_VALUE
+#define ACCEL_TOL_LSB       1.0f
+#define GYRO_TOL_LSB        1.0f
+#define TEMP_TOL_C          0.3f    // 1/2.07 C FIFO resolution
+
+#elif CONFIG_ROW_IMU_LSM6DSO
+
+// ---- LSM6DSO: tagged 7-byte words, little endian, FIFO status in words ----
+#define WORD_BYTES      7
+
+static void part_reset(void) {
+    memset(regs, 0, sizeof(regs));
+    regs[LSM6DSO_WHO_AM_I] = who_am_i_value;
+    fifo_clear();
+}
+
+static void part_write(uint8_t reg, uint8_t value) {
+    if (reg == LSM6DSO_CTRL3_C && (value & 0x01)) {
+        resets++;
+        part_reset();
+        return;
+    }
+    regs[reg] = value;
+}
+
+static void part_read(uint8_t reg, uint8_t *out, size_t len) {
+    if (reg == LSM6DSO_FIFO_DATA_OUT_TAG) {
+        for (size_t i = 0; i < len; i++) {
+            out[i] = fifo_head < fifo_tail ? fifo[fifo_head++] : 0;
+        }
+        return;
+    }
+    size_t words = fifo_level() / WORD_BYTES;
+    regs[LSM6DSO_FIFO_STATUS1] = (uint8_t)words;
+    regs[LSM6DSO_FIFO_STATUS1 + 1] = (uint8_t)((words >> 8) & 0x03);
+    memcpy(out, regs + reg, len);
+}
+
+static void push_word(uint8_t tag, const int16_t v[3]) {
+    uint8_t w[WORD_BYTES] = { (uint8_t)(tag << 3) };
+    for (int i = 0; i < 3; i++) {
+        w[1 + 2 * i] = (uint8_t)v[i];
+        w[2 + 2 * i] = (uint8_t)(v[i] >> 8);
+    }
+    fifo_push(w, sizeof(w));
+}
+
+static int pushed = 0;
+
+// Temperature word at the start of every 16 samples; accelerometer and gyroscope
+// words alternate which comes first, as the part does when their batch times cross
+static void push_motion(const motion_t *m) {
+    int16_t accel[3], gyro[3];
+    for (int i = 0; i < 3; i++) {
+        accel[i] = clamp16(m->accel_g[i] * 1000.0f / 0.061f);
+        gyro[i] = clamp16(m->gyro_dps[i] * 1000.0f / 8.75f);
+    }
+    if (pushed % 16 == 0) {
+        int16_t temp[3] = { clamp16((m->temp_c - 25.0f) * 256.0f), 0, 0 };
+        push_word(0x03, temp);
+    }
+    if (pushed++ & 1) {
+        push_word(0x01, gyro);
+        push_word(0x02, accel);
+    } else {
+        push_word(0x02, accel);
+        push_word(0x01, gyro);
+    }
+}
+
+static void push_empty(void) {
+    int16_t timestamp[3] = { 0x1234, 0, 0 };
+    push_word(0x04, timestamp);             // Timestamp words are skipped
+}
+
+static void check_config(uint16_t odr_hz) {
+    CHECK(odr_hz == 1667, "ODR %u Hz", odr_hz);
+    CHECK(regs[LSM6DSO_CTRL1_XL] == 0x80, "CTRL1_XL 0x%02X", regs[LSM6DSO_CTRL1_XL]);
+    CHECK(regs[LSM6DSO_CTRL2_G] == 0x80, "CTRL2_G 0x%02X", regs[LSM6DSO_CTRL2_G]);
+    CHECK(regs[LSM6DSO_CTRL3_C] == 0x44, "BDU + auto-increment");
+    CHECK(regs[LSM6DSO_FIFO_CTRL3] == 0x88, "FIFO batch rates 0x%02X", regs[LSM6DSO_FIFO_CTRL3]);
+    CHECK(regs[LSM6DSO_FIFO_CTRL4] == 0x26, "FIFO mode 0x%02X", regs[LSM6DSO_FIFO_CTRL4]);
+}
+
+#define PART_WHO_AM_I       LSM6DSO_WHO_AM_I_VALUE
+#define ACCEL_TOL_LSB       2.0f    // Rescaled from 0.061 mg
+#define GYRO_TOL_LSB        2.0f    // Rescaled from 8.75 mdps
+#define TEMP_TOL_C          0.05f
+
+#endif
+
+// ---- SPI wire protocol: address byte (MSB = read), then data ----
+static unsigned long transactions = 0;
+
+static esp_err_t exchange(spi_transaction_t *t) {
+    transactions++;
+    if (t->flags & SPI_TRANS_USE_TXDATA) {
+        CHECK(t->length == 16, "register write is %u bits", (unsigned)t->length);
+        if (!(t->tx_data[0] & 0x80)) {
+            part_write(t->tx_data[0], t->tx_data[1]);
+        }
+        return ESP_OK;
+    }
+    const uint8_t *tx = t->tx_buffer;
+    uint8_t *rx = t->rx_buffer;
+    size_t len = t->length / 8;
+    if (tx[0] & 0x80) {
+        rx[0] = 0;
+        part_read(tx[0] & 0x7F, rx + 1, len - 1);
+    }
+    return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *t) {
+    return exchange(t);
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *t) {
+    return exchange(t);
+}
+
+static void check_sample(const imu_fifo_t *out, uint16_t index, int n) {
+    motion_t m = motion_at(n);
+    float accel_err = 0.0f, gyro_err = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        accel_err = fmaxf(accel_err, fabsf(out->v[MPU6050_AX + i][index] - m.accel_g[i] * 16384.0f));
+        gyro_err = fmaxf(gyro_err, fabsf(out->v[MPU6050_GX + i][index] - m.gyro_dps[i] * 131.0f));
+    }
+    float temp_c = MPU6050_TEMP_TO_C(out->v[MPU6050_TEMP][index]);
+    CHECK(accel_err <= ACCEL_TOL_LSB, "sample %d: accel off by %.2f LSB", n, accel_err);
+    CHECK(gyro_err <= GYRO_TOL_LSB, "sample %d: gyro off by %.2f LSB", n, gyro_err);
+#if CONFIG_ROW_IMU_LSM6DSO
+    m = motion_at(n - n % 16);              // Temperature is batched every 16 samples
+#endif
+    CHECK(fabsf(temp_c - m.temp_c) <= TEMP_TOL_C, "sample %d: %.2f C, expected %.2f", n, temp_c, m.temp_c);
+}
+
+int main(void) {
+    // Wrong part on the bus
+    who_am_i_value = 0x00;
+    part_reset();
+    CHECK(imu_init() != ESP_OK, "wrong WHO_AM_I rejected");
+
+    who_am_i_value = PART_WHO_AM_I;
+    part_reset();
+    resets = 0;
+    REQUIRE(imu_init() == ESP_OK, "init");
+    CHECK(resets == 1, "soft reset once");
+    uint16_t odr_hz = 0;
+    imu_backend_config_t config = { .odr_hz = 1000 };
+    REQUIRE(imu_backend_configure(&config, &odr_hz) == ESP_OK, "configure");
+    check_config(odr_hz);
+
+    // One burst: every sample decoded in order, filler packets/words skipped
+    imu_fifo_t out;
+    int n = 0;
+    for (int i = 0; i < 20; i++) {
+        if (i == 7) {
+            push_empty();
+        }
+        motion_t m = motion_at(n++);
+        push_motion(&m);
+    }
+    unsigned long before = transactions;
+    REQUIRE(imu_read(&out, odr_hz) == ESP_OK, "read");
+    CHECK(transactions - before == 2, "status + one burst (%lu transactions)", transactions - before);
+    CHECK(out.count == 20, "%u samples decoded", out.count);
+    for (uint16_t i = 0; i < out.count; i++) {
+        check_sample(&out, i, i);
+    }
+
+    // A backlog larger than one burst drains over several reads without loss,
+    // including bursts that end inside a sample
+    int first = n;
+    for (int i = 0; i < 75; i++) {
+        motion_t m = motion_at(n++);
+        push_motion(&m);
+    }
+    int decoded = 0;
+    for (int reads = 0; reads < 10 && decoded < 75; reads++) {
+        REQUIRE(imu_read(&out, odr_hz) == ESP_OK, "backlog read");
+        CHECK(out.count <= IMU_FIFO_MAX_SAMPLES, "burst of %u samples", out.count);
+        for (uint16_t i = 0; i < out.count; i++) {
+            check_sample(&out, i, first + decoded + i);
+        }
+        decoded += out.count;
+    }
+    CHECK(decoded == 75, "backlog: %d of 75 samples", decoded);
+    CHECK(fifo_level() == 0, "FIFO drained");
+
+    // Empty FIFO: no burst
+    before = transactions;
+    REQUIRE(imu_read(&out, odr_hz) == ESP_OK, "empty read");
+    CHECK(out.count == 0 && transactions - before == 1, "empty FIFO costs one status read");
+
+    // Reduced-rate state: thinned evenly to the output rate
+    int thinned = 0;
+    for (int burst = 0; burst < 10; burst++) {
+        for (int i = 0; i < 30; i++) {
+            motion_t m = motion_at(n++);
+            push_motion(&m);
+        }
+        imu_read(&out, 100);
+        thinned += out.count;
+    }
+    int expected = 300 * 100 / odr_hz;
+    CHECK(thinned >= expected - 1 && thinned <= expected + 1, "thinned to %d of 300 (expected %d)", thinned, expected);
+
+    printf("%s: %u Hz, 395 samples decoded\n", imu_backend_name, odr_hz);
+    return test_report(imu_backend_name);
+}
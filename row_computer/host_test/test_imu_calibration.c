@@ -0,0 +1,83 @@
+// IMU bias calibration timing: the stillness window and the forgetting of the
+// bias fit must be the same in seconds at every acquisition rate (1kHz rowing,
+// 100Hz rest, slower configured rates) - imu_sample observes every sample it gets.
+#include <math.h>
+#include "imu_calibration.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "test_support.h"
+
+static uint32_t rng = 99;
+
+static float gaussian(void) {
+    float sum = 0.0f;
+    for (int i = 0; i < 12; i++) {
+        rng = rng * 1664525u + 1013904223u;
+        sum += (float)(rng >> 8) / 16777216.0f;
+    }
+    return sum - 6.0f;
+}
+
+// Still sensor at the reference temperature with a gyro X bias
+static void feed_still(uint16_t sample_hz, uint32_t seconds, float gyro_bias) {
+    int16_t temp_raw = (int16_t)lroundf((IMU_CAL_TEMP_REF_C - MPU6050_TEMP_OFFSET_C) * MPU6050_TEMP_LSB_PER_C);
+    for (uint32_t n = 0; n < sample_hz * seconds; n++) {
+        mpu6050_raw_t raw = {0};
+        raw.v[MPU6050_AX] = (int16_t)lroundf(4.0f * gaussian());
+        raw.v[MPU6050_AY] = (int16_t)lroundf(4.0f * gaussian());
+        raw.v[MPU6050_AZ] = (int16_t)lroundf(16384.0f + 4.0f * gaussian());
+        raw.v[MPU6050_GX] = (int16_t)lroundf(gyro_bias + 4.0f * gaussian());
+        raw.v[MPU6050_GY] = (int16_t)lroundf(4.0f * gaussian());
+        raw.v[MPU6050_GZ] = (int16_t)lroundf(4.0f * gaussian());
+        raw.v[MPU6050_TEMP] = temp_raw;
+        imu_calibration_observe(&raw, sample_hz);
+    }
+}
+
+// Forgetting-weighted mean after `before` windows at b0 then `after` at b1
+static float expected_bias(float forget, int before, float b0, int after, float b1) {
+    float w_after = (1.0f - powf(forget, (float)after)) / (1.0f - forget);
+    float w_before = powf(forget, (float)after) * (1.0f - powf(forget, (float)before)) / (1.0f - forget);
+    return (b0 * w_before + b1 * w_after) / (w_before + w_after);
+}
+
+static void check_rate(uint16_t sample_hz) {
+    host_nvs_erase_all();
+    imu_calibration_init();
+
+    // One window per IMU_CAL_WINDOW_MS (stretched to the minimum sample count when slow)
+    uint32_t window_s = sample_hz >= IMU_CAL_WINDOW_MIN_SAMPLES * 1000 / IMU_CAL_WINDOW_MS
+                        ? IMU_CAL_WINDOW_MS / 1000
+                        : (IMU_CAL_WINDOW_MIN_SAMPLES + sample_hz - 1) / sample_hz;
+    imu_cal_status_t status;
+    imu_calibration_get_status(&status);
+    uint32_t windows_before = status.windows;
+    uint32_t still_before = status.still_windows;
+    feed_still(sample_hz, 60, 50.0f);
+    imu_calibration_get_status(&status);
+    uint32_t windows = status.windows - windows_before;
+    CHECK(windows == 60 / window_s, "%u Hz: %u windows in 60 s", sample_hz, windows);
+    CHECK(status.still_windows - still_before == windows, "%u Hz: %u still windows",
+          sample_hz, status.still_windows - still_before);
+    float bias = status.gyro_bias_dps[0] * LSB_SENSITIVITY_250_deg;
+    CHECK(fabsf(bias - 50.0f) < 1.0f, "%u Hz: auto-zero %.2f LSB", sample_hz, bias);
+
+    // The bias steps; how far the fit has followed after 30 s depends only on time
+    feed_still(sample_hz, 30, 80.0f);
+    imu_calibration_get_status(&status);
+    bias = status.gyro_bias_dps[0] * LSB_SENSITIVITY_250_deg;
+    float forget = powf(IMU_CAL_FORGET, (float)window_s);
+    float expected = expected_bias(forget, 60 / window_s, 50.0f, 30 / window_s, 80.0f);
+    CHECK(fabsf(bias - expected) < 1.0f, "%u Hz: after the step %.2f LSB, expected %.2f", sample_hz, bias, expected);
+    printf("%4u Hz: %u s windows, bias %.2f LSB 30 s after a 50 -> 80 step (expected %.2f)\n",
+           sample_hz, window_s, bias, expected);
+}
+
+int main(void) {
+    check_rate(1000);
+    check_rate(100);
+    check_rate(50);
+    check_rate(10);
+    check_rate(1);
+    return test_report("test_imu_calibration");
+}
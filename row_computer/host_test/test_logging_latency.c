@@ -0,0 +1,134 @@
+// Logging consumer batching on the virtual clock: the real logging task fed
+// through dsp_record_queue and batch_notify_post, as the DSP task feeds it, with
+// non-urgent records at a sweep of rates and watermarks and an urgent stroke
+// every STROKE_EVERY_MS. Each stroke must reach the log in the millisecond it
+// was queued; every other record within the latency bound. The consumer must
+// wake once per batch of min(watermark, records inside the latency bound), plus
+// once per stroke - no more (a missed batch) and no less (a lost wakeup).
+//
+// The card is not mounted: appends are timed at the call, which is where the
+// batching policy ends.
+#include <string.h>
+#include "tasks_common.h"
+#include "batch_notify.h"
+#include "multirate.h"
+#include "runtime_config.h"
+#include "session_log.h"
+#include "test_support.h"
+
+TaskHandle_t imu_task_handle = NULL;
+TaskHandle_t logging_task_handle = NULL;
+QueueHandle_t dsp_record_queue = NULL;
+
+esp_err_t imu_enable_motion_wakeup(uint16_t threshold_mg) {
+    return ESP_OK;
+}
+
+esp_err_t imu_disable_motion_wakeup(void) {
+    return ESP_OK;
+}
+
+#define RUN_MS          10000
+#define STROKE_EVERY_MS 2000
+
+static uint32_t wakeups = 0;
+static uint32_t appended = 0;
+static uint32_t stroke_latency_max_us = 0;
+static uint32_t record_latency_max_us = 0;
+
+uint32_t __real_batch_notify_wait(uint32_t max_latency_ms);
+
+// Linked with --wrap: the logging task's only blocking call
+uint32_t __wrap_batch_notify_wait(uint32_t max_latency_ms) {
+    uint32_t bits = __real_batch_notify_wait(max_latency_ms);
+    wakeups++;
+    return bits;
+}
+
+esp_err_t __real_session_log_append(session_rec_type_t type, timebase_us_t timestamp_us,
+                                    const void *payload, uint8_t length);
+
+esp_err_t __wrap_session_log_append(session_rec_type_t type, timebase_us_t timestamp_us,
+                                    const void *payload, uint8_t length) {
+    uint32_t latency_us = (uint32_t)(timebase_now_us() - timestamp_us);
+    if (type == SESSION_REC_STROKE) {
+        stroke_latency_max_us = latency_us > stroke_latency_max_us ? latency_us : stroke_latency_max_us;
+    } else if (type == SESSION_REC_FIX) {
+        record_latency_max_us = latency_us > record_latency_max_us ? latency_us : record_latency_max_us;
+    }
+    appended++;
+    return __real_session_log_append(type, timestamp_us, payload, length);
+}
+
+static void queue_record(dsp_record_type_t type, uint32_t watermark, bool urgent) {
+    dsp_record_t record = { .type = type, .timestamp_us = timebase_now_us() };
+    record.created_us = (uint32_t)record.timestamp_us;
+    if (type == DSP_RECORD_STROKE) {
+        record.stroke.peak_g = 1.4f;
+        record.stroke.rate_spm = 30;
+    }
+    if (xQueueSend(dsp_record_queue, &record, 0) == pdTRUE) {
+        batch_notify_post(dsp_record_queue, logging_task_handle, watermark, urgent);
+    }
+}
+
+// RUN_MS of records every period_ms, posted at watermark
+static void run(uint32_t period_ms, uint32_t watermark, uint32_t latency_ms) {
+    host_wait_idle();
+    wakeups = appended = 0;
+    stroke_latency_max_us = record_latency_max_us = 0;
+
+    uint32_t records = 0, strokes = 0;
+    for (uint32_t ms = 1; ms <= RUN_MS; ms++) {
+        host_advance_ms(1);
+        if (ms % STROKE_EVERY_MS == 0) {
+            queue_record(DSP_RECORD_STROKE, watermark, true);
+            strokes++;
+        } else if (ms % period_ms == 0) {
+            queue_record(DSP_RECORD_FIX, watermark, false);
+            records++;
+        }
+        host_wait_idle();
+    }
+    host_advance_ms(latency_ms + 1);        // The last batch times out
+
+    // A batch opens at its first record and closes at the watermark or the bound.
+    // A stroke flushes the batch it lands in, which can only add a wakeup.
+    // The bound expires before that millisecond's record is queued.
+    uint32_t in_bound = (latency_ms - 1) / period_ms + 1;
+    uint32_t per_batch = in_bound < watermark ? in_bound : watermark;
+    uint32_t batches = (records + per_batch - 1) / per_batch;
+    uint32_t expected = batches + strokes;
+    printf("%4u Hz, watermark %2u: %4u wakeups (%.1f/s, expected %u + %u strokes), latency max %5.1f ms, "
+           "stroke %.1f ms\n", 1000 / period_ms, watermark, wakeups, wakeups * 1000.0 / RUN_MS, batches, strokes,
+           record_latency_max_us / 1000.0, stroke_latency_max_us / 1000.0);
+
+    CHECK(appended == records + strokes, "%u Hz/%u: %u of %u records logged", 1000 / period_ms, watermark, appended,
+          records + strokes);
+    CHECK(stroke_latency_max_us == 0, "%u Hz/%u: stroke waited %u us", 1000 / period_ms, watermark,
+          stroke_latency_max_us);
+    CHECK(record_latency_max_us <= latency_ms * 1000, "%u Hz/%u: record waited %u us, bound %u ms",
+          1000 / period_ms, watermark, record_latency_max_us, latency_ms);
+    CHECK(wakeups >= batches && wakeups <= expected, "%u Hz/%u: %u wakeups, expected %u..%u", 1000 / period_ms,
+          watermark, wakeups, batches, expected);
+}
+
+int main(void) {
+    host_set_time_us(1000000);
+    REQUIRE(runtime_config_init(NULL) == ESP_OK, "config");
+    REQUIRE(multirate_init() == ESP_OK, "topics");
+    uint32_t latency_ms = runtime_config_boot()->log_max_latency_ms;
+    dsp_record_queue = xQueueCreate(runtime_config_boot()->dsp_record_queue_size, sizeof(dsp_record_t));
+    logging_task_handle = host_task_create(logging_task, "LOG_TASK", NULL);
+
+    printf("latency bound %u ms, a stroke every %u ms\n", latency_ms, STROKE_EVERY_MS);
+    const uint32_t periods_ms[] = { 100, 20, 5, 1 };
+    const uint32_t watermarks[] = { 1, 4, LOG_BATCH_WATERMARK, 16 };
+    for (size_t p = 0; p < sizeof(periods_ms) / sizeof(periods_ms[0]); p++) {
+        for (size_t w = 0; w < sizeof(watermarks) / sizeof(watermarks[0]); w++) {
+            run(periods_ms[p], watermarks[w], latency_ms);
+        }
+    }
+
+    return test_report("test_logging_latency");
+}
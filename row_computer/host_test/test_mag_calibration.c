@@ -0,0 +1,184 @@
+// Magnetometer ellipsoid fit on synthetic data: points on a known sphere pushed
+// through soft- and hard-iron distortion, with sensor noise. The fit must recover
+// the offset and a transform that maps every point back onto a sphere, both for a
+// first fit (accumulation centred on zero) and a refit centred on the first result,
+// and stay accurate over a long collection. Readings through mag_read() with
+// saturated axes mixed in must be refused and kept out of the fit.
+#include <math.h>
+#include <string.h>
+#include "mag_calibration.h"
+#include "sensors/sensors_common.h"
+#include "config/common_constants.h"
+#include "config/pin_definitions.h"
+#include "test_support.h"
+
+// HMC5883L data registers as mag_read() finds them (X, Z, Y, big-endian)
+static int16_t register_counts[3];
+
+esp_err_t mag_write_byte(uint8_t reg_addr, uint8_t data) {
+    return ESP_OK;
+}
+
+esp_err_t mag_read_bytes(uint8_t reg_addr, uint8_t *data, size_t len) {
+    const int16_t order[3] = { register_counts[0], register_counts[2], register_counts[1] };
+    for (int i = 0; i < 3 && (size_t)(i * 2 + 1) < len; i++) {
+        data[i * 2] = (uint8_t)((uint16_t)order[i] >> 8);
+        data[i * 2 + 1] = (uint8_t)order[i];
+    }
+    return ESP_OK;
+}
+
+typedef struct {
+    float offset[3];
+    float soft[9];          // raw = soft * field + offset
+    float field;
+} distortion_t;
+
+static uint32_t rng = 12345;
+
+static float uniform(void) {
+    rng = rng * 1664525u + 1013904223u;
+    return (float)(rng >> 8) / 16777216.0f;
+}
+
+static float gaussian(void) {
+    float u1 = uniform() + 1e-7f;
+    float u2 = uniform();
+    return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+// Direction number n of a slow pole-to-pole sweep over `sweep` samples, or a
+// uniform random direction when sweep is 0
+static void sample(const distortion_t *d, float noise, uint32_t n, uint32_t sweep, float raw[3], float truth[3]) {
+    float z = sweep > 0 ? 1.0f - 2.0f * (float)n / (float)sweep : 2.0f * uniform() - 1.0f;
+    float a = sweep > 0 ? 2.39996323f * (float)n : 2.0f * (float)M_PI * uniform();
+    float r = sqrtf(1.0f - z * z);
+    truth[0] = d->field * r * cosf(a);
+    truth[1] = d->field * r * sinf(a);
+    truth[2] = d->field * z;
+    for (int i = 0; i < 3; i++) {
+        raw[i] = d->offset[i] + noise * gaussian();
+        for (int j = 0; j < 3; j++) {
+            raw[i] += d->soft[i * 3 + j] * truth[j];
+        }
+    }
+}
+
+// Feed until the fit is ready, finish, and measure the result
+static void fit_and_check(const char *name, const distortion_t *d, uint32_t sweep,
+                          float offset_tol, float radius_tol) {
+    mag_calibration_start();
+    mag_cal_status_t status;
+    uint32_t fed = 0;
+    float raw[3], truth[3];
+    do {
+        sample(d, 0.5f, fed, sweep, raw, truth);
+        mag_calibration_feed(raw);
+        mag_calibration_get_status(&status);
+        fed++;
+    } while (status.state != MAG_CAL_READY && fed < 1000000);
+    CHECK(status.state == MAG_CAL_READY, "%s: ready after %u samples", name, fed);
+
+    CHECK(mag_calibration_finish() == ESP_OK, "%s: fit", name);
+    const mag_cal_transform_t *t = mag_calibration_transform();
+    float offset_err = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        offset_err = fmaxf(offset_err, fabsf(t->offset[i] - d->offset[i]));
+    }
+    CHECK(offset_err < offset_tol, "%s: offset error %.3f", name, offset_err);
+
+    // Noise-free points must land on one sphere
+    float min_r = INFINITY, max_r = 0.0f;
+    for (int n = 0; n < 2000; n++) {
+        float corrected[3];
+        sample(d, 0.0f, 0, 0, raw, truth);
+        mag_calibration_apply(t, raw, corrected);
+        float r = sqrtf(corrected[0] * corrected[0] + corrected[1] * corrected[1] + corrected[2] * corrected[2]);
+        min_r = fminf(min_r, r);
+        max_r = fmaxf(max_r, r);
+    }
+    mag_calibration_get_status(&status);
+    CHECK((max_r - min_r) / status.field_radius < radius_tol,
+          "%s: corrected radius %.2f..%.2f (field %.2f)", name, min_r, max_r, status.field_radius);
+    printf("%s: %u samples, offset error %.3f, radius spread %.4f%%, rms %.5f\n", name, status.samples,
+           offset_err, 100.0f * (max_r - min_r) / status.field_radius, status.fit_rms);
+}
+
+int main(void) {
+    // No stored calibration: init starts collecting around the identity transform
+    CHECK(mag_calibration_init() == ESP_ERR_NOT_FOUND, "nothing stored");
+
+    const distortion_t sphere = {
+        .offset = { 0.0f, 0.0f, 0.0f },
+        .soft = { 1, 0, 0, 0, 1, 0, 0, 0, 1 },
+        .field = 450.0f,
+    };
+    fit_and_check("sphere", &sphere, 0, 1.0f, 0.005f);
+
+    // Hard iron comparable to the field, skewed soft iron
+    const distortion_t boat = {
+        .offset = { 310.0f, -240.0f, 125.0f },
+        .soft = { 1.12f, 0.06f, -0.03f,
+                  0.06f, 0.91f, 0.04f,
+                  -0.03f, 0.04f, 1.02f },
+        .field = 450.0f,
+    };
+    fit_and_check("first fit", &boat, 0, 1.5f, 0.01f);
+
+    // Refit: accumulation is centred on the transform just found
+    fit_and_check("refit", &boat, 0, 1.0f, 0.01f);
+
+    // A slow sweep collects for a long time before the spans are covered; the
+    // float sums must not lose precision on the way
+    fit_and_check("long collection", &boat, 100000, 1.5f, 0.01f);
+
+    // The stored transform is reloaded on the next boot
+    mag_cal_transform_t fitted = *mag_calibration_transform();
+    CHECK(mag_calibration_init() == ESP_OK, "reload");
+    CHECK(memcmp(mag_calibration_transform(), &fitted, sizeof(fitted)) == 0, "reloaded transform matches");
+
+    // Saturated axis: refused, the previous reading stays, nothing reaches the fit
+    mag_calibration_start();
+    mag_cal_status_t status;
+    mag_calibration_get_status(&status);
+    uint32_t fed = status.samples;
+    float x = 1.0f, y = 2.0f, z = 3.0f;
+    register_counts[0] = 120;
+    register_counts[1] = HMC5883L_OVERFLOW;
+    register_counts[2] = 300;
+    CHECK(mag_read(&x, &y, &z) == ESP_ERR_INVALID_RESPONSE, "overflow refused");
+    CHECK(x == 1.0f && y == 2.0f && z == 3.0f, "overflow overwrote the reading: %.1f %.1f %.1f", x, y, z);
+    mag_calibration_get_status(&status);
+    CHECK(status.samples == fed, "overflow fed to the fit");
+    register_counts[1] = -80;
+    CHECK(mag_read(&x, &y, &z) == ESP_OK, "in-range reading");
+    mag_calibration_get_status(&status);
+    CHECK(status.samples == fed + 1, "in-range reading not fed to the fit");
+
+    // A fit through mag_read() with an overflow on one axis every 20 readings
+    float raw[3], truth[3];
+    uint32_t reads = 0, refused = 0;
+    do {
+        sample(&boat, 0.5f, 0, 0, raw, truth);
+        for (int i = 0; i < 3; i++) {
+            register_counts[i] = (int16_t)lroundf(raw[i] / MAG_SCALE_1_3_GAUSS);
+        }
+        if (reads % 20 == 19) {
+            register_counts[reads % 3] = HMC5883L_OVERFLOW;
+        }
+        refused += mag_read(&x, &y, &z) == ESP_ERR_INVALID_RESPONSE;
+        mag_calibration_get_status(&status);
+        reads++;
+    } while (status.state != MAG_CAL_READY && reads < 1000000);
+    CHECK(refused == reads / 20, "%u of %u overflow readings refused", refused, reads / 20);
+    CHECK(mag_calibration_finish() == ESP_OK, "fit through overflows");
+    const mag_cal_transform_t *t = mag_calibration_transform();
+    float offset_err = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        offset_err = fmaxf(offset_err, fabsf(t->offset[i] - boat.offset[i]));
+    }
+    CHECK(offset_err < 1.5f, "fit through overflows: offset error %.3f", offset_err);
+    printf("overflow: %u readings, %u refused, offset error %.3f\n", reads, refused, offset_err);
+
+    return test_report("test_mag_calibration");
+}
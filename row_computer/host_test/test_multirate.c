@@ -0,0 +1,113 @@
+// Multi-rate decimation tree on synthetic sines. Each stage is fed on its own
+// (acquisition entering at its input stream) across the passband, the -6 dB
+// point and frequencies that would alias into the output band: gains must stay
+// flat in the passband and below the stopband floor above it. Passband outputs
+// must match the input sine at their own timestamps, so the group delay shift
+// is exact per stage and, from a 1 kHz input through every stage, when the
+// delays add up. The cost per 1 kHz input sample of the whole tree is printed.
+#include <math.h>
+#include <time.h>
+#include "multirate.h"
+#include "config/common_constants.h"
+#include "test_support.h"
+
+#define OUTPUTS         400     // Decimated samples measured per point
+#define PASSBAND_DB     0.1f    // Flatness up to 0.1 of the output rate
+#define STOPBAND_DB     (-40.0f)
+#define TIME_ERROR      0.01f   // Of a unit sine; one input period late is 0.06
+
+typedef struct {
+    float gain_db;              // RMS out over RMS in
+    float time_error;           // Worst |out - sin(2 pi f t_out)|
+} response_t;
+
+static float sine(float f_hz, timebase_us_t t_us) {
+    return sinf(2.0f * (float)M_PI * f_hz * (float)((double)t_us / 1e6));
+}
+
+// Stage below stream `in` fed a unit sine at f_hz at that stream's rate
+static response_t stage_response(multirate_stream_t in, float f_hz) {
+    multirate_init();
+    multirate_set_input(in);
+    multirate_stream_t out = in + 1;
+    timebase_us_t period_us = (timebase_us_t)multirate_stream_period_ms(in) * 1000;
+
+    response_t r = { 0 };
+    double sum_sq = 0.0;
+    uint32_t outputs = 0;
+    for (uint32_t n = 0; outputs < OUTPUTS; n++) {
+        imu_data_t sample = { .timestamp_us = n * period_us, .accel_z = 1.0f };
+        sample.accel_x = sine(f_hz, sample.timestamp_us);
+        if (multirate_push(&sample) & MULTIRATE_BIT(out)) {
+            const imu_data_t *o = multirate_latest(out);
+            sum_sq += (double)o->accel_x * o->accel_x;
+            r.time_error = fmaxf(r.time_error, fabsf(o->accel_x - sine(f_hz, o->timestamp_us)));
+            outputs++;
+        }
+    }
+    r.gain_db = 20.0f * log10f((float)sqrt(sum_sq / outputs / 0.5));
+    return r;
+}
+
+int main(void) {
+    const char *names[MULTIRATE_STREAM_COUNT] = { "1 kHz", "100 Hz", "10 Hz", "1 Hz" };
+
+    for (multirate_stream_t in = MULTIRATE_1KHZ; in < MULTIRATE_1HZ; in++) {
+        float out_hz = 1000.0f / (float)multirate_stream_period_ms(in + 1);
+        const float pass[] = { 0.02f, 0.05f, 0.1f };
+        const float stop[] = { 0.65f, 0.8f, 1.0f, 1.3f, 2.5f, 4.4f };
+        float worst_pass = 0.0f, worst_stop = -INFINITY, worst_time = 0.0f;
+
+        for (size_t i = 0; i < sizeof(pass) / sizeof(pass[0]); i++) {
+            response_t r = stage_response(in, pass[i] * out_hz);
+            worst_pass = fmaxf(worst_pass, fabsf(r.gain_db));
+            worst_time = fmaxf(worst_time, r.time_error);
+        }
+        response_t edge = stage_response(in, MULTIRATE_CUTOFF * out_hz);
+        for (size_t i = 0; i < sizeof(stop) / sizeof(stop[0]); i++) {
+            worst_stop = fmaxf(worst_stop, stage_response(in, stop[i] * out_hz).gain_db);
+        }
+
+        printf("%s -> %s: passband %.3f dB, %.2f of the output rate %.1f dB, stopband %.1f dB, "
+               "timestamp error %.4f\n", names[in], names[in + 1], worst_pass, MULTIRATE_CUTOFF, edge.gain_db,
+               worst_stop, worst_time);
+        CHECK(worst_pass < PASSBAND_DB, "%s: passband ripple %.3f dB", names[in], worst_pass);
+        CHECK(edge.gain_db > -7.0f && edge.gain_db < -5.0f, "%s: %.1f dB at the cutoff", names[in], edge.gain_db);
+        CHECK(worst_stop < STOPBAND_DB, "%s: stopband %.1f dB", names[in], worst_stop);
+        CHECK(worst_time < TIME_ERROR, "%s: outputs off their timestamps by %.4f", names[in], worst_time);
+    }
+
+    // Whole tree from 1 kHz: each stream's timestamps carry the delays of every
+    // stage above it. A sine slow enough for the 1 Hz passband, timed throughout.
+    multirate_init();
+    multirate_set_input(MULTIRATE_1KHZ);
+    const float f_hz = 0.05f;
+    uint32_t samples = (uint32_t)test_env_ul("MULTIRATE_SECONDS", 200) * 1000;
+    float time_error[MULTIRATE_STREAM_COUNT] = { 0 };
+    uint32_t outputs[MULTIRATE_STREAM_COUNT] = { 0 };
+    struct timespec start, end;
+    double push_ns = 0.0;
+    for (uint32_t n = 0; n < samples; n++) {
+        imu_data_t sample = { .timestamp_us = (timebase_us_t)n * 1000, .accel_z = 1.0f };
+        sample.accel_x = sine(f_hz, sample.timestamp_us);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint32_t produced = multirate_push(&sample);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        push_ns += (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        for (int s = 0; s < MULTIRATE_STREAM_COUNT; s++) {
+            if (produced & MULTIRATE_BIT(s)) {
+                const imu_data_t *o = multirate_latest(s);
+                time_error[s] = fmaxf(time_error[s], fabsf(o->accel_x - sine(f_hz, o->timestamp_us)));
+                outputs[s]++;
+            }
+        }
+    }
+    for (int s = 0; s < MULTIRATE_STREAM_COUNT; s++) {
+        CHECK(outputs[s] > 0 && time_error[s] < TIME_ERROR, "tree: %s off its timestamps by %.4f (%u samples)",
+              names[s], time_error[s], outputs[s]);
+    }
+    printf("tree: timestamp error %.4f / %.4f / %.4f / %.4f; %.0f ns per 1 kHz input sample over %u\n",
+           time_error[0], time_error[1], time_error[2], time_error[3], push_ns / samples, samples);
+
+    return test_report("test_multirate");
+}
@@ -0,0 +1,137 @@
+// Power governor replay: a synthesised outing (rowing, still, REST, SLEEP, wake by
+// interrupt, REST, wake by a strong sample) fed at each state's IMU period, with a
+// second thread copying the statistics throughout. Every copy must account exactly
+// the time asked for - a copy taken mid-update would not. Built with ThreadSanitizer
+// where available, which reports an unguarded copy even when no tear is observed.
+#include <math.h>
+#include <pthread.h>
+#include "power_governor.h"
+#include "runtime_config.h"
+#include "tasks_common.h"
+#include "test_support.h"
+
+TaskHandle_t imu_task_handle = NULL;
+
+esp_err_t imu_enable_motion_wakeup(uint16_t threshold_mg) {
+    return ESP_OK;
+}
+
+esp_err_t imu_disable_motion_wakeup(void) {
+    return ESP_OK;
+}
+
+#define READER_NOW_MS   0x7fff0000u     // Any mark works: the copy accounts up to it
+#define BOOT_MS         7000u           // Init well after boot: residency starts there
+
+static bool reader_stop = false;
+static unsigned long reader_copies = 0;
+static unsigned long reader_torn = 0;
+
+static void *stats_reader(void *arg) {
+    while (!__atomic_load_n(&reader_stop, __ATOMIC_RELAXED)) {
+        power_governor_stats_t s;
+        power_governor_get_stats(&s, READER_NOW_MS);
+        uint32_t total = 0;
+        for (int i = 0; i < POWER_STATE_COUNT; i++) {
+            total += s.time_in_state_ms[i];
+        }
+        reader_torn += total != READER_NOW_MS - BOOT_MS;
+        reader_copies++;
+    }
+    return NULL;
+}
+
+static uint32_t now_ms = BOOT_MS;
+static uint32_t entered_ms[POWER_STATE_COUNT];
+static power_state_t last_state = POWER_STATE_ROWING;
+
+// One sample at the current state's period; strokes are a 0.5g swing at 30 spm
+static power_state_t step(bool rowing) {
+    float az = rowing ? 1.0f + 0.5f * sinf(2.0f * (float)M_PI * (float)now_ms / 2000.0f) : 1.0f;
+    power_state_t state = power_governor_update(0.0f, 0.0f, az, 0.0f, 0.0f, rowing ? 40.0f : 0.5f, now_ms);
+    if (state != last_state) {
+        entered_ms[state] = now_ms;
+        last_state = state;
+    }
+    return state;
+}
+
+static void run_for(uint32_t duration_ms, bool rowing) {
+    uint32_t end_ms = now_ms + duration_ms;
+    while (now_ms < end_ms) {
+        uint16_t period = power_governor_profile()->imu_period_ms;
+        if (period == 0) {
+            now_ms = end_ms;    // SLEEP: the IMU task waits on the motion interrupt
+            break;
+        }
+        now_ms += period;
+        step(rowing);
+    }
+}
+
+int main(void) {
+    const runtime_config_t *config = runtime_config_boot();
+    host_set_time_us((uint64_t)BOOT_MS * 1000);
+    REQUIRE(power_governor_init() == ESP_OK, "init");
+    CHECK(power_governor_state() == POWER_STATE_ROWING, "starts rowing");
+
+    pthread_t reader;
+    pthread_create(&reader, NULL, stats_reader, NULL);
+
+    // Rowing stays at full rate
+    run_for(60000, true);
+    CHECK(power_governor_state() == POWER_STATE_ROWING, "still rowing after 60s");
+    CHECK(power_governor_profile()->imu_period_ms == config->imu_period_ms, "rowing IMU period");
+
+    // Still: REST after the hold, SLEEP after the second hold
+    uint32_t stopped_ms = now_ms;
+    run_for(config->gov_rest_hold_ms + 5000, false);
+    CHECK(power_governor_state() == POWER_STATE_REST, "REST after the hold");
+    CHECK(entered_ms[POWER_STATE_REST] >= stopped_ms + config->gov_rest_hold_ms &&
+          entered_ms[POWER_STATE_REST] <= stopped_ms + config->gov_rest_hold_ms + 500,
+          "REST at %u, stopped at %u", entered_ms[POWER_STATE_REST], stopped_ms);
+    CHECK(power_governor_profile()->imu_period_ms == config->rest_imu_period_ms, "rest IMU period");
+
+    run_for(config->gov_sleep_hold_ms, false);
+    CHECK(power_governor_state() == POWER_STATE_SLEEP, "SLEEP after the second hold");
+    CHECK(entered_ms[POWER_STATE_SLEEP] - entered_ms[POWER_STATE_REST] >= config->gov_sleep_hold_ms &&
+          entered_ms[POWER_STATE_SLEEP] - entered_ms[POWER_STATE_REST] <=
+              config->gov_sleep_hold_ms + config->rest_imu_period_ms,
+          "SLEEP %u ms after REST", entered_ms[POWER_STATE_SLEEP] - entered_ms[POWER_STATE_REST]);
+    CHECK(power_governor_profile()->imu_period_ms == 0, "sleep waits on the interrupt");
+
+    // Wake by interrupt, row a little, stop again, wake by a strong sample
+    run_for(600000, false);
+    uint32_t slept_ms = now_ms - entered_ms[POWER_STATE_SLEEP];
+    power_governor_wake(now_ms);
+    CHECK(power_governor_state() == POWER_STATE_ROWING, "interrupt wakes");
+    run_for(20000, true);
+    run_for(config->gov_rest_hold_ms + 1000, false);
+    CHECK(power_governor_state() == POWER_STATE_REST, "REST again");
+    run_for(2000, false);
+    now_ms += power_governor_profile()->imu_period_ms;
+    CHECK(step(true) == POWER_STATE_ROWING, "strong sample wakes");
+    run_for(5000, true);
+
+    __atomic_store_n(&reader_stop, true, __ATOMIC_RELAXED);
+    pthread_join(reader, NULL);
+
+    power_governor_stats_t stats;
+    power_governor_get_stats(&stats, now_ms);
+    uint32_t total = 0;
+    for (int i = 0; i < POWER_STATE_COUNT; i++) {
+        total += stats.time_in_state_ms[i];
+    }
+    CHECK(total == now_ms - BOOT_MS, "time accounted %u of %u ms", total, now_ms - BOOT_MS);
+    CHECK(stats.time_in_state_ms[POWER_STATE_SLEEP] == slept_ms,
+          "sleep time %u, expected %u", stats.time_in_state_ms[POWER_STATE_SLEEP], slept_ms);
+    CHECK(stats.transitions == 5, "transitions %u", stats.transitions);
+    CHECK(stats.wake_events == 2, "wake events %u", stats.wake_events);
+    CHECK(stats.last_wake_latency_ms == config->rest_imu_period_ms,
+          "sample wake latency %u ms", stats.last_wake_latency_ms);
+    CHECK(reader_copies > 0 && reader_torn == 0, "%lu of %lu concurrent copies torn", reader_torn, reader_copies);
+    printf("rowing %u ms, rest %u ms, sleep %u ms, %lu concurrent copies\n",
+           stats.time_in_state_ms[POWER_STATE_ROWING], stats.time_in_state_ms[POWER_STATE_REST],
+           stats.time_in_state_ms[POWER_STATE_SLEEP], reader_copies);
+    return test_report("test_power_governor");
+}
@@ -0,0 +1,100 @@
+// Runtime configuration against a store that behaves like the NVS one (an empty
+// save erases the key): non-finite values are refused from the console and from
+// stored text, and a change whose text does not fit the buffer (shrunk for this
+// build) is refused without touching what is stored or what runs.
+#include <math.h>
+#include <string.h>
+#include "runtime_config.h"
+#include "test_support.h"
+
+static char saved[RUNTIME_CONFIG_TEXT_MAX];
+static size_t saved_length = 0;
+static bool saved_present = false;
+static int save_calls = 0;
+
+static esp_err_t memory_load(char *text, size_t size, size_t *length) {
+    if (!saved_present) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *length = saved_length < size ? saved_length : size;
+    memcpy(text, saved, *length);
+    return ESP_OK;
+}
+
+static esp_err_t memory_save(const char *text, size_t length) {
+    save_calls++;
+    saved_present = length > 0;
+    saved_length = length;
+    memcpy(saved, text, length);
+    return ESP_OK;
+}
+
+static const runtime_config_store_t memory_store = {
+    .name = "memory",
+    .load = memory_load,
+    .save = memory_save,
+};
+
+static void store_text(const char *text) {
+    saved_present = true;
+    saved_length = strlen(text);
+    memcpy(saved, text, saved_length);
+}
+
+static esp_err_t set(const char *text) {
+    return runtime_config_set(text, strlen(text));
+}
+
+int main(void) {
+    host_log_set_level(ESP_LOG_NONE);
+    REQUIRE(runtime_config_init(&memory_store) == ESP_OK, "init with nothing stored");
+    runtime_config_reader_t *reader = runtime_config_register_reader("test");
+    const runtime_config_t *config = runtime_config_quiescent(reader);
+    const float threshold = config->stroke_threshold_g;
+
+    // NaN passes every range comparison, infinity the unbounded side of none
+    const char *non_finite[] = {
+        "stroke_threshold_g=nan", "stroke_threshold_g=NAN(1)", "stroke_threshold_g=-nan",
+        "gov_wake_accel_g=inf", "crab_gyro_dps=-infinity",
+    };
+    for (size_t i = 0; i < sizeof(non_finite) / sizeof(non_finite[0]); i++) {
+        CHECK(set(non_finite[i]) == ESP_ERR_INVALID_ARG, "%s staged", non_finite[i]);
+    }
+    bool restart = false;
+    CHECK(runtime_config_commit(&restart) == ESP_OK && save_calls == 0, "nothing staged, nothing saved");
+    config = runtime_config_quiescent(reader);
+    CHECK(config->stroke_threshold_g == threshold && isfinite(config->gov_wake_accel_g), "defaults still run");
+
+    // A valid change is saved and published
+    CHECK(set("stroke_threshold_g=2.5") == ESP_OK, "stage");
+    CHECK(runtime_config_commit(&restart) == ESP_OK && !restart, "commit");
+    config = runtime_config_quiescent(reader);
+    CHECK(config->stroke_threshold_g == 2.5f, "published %g", config->stroke_threshold_g);
+    CHECK(saved_present && saved_length == strlen("stroke_threshold_g=2.5\n") &&
+          memcmp(saved, "stroke_threshold_g=2.5\n", saved_length) == 0, "stored %.*s", (int)saved_length, saved);
+
+    // More changed fields than the text holds: refused, the stored and running
+    // configuration untouched, and nothing left staged
+    char before[RUNTIME_CONFIG_TEXT_MAX];
+    size_t before_length = saved_length;
+    memcpy(before, saved, saved_length);
+    int saves_before = save_calls;
+    CHECK(set("gov_rest_hold_ms=60000\ngov_sleep_hold_ms=120000\nstroke_min_interval_ms=400\n"
+              "split_min_speed_mm_s=1000\ncrab_gyro_dps=100\n") == ESP_OK, "stage a large change");
+    CHECK(runtime_config_commit(&restart) == ESP_ERR_INVALID_SIZE, "oversized text committed");
+    CHECK(save_calls == saves_before && saved_present && saved_length == before_length &&
+          memcmp(saved, before, before_length) == 0, "stored configuration changed (%d saves)", save_calls - saves_before);
+    config = runtime_config_quiescent(reader);
+    CHECK(config->stroke_threshold_g == 2.5f && config->gov_rest_hold_ms == GOV_REST_HOLD_MS &&
+          config->crab_gyro_dps == CAPTURE_CRAB_GYRO_DPS, "running configuration changed");
+    CHECK(runtime_config_commit(&restart) == ESP_OK && save_calls == saves_before, "the refused change stayed staged");
+
+    // Stored text from elsewhere: a non-finite line is skipped, the rest loads
+    store_text("stroke_threshold_g=nan\ngov_wake_accel_g=0.5\n");
+    REQUIRE(runtime_config_init(&memory_store) == ESP_OK, "init from stored text");
+    config = runtime_config_boot();
+    CHECK(config->stroke_threshold_g == threshold && config->gov_wake_accel_g == 0.5f,
+          "loaded threshold %g, wake %g", config->stroke_threshold_g, config->gov_wake_accel_g);
+
+    return test_report("test_runtime_config");
+}
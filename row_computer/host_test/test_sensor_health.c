@@ -0,0 +1,316 @@
+// Sensor health under scripted faults: a rig feeds the checks as the tasks do
+// (IMU at 1 kHz, magnetometer read at 100 Hz from a 15 Hz part, GNSS at 10 Hz)
+// and each scenario switches one fault on and off again. The events published
+// must name the right sensor, state, check and weight, at the sample the EWMA
+// arithmetic puts them (rate checks) or the exact sample (stuck, accuracy), and
+// every sensor must come back OK HEALTH_RECOVER_MS after the fault clears.
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "config/common_constants.h"
+#include "sensor_health.h"
+#include "test_support.h"
+
+#define ACCEL_LSB_PER_G     16400.0     // Canonical scale (HEALTH_ACCEL_NOISE_LSB is 0.1 g)
+#define STROKE_MS           2000
+#define MAG_UPDATE_HZ       15
+#define MAX_EVENTS          64
+#define COST_SAMPLES        2000000
+
+// Faults the rig applies while a scenario holds them (zero is clean)
+typedef struct {
+    bool imu_frozen;                // Every IMU count repeats the last sample
+    bool accel_pinned;              // Accelerometer x held on the rail
+    bool clipping_catches;          // The rail for a few samples at each catch
+    double accel_noise_lsb;         // Accelerometer x noise std (0: the normal floor)
+    uint32_t imu_error_every;       // Every nth IMU read fails
+    uint32_t mag_overflow_every;    // Every nth magnetometer read overflows
+    uint32_t horizontal_accuracy_mm;
+    uint32_t speed_accuracy_mm_s;
+    bool itow_frozen;               // Receiver repeats its last solution
+    bool fix_lost;
+} faults_t;
+
+typedef struct {
+    uint32_t at_ms;                 // After the fault starts
+    uint32_t tolerance_ms;
+    health_sensor_t sensor;
+    health_state_t state;
+    health_check_t check;
+} expected_event_t;
+
+static unsigned int seed = 7;
+static faults_t faults;
+static timebase_us_t now_us = 1000000;
+static uint32_t imu_reads = 0, mag_reads = 0;
+static mpu6050_raw_t last_raw;
+static float mag_field[3];
+static uint32_t mag_update = UINT32_MAX;
+static bus_subscriber_t *subs[HEALTH_SOURCES];
+static health_event_t events[MAX_EVENTS];
+static size_t event_count = 0;
+
+static double gaussian(void) {
+    double u1 = (rand_r(&seed) + 1.0) / ((double)RAND_MAX + 2.0);
+    double u2 = (rand_r(&seed) + 1.0) / ((double)RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static int16_t count(double value) {
+    return (int16_t)fmax(-32768.0, fmin(32767.0, lround(value)));
+}
+
+// Bias-corrected counts of a steady stroke: surge on x, gravity on z, pitch on the gyro
+static void imu_sample(uint32_t ms, mpu6050_raw_t *raw) {
+    double phase = 2.0 * M_PI * (ms % STROKE_MS) / STROKE_MS;
+    double noise_x = faults.accel_noise_lsb > 0.0 ? faults.accel_noise_lsb : 12.0;
+    raw->v[MPU6050_AX] = count(0.3 * ACCEL_LSB_PER_G * sin(phase) + noise_x * gaussian());
+    raw->v[MPU6050_AY] = count(12.0 * gaussian());
+    raw->v[MPU6050_AZ] = count(ACCEL_LSB_PER_G + 12.0 * gaussian());
+    raw->v[MPU6050_TEMP] = 2000;
+    raw->v[MPU6050_GX] = count(5.0 * gaussian());
+    raw->v[MPU6050_GY] = count(1000.0 * cos(phase) + 5.0 * gaussian());
+    raw->v[MPU6050_GZ] = count(5.0 * gaussian());
+    if (faults.accel_pinned || (faults.clipping_catches && ms % STROKE_MS < 25)) {
+        raw->v[MPU6050_AX] = INT16_MAX;
+    }
+}
+
+static void drain(void) {
+    health_event_t event;
+    for (int s = 0; s < HEALTH_SOURCES; s++) {
+        while (bus_receive(subs[s], &event)) {
+            if (event_count < MAX_EVENTS) {
+                events[event_count] = event;
+            }
+            event_count++;
+        }
+    }
+}
+
+// The rig for ms milliseconds, one step per millisecond
+static void run(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++, now_us += 1000) {
+        uint32_t now_ms = (uint32_t)(now_us / 1000);
+
+        bool ok = faults.imu_error_every == 0 || ++imu_reads % faults.imu_error_every != 0;
+        sensor_health_read(HEALTH_ACCEL, ok, now_us);
+        sensor_health_read(HEALTH_GYRO, ok, now_us);
+        if (ok) {
+            if (!faults.imu_frozen) {
+                imu_sample(now_ms, &last_raw);
+            }
+            sensor_health_imu_sample(&last_raw, now_us);
+        }
+
+        // The part updates at 15 Hz; reads in between return the same field
+        if (now_ms % 10 == 0) {
+            uint32_t update = (uint32_t)((uint64_t)now_ms * MAG_UPDATE_HZ / 1000);
+            if (update != mag_update) {
+                mag_update = update;
+                mag_field[0] = (float)(220.0 + 2.0 * gaussian());
+                mag_field[1] = (float)(-140.0 + 2.0 * gaussian());
+                mag_field[2] = (float)(380.0 + 2.0 * gaussian());
+            }
+            bool overflow = faults.mag_overflow_every != 0 && mag_reads++ % faults.mag_overflow_every == 0;
+            sensor_health_read(HEALTH_MAG, true, now_us);
+            sensor_health_mag_sample(overflow ? -4096.0f : mag_field[0], mag_field[1], mag_field[2], now_us);
+        }
+
+        if (now_ms % 100 == 0) {
+            static uint32_t itow_ms = 0;
+            itow_ms = faults.itow_frozen ? itow_ms : now_ms;
+            gps_data_t fix = {
+                .timestamp_us = now_us, .lat_e7 = 515000000, .lon_e7 = -1200000, .speed_mm_s = 4500,
+                .itow_ms = itow_ms, .satellites = 14, .valid_fix = !faults.fix_lost,
+            };
+            gps_health_t health = {
+                .horizontal_accuracy = faults.horizontal_accuracy_mm ? faults.horizontal_accuracy_mm : 1500,
+                .speed_accuracy = faults.speed_accuracy_mm_s ? faults.speed_accuracy_mm_s : 150,
+                .fix_type = faults.fix_lost ? 0 : 3, .satellites = 14, .timestamp_us = now_us,
+            };
+            sensor_health_read(HEALTH_GPS_POSITION, true, now_us);
+            sensor_health_read(HEALTH_GPS_SPEED, true, now_us);
+            sensor_health_gps_fix(&fix, &health);
+        }
+        drain();
+    }
+}
+
+// Samples for an EWMA starting at from and fed target to pass threshold
+static uint32_t ewma_samples(double from, double target, double threshold, double alpha) {
+    return (uint32_t)ceil(log((threshold - target) / (from - target)) / log(1.0 - alpha));
+}
+
+static bool all_ok(void) {
+    for (health_sensor_t sensor = 0; sensor < HEALTH_SENSORS; sensor++) {
+        sensor_health_status_t status;
+        if (sensor_health_get_status(sensor, &status) != ESP_OK || status.state != HEALTH_OK ||
+            status.weight != HEALTH_WEIGHT_FULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Hold a fault for fault_ms, clear it for clear_ms, and match the events published
+// (in any order within their tolerance) one for one against the expected ones
+static void scenario(const char *name, const faults_t *fault, uint32_t fault_ms, uint32_t clear_ms,
+                     const expected_event_t *expected, size_t expected_count) {
+    static const uint8_t weight[] = { HEALTH_WEIGHT_FULL, HEALTH_WEIGHT_DEGRADED, 0 };
+    timebase_us_t start_us = now_us;
+    event_count = 0;
+    faults = *fault;
+    run(fault_ms);
+    faults = (faults_t){ 0 };
+    run(clear_ms);
+
+    bool matched[MAX_EVENTS] = { false };
+    for (size_t e = 0; e < expected_count; e++) {
+        const expected_event_t *want = &expected[e];
+        size_t found = SIZE_MAX;
+        for (size_t i = 0; i < event_count && i < MAX_EVENTS && found == SIZE_MAX; i++) {
+            int64_t at_ms = (int64_t)((events[i].timestamp_us - start_us) / 1000);
+            if (!matched[i] && events[i].sensor == want->sensor && events[i].state == want->state &&
+                events[i].check == want->check && llabs(at_ms - (int64_t)want->at_ms) <= want->tolerance_ms) {
+                found = i;
+            }
+        }
+        CHECK(found != SIZE_MAX, "%s: no %s %d (%s) at %lu +- %lu ms", name, sensor_health_sensor_name(want->sensor),
+              want->state, sensor_health_check_name(want->check), (unsigned long)want->at_ms,
+              (unsigned long)want->tolerance_ms);
+        if (found != SIZE_MAX) {
+            matched[found] = true;
+            CHECK(events[found].weight == weight[want->state], "%s: weight %u", name, events[found].weight);
+        }
+    }
+    for (size_t i = 0; i < event_count && i < MAX_EVENTS; i++) {
+        CHECK(matched[i], "%s: unexpected %s %d (%s, %u) at %llu ms", name, sensor_health_sensor_name(events[i].sensor),
+              events[i].state, sensor_health_check_name(events[i].check), events[i].detail,
+              (unsigned long long)((events[i].timestamp_us - start_us) / 1000));
+    }
+    CHECK(event_count == expected_count, "%s: %zu events, %zu expected", name, event_count, expected_count);
+    CHECK(all_ok(), "%s: a sensor did not recover", name);
+}
+
+int main(void) {
+    host_log_set_level(ESP_LOG_NONE);
+    REQUIRE(sensor_health_init() == ESP_OK, "init");
+    subs[HEALTH_SOURCE_IMU] = bus_subscribe(sensor_health_topic(HEALTH_SOURCE_IMU), "test", NULL, 1);
+    subs[HEALTH_SOURCE_GPS] = bus_subscribe(sensor_health_topic(HEALTH_SOURCE_GPS), "test", NULL, 1);
+    REQUIRE(subs[HEALTH_SOURCE_IMU] != NULL && subs[HEALTH_SOURCE_GPS] != NULL, "subscribe");
+    const double imu = HEALTH_IMU_ALPHA, mag = HEALTH_MAG_ALPHA;
+    const double degraded = HEALTH_DEGRADED_RATE, failed = HEALTH_FAILED_RATE;
+    const uint32_t recover = HEALTH_RECOVER_MS;
+
+    // Rowing on healthy sensors, the magnetometer repeating between its updates
+    scenario("clean", &(faults_t){ 0 }, 30000, 0, NULL, 0);
+
+    // Frozen IMU: the 50th repeat fails both parts, the first new sample starts the
+    // recovery (a quiet axis may repeat a count on either side of the freeze)
+    scenario("imu frozen", &(faults_t){ .imu_frozen = true }, 1000, 3000, (const expected_event_t[]){
+        { HEALTH_IMU_STUCK_SAMPLES - 1, 1, HEALTH_ACCEL, HEALTH_FAILED, HEALTH_CHECK_STUCK },
+        { HEALTH_IMU_STUCK_SAMPLES - 1, 1, HEALTH_GYRO, HEALTH_FAILED, HEALTH_CHECK_STUCK },
+        { 1000 + recover, 2, HEALTH_ACCEL, HEALTH_OK, HEALTH_CHECK_NONE },
+        { 1000 + recover, 2, HEALTH_GYRO, HEALTH_OK, HEALTH_CHECK_NONE },
+    }, 4);
+
+    // A few clipped samples at each catch stay under the degraded rate...
+    scenario("clipping catches", &(faults_t){ .clipping_catches = true }, 30000, 0, NULL, 0);
+    sensor_health_status_t status;
+    sensor_health_get_status(HEALTH_ACCEL, &status);
+    float catch_rate = status.saturation_rate;
+    run(10000);
+
+    // ... a pinned rail fails the accelerometer, then recovers a step at a time
+    const uint32_t pinned_ms = 3000;
+    double pinned_rate = 1.0 - pow(1.0 - imu, pinned_ms);
+    scenario("accel pinned", &(faults_t){ .accel_pinned = true }, pinned_ms, 9000, (const expected_event_t[]){
+        { ewma_samples(0.0, 1.0, degraded, imu) - 1, 2, HEALTH_ACCEL, HEALTH_DEGRADED, HEALTH_CHECK_SATURATION },
+        { ewma_samples(0.0, 1.0, failed, imu) - 1, 2, HEALTH_ACCEL, HEALTH_FAILED, HEALTH_CHECK_SATURATION },
+        { pinned_ms + ewma_samples(pinned_rate, 0.0, failed, imu) - 1 + recover, 2,
+          HEALTH_ACCEL, HEALTH_DEGRADED, HEALTH_CHECK_SATURATION },
+        { pinned_ms + ewma_samples(pinned_rate, 0.0, degraded, imu) - 1 + recover, 2,
+          HEALTH_ACCEL, HEALTH_OK, HEALTH_CHECK_NONE },
+    }, 4);
+
+    // Noise floor jump on one axis: the step variance heads for twice the noise variance
+    const uint32_t noisy_ms = 3000;
+    const double noise = 2000.0, floor_var = 2.0 * 12.0 * 12.0, noise_var = 2.0 * noise * noise;
+    const double noise_max = (double)HEALTH_ACCEL_NOISE_LSB * HEALTH_ACCEL_NOISE_LSB;
+    uint32_t noisy_at = ewma_samples(floor_var, noise_var, noise_max, imu);
+    uint32_t quiet_at = ewma_samples(floor_var + (noise_var - floor_var) * (1.0 - pow(1.0 - imu, noisy_ms)),
+                                     floor_var, noise_max, imu);
+    scenario("accel noise", &(faults_t){ .accel_noise_lsb = noise }, noisy_ms, 6000, (const expected_event_t[]){
+        { noisy_at, noisy_at * 15 / 100, HEALTH_ACCEL, HEALTH_DEGRADED, HEALTH_CHECK_NOISE },
+        { noisy_ms + quiet_at + recover, quiet_at * 15 / 100, HEALTH_ACCEL, HEALTH_OK, HEALTH_CHECK_NONE },
+    }, 2);
+
+    // One IMU read in ten fails (the rate saws around its mean of 0.1)
+    const uint32_t erroring_ms = 4000;
+    uint32_t errors_at = ewma_samples(0.0, 0.1, degraded, imu);
+    uint32_t errors_clear_at = ewma_samples(0.1 * (1.0 - pow(1.0 - imu, erroring_ms)), 0.0, degraded, imu);
+    scenario("imu read errors", &(faults_t){ .imu_error_every = 10 }, erroring_ms, 6000, (const expected_event_t[]){
+        { errors_at, 50, HEALTH_ACCEL, HEALTH_DEGRADED, HEALTH_CHECK_READ_ERRORS },
+        { errors_at, 50, HEALTH_GYRO, HEALTH_DEGRADED, HEALTH_CHECK_READ_ERRORS },
+        { erroring_ms + errors_clear_at + recover, 50, HEALTH_ACCEL, HEALTH_OK, HEALTH_CHECK_NONE },
+        { erroring_ms + errors_clear_at + recover, 50, HEALTH_GYRO, HEALTH_OK, HEALTH_CHECK_NONE },
+    }, 4);
+
+    // Magnetometer overflow on one read in five (reads every 10 ms)
+    const uint32_t overflow_ms = 2000;
+    uint32_t overflow_at = ewma_samples(0.0, 0.2, degraded, mag) * 10;
+    uint32_t overflow_clear_at = ewma_samples(0.2, 0.0, degraded, mag) * 10;
+    scenario("mag overflow", &(faults_t){ .mag_overflow_every = 5 }, overflow_ms, 4000, (const expected_event_t[]){
+        { overflow_at, 60, HEALTH_MAG, HEALTH_DEGRADED, HEALTH_CHECK_RANGE },
+        { overflow_ms + overflow_clear_at + recover, 60, HEALTH_MAG, HEALTH_OK, HEALTH_CHECK_NONE },
+    }, 2);
+
+    // GNSS, one fix each 100 ms from the start of the fault: multipath on one fix...
+    scenario("gps multipath", &(faults_t){ .horizontal_accuracy_mm = 15000 }, 100, 3000, (const expected_event_t[]){
+        { 0, 0, HEALTH_GPS_POSITION, HEALTH_FAILED, HEALTH_CHECK_ACCURACY },
+        { 100 + recover, 0, HEALTH_GPS_POSITION, HEALTH_OK, HEALTH_CHECK_NONE },
+    }, 2);
+
+    // ... a poor speed estimate for a second...
+    scenario("gps speed accuracy", &(faults_t){ .speed_accuracy_mm_s = 600 }, 1000, 3000, (const expected_event_t[]){
+        { 0, 0, HEALTH_GPS_SPEED, HEALTH_DEGRADED, HEALTH_CHECK_ACCURACY },
+        { 1000 + recover, 0, HEALTH_GPS_SPEED, HEALTH_OK, HEALTH_CHECK_NONE },
+    }, 2);
+
+    // ... the same solution over and over (the fifth repeat fails)...
+    uint32_t stuck_ms = (HEALTH_GPS_STUCK_FIXES - 1) * 100;
+    scenario("gps stuck", &(faults_t){ .itow_frozen = true }, 1000, 3000, (const expected_event_t[]){
+        { stuck_ms, 0, HEALTH_GPS_POSITION, HEALTH_FAILED, HEALTH_CHECK_STUCK },
+        { stuck_ms, 0, HEALTH_GPS_SPEED, HEALTH_FAILED, HEALTH_CHECK_STUCK },
+        { 1000 + recover, 0, HEALTH_GPS_POSITION, HEALTH_OK, HEALTH_CHECK_NONE },
+        { 1000 + recover, 0, HEALTH_GPS_SPEED, HEALTH_OK, HEALTH_CHECK_NONE },
+    }, 4);
+
+    // ... and no fix at all, whatever accuracy the receiver claims
+    scenario("gps fix lost", &(faults_t){ .fix_lost = true }, 1000, 3000, (const expected_event_t[]){
+        { 0, 0, HEALTH_GPS_POSITION, HEALTH_FAILED, HEALTH_CHECK_ACCURACY },
+        { 0, 0, HEALTH_GPS_SPEED, HEALTH_FAILED, HEALTH_CHECK_ACCURACY },
+        { 1000 + recover, 0, HEALTH_GPS_POSITION, HEALTH_OK, HEALTH_CHECK_NONE },
+        { 1000 + recover, 0, HEALTH_GPS_SPEED, HEALTH_OK, HEALTH_CHECK_NONE },
+    }, 4);
+
+    // Cost of the checks on one IMU sample, cycling through a stroke of samples
+    static mpu6050_raw_t stroke[STROKE_MS];
+    for (uint32_t ms = 0; ms < STROKE_MS; ms++) {
+        imu_sample(ms, &stroke[ms]);
+    }
+    event_count = 0;
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (uint32_t i = 0; i < COST_SAMPLES; i++, now_us += 1000) {
+        sensor_health_imu_sample(&stroke[i % STROKE_MS], now_us);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ns = ((end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec)) / COST_SAMPLES;
+    drain();
+    CHECK(event_count == 0, "%zu events from the cost run", event_count);
+
+    printf("catch saturation rate %.4f; %.1f ns per IMU sample on the host\n", catch_rate, ns);
+    return test_report("test_sensor_health");
+}
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""tools/session_download.py against the firmware's transfer server on a pty.
+
+    test_session_download.py <transfer_host> <session_download.py>
+
+Starts transfer_host with three synthetic sessions and a lossy line, then runs
+the host tool as a user would: list, get everything, get again after cutting a
+file short (resume), stats and config. Every download must match the card
+byte for byte, and the stats must show the losses were repaired.
+"""
+
+import json
+import os
+import subprocess
+import sys
+import time
+
+SESSIONS = 3
+CARD_DIR = "transfer_host.sd"
+OUT_DIR = "test_session_download.out"
+
+checks, failures = 0, 0
+
+
+def check(cond, message):
+    global checks, failures
+    checks += 1
+    if not cond:
+        failures += 1
+        print("FAIL %s" % message, file=sys.stderr)
+
+
+def tool(script, port, *args):
+    result = subprocess.run([sys.executable, script, port] + list(args), capture_output=True, text=True,
+                            timeout=60)
+    check(result.returncode == 0, "%s exited %d: %s" % (" ".join(args), result.returncode, result.stderr.strip()))
+    return result.stdout
+
+
+def same_file(a, b):
+    with open(a, "rb") as fa, open(b, "rb") as fb:
+        return fa.read() == fb.read()
+
+
+def main():
+    host, script = sys.argv[1], sys.argv[2]
+    device = subprocess.Popen([host, "-s", str(SESSIONS), "-l", "0.02"], stdout=subprocess.PIPE,
+                              stderr=subprocess.DEVNULL, text=True)
+    try:
+        port = device.stdout.readline().strip()
+        if not port.startswith("/dev/"):
+            print("FAIL transfer_host printed no pty path", file=sys.stderr)
+            return 1
+
+        listing = tool(script, port, "list").split()
+        names = sorted(name for name in listing if name.endswith(".LOG"))
+        check(len(names) == SESSIONS, "list shows %d sessions" % len(names))
+
+        os.makedirs(OUT_DIR, exist_ok=True)
+        for name in os.listdir(OUT_DIR):
+            os.unlink(os.path.join(OUT_DIR, name))
+        started = time.monotonic()
+        tool(script, port, "get", "-d", OUT_DIR)
+        for name in names:
+            check(same_file(os.path.join(CARD_DIR, name), os.path.join(OUT_DIR, name)),
+                  "%s downloaded intact" % name)
+
+        # A download cut short is resumed from where it stopped
+        partial = os.path.join(OUT_DIR, names[-1])
+        size = os.path.getsize(partial)
+        with open(partial, "r+b") as f:
+            f.truncate(size // 3)
+        tool(script, port, "get", "-d", OUT_DIR, names[-1][1:5].lstrip("0"))
+        check(same_file(os.path.join(CARD_DIR, names[-1]), partial), "%s resumed intact" % names[-1])
+        elapsed = time.monotonic() - started
+        total = sum(os.path.getsize(os.path.join(CARD_DIR, name)) for name in names)
+
+        counters = json.loads(tool(script, port, "stats"))["counters"]
+        check(counters.get("xfer.kbytes", 0) >= total // 1024, "xfer.kbytes counts every byte sent")
+        check(counters.get("xfer.retransmits", 0) + counters.get("xfer.timeouts", 0) > 0,
+              "corrupted frames were resent")
+        check(counters.get("xfer.bad_frames", 0) == 0, "no bad frames from the host")
+        check(counters.get("xfer.muted_lines", 0) == 0, "the pty does not mute the console")
+
+        fields = json.loads(tool(script, port, "config", "--json"))
+        check(len(fields) > 0, "config lists fields")
+        print("%d sessions, %d bytes in %.2f s with 2%% of frames corrupted" % (len(names), total, elapsed))
+    finally:
+        device.terminate()
+        device.wait()
+
+    print("test_session_download: %d checks, %d failed" % (checks, failures))
+    return 0 if failures == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
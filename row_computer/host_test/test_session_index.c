@@ -0,0 +1,150 @@
+// Session piece index after clean closes and crashes: an outing of three pieces
+// is written through the real writer, then the index is loaded from the footer,
+// from the sidecar with the footer torn off, from a record scan, and from crash
+// images - the log and sidecar as they were before the close, truncated at byte
+// offsets through the whole file. Every load must succeed and every piece it
+// lists must be one the writer made; recovery of a crash image must end in a
+// footer that agrees with the surviving data.
+#include <string.h>
+#include "session_index.h"
+#include "log_block.h"
+#include "session_card.h"
+#include "test_support.h"
+
+#define PIECES          3
+#define PIECE_S         400
+#define REST_S          60
+#define STROKES         (PIECE_S * 1000 / CARD_STROKE_MS)
+
+static session_piece_t reference[SESSION_MAX_PIECES];
+static size_t reference_count = 0;
+
+// Piece i as the writer made it; a crash image may only have an older checkpoint
+// of the last piece it lists
+static bool plausible(const session_piece_t *piece, size_t i, size_t count, uint32_t data_end) {
+    const session_piece_t *ref = &reference[i];
+    if (piece->number != i || piece->offset_start != ref->offset_start || piece->start_ms != ref->start_ms ||
+        piece->offset_end <= piece->offset_start || piece->offset_end > data_end) {
+        return false;
+    }
+    if (i + 1 < count) {
+        return piece->offset_end == ref->offset_end && piece->stroke_count == ref->stroke_count;
+    }
+    return piece->stroke_count <= ref->stroke_count && piece->end_ms <= ref->end_ms;
+}
+
+int main(void) {
+    host_log_set_level(ESP_LOG_ERROR);      // Every torn image warns that it is scanned
+    card_reset();
+    REQUIRE(session_log_init() == ESP_OK, "mount");
+
+    char log_path[SESSION_PATH_MAX], sidecar_path[SESSION_PATH_MAX];
+    char crash_log[SESSION_PATH_MAX], crash_sidecar[SESSION_PATH_MAX];
+    session_log_path(1, log_path, sidecar_path);
+    session_log_path(2, crash_log, crash_sidecar);
+    const char *image_log = SESSION_LOG_DIR "/IMAGE.LOG";
+    const char *image_sidecar = SESSION_LOG_DIR "/IMAGE.IDX";
+
+    timebase_us_t end_us = card_row_outing(1000000, PIECES, PIECE_S, REST_S, NULL);
+    card_copy(log_path, image_log, -1);             // As the card was at power loss
+    card_copy(sidecar_path, image_sidecar, -1);
+    REQUIRE(session_log_close(timebase_ms(end_us)) == ESP_OK, "close");
+
+    // Clean close: the footer
+    session_index_source_t source;
+    REQUIRE(session_index_load(log_path, sidecar_path, reference, SESSION_MAX_PIECES, &reference_count,
+                               &source) == ESP_OK, "load");
+    CHECK(source == SESSION_INDEX_FOOTER, "clean session read from the footer (source %d)", source);
+    CHECK(reference_count == PIECES, "%zu pieces", reference_count);
+    for (size_t i = 0; i < reference_count; i++) {
+        const session_piece_t *p = &reference[i];
+        CHECK(p->number == i && !(p->flags & SESSION_PIECE_OPEN), "piece %zu closed", i);
+        CHECK(p->stroke_count == STROKES, "piece %zu: %u strokes", i, p->stroke_count);
+        CHECK(p->end_ms - p->start_ms == (STROKES - 1) * CARD_STROKE_MS, "piece %zu: %lu ms", i,
+              (unsigned long)(p->end_ms - p->start_ms));
+        CHECK(p->distance_m >= (PIECE_S - 1) * CARD_METRES_PER_S && p->distance_m <= PIECE_S * CARD_METRES_PER_S,
+              "piece %zu: %lu m", i, (unsigned long)p->distance_m);
+        CHECK(p->avg_split_ds >= 1240 && p->avg_split_ds <= 1260, "piece %zu: split %u ds", i, p->avg_split_ds);
+        CHECK(i == 0 || p->offset_start >= reference[i - 1].offset_end, "piece %zu after piece %zu", i, i - 1);
+    }
+
+    // Footer torn off: the sidecar, then the record scan, list the same pieces
+    session_piece_t pieces[SESSION_MAX_PIECES];
+    size_t count = 0;
+    long log_size = card_file_size(log_path);
+    card_copy(log_path, crash_log, log_size - 1);
+    card_copy(sidecar_path, crash_sidecar, -1);
+    REQUIRE(session_index_load(crash_log, crash_sidecar, pieces, SESSION_MAX_PIECES, &count, &source) == ESP_OK,
+            "sidecar load");
+    CHECK(source == SESSION_INDEX_SIDECAR && count == reference_count &&
+          memcmp(pieces, reference, count * sizeof(pieces[0])) == 0, "sidecar matches the footer");
+    REQUIRE(session_index_load(crash_log, NULL, pieces, SESSION_MAX_PIECES, &count, &source) == ESP_OK,
+            "scan");
+    CHECK(source == SESSION_INDEX_SCAN && count == reference_count, "scan found %zu pieces", count);
+    for (size_t i = 0; i < count && i < reference_count; i++) {
+        // The scan cannot tell the last piece was closed by the session close
+        CHECK(memcmp(&pieces[i], &reference[i], offsetof(session_piece_t, flags)) == 0,
+              "scanned piece %zu matches the writer's", i);
+    }
+
+    // Crash images cut anywhere, the sidecar cut at a point of its own
+    long image_size = card_file_size(image_log);
+    long sidecar_size = card_file_size(image_sidecar);
+    unsigned long cuts = 0, load_failures = 0, bad_pieces = 0, bad_recoveries = 0;
+    for (long cut = 0; cut <= image_size; cut += cut < LOG_BLOCK_SIZE + 64 ? 7 : 997) {
+        long sidecar_cut = cut * sidecar_size / image_size + (long)(cuts % 40);
+        card_copy(image_log, crash_log, cut);
+        card_copy(image_sidecar, crash_sidecar, sidecar_cut < sidecar_size ? sidecar_cut : sidecar_size);
+        cuts++;
+
+        esp_err_t err = session_index_load(crash_log, crash_sidecar, pieces, SESSION_MAX_PIECES, &count, &source);
+        if (cut < LOG_BLOCK_SIZE) {
+            continue;                       // No file header: nothing to list
+        }
+        if (err != ESP_OK) {
+            load_failures++;
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (i >= reference_count || !plausible(&pieces[i], i, count, (uint32_t)image_size)) {
+                bad_pieces++;
+                break;
+            }
+        }
+
+        // Boot recovery cuts the index to the data that survived
+        if (session_log_recover(2) != ESP_OK ||
+            session_index_load(crash_log, NULL, pieces, SESSION_MAX_PIECES, &count, &source) != ESP_OK ||
+            source != SESSION_INDEX_FOOTER) {
+            bad_recoveries++;
+            continue;
+        }
+        uint32_t data_end = (uint32_t)(cut / LOG_BLOCK_SIZE) * LOG_BLOCK_SIZE;
+        for (size_t i = 0; i < count; i++) {
+            if (i >= reference_count || !plausible(&pieces[i], i, count, data_end)) {
+                bad_recoveries++;
+                break;
+            }
+        }
+    }
+    CHECK(load_failures == 0, "%lu of %lu crash images failed to load", load_failures, cuts);
+    CHECK(bad_pieces == 0, "%lu crash images listed pieces the writer never made", bad_pieces);
+    CHECK(bad_recoveries == 0, "%lu recoveries left an index past the data", bad_recoveries);
+
+    // Sidecar torn at every byte, log complete: whole entries are used, a torn
+    // tail is ignored, and with no whole entry the records are scanned
+    card_copy(image_log, crash_log, -1);
+    unsigned long sidecar_failures = 0;
+    size_t entry_size = sizeof(session_piece_t) + sizeof(uint32_t);
+    for (long sidecar_cut = 0; sidecar_cut <= sidecar_size; sidecar_cut++) {
+        card_copy(image_sidecar, crash_sidecar, sidecar_cut);
+        esp_err_t err = session_index_load(crash_log, crash_sidecar, pieces, SESSION_MAX_PIECES, &count, &source);
+        session_index_source_t expected = sidecar_cut >= (long)entry_size ? SESSION_INDEX_SIDECAR : SESSION_INDEX_SCAN;
+        sidecar_failures += err != ESP_OK || source != expected;
+    }
+    CHECK(sidecar_failures == 0, "%lu of %ld sidecar cuts mis-loaded", sidecar_failures, sidecar_size + 1);
+
+    printf("%zu pieces, log %ld bytes, sidecar %ld bytes: %lu crash images, %ld sidecar cuts\n",
+           reference_count, log_size, sidecar_size, cuts, sidecar_size + 1);
+    return test_report("test_session_index");
+}
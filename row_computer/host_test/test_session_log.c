@@ -0,0 +1,281 @@
+// Session log writer on a failing and a failing-power card.
+//
+// Card faults: write() and fsync() are interposed so the card can refuse them.
+// A session whose header cannot be written is not opened and leaks no file;
+// failed flushes and syncs come back from session_log_tick()/append() and are
+// counted, the sidecar gets no checkpoint the log does not back, and the data
+// is written once the card answers again.
+//
+// Power loss: a long outing is written and the log is cut at random byte
+// offsets, the rest of the file filled with stale-cluster garbage and the
+// sidecar rolled back to its size at that moment. Recovery must end the data at
+// the last whole block, lose no record that waited less than the flush bound,
+// and find the end in O(log n) block reads. SESSION_TORTURE_HOURS and
+// SESSION_TORTURE_CUTS size the run.
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include "session_index.h"
+#include "log_block.h"
+#include "session_card.h"
+#include "test_support.h"
+
+// ---- Card: real host files, with write/fsync failures and read accounting ----
+static bool card_fail_writes = false;
+static bool card_fail_syncs = false;
+static unsigned long card_reads = 0;
+
+ssize_t write(int fd, const void *buf, size_t len) {
+    if (card_fail_writes) {
+        errno = EIO;
+        return -1;
+    }
+    return syscall(SYS_write, fd, buf, len);
+}
+
+ssize_t read(int fd, void *buf, size_t len) {
+    card_reads++;
+    return syscall(SYS_read, fd, buf, len);
+}
+
+int fsync(int fd) {
+    if (card_fail_syncs) {
+        errno = EIO;
+        return -1;
+    }
+    return syscall(SYS_fsync, fd);
+}
+
+// Lowest free descriptor: a leaked file shows up as a change
+static int lowest_free_fd(void) {
+    int fd = open("/dev/null", O_RDONLY);
+    close(fd);
+    return fd;
+}
+
+static session_log_stats_t log_stats(void) {
+    session_log_stats_t stats;
+    session_log_get_stats(&stats);
+    return stats;
+}
+
+static timebase_us_t fault_now_us = 1000000;
+static uint16_t fault_strokes = 0;
+
+// Row for a while: a stroke every 2 s, a tick every 50 ms. Returns the first error.
+static esp_err_t row(uint32_t seconds) {
+    esp_err_t first = ESP_OK;
+    for (uint32_t step = 0; step < seconds * 20; step++) {
+        esp_err_t err = ESP_OK;
+        if (step % 40 == 0) {
+            session_stroke_t stroke = { .peak_cg = 150, .rate_spm = 30 };
+            err = session_log_append(SESSION_REC_STROKE, fault_now_us, &stroke, sizeof(stroke));
+            fault_strokes++;
+        }
+        esp_err_t tick = session_log_tick(timebase_ms(fault_now_us));
+        err = err != ESP_OK ? err : tick;
+        first = first != ESP_OK ? first : err;
+        fault_now_us += 50000;
+    }
+    return first;
+}
+
+static void check_card_faults(void) {
+    // The header block cannot be written: no session, no open file
+    int free_fd = lowest_free_fd();
+    card_fail_writes = true;
+    session_stroke_t stroke = { .peak_cg = 150, .rate_spm = 30 };
+    CHECK(session_log_append(SESSION_REC_STROKE, fault_now_us, &stroke, sizeof(stroke)) != ESP_OK, "open fails");
+    card_fail_writes = false;
+    CHECK(!session_log_is_open(), "no session after a failed open");
+    CHECK(lowest_free_fd() == free_fd, "failed open closed its files");
+    CHECK(log_stats().write_errors == 1, "failed open counted");
+
+    // The card answers again: the next stroke opens the session
+    CHECK(row(2) == ESP_OK && session_log_is_open(), "session opened");
+    char log_path[SESSION_PATH_MAX], sidecar_path[SESSION_PATH_MAX];
+    session_log_path(session_log_current_id(), log_path, sidecar_path);
+    long sidecar_size = card_file_size(sidecar_path);
+
+    // Syncs fail: reported and counted, and no piece checkpoint the log cannot
+    // back reaches the sidecar
+    card_fail_syncs = true;
+    uint32_t errors = log_stats().write_errors;
+    CHECK(row(SESSION_INDEX_CHECKPOINT_MS / 1000 + 2) != ESP_OK, "failed syncs returned");
+    CHECK(log_stats().write_errors > errors, "failed syncs counted");
+    CHECK(card_file_size(sidecar_path) == sidecar_size, "no sidecar entry without a durable log");
+
+    // Block writes fail: reported, and the records stay queued
+    card_fail_syncs = false;
+    card_fail_writes = true;
+    uint32_t blocks = log_stats().blocks_written;
+    CHECK(row(3) != ESP_OK, "failed block writes returned");
+    CHECK(log_stats().blocks_written == blocks, "no block counted as written");
+
+    // Card back: the queued block and the overdue checkpoint go out
+    card_fail_writes = false;
+    CHECK(row(2) == ESP_OK, "ticks succeed once the card answers");
+    CHECK(log_stats().blocks_written > blocks, "queued block written");
+    CHECK(card_file_size(sidecar_path) > sidecar_size, "sidecar checkpointed after the faults");
+
+    CHECK(session_log_close(timebase_ms(fault_now_us)) == ESP_OK, "close");
+    session_piece_t pieces[SESSION_MAX_PIECES];
+    size_t count;
+    session_index_source_t source;
+    CHECK(session_index_load(log_path, NULL, pieces, SESSION_MAX_PIECES, &count, &source) == ESP_OK &&
+          source == SESSION_INDEX_FOOTER && count == 1 && pieces[0].stroke_count == fault_strokes,
+          "every stroke kept (%zu pieces, %u of %u strokes)", count, count > 0 ? pieces[0].stroke_count : 0,
+          fault_strokes);
+}
+
+// ---- Power loss ----
+static timebase_us_t *written_us = NULL;    // When block n reached the card
+static long *sidecar_at = NULL;             // Sidecar size while block n was written
+static uint32_t blocks_before = 0;         // Written by earlier sessions
+static uint32_t blocks_seen = 0;
+static uint32_t blocks_max = 0;
+static long sidecar_size = 0;
+
+static void note_blocks(timebase_us_t now_us) {
+    session_log_stats_t stats = log_stats();
+    while (blocks_before + blocks_seen < stats.blocks_written && blocks_seen < blocks_max) {
+        written_us[blocks_seen] = now_us;
+        sidecar_at[blocks_seen] = sidecar_size;
+        blocks_seen++;
+    }
+    char sidecar_path[SESSION_PATH_MAX];
+    session_log_path(session_log_current_id(), NULL, sidecar_path);
+    sidecar_size = card_file_size(sidecar_path);
+}
+
+static uint8_t *load_file(const char *path, long *size) {
+    *size = card_file_size(path);
+    uint8_t *data = malloc(*size > 0 ? *size : 1);
+    FILE *f = fopen(path, "rb");
+    CHECK(f != NULL && fread(data, 1, *size, f) == (size_t)*size, "read %s", path);
+    if (f != NULL) {
+        fclose(f);
+    }
+    return data;
+}
+
+// The log up to cut, then stale clusters (and the torn sector) from garbage
+static void write_image(const char *path, const uint8_t *data, const uint8_t *garbage, long length, long cut) {
+    FILE *f = fopen(path, "wb");
+    fwrite(data, 1, cut, f);
+    fwrite(garbage + cut, 1, length - cut, f);
+    fclose(f);
+}
+
+static void check_power_loss(unsigned long hours, unsigned long cuts) {
+    blocks_before = log_stats().blocks_written;
+    blocks_max = (uint32_t)(hours * 3600 * 1000 / SESSION_LOG_FLUSH_MS * 2 + 16);
+    written_us = calloc(blocks_max, sizeof(*written_us));
+    sidecar_at = calloc(blocks_max, sizeof(*sidecar_at));
+
+    // Rowing with a 2 minute rest every 10 minutes
+    timebase_us_t start_us = 100ULL * 3600 * 1000000;
+    card_row_outing(start_us, (uint32_t)(hours * 6), 480, 120, note_blocks);
+    uint32_t id = session_log_current_id();
+    char log_path[SESSION_PATH_MAX], sidecar_path[SESSION_PATH_MAX];
+    char image_log[SESSION_PATH_MAX], image_sidecar[SESSION_PATH_MAX];
+    session_log_path(id, log_path, sidecar_path);
+    session_log_path(id + 1, image_log, image_sidecar);
+
+    long log_size, sidecar_total;
+    uint8_t *log = load_file(log_path, &log_size);
+    uint8_t *sidecar = load_file(sidecar_path, &sidecar_total);
+    session_log_stats_t written = log_stats();
+    uint32_t blocks = blocks_seen;
+    CHECK(blocks_before + blocks == written.blocks_written, "%u of %u block writes seen", blocks,
+          written.blocks_written - blocks_before);
+    printf("%lu h session: %u blocks (%.1f MB), %u syncs, %u segments, sidecar %ld bytes\n", hours, blocks,
+           blocks * (double)LOG_BLOCK_SIZE / 1e6, written.syncs, written.segments, sidecar_total);
+
+    srand(7);
+    uint8_t *garbage = malloc(log_size);
+    for (long i = 0; i < log_size; i++) {
+        garbage[i] = (uint8_t)rand();
+    }
+    unsigned long wrong_end = 0, over_bound = 0, bad_index = 0, slow = 0;
+    uint32_t worst_loss_ms = 0;
+    unsigned long worst_reads = 0;
+    double worst_us = 0.0;
+    uint32_t capacity = (uint32_t)(log_size / LOG_BLOCK_SIZE);
+    unsigned long read_bound = (unsigned long)ceil(log2(capacity)) + 2;
+    for (unsigned long n = 0; n < cuts; n++) {
+        long cut = LOG_BLOCK_SIZE + (long)((double)rand() / RAND_MAX * (blocks - 1) * LOG_BLOCK_SIZE);
+        if (n % 10 == 0) {
+            cut -= cut % LOG_BLOCK_SIZE;    // Between two block writes
+        }
+        uint32_t torn = (uint32_t)(cut / LOG_BLOCK_SIZE);
+        write_image(image_log, log, garbage, log_size, cut);
+        card_copy(sidecar_path, image_sidecar, sidecar_at[torn < blocks ? torn : blocks - 1]);
+
+        unsigned long reads_before = card_reads;
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        esp_err_t err = session_log_recover(id + 1);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double us = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3;
+        worst_us = fmax(worst_us, us);
+        unsigned long reads = card_reads - reads_before;
+        worst_reads = reads > worst_reads ? reads : worst_reads;
+        slow += reads > read_bound;
+
+        // A cut past the used payload only lost padding: that block is whole
+        const log_block_t *block = (const log_block_t *)(log + (long)torn * LOG_BLOCK_SIZE);
+        if (torn < blocks && cut - (long)torn * LOG_BLOCK_SIZE >= (long)(sizeof(log_block_header_t) + block->header.length)) {
+            torn++;
+            block++;
+        }
+        uint32_t end = log_stats().recovered_blocks + 1;
+        wrong_end += err != ESP_OK || end != torn;
+
+        // What was lost is block torn: it waited since its first (timebase) record
+        if (torn < blocks) {
+            session_timebase_t timebase;
+            memcpy(&timebase, block->payload + sizeof(session_rec_header_t), sizeof(timebase));
+            uint32_t loss_ms = (uint32_t)((written_us[torn] - timebase.base_us) / 1000);
+            worst_loss_ms = loss_ms > worst_loss_ms ? loss_ms : worst_loss_ms;
+            over_bound += loss_ms > SESSION_LOG_FLUSH_MS + CARD_STEP_MS;
+        }
+
+        session_piece_t pieces[SESSION_MAX_PIECES];
+        size_t count;
+        session_index_source_t source;
+        if (session_index_load(image_log, NULL, pieces, SESSION_MAX_PIECES, &count, &source) != ESP_OK ||
+            source != SESSION_INDEX_FOOTER) {
+            bad_index++;
+            continue;
+        }
+        for (size_t i = 0; i < count && i < SESSION_MAX_PIECES; i++) {
+            if (pieces[i].number != i || pieces[i].offset_end > end * LOG_BLOCK_SIZE) {
+                bad_index++;
+                break;
+            }
+        }
+    }
+    CHECK(wrong_end == 0, "%lu of %lu recoveries did not end at the last whole block", wrong_end, cuts);
+    CHECK(over_bound == 0, "%lu cuts lost records older than %u ms", over_bound, SESSION_LOG_FLUSH_MS);
+    CHECK(bad_index == 0, "%lu recovered indexes unusable", bad_index);
+    CHECK(slow == 0, "%lu recoveries took more than %lu reads", slow, read_bound);
+    printf("%lu cuts: worst loss %u ms (bound %u), worst recovery %lu reads (bound %lu), %.0f us\n",
+           cuts, worst_loss_ms, SESSION_LOG_FLUSH_MS, worst_reads, read_bound, worst_us);
+    free(log);
+    free(sidecar);
+    free(garbage);
+}
+
+int main(void) {
+    host_log_set_level(ESP_LOG_NONE);       // Faults and recoveries are logged on purpose
+    card_reset();
+    REQUIRE(session_log_init() == ESP_OK, "mount");
+    check_card_faults();
+    check_power_loss(test_env_ul("SESSION_TORTURE_HOURS", 3), test_env_ul("SESSION_TORTURE_CUTS", 400));
+    return test_report("test_session_log");
+}
@@ -0,0 +1,511 @@
+// Long-session soak: the real DSP, logging and deferred log tasks for hours of
+// virtual time, fed as the acquisition tasks feed them - 1 kHz IMU through the
+// multi-rate tree and the power governor, 10 Hz GPS through sensor health - on
+// a randomised training day of pieces, rests and breaks long enough to sleep.
+//
+// Faults: IMU read gaps, saturated spikes and crabs, GPS fix loss and silence,
+// SD card stalls (fsync blocks the logging task) and a 32-bit millisecond wrap
+// of the timebase part way in. The report covers timestamp monotonicity per
+// stream and per record type, filter transients in the 1 Hz summary, bus and
+// queue losses and high-water marks, sample-to-log latency percentiles, strokes
+// logged against strokes rowed, heap allocations after start and RSS growth.
+//
+// SOAK_HOURS (default 1) and SOAK_SEED (default 42) size the run.
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include "tasks_common.h"
+#include "display_task.h"
+#include "event_capture.h"
+#include "multirate.h"
+#include "power_governor.h"
+#include "sensor_health.h"
+#include "deferred_log.h"
+#include "runtime_config.h"
+#include "stats.h"
+#include "session_index.h"
+#include "session_card.h"
+#include "test_support.h"
+
+TaskHandle_t imu_task_handle = NULL;
+TaskHandle_t gps_task_handle = NULL;
+TaskHandle_t dsp_task_handle = NULL;
+TaskHandle_t logging_task_handle = NULL;
+TaskHandle_t display_task_handle = NULL;
+TaskHandle_t dlog_task_handle = NULL;
+TaskHandle_t transfer_task_handle = NULL;
+bus_topic_t *gps_topic = NULL;
+QueueHandle_t dsp_record_queue = NULL;
+
+esp_err_t imu_enable_motion_wakeup(uint16_t threshold_mg) {
+    return ESP_OK;
+}
+
+esp_err_t imu_disable_motion_wakeup(void) {
+    return ESP_OK;
+}
+
+void display_task_publish_metrics(const display_metrics_t *metrics) {
+}
+
+#define WARMUP_S            120         // Heap and RSS baselines are taken after this
+#define SPIKE_EVERY_S       180         // Mean interval of each fault
+#define IMU_GAP_EVERY_S     420
+#define CRAB_EVERY_S        660
+#define FIX_LOSS_EVERY_S    780
+#define GPS_SILENCE_EVERY_S 1020
+#define SD_STALL_EVERY_S    540
+#define SD_STALL_MAX_MS     1500
+#define LATENCY_BINS        50000       // 0.1 ms each
+#define RSS_GROWTH_MAX_KB   1024
+#define MAX_STEP_US         10000       // Clock steps while the IMU is slow, so task deadlines keep time
+
+static unsigned int seed;
+
+static float uniform(float lo, float hi) {
+    return lo + (hi - lo) * (float)rand_r(&seed) / (float)RAND_MAX;
+}
+
+static float noise(float sigma) {
+    return sigma * (uniform(-1.0f, 1.0f) + uniform(-1.0f, 1.0f) + uniform(-1.0f, 1.0f));
+}
+
+// A fault of mean interval every_s happens in this step of step_ms
+static bool fault_due(uint32_t every_s, uint32_t step_ms) {
+    return (float)rand_r(&seed) / (float)RAND_MAX < (float)step_ms / (every_s * 1000.0f);
+}
+
+// ---- Training day: pieces at a rate with rests between, then a break ----
+typedef struct {
+    uint64_t end_us;
+    bool rowing;
+    float spm;
+} plan_step_t;
+
+static plan_step_t plan;
+static uint32_t plan_pieces_left = 0;
+static uint64_t stroke_phase_start_us = 0;
+
+static void plan_next(uint64_t now_us) {
+    if (plan.rowing) {
+        // Rest between pieces, or the break after the session (long enough to sleep)
+        plan.rowing = false;
+        float rest_s = plan_pieces_left > 0 ? uniform(60.0f, 240.0f) : uniform(420.0f, 2400.0f);
+        plan.end_us = now_us + (uint64_t)(rest_s * 1e6f);
+        return;
+    }
+    if (plan_pieces_left == 0) {
+        plan_pieces_left = 3 + (uint32_t)uniform(0.0f, 4.0f);
+    }
+    plan_pieces_left--;
+    plan.rowing = true;
+    plan.spm = uniform(18.0f, 34.0f);
+    plan.end_us = now_us + (uint64_t)(uniform(60.0f, 480.0f) * 1e6f);
+    stroke_phase_start_us = now_us;
+}
+
+// ---- Fault state ----
+static uint64_t imu_gap_end_us = 0;
+static uint64_t crab_end_us = 0;
+static uint64_t fix_loss_end_us = 0;
+static uint64_t gps_silence_end_us = 0;
+static uint32_t faults_spikes = 0, faults_gaps = 0, faults_crabs = 0;
+static uint32_t faults_fix_loss = 0, faults_silences = 0, faults_stalls = 0;
+static uint32_t stall_pending_ms = 0;
+static uint32_t stall_worst_ms = 0;
+
+// The logging task's card syncs; a pending stall blocks it for that long in
+// virtual time. No real sync - the card is a build directory.
+int fsync(int fd) {
+    uint32_t stall_ms = __atomic_exchange_n(&stall_pending_ms, 0, __ATOMIC_RELAXED);
+    if (stall_ms > 0) {
+        host_sleep_until_us(host_time_us() + (uint64_t)stall_ms * 1000);
+    }
+    return 0;
+}
+
+// ---- Log side: every record the logging task appends ----
+typedef struct {
+    uint64_t bins[LATENCY_BINS + 1];
+    uint64_t count;
+} latency_t;
+
+static latency_t stroke_latency, fix_latency;
+static timebase_us_t last_record_us[SESSION_REC_TYPES];
+static uint32_t record_regressions[SESSION_REC_TYPES];
+static uint32_t records_logged[SESSION_REC_TYPES];
+static uint32_t summary_transients = 0;
+
+static void latency_add(latency_t *l, timebase_us_t from_us) {
+    uint64_t bin = (timebase_now_us() - from_us) / 100;
+    l->bins[bin < LATENCY_BINS ? bin : LATENCY_BINS]++;
+    l->count++;
+}
+
+static float latency_ms(const latency_t *l, double quantile) {
+    uint64_t rank = (uint64_t)ceil(quantile * (double)l->count), seen = 0;
+    for (uint32_t bin = 0; bin <= LATENCY_BINS; bin++) {
+        seen += l->bins[bin];
+        if (seen >= rank && seen > 0) {
+            return bin / 10.0f;
+        }
+    }
+    return 0.0f;
+}
+
+esp_err_t __real_session_log_append(session_rec_type_t type, timebase_us_t timestamp_us,
+                                    const void *payload, uint8_t length);
+
+// Linked with --wrap: every append of the logging task passes through here
+esp_err_t __wrap_session_log_append(session_rec_type_t type, timebase_us_t timestamp_us,
+                                    const void *payload, uint8_t length) {
+    if (type < SESSION_REC_TYPES) {
+        record_regressions[type] += last_record_us[type] != 0 && timestamp_us <= last_record_us[type];
+        last_record_us[type] = timestamp_us;
+        records_logged[type]++;
+    }
+    if (type == SESSION_REC_STROKE) {
+        latency_add(&stroke_latency, timestamp_us);
+    } else if (type == SESSION_REC_FIX) {
+        latency_add(&fix_latency, timestamp_us);
+    } else if (type == SESSION_REC_SUMMARY) {
+        // Gravity is on z throughout: a partial filter sum shows as a dip
+        const session_summary_t *summary = payload;
+        summary_transients += summary->accel_mg[2] < 800 || summary->accel_mg[2] > 1200;
+    }
+    return __real_session_log_append(type, timestamp_us, payload, length);
+}
+
+static long rss_kb(void) {
+    long pages = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f != NULL) {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(f);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static uint32_t metric(const char *name) {
+    return stats_value(stats_register(name, STATS_COUNTER));
+}
+
+// ---- Acquisition: one IMU sample as the IMU task would publish it ----
+static uint32_t strokes_rowed = 0;
+static timebase_us_t last_stream_us[MULTIRATE_STREAM_COUNT];
+static uint32_t stream_regressions[MULTIRATE_STREAM_COUNT];
+static bus_subscriber_t *stream_subs[MULTIRATE_STREAM_COUNT];
+
+static void imu_step(uint64_t now_us, uint16_t period_ms) {
+    timebase_us_t stamp_us = timebase_now_us();
+    bool gap = now_us < imu_gap_end_us;
+    sensor_health_read(HEALTH_ACCEL, !gap, stamp_us);
+    sensor_health_read(HEALTH_GYRO, !gap, stamp_us);
+    if (gap) {
+        return;
+    }
+
+    // A stroke is a drive of a third of the cycle peaking past the detection
+    // threshold, then a recovery that brings the mean surge back to zero
+    float surge = 0.0f;
+    if (plan.rowing) {
+        float cycle_s = 60.0f / plan.spm;
+        float t = fmodf((float)(now_us - stroke_phase_start_us) * 1e-6f, cycle_s) / cycle_s;
+        float prev = fmodf((float)(now_us - stroke_phase_start_us - period_ms * 1000) * 1e-6f, cycle_s) / cycle_s;
+        surge = t < 0.35f ? 1.85f * sinf((float)M_PI * t / 0.35f)
+                          : -0.996f * sinf((float)M_PI * (t - 0.35f) / 0.65f);
+        strokes_rowed += now_us > stroke_phase_start_us && t < prev;
+    }
+
+    mpu6050_raw_t raw;
+    imu_data_t sample = {
+        .timestamp_us = stamp_us,
+        .accel_x = surge + noise(0.01f),
+        .accel_y = noise(plan.rowing ? 0.05f : 0.005f),
+        .accel_z = 1.0f + noise(plan.rowing ? 0.05f : 0.005f),
+        .gyro_x = noise(plan.rowing ? 2.0f : 0.2f),
+        .gyro_y = noise(plan.rowing ? 2.0f : 0.2f),
+        .gyro_z = now_us < crab_end_us ? 120.0f : noise(plan.rowing ? 2.0f : 0.2f),
+        .mag_x = 0.2f, .mag_y = 0.0f, .mag_z = 0.4f,
+    };
+    if (fault_due(SPIKE_EVERY_S, period_ms)) {
+        sample.accel_x = sample.accel_y = sample.accel_z = 2.0f;        // Saturated burst read
+        faults_spikes++;
+    }
+    raw.v[MPU6050_AX] = (int16_t)fmaxf(-32768.0f, fminf(32767.0f, sample.accel_x * LSB_SENSITIVITY_2g));
+    raw.v[MPU6050_AY] = (int16_t)fmaxf(-32768.0f, fminf(32767.0f, sample.accel_y * LSB_SENSITIVITY_2g));
+    raw.v[MPU6050_AZ] = (int16_t)fmaxf(-32768.0f, fminf(32767.0f, sample.accel_z * LSB_SENSITIVITY_2g));
+    raw.v[MPU6050_TEMP] = 0;
+    raw.v[MPU6050_GX] = (int16_t)(sample.gyro_x * LSB_SENSITIVITY_250_deg);
+    raw.v[MPU6050_GY] = (int16_t)(sample.gyro_y * LSB_SENSITIVITY_250_deg);
+    raw.v[MPU6050_GZ] = (int16_t)(sample.gyro_z * LSB_SENSITIVITY_250_deg);
+
+    event_capture_push(&raw, stamp_us);
+    sensor_health_imu_sample(&raw, stamp_us);
+    uint32_t produced = multirate_push(&sample);
+    if (produced & MULTIRATE_BIT(MULTIRATE_100HZ)) {
+        const imu_data_t *governed = multirate_latest(MULTIRATE_100HZ);
+        power_governor_update(governed->accel_x, governed->accel_y, governed->accel_z,
+                              governed->gyro_x, governed->gyro_y, governed->gyro_z, timebase_ms(stamp_us));
+    }
+    if (period_ms < 10 || (now_us / 1000) % 10 == 0) {
+        sensor_health_mag_sample(sample.mag_x + noise(0.002f), sample.mag_y + noise(0.002f), sample.mag_z, stamp_us);
+        sensor_health_read(HEALTH_MAG, true, stamp_us);
+    }
+
+    // Every stream, as its consumers see it
+    imu_data_t out;
+    for (int s = 0; s < MULTIRATE_STREAM_COUNT; s++) {
+        while (bus_receive(stream_subs[s], &out)) {
+            stream_regressions[s] += last_stream_us[s] != 0 && out.timestamp_us <= last_stream_us[s];
+            last_stream_us[s] = out.timestamp_us;
+        }
+    }
+}
+
+// ---- Acquisition: one GPS read as the GPS task would publish it ----
+static double track_m = 0.0;
+
+static void gps_step(uint32_t period_ms) {
+    timebase_us_t stamp_us = timebase_now_us();
+    bool silent = host_time_us() < gps_silence_end_us;
+    sensor_health_read(HEALTH_GPS_POSITION, !silent, stamp_us);
+    sensor_health_read(HEALTH_GPS_SPEED, !silent, stamp_us);
+    if (silent) {
+        return;
+    }
+    float speed_m_s = plan.rowing ? 4.0f + noise(0.1f) : 0.0f;
+    track_m += speed_m_s * period_ms / 1000.0;
+    gps_data_t fix = {
+        .timestamp_us = stamp_us,
+        .lat_e7 = 515000000 + (int32_t)noise(2.0f),
+        .lon_e7 = (int32_t)(track_m / (111320.0 * cos(51.5 * M_PI / 180.0)) * 1e7) + (int32_t)noise(2.0f),
+        .speed_mm_s = (uint32_t)(speed_m_s * 1000.0f),
+        .heading_e5 = 9000000,
+        .itow_ms = (uint32_t)(host_time_us() / 1000),
+        .satellites = 12,
+        .valid_fix = host_time_us() >= fix_loss_end_us,
+    };
+    gps_health_t health = {
+        .horizontal_accuracy = 1500,
+        .speed_accuracy = 150,
+        .fix_type = fix.valid_fix ? 3 : 0,
+        .satellites = fix.satellites,
+        .timestamp_us = stamp_us,
+    };
+    sensor_health_gps_fix(&fix, &health);
+    bus_publish(gps_topic, &fix, false);
+}
+
+static void inject_faults(uint64_t now_us, uint32_t step_ms) {
+    if (fault_due(IMU_GAP_EVERY_S, step_ms)) {
+        imu_gap_end_us = now_us + (uint64_t)uniform(20.0f, 300.0f) * 1000;
+        faults_gaps++;
+    }
+    if (plan.rowing && fault_due(CRAB_EVERY_S, step_ms)) {
+        crab_end_us = now_us + 150000;
+        faults_crabs++;
+    }
+    if (fault_due(FIX_LOSS_EVERY_S, step_ms)) {
+        fix_loss_end_us = now_us + (uint64_t)uniform(3.0f, 30.0f) * 1000000;
+        faults_fix_loss++;
+    }
+    if (fault_due(GPS_SILENCE_EVERY_S, step_ms)) {
+        gps_silence_end_us = now_us + (uint64_t)uniform(2.0f, 20.0f) * 1000000;
+        faults_silences++;
+    }
+    if (fault_due(SD_STALL_EVERY_S, step_ms)) {
+        uint32_t stall_ms = (uint32_t)uniform(100.0f, SD_STALL_MAX_MS);
+        __atomic_store_n(&stall_pending_ms, stall_ms, __ATOMIC_RELAXED);
+        stall_worst_ms = stall_ms > stall_worst_ms ? stall_ms : stall_worst_ms;
+        faults_stalls++;
+    }
+}
+
+int main(void) {
+    unsigned long hours = test_env_ul("SOAK_HOURS", 1);
+    seed = (unsigned int)test_env_ul("SOAK_SEED", 42);
+    uint64_t run_us = (uint64_t)hours * 3600000000ULL;
+
+    // The 32-bit millisecond timebase wraps 40% into the run (at most 5 h in)
+    uint64_t wrap_in_us = run_us * 2 / 5 < 5 * 3600000000ULL ? run_us * 2 / 5 : 5 * 3600000000ULL;
+    host_timer_offset_us = (1ULL << 32) * 1000 - wrap_in_us;
+    host_log_set_level(ESP_LOG_ERROR);
+    card_reset();
+
+    // Boot as app_main does, at the highest rates the configuration allows
+    REQUIRE(runtime_config_init(NULL) == ESP_OK, "config");
+    const char *rates = "imu_period_ms=1\ngps_period_ms=100";
+    bool restart = false;
+    REQUIRE(runtime_config_set(rates, strlen(rates)) == ESP_OK && runtime_config_commit(&restart) == ESP_OK,
+            "maximum rates");
+    REQUIRE(power_governor_init() == ESP_OK, "governor");
+    REQUIRE(event_capture_init(CAPTURE_RING_SAMPLES, CAPTURE_PRE_SAMPLES, CAPTURE_POST_SAMPLES) == ESP_OK,
+            "capture");
+    REQUIRE(session_log_init() == ESP_OK, "card");
+    REQUIRE(deferred_log_init() == ESP_OK, "deferred log");
+    REQUIRE(multirate_init() == ESP_OK && sensor_health_init() == ESP_OK, "topics");
+    gps_topic = bus_topic_create("gps", sizeof(gps_data_t), GPS_TOPIC_DEPTH);
+    dsp_record_queue = xQueueCreate(runtime_config_boot()->dsp_record_queue_size, sizeof(dsp_record_t));
+    for (int s = 0; s < MULTIRATE_STREAM_COUNT; s++) {
+        stream_subs[s] = bus_subscribe(multirate_topic(s), "soak", NULL, 1);
+    }
+    dlog_task_handle = host_task_create(deferred_log_task, "DLOG_TASK", NULL);
+    logging_task_handle = host_task_create(logging_task, "LOG_TASK", NULL);
+    dsp_task_handle = host_task_create(dsp_task, "DSP_TASK", NULL);
+    host_wait_idle();
+
+    runtime_config_reader_t *config_reader = runtime_config_register_reader("imu");
+    const runtime_config_t *applied_config = NULL;
+    uint64_t now_us = 0, next_imu_us = 0, next_gps_us = 0;
+    uint64_t next_report_us = 3600000000ULL;
+    long rss_start_kb = 0;
+    bool warm = false;
+    plan_next(0);
+
+    while (now_us < run_us) {
+        uint64_t next_us = next_imu_us < next_gps_us ? next_imu_us : next_gps_us;
+        now_us = next_us < now_us + MAX_STEP_US ? next_us : now_us + MAX_STEP_US;
+        host_set_time_us(now_us);
+        while (now_us >= plan.end_us) {
+            plan_next(plan.end_us);
+        }
+
+        if (now_us == next_imu_us) {
+            const runtime_config_t *config = runtime_config_quiescent(config_reader);
+            if (config != applied_config) {
+                power_governor_apply_config(config);
+                event_capture_set_crab_threshold(config->crab_gyro_dps);
+                applied_config = config;
+            }
+            uint16_t period_ms = power_governor_profile()->imu_period_ms;
+            if (period_ms == 0) {
+                // Asleep on wake-on-motion: the interrupt fires with the first stroke
+                if (plan.rowing) {
+                    power_governor_wake(timebase_now_ms());
+                }
+                next_imu_us = now_us + (plan.rowing ? 1000 : GOV_SLEEP_POLL_MS * 1000);
+            } else {
+                multirate_set_input(multirate_stream_for_period(period_ms));
+                imu_step(now_us, period_ms);
+                inject_faults(now_us, period_ms);
+                next_imu_us = now_us + (uint64_t)power_governor_profile()->imu_period_ms * 1000;
+                next_imu_us = next_imu_us > now_us ? next_imu_us : now_us + GOV_SLEEP_POLL_MS * 1000;
+            }
+        }
+        if (now_us == next_gps_us) {
+            gps_step(power_governor_profile()->gps_period_ms);
+            next_gps_us = now_us + (uint64_t)power_governor_profile()->gps_period_ms * 1000;
+        }
+        host_wait_idle();
+
+        if (!warm && now_us >= WARMUP_S * 1000000ULL) {
+            warm = true;
+            rss_start_kb = rss_kb();
+            host_heap_count(true);
+        }
+        if (now_us >= next_report_us) {
+            printf("%3llu h: %u strokes rowed, %u logged, RSS %ld kB\n",
+                   (unsigned long long)(now_us / 3600000000ULL), strokes_rowed,
+                   records_logged[SESSION_REC_STROKE], rss_kb());
+            fflush(stdout);
+            next_report_us += 3600000000ULL;
+        }
+    }
+    // Let the last batches reach the log
+    for (int i = 0; i < 100; i++) {
+        host_advance_ms(MAX_STEP_US / 1000);
+    }
+
+    // ---- Report ----
+    uint8_t buffer[2048];
+    stats_snapshot(buffer, sizeof(buffer));         // Runs the collectors
+    uint32_t queue_high_water = 0, queue_failures = 0;
+    host_queue_stats(dsp_record_queue, &queue_high_water, &queue_failures);
+    uint32_t queue_size = runtime_config_boot()->dsp_record_queue_size;
+    deferred_log_stats_t dlog;
+    deferred_log_get_stats(&dlog);
+    capture_stats_t capture;
+    event_capture_get_stats(&capture);
+    power_governor_stats_t governor;
+    power_governor_get_stats(&governor, timebase_now_ms());
+    long rss_growth_kb = rss_kb() - rss_start_kb;
+
+    printf("\n%lu h soak, seed %u\n", hours, (unsigned int)test_env_ul("SOAK_SEED", 42));
+    printf("faults: %u IMU gaps, %u spikes, %u crabs, %u fix losses, %u GPS silences, %u SD stalls "
+           "(worst %u ms), timebase wrap at %.1f h\n", faults_gaps, faults_spikes, faults_crabs, faults_fix_loss,
+           faults_silences, faults_stalls, stall_worst_ms, wrap_in_us / 3.6e9);
+    printf("strokes: %u rowed, %u logged, %u shapes; %u fixes, %u summaries, %u capture runs\n", strokes_rowed,
+           records_logged[SESSION_REC_STROKE], records_logged[SESSION_REC_STROKE_SHAPE],
+           records_logged[SESSION_REC_FIX], records_logged[SESSION_REC_SUMMARY], records_logged[SESSION_REC_CAPTURE]);
+    printf("latency to the log (ms): stroke p50 %.1f p99 %.1f max %.1f | fix p50 %.1f p99 %.1f max %.1f\n",
+           latency_ms(&stroke_latency, 0.5), latency_ms(&stroke_latency, 0.99), latency_ms(&stroke_latency, 1.0),
+           latency_ms(&fix_latency, 0.5), latency_ms(&fix_latency, 0.99), latency_ms(&fix_latency, 1.0));
+    printf("record queue high water %u/%u, deferred log high water %lu, capture overruns %lu (reported only)\n",
+           queue_high_water, queue_size, (unsigned long)dlog.high_water, (unsigned long)capture.overruns);
+    printf("governor: %lu wakes, %lu%% asleep; heap allocations after start %lu, RSS growth %ld kB\n",
+           (unsigned long)governor.wake_events,
+           (unsigned long)((uint64_t)governor.time_in_state_ms[POWER_STATE_SLEEP] * 100 / (run_us / 1000)),
+           host_heap_allocations(), rss_growth_kb);
+
+    const char *stream_names[MULTIRATE_STREAM_COUNT] = { "1 kHz", "100 Hz", "10 Hz", "1 Hz" };
+    for (int s = 0; s < MULTIRATE_STREAM_COUNT; s++) {
+        CHECK(stream_regressions[s] == 0, "%s stream stepped back %u times", stream_names[s], stream_regressions[s]);
+    }
+    const char *record_names[SESSION_REC_TYPES] = { "", "stroke", "fix", "summary", "shape", "timebase", "capture" };
+    for (int t = SESSION_REC_STROKE; t <= SESSION_REC_STROKE_SHAPE; t++) {
+        CHECK(record_regressions[t] == 0, "%s records stepped back %u times", record_names[t], record_regressions[t]);
+    }
+    CHECK(records_logged[SESSION_REC_CAPTURE] > 0, "no capture window reached the log");
+    CHECK(summary_transients == 0, "%u summaries off 1 g on z (partial filter sums)", summary_transients);
+    CHECK(records_logged[SESSION_REC_STROKE] >= strokes_rowed * 98 / 100 &&
+          records_logged[SESSION_REC_STROKE] <= strokes_rowed + faults_spikes,
+          "%u strokes logged of %u rowed", records_logged[SESSION_REC_STROKE], strokes_rowed);
+    CHECK(queue_failures == 0 && queue_high_water < queue_size, "record queue: %u full, high water %u/%u",
+          queue_failures, queue_high_water, queue_size);
+    CHECK(metric("bus.imu_1khz.dsp.dropped") == 0, "DSP lost %u IMU samples", metric("bus.imu_1khz.dsp.dropped"));
+    CHECK(metric("bus.gps.dsp.dropped") == 0, "DSP lost %u fixes", metric("bus.gps.dsp.dropped"));
+    CHECK(metric("bus.imu_1hz.log.dropped") == 0, "log lost %u summaries", metric("bus.imu_1hz.log.dropped"));
+    CHECK(dlog.dropped == 0, "deferred log dropped %lu lines", (unsigned long)dlog.dropped);
+    CHECK(latency_ms(&stroke_latency, 0.99) <= runtime_config_boot()->dsp_max_latency_ms + 10,
+          "stroke p99 %.1f ms", latency_ms(&stroke_latency, 0.99));
+    CHECK(latency_ms(&fix_latency, 0.99) <= runtime_config_boot()->log_max_latency_ms + 20,
+          "fix p99 %.1f ms", latency_ms(&fix_latency, 0.99));
+    CHECK(latency_ms(&stroke_latency, 1.0) <= SD_STALL_MAX_MS + 100 &&
+          latency_ms(&fix_latency, 1.0) <= SD_STALL_MAX_MS + runtime_config_boot()->log_max_latency_ms + 100,
+          "worst latency beyond the longest card stall");
+    CHECK(governor.wake_events > 0, "the governor never slept and woke");
+    CHECK(host_heap_allocations() == 0, "%lu heap allocations after start", host_heap_allocations());
+    CHECK(rss_growth_kb <= RSS_GROWTH_MAX_KB, "RSS grew %ld kB", rss_growth_kb);
+
+    // Every session closed by a sleep loads from its footer
+    DIR *dir = opendir(SESSION_LOG_DIR);
+    struct dirent *entry;
+    uint32_t sessions = 0, bad_sessions = 0, open_id = session_log_current_id();
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        uint32_t id;
+        if (!session_log_id_from_name(entry->d_name, &id) || id == open_id) {
+            continue;
+        }
+        char log_path[SESSION_PATH_MAX], sidecar_path[SESSION_PATH_MAX];
+        session_piece_t pieces[SESSION_MAX_PIECES];
+        size_t count = 0;
+        session_index_source_t source;
+        session_log_path(id, log_path, sidecar_path);
+        bad_sessions += session_index_load(log_path, sidecar_path, pieces, SESSION_MAX_PIECES, &count, &source) !=
+                        ESP_OK || source != SESSION_INDEX_FOOTER || count == 0;
+        sessions++;
+    }
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    CHECK(sessions > 0 && bad_sessions == 0, "%u of %u closed sessions without a valid footer", bad_sessions,
+          sessions);
+    printf("%u sessions closed on the card\n", sessions);
+
+    return test_report("test_soak");
+}
@@ -0,0 +1,196 @@
+// Stroke shape on synthetic strokes: a half-sine drive, a flat recovery and a
+// check dip before the catch, at race and paddling rates and at 1 kHz and 100 Hz
+// acquisition. Drive length, peak, check, impulse, rhythm, peak position and the
+// resampled drive curve must match the same curve analysed sample by sample
+// (mean removed, finish at the first drop below zero after the peak). Repeated
+// strokes must score full consistency, a reshaped drive less; a first catch, an
+// over-long cycle and a flat one give no stroke. The cost per stroke is printed
+// (STROKE_PROFILE_STROKES).
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include "utils/stroke_profile.h"
+#include "test_support.h"
+
+#define GRAVITY_MM_S2   9806.65f
+#define CHECK_DIP_MS    150
+
+typedef struct {
+    uint32_t cycle_ms;
+    uint32_t drive_ms;
+    float peak_g;               // Drive amplitude
+    float recovery_g;           // Deceleration through the recovery
+    float check_g;              // Extra dip before the catch
+    float skew;                 // Drive peak moved later: 0 = half sine, 0.6 = at 65%
+} stroke_t;
+
+// Surge acceleration t_ms into the stroke
+static float surge(const stroke_t *s, float t_ms) {
+    if (t_ms < s->drive_ms) {
+        float x = t_ms / s->drive_ms;
+        x = powf(x, 1.0f + s->skew);
+        return s->peak_g * sinf((float)M_PI * x);
+    }
+    float dip_start = (float)(s->cycle_ms - CHECK_DIP_MS);
+    float dip = t_ms >= dip_start ? sinf((float)M_PI * (t_ms - dip_start) / CHECK_DIP_MS) : 0.0f;
+    return -s->recovery_g - s->check_g * dip;
+}
+
+// The same analysis done at 1 ms with no binning
+typedef struct {
+    float drive_ms;
+    float peak_g;
+    float peak_ms;
+    float check_g;
+    float impulse_mm_s;
+    float profile[STROKE_PROFILE_POINTS];
+} reference_t;
+
+static reference_t reference(const stroke_t *s) {
+    reference_t r = { 0 };
+    float mean = 0.0f;
+    for (uint32_t t = 0; t < s->cycle_ms; t++) {
+        mean += surge(s, t);
+    }
+    mean /= s->cycle_ms;
+    uint32_t peak = 0;
+    for (uint32_t t = 0; t < s->cycle_ms; t++) {
+        float a = surge(s, t) - mean;
+        peak = a > surge(s, peak) - mean ? t : peak;
+        r.check_g = fminf(r.check_g, a);
+    }
+    uint32_t finish = peak + 1;
+    while (finish < s->cycle_ms && surge(s, finish) - mean >= 0.0f) {
+        finish++;
+    }
+    for (uint32_t t = 0; t < finish; t++) {
+        r.impulse_mm_s += (surge(s, t) - mean) * GRAVITY_MM_S2 / 1000.0f;
+    }
+    for (int k = 0; k < STROKE_PROFILE_POINTS; k++) {
+        r.profile[k] = surge(s, (float)k * finish / (STROKE_PROFILE_POINTS - 1)) - mean;
+    }
+    r.drive_ms = finish;
+    r.peak_g = surge(s, peak) - mean;
+    r.peak_ms = peak;
+    r.check_g = -r.check_g;
+    return r;
+}
+
+static timebase_us_t now_us = 1000000;
+
+// One cycle sampled every period_ms, closed by the next catch
+static bool row(const stroke_t *s, uint32_t period_ms, stroke_shape_t *out) {
+    for (uint32_t t = 0; t < s->cycle_ms; t += period_ms) {
+        stroke_profile_push(surge(s, t), now_us + (timebase_us_t)t * 1000);
+    }
+    now_us += (timebase_us_t)s->cycle_ms * 1000;
+    return stroke_profile_catch(now_us, out);
+}
+
+static void check_shape(const char *name, const stroke_t *s, const stroke_shape_t *shape, uint32_t period_ms) {
+    reference_t r = reference(s);
+    float bin_ms = period_ms > STROKE_PROFILE_BIN_MS ? (float)period_ms : (float)STROKE_PROFILE_BIN_MS;
+    float drive_ms = shape->drive_ms;
+
+    printf("%s: drive %u ms (%.0f), peak %.2f g (%.2f) at %u%% (%.0f), check %.2f g (%.2f), "
+           "impulse %d mm/s (%.0f), rhythm %u%%\n", name, shape->drive_ms, r.drive_ms, shape->peak_cg / 100.0f,
+           r.peak_g, shape->peak_pct, 100.0f * r.peak_ms / r.drive_ms, shape->check_cg / 100.0f, r.check_g,
+           shape->impulse_mm_s, r.impulse_mm_s, shape->rhythm_pct);
+    CHECK(shape->cycle_ms == s->cycle_ms, "%s: cycle %u ms", name, shape->cycle_ms);
+    CHECK(fabsf(drive_ms - r.drive_ms) <= bin_ms, "%s: drive %u ms, expected %.0f", name, shape->drive_ms,
+          r.drive_ms);
+    CHECK(fabsf(shape->peak_cg / 100.0f - r.peak_g) <= 0.02f * r.peak_g + 0.01f, "%s: peak %.2f g, expected %.2f",
+          name, shape->peak_cg / 100.0f, r.peak_g);
+    CHECK(fabsf(shape->check_cg / 100.0f - r.check_g) <= 0.03f * r.check_g + 0.01f,
+          "%s: check %.2f g, expected %.2f", name, shape->check_cg / 100.0f, r.check_g);
+    CHECK(fabsf(shape->impulse_mm_s - r.impulse_mm_s) <= 0.03f * r.impulse_mm_s,
+          "%s: impulse %d mm/s, expected %.0f", name, shape->impulse_mm_s, r.impulse_mm_s);
+    int rhythm_pct = (int)lrintf(100.0f * r.drive_ms / s->cycle_ms);
+    CHECK(abs((int)shape->rhythm_pct - rhythm_pct) <= 1 + 100 * bin_ms / s->cycle_ms, "%s: rhythm %u%%, expected %d%%",
+          name, shape->rhythm_pct, rhythm_pct);
+    CHECK(fabsf(shape->peak_pct - 100.0f * r.peak_ms / r.drive_ms) <= 100.0f * 2 * bin_ms / r.drive_ms,
+          "%s: peak at %u%%, expected %.0f%%", name, shape->peak_pct, 100.0f * r.peak_ms / r.drive_ms);
+    float worst = 0.0f;
+    for (int k = 0; k < STROKE_PROFILE_POINTS; k++) {
+        worst = fmaxf(worst, fabsf(shape->profile[k] * 0.02f - r.profile[k]));
+    }
+    CHECK(worst <= 0.05f * r.peak_g + 0.02f, "%s: drive curve off by %.3f g", name, worst);
+}
+
+int main(void) {
+    const stroke_t race = { .cycle_ms = 1600, .drive_ms = 650, .peak_g = 0.6f, .recovery_g = 0.12f,
+                            .check_g = 0.35f };
+    const stroke_t paddle = { .cycle_ms = 3000, .drive_ms = 900, .peak_g = 0.3f, .recovery_g = 0.05f,
+                              .check_g = 0.15f };
+    const uint32_t periods_ms[] = { 1, STROKE_PROFILE_BIN_MS };
+    stroke_shape_t shape;
+
+    for (size_t p = 0; p < sizeof(periods_ms) / sizeof(periods_ms[0]); p++) {
+        char name[48];
+        stroke_profile_reset();
+        CHECK(!stroke_profile_catch(now_us, &shape), "first catch gave a stroke");
+        for (int i = 0; i < 5; i++) {
+            REQUIRE(row(&race, periods_ms[p], &shape), "race stroke %d at %u ms", i, periods_ms[p]);
+        }
+        snprintf(name, sizeof(name), "race, %u Hz", 1000 / periods_ms[p]);
+        check_shape(name, &race, &shape, periods_ms[p]);
+        CHECK(shape.consistency_pct == 100, "%s: consistency %u%% on repeated strokes", name, shape.consistency_pct);
+
+        REQUIRE(row(&paddle, periods_ms[p], &shape), "paddle stroke at %u ms", periods_ms[p]);
+        snprintf(name, sizeof(name), "paddle, %u Hz", 1000 / periods_ms[p]);
+        check_shape(name, &paddle, &shape, periods_ms[p]);
+    }
+
+    // Consistency: the template follows the crew, a reshaped drive scores lower
+    stroke_t late = race;
+    late.skew = 0.6f;
+    stroke_profile_reset();
+    stroke_profile_catch(now_us, &shape);
+    for (int i = 0; i < 10; i++) {
+        row(&race, 1, &shape);
+    }
+    REQUIRE(row(&late, 1, &shape), "late-peak stroke");
+    check_shape("late peak", &late, &shape, 1);
+    uint8_t late_score = shape.consistency_pct;
+    row(&race, 1, &shape);
+    printf("consistency: %u%% for a late peak, then %u%% back on the usual stroke\n", late_score,
+           shape.consistency_pct);
+    CHECK(late_score < 95 && late_score > 50, "late peak: consistency %u%%", late_score);
+    CHECK(shape.consistency_pct > late_score, "usual stroke after the late one: %u%%", shape.consistency_pct);
+
+    // No stroke: a pause longer than the buffer, and a cycle without a drive
+    stroke_t pause = paddle;
+    pause.cycle_ms = STROKE_PROFILE_MAX_MS + 500;
+    CHECK(!row(&pause, 1, &shape), "over-long cycle gave a stroke");
+    stroke_t flat = { .cycle_ms = 2000, .drive_ms = 700 };
+    CHECK(!row(&flat, 1, &shape), "flat cycle gave a stroke");
+    CHECK(row(&race, 1, &shape), "no stroke after the flat cycle");
+
+    // Cost at 1 kHz: the samples of a stroke and the analysis at its catch
+    uint32_t strokes = (uint32_t)test_env_ul("STROKE_PROFILE_STROKES", 2000);
+    float samples[2000];
+    for (uint32_t t = 0; t < race.cycle_ms; t++) {
+        samples[t] = surge(&race, t);
+    }
+    double push_ns = 0.0, catch_ns = 0.0;
+    uint32_t complete = 0;
+    struct timespec a, b, c;
+    for (uint32_t n = 0; n < strokes; n++) {
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        for (uint32_t t = 0; t < race.cycle_ms; t++) {
+            stroke_profile_push(samples[t], now_us + (timebase_us_t)t * 1000);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        now_us += (timebase_us_t)race.cycle_ms * 1000;
+        complete += stroke_profile_catch(now_us, &shape);
+        clock_gettime(CLOCK_MONOTONIC, &c);
+        push_ns += (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+        catch_ns += (c.tv_sec - b.tv_sec) * 1e9 + (c.tv_nsec - b.tv_nsec);
+    }
+    printf("cost: %.1f us per %u ms stroke at 1 kHz (%.1f ns per sample, %.0f ns to analyse at the catch) "
+           "over %u strokes\n", (push_ns + catch_ns) / strokes / 1000.0, race.cycle_ms,
+           push_ns / strokes / race.cycle_ms, catch_ns / strokes, strokes);
+    CHECK(complete == strokes, "timing run: %u of %u strokes analysed", complete, strokes);
+
+    return test_report("test_stroke_profile");
+}
@@ -0,0 +1,49 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "host_sim.h"
+
+// Minimal check/report helpers shared by the host tests. A failed CHECK is
+// reported and counted; test_report() turns the count into the exit status.
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+#define CHECK(cond, ...) do {                                               \
+        test_checks++;                                                      \
+        if (!(cond)) {                                                      \
+            test_failures++;                                                \
+            fprintf(stderr, "FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__);                                   \
+            fputc('\n', stderr);                                            \
+        }                                                                   \
+    } while (0)
+
+// A check that makes the rest of the test meaningless. cond is evaluated once,
+// so it may be the call under test.
+#define REQUIRE(cond, ...) do {                                             \
+        test_checks++;                                                      \
+        if (!(cond)) {                                                      \
+            test_failures++;                                                \
+            fprintf(stderr, "FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__);                                   \
+            fputc('\n', stderr);                                            \
+            return test_report(__FILE__);                                   \
+        }                                                                   \
+    } while (0)
+
+static inline int test_report(const char *name) {
+    printf("%s: %d checks, %d failed\n", name, test_checks, test_failures);
+    return test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Long runs (soak, benchmarks) read their size from the environment so ctest
+// stays quick and a full run is one variable away
+static inline unsigned long test_env_ul(const char *name, unsigned long fallback) {
+    const char *value = getenv(name);
+    return value != NULL && *value != '\0' ? strtoul(value, NULL, 0) : fallback;
+}
+
+#endif // TEST_SUPPORT_H
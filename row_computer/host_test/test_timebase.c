@@ -0,0 +1,235 @@
+// Timebase wrap points: the 16-bit delta codec around every boundary a
+// microsecond or millisecond count crosses, and the consumers that keep 32-bit
+// milliseconds - a session log rowed across the 2^32 ms wrap must read back to
+// the appended times and index the same pieces from its footer and from a
+// record scan, and stroke shapes must not depend on where the clock stands.
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include "session_index.h"
+#include "log_block.h"
+#include "stroke_profile.h"
+#include "session_card.h"
+#include "test_support.h"
+
+#define US_PER_MS_WRAP      ((1ULL << 32) * 1000)   // timebase_ms() wraps here
+#define PAIRS_PER_BASE      400
+#define MAX_RECORDS         4096
+
+static unsigned int seed = 1;
+
+// ---- Delta codec ----
+static unsigned long codec_pairs = 0, codec_failures = 0;
+
+static void codec_check(timebase_us_t base_us, timebase_us_t time_us) {
+    int16_t delta = 0;
+    int64_t whole_ms = (int64_t)(time_us / 1000) - (int64_t)(base_us / 1000);
+    bool fits = timebase_delta_ms(base_us, time_us, &delta);
+    codec_pairs++;
+    if (fits != (whole_ms >= INT16_MIN && whole_ms <= INT16_MAX) ||
+        (fits && timebase_delta_to_ms(base_us, delta) != timebase_ms(time_us))) {
+        if (codec_failures++ < 5) {
+            fprintf(stderr, "base %llu time %llu: fits %d delta %d\n", (unsigned long long)base_us,
+                    (unsigned long long)time_us, fits, delta);
+        }
+    }
+}
+
+static void codec_around(timebase_us_t wrap_us) {
+    for (int64_t offset_us = -70000000; offset_us <= 70000000; offset_us += 499000 + rand_r(&seed) % 1000) {
+        if ((int64_t)wrap_us + offset_us < 0) {
+            continue;
+        }
+        timebase_us_t base_us = wrap_us + offset_us;
+        for (int i = 0; i < PAIRS_PER_BASE; i++) {
+            int64_t d_us = (int64_t)(rand_r(&seed) % 80001) * 1000 - 40000000 + rand_r(&seed) % 1000;
+            if ((int64_t)base_us + d_us >= 0) {
+                codec_check(base_us, base_us + d_us);
+            }
+        }
+        // The edges of the 16-bit range, either side of a millisecond boundary
+        for (int64_t edge_ms = 32766; edge_ms <= 32769; edge_ms++) {
+            codec_check(base_us, base_us + edge_ms * 1000);
+            if (base_us >= (timebase_us_t)edge_ms * 1000) {
+                codec_check(base_us, base_us - edge_ms * 1000);
+            }
+        }
+    }
+}
+
+// ---- Session log across the 32-bit millisecond wrap ----
+typedef struct {
+    uint8_t type;
+    uint32_t time_ms;
+} expected_record_t;
+
+static expected_record_t expected[MAX_RECORDS];
+static size_t expected_count = 0;
+
+static void append(session_rec_type_t type, timebase_us_t time_us, const void *payload, uint8_t length) {
+    if (session_log_append(type, time_us, payload, length) == ESP_OK && expected_count < MAX_RECORDS) {
+        expected[expected_count++] = (expected_record_t){ type, timebase_ms(time_us) };
+    }
+}
+
+// Two pieces of strokes every 2 s with a pause between, fixes each second, and a
+// stroke shape stamped at the previous catch (a negative delta) after each stroke
+static timebase_us_t row_across(timebase_us_t start_us, uint32_t piece_s, uint32_t pause_s) {
+    timebase_us_t now_us = start_us, last_catch_us = 0;
+    uint32_t distance_m = 0;
+    for (int piece = 0; piece < 2; piece++) {
+        timebase_us_t rowing_end_us = now_us + (timebase_us_t)piece_s * 1000000;
+        timebase_us_t pause_end_us = rowing_end_us + (timebase_us_t)pause_s * 1000000;
+        for (; now_us < pause_end_us; now_us += CARD_STEP_MS * 1000) {
+            uint32_t elapsed_ms = (uint32_t)((now_us - start_us) / 1000);
+            bool rowing = now_us < rowing_end_us;
+            if (rowing && elapsed_ms % CARD_STROKE_MS == 0) {
+                session_stroke_t stroke = { .peak_cg = 250, .rate_spm = 30 };
+                append(SESSION_REC_STROKE, now_us, &stroke, sizeof(stroke));
+                if (last_catch_us != 0) {
+                    stroke_shape_t shape = { .cycle_ms = CARD_STROKE_MS, .drive_ms = 700 };
+                    append(SESSION_REC_STROKE_SHAPE, last_catch_us, &shape, sizeof(shape));
+                }
+                last_catch_us = now_us;
+            }
+            if (elapsed_ms % 1000 == 0) {
+                distance_m += rowing ? CARD_METRES_PER_S : 0;
+                session_fix_t fix = { .speed_mm_s = rowing ? 4000 : 0, .distance_m = distance_m,
+                                      .split_ds = rowing ? 1250 : 0 };
+                append(SESSION_REC_FIX, now_us, &fix, sizeof(fix));
+            }
+            session_log_tick(timebase_ms(now_us));
+        }
+        last_catch_us = 0;
+    }
+    return now_us;
+}
+
+// Every record of a closed log in order, times decoded from the block timebases
+static size_t read_back(const char *path, expected_record_t *out, size_t max) {
+    int fd = open(path, O_RDONLY);
+    log_block_t block;
+    size_t count = 0;
+    if (fd < 0 || pread(fd, &block.header, sizeof(block.header), 0) != (ssize_t)sizeof(block.header)) {
+        return 0;
+    }
+    uint32_t nonce = block.header.nonce;
+    for (uint32_t seq = 1; log_block_read(fd, nonce, seq, &block); seq++) {
+        timebase_us_t base_us = 0;
+        for (size_t at = 0; at + sizeof(session_rec_header_t) <= block.header.length;) {
+            session_rec_header_t rec;
+            memcpy(&rec, block.payload + at, sizeof(rec));
+            if (rec.type == 0) {
+                break;
+            }
+            if (rec.type == SESSION_REC_TIMEBASE) {
+                session_timebase_t timebase;
+                memcpy(&timebase, block.payload + at + sizeof(rec), sizeof(timebase));
+                base_us = timebase.base_us;
+            } else if (count < max) {
+                out[count++] = (expected_record_t){ rec.type, timebase_delta_to_ms(base_us, rec.delta_ms) };
+            }
+            at += sizeof(rec) + rec.length;
+        }
+    }
+    close(fd);
+    return count;
+}
+
+// ---- Stroke shapes at two clock positions ----
+static size_t shapes_from(timebase_us_t start_us, stroke_shape_t *shapes, size_t max) {
+    size_t count = 0;
+    stroke_profile_reset();
+    for (uint32_t ms = 0; ms < 60000; ms++) {
+        float t = (float)(ms % CARD_STROKE_MS) / CARD_STROKE_MS;
+        float surge = t < 0.35f ? 1.2f * sinf((float)M_PI * t / 0.35f) : -0.65f * sinf((float)M_PI * (t - 0.35f) / 0.65f);
+        timebase_us_t time_us = start_us + (timebase_us_t)ms * 1000;
+        if (ms % CARD_STROKE_MS == 0 && count < max && stroke_profile_catch(time_us, &shapes[count])) {
+            count++;
+        }
+        stroke_profile_push(surge, time_us);
+    }
+    return count;
+}
+
+int main(void) {
+    host_log_set_level(ESP_LOG_ERROR);
+
+    // Codec: the 32-bit microsecond, 32-bit millisecond and 2^52 us boundaries,
+    // 16-bit millisecond multiples and boot
+    const timebase_us_t wraps[] = {
+        0, 1ULL << 32, 65536000ULL, 65536000ULL * 1000, US_PER_MS_WRAP, 2 * US_PER_MS_WRAP, 1ULL << 52,
+    };
+    for (size_t i = 0; i < sizeof(wraps) / sizeof(wraps[0]); i++) {
+        codec_around(wraps[i]);
+    }
+    CHECK(codec_failures == 0, "%lu of %lu base/time pairs mis-coded", codec_failures, codec_pairs);
+
+    // The clock: microseconds keep counting through the millisecond wrap
+    host_timer_offset_us = US_PER_MS_WRAP - 500000;
+    host_set_time_us(0);
+    timebase_us_t before_us = timebase_now_us();
+    uint32_t before_ms = timebase_now_ms();
+    host_set_time_us(1000000);
+    CHECK(timebase_now_us() - before_us == 1000000, "us step %llu", (unsigned long long)(timebase_now_us() - before_us));
+    CHECK(timebase_now_ms() < before_ms && timebase_now_ms() - before_ms == 1000, "ms %lu -> %lu",
+          (unsigned long)before_ms, (unsigned long)timebase_now_ms());
+
+    // Session log: a piece across the wrap, then a piece after it
+    card_reset();
+    REQUIRE(session_log_init() == ESP_OK, "mount");
+    timebase_us_t start_us = US_PER_MS_WRAP - 120000000;
+    host_timer_offset_us = 0;
+    host_set_time_us(start_us);
+    timebase_us_t end_us = row_across(start_us, 150, SESSION_PIECE_GAP_MS / 1000 + 10);
+    uint32_t session_id = session_log_current_id();
+    REQUIRE(session_log_close(timebase_ms(end_us)) == ESP_OK, "close");
+
+    char log_path[SESSION_PATH_MAX], sidecar_path[SESSION_PATH_MAX];
+    session_log_path(session_id, log_path, sidecar_path);
+    static expected_record_t decoded[MAX_RECORDS];
+    size_t decoded_count = read_back(log_path, decoded, MAX_RECORDS);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < decoded_count && i < expected_count; i++) {
+        mismatches += decoded[i].type != expected[i].type || decoded[i].time_ms != expected[i].time_ms;
+    }
+    CHECK(decoded_count == expected_count && mismatches == 0, "read back %zu of %zu records, %zu differ",
+          decoded_count, expected_count, mismatches);
+
+    // Index from the footer and from a scan of the records
+    session_piece_t footer[SESSION_MAX_PIECES], scanned[SESSION_MAX_PIECES];
+    size_t footer_count = 0, scanned_count = 0;
+    session_index_source_t source;
+    REQUIRE(session_index_load(log_path, sidecar_path, footer, SESSION_MAX_PIECES, &footer_count, &source) == ESP_OK,
+            "footer");
+    CHECK(source == SESSION_INDEX_FOOTER && footer_count == 2, "%zu pieces from source %d", footer_count, source);
+    uint32_t strokes_per_piece = 150000 / CARD_STROKE_MS;
+    for (size_t i = 0; i < footer_count; i++) {
+        CHECK(footer[i].stroke_count == strokes_per_piece &&
+              footer[i].end_ms - footer[i].start_ms == (strokes_per_piece - 1) * CARD_STROKE_MS,
+              "piece %zu: %u strokes in %lu ms", i, footer[i].stroke_count,
+              (unsigned long)(footer[i].end_ms - footer[i].start_ms));
+    }
+    CHECK(footer_count == 2 && footer[0].start_ms > footer[1].start_ms, "the pieces straddle the wrap");
+    const char *torn_path = SESSION_LOG_DIR "/TORN.LOG";      // Footer torn off
+    card_copy(log_path, torn_path, card_file_size(log_path) - 1);
+    REQUIRE(session_index_load(torn_path, NULL, scanned, SESSION_MAX_PIECES, &scanned_count, &source) == ESP_OK,
+            "scan");
+    CHECK(source == SESSION_INDEX_SCAN && scanned_count == footer_count, "scan found %zu pieces", scanned_count);
+    for (size_t i = 0; i < scanned_count && i < footer_count; i++) {
+        CHECK(memcmp(&scanned[i], &footer[i], offsetof(session_piece_t, flags)) == 0,
+              "scanned piece %zu matches the footer", i);
+    }
+
+    // Stroke shapes: the same strokes at boot and across the wrap
+    stroke_shape_t at_boot[32], at_wrap[32];
+    size_t boot_count = shapes_from(1000000, at_boot, 32);
+    size_t wrap_count = shapes_from(US_PER_MS_WRAP - 30000000, at_wrap, 32);
+    CHECK(boot_count > 20 && boot_count == wrap_count && memcmp(at_boot, at_wrap, boot_count * sizeof(at_boot[0])) == 0,
+          "%zu shapes at boot, %zu across the wrap", boot_count, wrap_count);
+
+    printf("%lu codec pairs; %zu records and %zu pieces across the ms wrap; %zu stroke shapes\n", codec_pairs,
+           decoded_count, footer_count, boot_count);
+    return test_report("test_timebase");
+}
@@ -0,0 +1,145 @@
+// The session download server on the host: session_transfer.c serving the card
+// directory (SESSION_LOG_DIR) over a pseudo-terminal, so tools/session_download.py
+// runs against the firmware unchanged:
+//
+//   transfer_host -s 3 -b 115200 -l 0.02 &       # prints the pty path
+//   tools/session_download.py /dev/pts/N get -d logs/
+//
+// -s writes that many synthetic sessions first, -b paces the device's output at
+// a line rate (8N1) and -l corrupts a fraction of its frames in flight, which
+// the protocol must repair. The virtual clock follows real time, so the ACK
+// timeouts behave as on the device.
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "config/common_constants.h"
+#include "session_transfer.h"
+#include "session_card.h"
+#include "host_sim.h"
+
+static int master_fd = -1;
+static long baud = 0;               // 0: as fast as the pty takes it
+static double loss = 0.0;           // Fraction of frames corrupted on the way out
+static unsigned int loss_seed = 1;
+static uint64_t wire_bytes = 0;
+static uint64_t start_ns = 0;
+static uint8_t corrupted[TRANSFER_FRAME_OVERHEAD + sizeof(transfer_data_t) + TRANSFER_CHUNK_MAX];
+
+static uint64_t real_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+// ---- transfer_port_t on the pty master ----
+static esp_err_t pty_init(void) {
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_fd < 0 || grantpt(master_fd) != 0 || unlockpt(master_fd) != 0) {
+        return ESP_FAIL;
+    }
+    // Held open so the master never sees a hangup between host tool runs; raw
+    // so the line discipline passes frames through untouched
+    int slave_fd = open(ptsname(master_fd), O_RDWR | O_NOCTTY);
+    struct termios attrs;
+    if (slave_fd < 0 || tcgetattr(slave_fd, &attrs) != 0) {
+        return ESP_FAIL;
+    }
+    cfmakeraw(&attrs);
+    return tcsetattr(slave_fd, TCSANOW, &attrs) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static int pty_read(uint8_t *data, size_t len, uint32_t timeout_ms) {
+    struct pollfd pfd = { .fd = master_fd, .events = POLLIN };
+    int ready = poll(&pfd, 1, (int)timeout_ms);
+    host_set_time_us((real_ns() - start_ns) / 1000);
+    if (ready <= 0) {
+        return ready;
+    }
+    ssize_t got = read(master_fd, data, len);
+    return got < 0 ? -1 : (int)got;
+}
+
+static int pty_write(const uint8_t *data, size_t len) {
+    const uint8_t *out = data;
+    if (loss > 0.0 && len > 6 && len <= sizeof(corrupted) && rand_r(&loss_seed) < loss * RAND_MAX) {
+        memcpy(corrupted, data, len);
+        corrupted[6 + rand_r(&loss_seed) % (len - 6)] ^= 0x40;
+        out = corrupted;
+    }
+    wire_bytes += len;
+    if (baud > 0) {
+        uint64_t due_ns = start_ns + wire_bytes * 10 * 1000000000ULL / (uint64_t)baud;
+        uint64_t now_ns = real_ns();
+        if (due_ns > now_ns) {
+            usleep((useconds_t)((due_ns - now_ns) / 1000));
+        }
+    }
+    for (size_t sent = 0; sent < len;) {
+        ssize_t n = write(master_fd, out + sent, len - sent);
+        if (n < 0) {
+            return -1;
+        }
+        sent += (size_t)n;
+    }
+    return (int)len;
+}
+
+// The pty carries only frames; the console is stderr
+static int stderr_vprintf(const char *format, va_list args) {
+    return vfprintf(stderr, format, args);
+}
+
+static const transfer_port_t transfer_port_pty = {
+    .name = "pty",
+    .init = pty_init,
+    .read = pty_read,
+    .write = pty_write,
+    .shares_console = false,
+};
+
+int main(int argc, char **argv) {
+    int sessions = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:b:l:")) != -1) {
+        switch (opt) {
+            case 's': sessions = atoi(optarg); break;
+            case 'b': baud = atol(optarg); break;
+            case 'l': loss = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-s sessions] [-b baud] [-l loss]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    esp_log_set_vprintf(stderr_vprintf);
+    host_log_set_level(ESP_LOG_INFO);
+    if (sessions > 0) {
+        card_reset();
+    } else {
+        mkdir(SESSION_LOG_DIR, 0755);
+    }
+    if (session_log_init() != ESP_OK) {
+        return EXIT_FAILURE;
+    }
+    // Sessions of 2, 4, 6... minutes of rowing
+    timebase_us_t now_us = 1000000;
+    for (int i = 0; i < sessions; i++) {
+        now_us = card_row_outing(now_us, 1, 120 * (i + 1), 20, NULL);
+        session_log_close(timebase_ms(now_us));
+        now_us += 60000000;
+    }
+
+    if (session_transfer_init(&transfer_port_pty) != ESP_OK) {
+        return EXIT_FAILURE;
+    }
+    printf("%s\n", ptsname(master_fd));
+    fflush(stdout);
+    start_ns = real_ns();
+    session_transfer_serve();
+    return EXIT_FAILURE;            // Serves until killed
+}
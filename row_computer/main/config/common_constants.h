@@ -2,36 +2,215 @@
 #define COMMON_CONSTANTS_H
 
 // Common timing constants (in milliseconds)
-#define TIMEOUT_I2C_MS              1000
 #define TIMEOUT_GPS_MS              500
 #define TIMEOUT_UART_MS             100
 #define TIMEOUT_QUEUE_MS            100
 
 // Task timing constants
-#define IMU_TASK_PERIOD_MS          10      // 100Hz
+#define IMU_TASK_PERIOD_MS          1       // 1kHz - input of the multi-rate tree
+#define MAG_READ_PERIOD_MS          10      // 100Hz magnetometer reads, held in between
 #define GPS_TASK_PERIOD_MS          1000    // 1Hz
-#define LOG_TASK_PERIOD_MS          50      // 20Hz
+#define DSP_MAX_LATENCY_MS          10      // Longest a sample waits for its DSP batch
+#define LOG_MAX_LATENCY_MS          50      // Longest a non-urgent record waits for storage
+#define LOG_STATS_INTERVAL_MS       60000   // Log consumer latency/wakeup stats
 #define SYSTEM_MONITOR_PERIOD_MS    10000   // 0.1Hz
+#define DISPLAY_TASK_PERIOD_MS      100     // 10Hz
 
 // Task priorities
 #define IMU_TASK_PRIORITY           6       // High priority - time critical
+#define DSP_TASK_PRIORITY           5       // Processing - below acquisition
 #define GPS_TASK_PRIORITY           4       // Medium priority
 #define LOG_TASK_PRIORITY           2       // Low priority - non-time critical
+#define DISPLAY_TASK_PRIORITY       1       // Lowest - must never preempt sensor tasks
+#define DLOG_TASK_PRIORITY          1       // Console formatting - lowest as well
+#define TRANSFER_TASK_PRIORITY      1       // Session download - idle unless a host asks
 
 // Task stack sizes
 #define IMU_TASK_STACK_SIZE         4096
 #define GPS_TASK_STACK_SIZE         4096
+#define DSP_TASK_STACK_SIZE         4096
 #define LOG_TASK_STACK_SIZE         8192    // Larger for data processing
+#define DISPLAY_TASK_STACK_SIZE     3072
+#define DLOG_TASK_STACK_SIZE        3072    // snprintf with floats
+#define TRANSFER_TASK_STACK_SIZE    3072
 
-// Queue configurations
-#define IMU_QUEUE_SIZE              50      // Buffer 0.5 seconds at 100Hz
-#define GPS_QUEUE_SIZE              10      // Buffer 10 GPS fixes
+// Task core affinity - pipeline stages (see task_layout in tasks_common.c)
+#define ACQUISITION_CORE            1       // Sensor reads, nothing else competes
+#define PROCESSING_CORE             0       // DSP / fusion / stroke detection
+#define STORAGE_CORE                0       // Logging, telemetry, display
+
+// Queue and bus topic configurations (topic depths round up to a power of two)
+#define IMU_TOPIC_DEPTH             128     // 0.128 seconds at 1kHz, shared by all subscribers
+#define IMU_TOPIC_DEPTH_SLOW        8       // 100Hz / 10Hz / 1Hz streams
+#define GPS_TOPIC_DEPTH             16      // GPS fixes
+#define DSP_RECORD_QUEUE_SIZE       32      // Processed records awaiting storage (~3s of card stall at 10Hz GPS)
+#define BUS_MAX_TOPICS              8
+#define BUS_MAX_SUBSCRIBERS         8       // Per topic
+
+// Batch watermarks - consumer is woken once this many items are queued
+#define IMU_BATCH_WATERMARK         10      // 10ms of 1kHz samples per DSP wakeup
+#define GPS_BATCH_WATERMARK         1
+#define LOG_BATCH_WATERMARK         8       // Strokes bypass this (urgent)
 
 // Sensor thresholds and constants
 #define STROKE_DETECTION_THRESHOLD  2.0f    // 2g acceleration threshold
 #define GPS_STARTUP_DELAY_MS        2000    // GPS module settling time
-#define SENSOR_HEALTH_LOG_INTERVAL  1000    // Log sensor health every N samples
+#define I2C_STATS_LOG_INTERVAL      1000    // Log I2C bus counters every N IMU reads
 #define GPS_LOG_INTERVAL            10      // Log GPS status every N reads
+#define STROKE_MIN_INTERVAL_MS      1000    // Refractory period between strokes (60spm max)
+#define SPLIT_MIN_SPEED_MM_S        500     // Below this speed no split is shown
+#define DISPLAY_STATS_LOG_INTERVAL  600     // Log display stats every N frames
+
+// Stroke shape (technique analytics)
+#define BOAT_SURGE_AXIS             accel_x // imu_data_t field along the hull
+#define BOAT_SURGE_SIGN             1.0f    // -1 when that axis points to the stern
+#define STROKE_PROFILE_POINTS       16      // Drive curve samples per stroke record
+#define STROKE_PROFILE_BIN_MS       10      // Analysis resolution (100Hz)
+#define STROKE_PROFILE_MAX_MS       4000    // Longest stroke analysed (15spm) - slower is a pause
+#define STROKE_TEMPLATE_ALPHA       0.2f    // Weight of each stroke in the consistency template
+
+// Power governor (activity detection and per-state profiles)
+#define GOV_WAKE_ACCEL_G            0.30f   // Instant |a|-1g deviation that means rowing
+#define GOV_WAKE_GYRO_DPS           30.0f   // Instant rotation rate that means rowing
+#define GOV_REST_ACCEL_G            0.08f   // Smoothed deviation below this counts as still
+#define GOV_ACTIVITY_EWMA_ALPHA     0.05f   // Smoothing of the activity level
+#define GOV_REST_HOLD_MS            30000   // Still this long before dropping to REST
+#define GOV_SLEEP_HOLD_MS           300000  // In REST this long before SLEEP
+#define GOV_WOM_THRESHOLD_MG        80      // IMU wake-on-motion threshold
+#define GOV_SLEEP_POLL_MS           1000    // IMU check interval while sleeping
+#define GOV_REST_IMU_PERIOD_MS      10      // 100Hz - enters the tree at its 100Hz stream
+#define GOV_REST_GPS_PERIOD_MS      5000
+#define GOV_SLEEP_GPS_PERIOD_MS     30000
+#define GOV_STATS_LOG_INTERVAL_MS   60000
+
+// I2C bus health (timeouts, circuit breakers, recovery)
+#define I2C_TIMEOUT_MARGIN          4       // Timeout = N x nominal wire time of the transfer
+#define I2C_TIMEOUT_MIN_MS          2
+#define I2C_BREAKER_THRESHOLD       3       // Consecutive failures that open a device breaker
+#define I2C_BACKOFF_MIN_MS          100     // First open period; doubles per failed probe
+#define I2C_BACKOFF_MAX_MS          10000
+#define I2C_RECOVERY_INTERVAL_MS    1000    // Limit SCL-toggle bus recoveries
+
+// Event capture - pre-trigger ring streamed around catches and crabs
+#define CAPTURE_RING_SAMPLES        1024    // 16 bytes each; must exceed pre + post
+#define CAPTURE_PRE_SAMPLES         200     // Kept from before the trigger
+#define CAPTURE_POST_SAMPLES        300     // Recorded after the trigger
+#define CAPTURE_DRAIN_CHUNK         64      // Wake the consumer every N window samples
+#define CAPTURE_CRAB_GYRO_DPS       150.0f  // Rotation on any axis that triggers a capture
+
+// Deferred logging - real-time tasks store records, DLOG_TASK formats them
+#define DLOG_RING_RECORDS           64      // 80 bytes each; power of two
+#define DLOG_BATCH_WATERMARK        16      // Warnings and errors wake the formatter at once
+#define DLOG_MAX_LATENCY_MS         200
+#define DLOG_LINE_MAX               192
+#define DLOG_WARN_INTERVAL_MS       1000    // Rate limit for warnings that can repeat per packet
+
+// Multi-rate decimation tree (1kHz -> 100Hz -> 10Hz -> 1Hz)
+#define MULTIRATE_FACTOR            10      // Decimation per stage
+#define MULTIRATE_PHASE_TAPS        8       // Taps per polyphase branch (80-tap FIR)
+#define MULTIRATE_CUTOFF            0.35f   // Anti-alias -6dB point, fraction of the output rate
+
+// GPS distance (local tangent plane)
+#define GEO_LTP_REANCHOR_E7         1000000 // Move the projection origin every 0.1 deg (~11km)
+
+// IMU backend transport
+#define SPI_SENSOR_MAX_BURST        512     // FIFO bytes per DMA burst (>= 32 ICM-42688 packets)
+#define SPI_SENSOR_POLL_MAX         16      // Reads up to this many bytes poll instead of waiting on DMA
+
+// Session log (SD card)
+#define SESSION_MAX_PIECES          64      // Index entries per session (later pieces extend the last)
+#define SESSION_PIECE_GAP_MS        15000   // Pause without strokes that ends a piece
+#define SESSION_INDEX_CHECKPOINT_MS 30000   // Sidecar update interval for the open piece
+#define SESSION_LOG_FLUSH_MS        1000    // Longest a record waits for the card (bounds loss at power-off)
+#define LOG_BLOCK_SIZE              512     // One SD sector - the unit that is written atomically
+#define SESSION_SEGMENT_BLOCKS      512     // Pre-allocation step (256kB)
+#define SESSION_PATH_MAX            32
+
+// Session download (serial bulk transfer)
+#define TRANSFER_CHUNK_MAX          4096    // Largest DATA payload (8 log blocks) and stats snapshot
+#define TRANSFER_WINDOW_MAX         16      // Chunks in flight beyond the last ACK
+#define TRANSFER_ACK_TIMEOUT_MS     500     // No ACK progress: resend from the last ACK
+#define TRANSFER_IDLE_TIMEOUT_MS    5000    // No ACK at all: give the download up
+#define TRANSFER_POLL_MS            20      // Receive wait while the window is full or idle
+
+// Runtime statistics registry
+#define STATS_MAX_METRICS           128
+#define STATS_MAX_HISTOGRAMS        8
+#define STATS_MAX_COLLECTORS        16
+#define STATS_JSON_MAX              6144    // Longest exported JSON line
+#define STATS_EXPORT_INTERVAL_MS    60000   // JSON snapshot on the console (0 = only on request)
+
+// Runtime configuration (NVS-backed overrides, fields in runtime_config_schema.h)
+#define RUNTIME_CONFIG_MAX_READERS  8       // Tasks that pick up live changes
+#ifndef RUNTIME_CONFIG_TEXT_MAX
+#define RUNTIME_CONFIG_TEXT_MAX     1024    // Stored "name=value" lines (host tests shrink it to overflow)
+#endif
+#define RUNTIME_CONFIG_GRACE_MS     2000    // Longest a change waits for every reader's safe point (> GOV_SLEEP_POLL_MS)
+
+// Course engine (distance to go and ghost delta on a fixed course)
+#define COURSE_MAX_POINTS           16384   // Polyline vertices (segment indices are 16-bit)
+#define COURSE_MAX_MARKERS          32
+#define COURSE_MATCH_RADIUS_M       50.0f   // Farthest a fix may be from the course line
+#define COURSE_GRID_CELL_M          50.0f   // Smallest grid cell (>= COURSE_MATCH_RADIUS_M)
+#define COURSE_GRID_MAX_CELLS       8192    // Cells grow beyond the minimum above this many
+#define COURSE_TRACK_WINDOW_M       30.0f   // Progress tolerance around the prediction
+#define COURSE_START_MARGIN_M       10.0f   // Back this far over the start ends a run (GPS noise at the line)
+#define COURSE_GHOST_STEP_M         10      // Run/ghost time table resolution
+#define COURSE_LOST_ABORT_MS        30000   // Off the course this long ends a run
+#define COURSE_EXTRAPOLATE_MS       2000    // Longest course_position_at reaches past the last fix
+
+// Ghost boat (previous piece as reference, utils/ghost_boat.h)
+#define GHOST_MAX_STROKES           2048    // Reference table entries (6 bytes each) - 6 km at 36spm is ~800
+#define GHOST_CATCH_EXTRAPOLATE_MS  2000    // Longest the distance at a catch is carried on from the last fix
+
+// Sensor health (online anomaly checks, utils/sensor_health.h)
+#define HEALTH_TOPIC_DEPTH          8       // State changes per source topic
+#define HEALTH_IMU_ALPHA            0.0005f // Per-sample EWMA weight (~2s at 1kHz - a few strokes)
+#define HEALTH_MAG_ALPHA            0.02f   // Per-read EWMA weight (~0.5s at 100Hz)
+#define HEALTH_GPS_ALPHA            0.1f    // Per-fix EWMA weight (~1s at 10Hz)
+#define HEALTH_DEGRADED_RATE        0.05f   // Error/saturation/range rate that degrades a sensor
+#define HEALTH_FAILED_RATE          0.5f    // ... and that fails it
+#define HEALTH_RECOVER_MS           2000    // Clean this long before a sensor is trusted again
+#define HEALTH_WEIGHT_DEGRADED      128     // Fusion weight of a degraded sensor (of 255)
+#define HEALTH_IMU_STUCK_SAMPLES    50      // Identical counts in a row (noise makes repeats rare)
+#define HEALTH_MAG_STUCK_SAMPLES    100     // Reads in a row - the 15Hz part repeats between updates
+#define HEALTH_GPS_STUCK_FIXES      5       // Solutions in a row without a new time of week
+#define HEALTH_IMU_SATURATION_LSB   32000   // Bias-corrected count at the end of the canonical range
+#define HEALTH_ACCEL_NOISE_LSB      1640.0f // Sample step std that means a noise-floor jump (0.1 g)
+#define HEALTH_GYRO_NOISE_LSB       655.0f  // Same for the gyroscope (5 deg/s)
+#define HEALTH_MAG_NOISE            50.0f   // Same for the magnetometer (mag_read units)
+#define HEALTH_MAG_RANGE            1200.0f // |axis| beyond the +-1.3 Ga range (overflow reads -4096)
+#define HEALTH_GPS_MAX_SPEED_MM_S   12000   // Faster than any rowing boat
+#define HEALTH_GPS_HACC_GOOD_MM     3000    // Position accuracy above this degrades...
+#define HEALTH_GPS_HACC_GATE_MM     10000   // ... above this gates the fix out (multipath, poor sky)
+#define HEALTH_GPS_SACC_GOOD_MM_S   300     // Same for the speed accuracy
+#define HEALTH_GPS_SACC_GATE_MM_S   1000
+
+// Magnetometer calibration (online ellipsoid fit)
+#define MAG_CAL_MIN_SAMPLES         300    // Distinct samples before a fit is attempted
+#define MAG_CAL_MIN_SPAN            300.0f  // Required max-min per axis (mag_read units)
+#define MAG_CAL_NORM                1000.0f // Input scaling that keeps fit sums well conditioned
+#define MAG_CAL_BLOCK_SAMPLES       64      // Samples summed on their own before folding into the fit totals
+
+// IMU bias / temperature calibration
+#define IMU_CAL_OBSERVE_HZ          100     // Stillness detector input rate (decimated from the IMU rate)
+#define IMU_CAL_WINDOW_MS           1000    // Stillness is judged per window
+#define IMU_CAL_WINDOW_MIN_SAMPLES  10      // Below 10Hz the window stretches to this many samples
+#define IMU_CAL_GYRO_STILL_VAR      225     // Max gyro variance in LSB^2 (~0.11 deg/s std)
+#define IMU_CAL_ACCEL_STILL_VAR     6724    // Max accel variance in LSB^2 (~5 mg std)
+#define IMU_CAL_ORIENT_TOL_LSB      164     // Accel windows must match reference pose (~10 mg)
+#define IMU_CAL_FORGET              0.98f   // Forgetting of the bias/temperature fit per IMU_CAL_WINDOW_MS
+#define IMU_CAL_MIN_TEMP_SPAN_C     2.0f    // Temperature spread needed before fitting a slope
+#define IMU_CAL_TEMP_REF_C          25.0f   // Model reference temperature
+#define IMU_CAL_SAVE_INTERVAL_MS    600000  // Limit NVS writes to one per 10 minutes
+
+// UBX command engine (sensors/ubx_command.h)
+#define UBX_CMD_QUEUE_LEN           8       // Commands queued or outstanding
+#define UBX_CMD_IN_FLIGHT           4       // Sent and not yet answered at once
+#define UBX_ACK_TIMEOUT_MS          1000    // Answer deadline per send (receivers answer within ~100ms)
+#define UBX_CMD_RETRIES             3       // Resends before a command times out
+#define UBX_POLL_MS                 50      // UART wait between engine polls while commands are outstanding
+#define GPS_UART_TX_BUF_SIZE        256     // TX ring: command writes return without waiting for the wire
 
 // Communication and protocol constants
 #define GPS_DATA_TIMEOUT_MS         5000    // No GPS data warning threshold
@@ -18,6 +18,11 @@
 #define GPS_UART_RTS_PIN            UART_PIN_NO_CHANGE
 #define GPS_UART_CTS_PIN            UART_PIN_NO_CHANGE
 #define GPS_UART_BUF_SIZE           1024
+
+// Session download shares the console UART (baud rate from sdkconfig)
+#define TRANSFER_UART_NUM           UART_NUM_0
+#define TRANSFER_UART_RX_BUF_SIZE   1024
+#define TRANSFER_UART_TX_BUF_SIZE   8192        // Whole frames are queued while the previous ones drain
 #define MAX_NMEA_LEN                256
 
 // SPI Configuration (if needed for other sensors)
@@ -25,18 +30,77 @@
 #define SPI_MISO_PIN                19
 #define SPI_SCLK_PIN                18
 #define SPI_CS_PIN                  5
+#define SPI_MAX_TRANSFER_SZ         4092        // Largest single DMA transfer on the bus
+
+// ST7789 LCD (shares the SPI bus above)
+#define LCD_CS_PIN                  SPI_CS_PIN
+#define LCD_DC_PIN                  4
+#define LCD_RST_PIN                 15
+#define LCD_BL_PIN                  32
+#define LCD_SPI_CLOCK_HZ            (40 * 1000 * 1000)
+#define LCD_X_OFFSET                0           // Panel RAM offset (non-zero on 240x135 panels)
+#define LCD_Y_OFFSET                0
+#define DISPLAY_WIDTH               240
+#define DISPLAY_HEIGHT              240
 
 // NEOM8N GPS
 #define GPS_TIMEOUT_MS              500
 
+// SD card (session log, shares the SPI bus above)
+#define SD_CS_PIN                   26
+
+// IMU interrupt (wake-on-motion), whichever backend is fitted
+#define IMU_INT_PIN                 27
+
+// SPI IMUs (ICM-42688-P / LSM6DSO, shares the SPI bus above)
+#define IMU_SPI_CS_PIN              25
+#define IMU_SPI_CLOCK_HZ            (10 * 1000 * 1000)  // LSM6DSO maximum
+
 // MPU6050
 #define MPU6050_ADDR                0x68            // I2C address
 #define MPU6050_PWR_MGMT_1          0x6B
 #define MPU6050_ACCEL_XOUT_H        0x3B
 #define MPU6050_GYRO_XOUT_H         0x43
+#define MPU6050_SMPLRT_DIV          0x19
+#define MPU6050_CONFIG_REG          0x1A
 #define MPU6050_ACCEL_CONFIG_REG    0x1C
+#define MPU6050_MOT_THR             0x1F
+#define MPU6050_MOT_DUR             0x20
+#define MPU6050_INT_PIN_CFG         0x37
+#define MPU6050_INT_ENABLE          0x38
+#define MPU6050_INT_STATUS          0x3A
+#define MPU6050_PWR_MGMT_2          0x6C
+#define MPU6050_WHO_AM_I            0x75
 #define LSB_SENSITIVITY_2g          16384.0f
 #define LSB_SENSITIVITY_250_deg     131
+#define MPU6050_TEMP_LSB_PER_C      340.0f
+#define MPU6050_TEMP_OFFSET_C       36.53f
+#define MPU6050_TEMP_TO_C(raw)      ((float)(raw) / MPU6050_TEMP_LSB_PER_C + MPU6050_TEMP_OFFSET_C)
+
+// ICM-42688-P (SPI, FIFO packet 3: header, accel, gyro, temp, timestamp)
+#define ICM42688_WHO_AM_I_VALUE     0x47
+#define ICM42688_DEVICE_CONFIG      0x11
+#define ICM42688_FIFO_CONFIG        0x16
+#define ICM42688_FIFO_COUNTH        0x2E
+#define ICM42688_FIFO_DATA          0x30
+#define ICM42688_SIGNAL_PATH_RESET  0x4B
+#define ICM42688_INTF_CONFIG0       0x4C
+#define ICM42688_PWR_MGMT0          0x4E
+#define ICM42688_GYRO_CONFIG0       0x4F
+#define ICM42688_ACCEL_CONFIG0      0x50
+#define ICM42688_FIFO_CONFIG1       0x5F
+#define ICM42688_WHO_AM_I           0x75
+
+// LSM6DSO (SPI, FIFO words: tag + 6 data bytes)
+#define LSM6DSO_WHO_AM_I_VALUE      0x6C
+#define LSM6DSO_FIFO_CTRL3          0x09
+#define LSM6DSO_FIFO_CTRL4          0x0A
+#define LSM6DSO_WHO_AM_I            0x0F
+#define LSM6DSO_CTRL1_XL            0x10
+#define LSM6DSO_CTRL2_G             0x11
+#define LSM6DSO_CTRL3_C             0x12
+#define LSM6DSO_FIFO_STATUS1        0x3A
+#define LSM6DSO_FIFO_DATA_OUT_TAG   0x78
 
 // HMC5883L
 #define HMC5883L_ADDR               0x1E            // HMC5883L I2C address
@@ -51,5 +115,6 @@
 #define HMC5883L_SAMPLES_8          0x60  // MA1:MA0 = 11
 #define HMC5883L_DATARATE_15HZ      0x14  // DO2:DO0 = 100
 #define HMC5883L_MEAS_NORMAL        0x00  // MS1:MS0 = 00
+#define HMC5883L_OVERFLOW           (-4096) // Data register value of a saturated axis
 
 #endif // PIN_DEFINITIONS_H
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef RUNTIME_CONFIG_SCHEMA_H
+#define RUNTIME_CONFIG_SCHEMA_H
+
+#include "config/common_constants.h"
+
+// Runtime-tunable parameters. The struct, defaults, limits, persisted keys and
+// the JSON export are all generated from this list (runtime_config.h/.c) - add
+// a field here and nowhere else. Defaults are the compile-time constants, so a
+// device with nothing stored behaves exactly like before.
+//
+//   X(name, kind, default, min, max, apply, unit, help)
+//
+// kind:  U32 (uint32_t) or F32 (float)
+// apply: LIVE - published to running tasks at their next loop iteration
+//        BOOT - sizes or scheduling fixed at task creation, stored and used from
+//               the next boot
+// Names are also the NVS / file keys: keep them stable, at most 31 characters.
+
+#define RUNTIME_CONFIG_FIELDS(X) \
+    X(imu_period_ms,          U32, IMU_TASK_PERIOD_MS,         1,     1000,    LIVE, "ms",     "IMU acquisition period while rowing (1, 10, 100 or 1000)") \
+    X(rest_imu_period_ms,     U32, GOV_REST_IMU_PERIOD_MS,     1,     1000,    LIVE, "ms",     "IMU acquisition period at rest (1, 10, 100 or 1000)") \
+    X(gps_period_ms,          U32, GPS_TASK_PERIOD_MS,         100,   10000,   LIVE, "ms",     "GPS navigation period while rowing") \
+    X(rest_gps_period_ms,     U32, GOV_REST_GPS_PERIOD_MS,     100,   60000,   LIVE, "ms",     "GPS navigation period at rest") \
+    X(sleep_gps_period_ms,    U32, GOV_SLEEP_GPS_PERIOD_MS,    1000,  60000,   LIVE, "ms",     "GPS navigation period while sleeping") \
+    X(stroke_threshold_g,     F32, STROKE_DETECTION_THRESHOLD, 1.1f,  8.0f,    LIVE, "g",      "Acceleration magnitude that marks a catch") \
+    X(stroke_min_interval_ms, U32, STROKE_MIN_INTERVAL_MS,     250,   5000,    LIVE, "ms",     "Refractory period between strokes") \
+    X(split_min_speed_mm_s,   U32, SPLIT_MIN_SPEED_MM_S,       0,     5000,    LIVE, "mm/s",   "Below this speed no split is shown and no distance counted") \
+    X(crab_gyro_dps,          F32, CAPTURE_CRAB_GYRO_DPS,      30.0f, 245.0f,  LIVE, "deg/s",  "Rotation on any axis that triggers a crab capture") \
+    X(gov_wake_accel_g,       F32, GOV_WAKE_ACCEL_G,           0.05f, 2.0f,    LIVE, "g",      "Instant |a|-1g deviation that means rowing") \
+    X(gov_wake_gyro_dps,      F32, GOV_WAKE_GYRO_DPS,          5.0f,  250.0f,  LIVE, "deg/s",  "Instant rotation rate that means rowing") \
+    X(gov_rest_accel_g,       F32, GOV_REST_ACCEL_G,           0.01f, 1.0f,    LIVE, "g",      "Smoothed deviation below this counts as still") \
+    X(gov_rest_hold_ms,       U32, GOV_REST_HOLD_MS,           5000,  600000,  LIVE, "ms",     "Still this long before dropping to REST") \
+    X(gov_sleep_hold_ms,      U32, GOV_SLEEP_HOLD_MS,          10000, 3600000, LIVE, "ms",     "In REST this long before SLEEP") \
+    X(dsp_max_latency_ms,     U32, DSP_MAX_LATENCY_MS,         1,     100,     LIVE, "ms",     "Longest a sample waits for its DSP batch") \
+    X(log_max_latency_ms,     U32, LOG_MAX_LATENCY_MS,         10,    1000,    LIVE, "ms",     "Longest a non-urgent record waits for storage") \
+    X(ghost_session,          U32, 0,                          0,     9999,    BOOT, "",       "Session holding the ghost boat piece (0 = no ghost boat)") \
+    X(ghost_piece,            U32, 0,                          0,     SESSION_MAX_PIECES - 1, BOOT, "", "Piece of that session raced by the ghost boat (0 = first)") \
+    X(dsp_record_queue_size,  U32, DSP_RECORD_QUEUE_SIZE,      8,     256,     BOOT, "records","Processed records awaiting storage") \
+    X(imu_task_priority,      U32, IMU_TASK_PRIORITY,          3,     20,      BOOT, "",       "IMU task priority (above DSP)") \
+    X(dsp_task_priority,      U32, DSP_TASK_PRIORITY,          3,     20,      BOOT, "",       "DSP task priority (above LOG)") \
+    X(log_task_priority,      U32, LOG_TASK_PRIORITY,          2,     20,      BOOT, "",       "Logging task priority (above display and console)")
+
+#endif // RUNTIME_CONFIG_SCHEMA_H
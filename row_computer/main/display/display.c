@@ -0,0 +1,321 @@
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "display.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "DISPLAY";
+
+// Screen layout: four rows of label + large value
+#define FONT_WIDTH          5
+#define FONT_HEIGHT         7
+#define FONT_ADVANCE        6           // Glyph width + 1 column spacing
+#define LABEL_SCALE         2
+#define VALUE_SCALE         5
+#define FIELD_MAX_CHARS     7
+#define FIELD_MARGIN_X      8
+#define FIELD_ROW_HEIGHT    (DISPLAY_HEIGHT / FIELD_COUNT)
+#define VALUE_OFFSET_Y      (FONT_HEIGHT * LABEL_SCALE + 10)
+
+typedef enum {
+    FIELD_SPLIT,
+    FIELD_RATE,
+    FIELD_DISTANCE,
+    FIELD_DELTA,
+    FIELD_COUNT
+} display_field_t;
+
+static const char *field_labels[FIELD_COUNT] = { "SPLIT", "RATE", "DIST", "DELTA" };
+
+// Classic 5x7 font, column-major, LSB = top row. Only glyphs used on screen.
+typedef struct {
+    char c;
+    uint8_t cols[FONT_WIDTH];
+} glyph_t;
+
+static const glyph_t font_5x7[] = {
+    { '0', {0x3E, 0x51, 0x49, 0x45, 0x3E} },
+    { '1', {0x00, 0x42, 0x7F, 0x40, 0x00} },
+    { '2', {0x42, 0x61, 0x51, 0x49, 0x46} },
+    { '3', {0x21, 0x41, 0x45, 0x4B, 0x31} },
+    { '4', {0x18, 0x14, 0x12, 0x7F, 0x10} },
+    { '5', {0x27, 0x45, 0x45, 0x45, 0x39} },
+    { '6', {0x3C, 0x4A, 0x49, 0x49, 0x30} },
+    { '7', {0x01, 0x71, 0x09, 0x05, 0x03} },
+    { '8', {0x36, 0x49, 0x49, 0x49, 0x36} },
+    { '9', {0x06, 0x49, 0x49, 0x29, 0x1E} },
+    { ':', {0x00, 0x36, 0x36, 0x00, 0x00} },
+    { '.', {0x00, 0x60, 0x60, 0x00, 0x00} },
+    { '-', {0x08, 0x08, 0x08, 0x08, 0x08} },
+    { '+', {0x08, 0x08, 0x3E, 0x08, 0x08} },
+    { '/', {0x20, 0x10, 0x08, 0x04, 0x02} },
+    { 'A', {0x7E, 0x11, 0x11, 0x11, 0x7E} },
+    { 'D', {0x7F, 0x41, 0x41, 0x22, 0x1C} },
+    { 'E', {0x7F, 0x49, 0x49, 0x49, 0x41} },
+    { 'I', {0x00, 0x41, 0x7F, 0x41, 0x00} },
+    { 'L', {0x7F, 0x40, 0x40, 0x40, 0x40} },
+    { 'P', {0x7F, 0x09, 0x09, 0x09, 0x06} },
+    { 'R', {0x7F, 0x09, 0x19, 0x29, 0x46} },
+    { 'S', {0x46, 0x49, 0x49, 0x49, 0x31} },
+    { 'T', {0x01, 0x01, 0x7F, 0x01, 0x01} },
+};
+
+static const display_backend_t *active_backend = NULL;
+static uint8_t *framebuffer = NULL;
+static char field_text[FIELD_COUNT][FIELD_MAX_CHARS + 1];
+static display_rect_t dirty_rects[DISPLAY_MAX_DIRTY_RECTS];
+static int dirty_count = 0;
+static uint32_t pending_render_us = 0;
+static display_stats_t stats = {0};
+
+static const uint8_t* font_lookup(char c) {
+    for (size_t i = 0; i < sizeof(font_5x7) / sizeof(font_5x7[0]); i++) {
+        if (font_5x7[i].c == c) {
+            return font_5x7[i].cols;
+        }
+    }
+    return NULL; // Unknown glyphs (including space) render blank
+}
+
+static void fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool on) {
+    for (uint16_t row = y; row < y + h && row < DISPLAY_HEIGHT; row++) {
+        uint8_t *line = &framebuffer[row * DISPLAY_FB_STRIDE];
+        for (uint16_t col = x; col < x + w && col < DISPLAY_WIDTH; col++) {
+            uint8_t mask = 0x80 >> (col & 7);
+            if (on) {
+                line[col >> 3] |= mask;
+            } else {
+                line[col >> 3] &= ~mask;
+            }
+        }
+    }
+}
+
+// Draw one glyph cell (background cleared) at the given scale
+static void draw_char(uint16_t x, uint16_t y, char c, uint8_t scale) {
+    fill_rect(x, y, FONT_ADVANCE * scale, FONT_HEIGHT * scale, false);
+
+    const uint8_t *cols = font_lookup(c);
+    if (cols == NULL) {
+        return;
+    }
+
+    for (int col = 0; col < FONT_WIDTH; col++) {
+        for (int row = 0; row < FONT_HEIGHT; row++) {
+            if (cols[col] & (1 << row)) {
+                fill_rect(x + col * scale, y + row * scale, scale, scale, true);
+            }
+        }
+    }
+}
+
+static void draw_string(uint16_t x, uint16_t y, const char *text, uint8_t scale) {
+    for (; *text != '\0'; text++) {
+        draw_char(x, y, *text, scale);
+        x += FONT_ADVANCE * scale;
+    }
+}
+
+// Queue a region for flushing; x is widened to byte boundaries for 1bpp panels
+static void mark_dirty(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    uint16_t x0 = x & ~7;
+    uint16_t x1 = (x + w + 7) & ~7;
+    if (x1 > DISPLAY_WIDTH) {
+        x1 = DISPLAY_WIDTH;
+    }
+    display_rect_t rect = { x0, y, x1 - x0, h };
+
+    if (dirty_count < DISPLAY_MAX_DIRTY_RECTS) {
+        dirty_rects[dirty_count++] = rect;
+        return;
+    }
+
+    // Out of slots - grow the last rectangle to cover the new one
+    display_rect_t *last = &dirty_rects[DISPLAY_MAX_DIRTY_RECTS - 1];
+    uint16_t ux0 = last->x < rect.x ? last->x : rect.x;
+    uint16_t uy0 = last->y < rect.y ? last->y : rect.y;
+    uint16_t ux1 = (last->x + last->w) > (rect.x + rect.w) ? (last->x + last->w) : (rect.x + rect.w);
+    uint16_t uy1 = (last->y + last->h) > (rect.y + rect.h) ? (last->y + last->h) : (rect.y + rect.h);
+    *last = (display_rect_t){ ux0, uy0, ux1 - ux0, uy1 - uy0 };
+}
+
+// Redraw only the characters that changed and mark just that span dirty
+static void update_field(display_field_t field, const char *text) {
+    char *current = field_text[field];
+    uint16_t x = FIELD_MARGIN_X;
+    uint16_t y = field * FIELD_ROW_HEIGHT + VALUE_OFFSET_Y;
+    const uint16_t advance = FONT_ADVANCE * VALUE_SCALE;
+    int text_len = (int)strnlen(text, FIELD_MAX_CHARS);
+    int first = -1;
+    int last = -1;
+
+    for (int i = 0; i < FIELD_MAX_CHARS; i++) {
+        char old_c = current[i] != '\0' ? current[i] : ' ';
+        char new_c = i < text_len ? text[i] : ' ';
+        if (old_c == new_c) {
+            continue;
+        }
+        draw_char(x + i * advance, y, new_c, VALUE_SCALE);
+        if (first < 0) {
+            first = i;
+        }
+        last = i;
+    }
+
+    if (first >= 0) {
+        mark_dirty(x + first * advance, y, (last - first + 1) * advance, FONT_HEIGHT * VALUE_SCALE);
+    }
+
+    memset(current, ' ', FIELD_MAX_CHARS);
+    memcpy(current, text, text_len);
+    current[FIELD_MAX_CHARS] = '\0';
+}
+
+static void format_split(char *out, size_t len, uint32_t split_ds) {
+    if (split_ds == 0 || split_ds >= 100 * 600) { // Hide splits slower than 99:59.9
+        snprintf(out, len, "-:--.-");
+        return;
+    }
+    uint32_t minutes = split_ds / 600;
+    uint32_t seconds = (split_ds / 10) % 60;
+    uint32_t tenths = split_ds % 10;
+    snprintf(out, len, "%lu:%02lu.%lu", (unsigned long)minutes, (unsigned long)seconds, (unsigned long)tenths);
+}
+
+// Seconds behind (+) or ahead (-) of the ghost, "-" without one
+static void format_delta(char *out, size_t len, bool has_ghost, int32_t delta_ds) {
+    if (!has_ghost) {
+        snprintf(out, len, "-");
+        return;
+    }
+    uint32_t magnitude = (uint32_t)(delta_ds < 0 ? -delta_ds : delta_ds);
+    if (magnitude > 9999) {
+        magnitude = 9999;
+    }
+    snprintf(out, len, "%c%lu.%lu", delta_ds < 0 ? '-' : '+', (unsigned long)(magnitude / 10),
+             (unsigned long)(magnitude % 10));
+}
+
+esp_err_t display_init(const display_backend_t *backend) {
+    if (backend == NULL || backend->flush == NULL) {
+        ESP_LOGE(TAG, "Invalid display backend");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (framebuffer == NULL) {
+        framebuffer = heap_caps_malloc(DISPLAY_FB_SIZE, MALLOC_CAP_DMA);
+        if (framebuffer == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate %d byte framebuffer", DISPLAY_FB_SIZE);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (backend->init != NULL) {
+        esp_err_t err = backend->init();
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Backend %s init failed: %s", backend->name, esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    active_backend = backend;
+    memset(framebuffer, 0, DISPLAY_FB_SIZE);
+    memset(&stats, 0, sizeof(stats));
+    dirty_count = 0;
+
+    // Static layout: labels never change, values start blank
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        draw_string(FIELD_MARGIN_X, i * FIELD_ROW_HEIGHT + 4, field_labels[i], LABEL_SCALE);
+        memset(field_text[i], ' ', FIELD_MAX_CHARS);
+        field_text[i][FIELD_MAX_CHARS] = '\0';
+    }
+    mark_dirty(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+    ESP_LOGD(TAG, "Display initialized (%dx%d, backend: %s)", DISPLAY_WIDTH, DISPLAY_HEIGHT, backend->name);
+    return display_flush();
+}
+
+bool display_is_ready(void) {
+    return active_backend != NULL;
+}
+
+int display_render(const display_metrics_t *metrics) {
+    if (active_backend == NULL || metrics == NULL) {
+        return 0;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    char text[FIELD_MAX_CHARS + 1];
+
+    format_split(text, sizeof(text), metrics->split_ds);
+    update_field(FIELD_SPLIT, text);
+
+    snprintf(text, sizeof(text), "%u", (unsigned)metrics->stroke_rate_spm);
+    update_field(FIELD_RATE, text);
+
+    snprintf(text, sizeof(text), "%lu",
+             (unsigned long)(metrics->course_active ? metrics->course_remaining_m : metrics->distance_m));
+    update_field(FIELD_DISTANCE, text);
+
+    format_delta(text, sizeof(text), metrics->has_ghost, metrics->ghost_delta_ds);
+    update_field(FIELD_DELTA, text);
+
+    pending_render_us += (uint32_t)(esp_timer_get_time() - start_us);
+    return dirty_count;
+}
+
+esp_err_t display_flush(void) {
+    if (active_backend == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (dirty_count == 0) {
+        return ESP_OK;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t result = ESP_OK;
+    uint32_t frame_bytes = 0;
+
+    for (int i = 0; i < dirty_count; i++) {
+        size_t bytes_sent = 0;
+        esp_err_t err = active_backend->flush(framebuffer, &dirty_rects[i], &bytes_sent);
+        if (err != ESP_OK) {
+            stats.flush_errors++;
+            result = err;
+            continue;
+        }
+        frame_bytes += bytes_sent;
+        stats.updates++;
+    }
+
+    if (active_backend->present != NULL) {
+        esp_err_t err = active_backend->present(framebuffer);
+        if (err != ESP_OK) {
+            stats.flush_errors++;
+            result = err;
+        }
+    }
+
+    uint32_t frame_us = pending_render_us + (uint32_t)(esp_timer_get_time() - start_us);
+    stats.frames++;
+    stats.bytes_pushed += frame_bytes;
+    stats.last_update_bytes = frame_bytes;
+    stats.last_render_us = frame_us;
+    stats.total_render_us += frame_us;
+    if (frame_us > stats.max_render_us) {
+        stats.max_render_us = frame_us;
+    }
+
+    pending_render_us = 0;
+    dirty_count = 0;
+    return result;
+}
+
+esp_err_t display_get_stats(display_stats_t *out_stats) {
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_stats = stats;
+    return ESP_OK;
+}
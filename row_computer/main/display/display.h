@@ -0,0 +1,69 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "config/pin_definitions.h"
+
+// 1 bit per pixel framebuffer, MSB = leftmost pixel
+#define DISPLAY_FB_STRIDE           ((DISPLAY_WIDTH + 7) / 8)
+#define DISPLAY_FB_SIZE             (DISPLAY_FB_STRIDE * DISPLAY_HEIGHT)
+#define DISPLAY_MAX_DIRTY_RECTS     8
+
+typedef struct {
+    uint16_t x, y, w, h;
+} display_rect_t;
+
+// Live rowing metrics shown on screen
+typedef struct {
+    uint32_t split_ds;          // Time per 500m in deciseconds (0 = not moving)
+    uint16_t stroke_rate_spm;   // Strokes per minute
+    uint32_t distance_m;        // Distance rowed in metres
+    bool course_active;         // Course run in progress: DIST shows the distance to go
+    uint32_t course_remaining_m;
+    bool has_ghost;
+    int32_t ghost_delta_ds;     // Behind (+) / ahead (-) of the ghost in deciseconds
+} display_metrics_t;
+
+// Render/update cost counters for benchmarking
+typedef struct {
+    uint32_t frames;            // Frames that changed at least one region
+    uint32_t updates;           // Dirty rectangles pushed to the panel
+    uint64_t bytes_pushed;      // Total bytes sent to the panel
+    uint32_t last_update_bytes; // Bytes sent for the most recent frame
+    uint32_t last_render_us;    // Render + flush time of the most recent frame
+    uint32_t max_render_us;
+    uint64_t total_render_us;
+    uint32_t flush_errors;
+} display_stats_t;
+
+// Panel backend - receives dirty rectangles of the 1bpp framebuffer
+typedef struct {
+    const char *name;
+    esp_err_t (*init)(void);
+    // Push one rectangle; must not block on the transfer completing
+    esp_err_t (*flush)(const uint8_t *fb, const display_rect_t *rect, size_t *bytes_sent);
+    // Called once every dirty rectangle of a frame was flushed (may be NULL)
+    esp_err_t (*present)(const uint8_t *fb);
+} display_backend_t;
+
+// Available backends
+extern const display_backend_t display_backend_lcd_spi;    // ST7789 over SPI2 with DMA
+extern const display_backend_t display_backend_file;       // PBM image per frame (host benchmarking)
+
+// Initialize framebuffer and backend, draws the static layout
+esp_err_t display_init(const display_backend_t *backend);
+bool display_is_ready(void);
+
+// Render changed metrics into the framebuffer, returns number of dirty rectangles
+int display_render(const display_metrics_t *metrics);
+
+// Push all dirty rectangles to the backend
+esp_err_t display_flush(void);
+
+// Read render/update statistics
+esp_err_t display_get_stats(display_stats_t *out_stats);
+
+#endif // DISPLAY_H
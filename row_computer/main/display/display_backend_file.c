@@ -0,0 +1,49 @@
+#include "esp_log.h"
+#include "display.h"
+#include <stdio.h>
+
+// Writes every presented frame as a PBM image so rendering can be inspected and
+// benchmarked off-target. Bytes per update are counted as a 1bpp panel
+// (e-paper style partial window) would receive them.
+
+#ifndef DISPLAY_FILE_PREFIX
+#define DISPLAY_FILE_PREFIX     "display_frame_"
+#endif
+
+static const char *TAG = "DISPLAY_FILE";
+static uint32_t frame_index = 0;
+
+static esp_err_t file_init(void) {
+    frame_index = 0;
+    return ESP_OK;
+}
+
+static esp_err_t file_flush(const uint8_t *fb, const display_rect_t *rect, size_t *bytes_sent) {
+    *bytes_sent = (size_t)rect->h * ((rect->w + 7) / 8);
+    return ESP_OK;
+}
+
+static esp_err_t file_present(const uint8_t *fb) {
+    char path[64];
+    snprintf(path, sizeof(path), "%s%05lu.pbm", DISPLAY_FILE_PREFIX, (unsigned long)frame_index++);
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return ESP_FAIL;
+    }
+
+    // PBM stores rows MSB first like the framebuffer (1 = black)
+    fprintf(f, "P4\n%d %d\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    size_t written = fwrite(fb, 1, DISPLAY_FB_SIZE, f);
+    fclose(f);
+
+    return written == DISPLAY_FB_SIZE ? ESP_OK : ESP_FAIL;
+}
+
+const display_backend_t display_backend_file = {
+    .name = "pbm-file",
+    .init = file_init,
+    .flush = file_flush,
+    .present = file_present,
+};
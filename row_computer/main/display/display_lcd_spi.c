@@ -0,0 +1,234 @@
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "config/pin_definitions.h"
+#include "display.h"
+
+static const char *TAG = "LCD";
+
+// ST7789 commands
+#define ST7789_SWRESET      0x01
+#define ST7789_SLPOUT       0x11
+#define ST7789_NORON        0x13
+#define ST7789_INVON        0x21
+#define ST7789_DISPON       0x29
+#define ST7789_CASET        0x2A
+#define ST7789_RASET        0x2B
+#define ST7789_RAMWR        0x2C
+#define ST7789_MADCTL       0x36
+#define ST7789_COLMOD       0x3A
+
+#define LCD_COLOR_FG        0xFFFF      // RGB565, byte order irrelevant for white/black
+#define LCD_COLOR_BG        0x0000
+#define LCD_CHUNK_BUFFERS   2           // Expand one chunk while the other is on the wire
+#define LCD_CHUNK_PIXELS    (SPI_MAX_TRANSFER_SZ / 2)
+
+static spi_device_handle_t lcd_spi = NULL;
+static uint16_t *chunk_buf[LCD_CHUNK_BUFFERS];
+static spi_transaction_t chunk_trans[LCD_CHUNK_BUFFERS];
+static int chunk_next = 0;
+static int chunks_in_flight = 0;
+
+// D/C line is driven from the transaction's user field before each transfer
+static void IRAM_ATTR lcd_pre_transfer_cb(spi_transaction_t *t) {
+    gpio_set_level(LCD_DC_PIN, (int)(intptr_t)t->user);
+}
+
+static void lcd_wait_one(void) {
+    spi_transaction_t *done;
+    spi_device_get_trans_result(lcd_spi, &done, portMAX_DELAY);
+    chunks_in_flight--;
+}
+
+static void lcd_wait_idle(void) {
+    while (chunks_in_flight > 0) {
+        lcd_wait_one();
+    }
+}
+
+static esp_err_t lcd_send(uint8_t cmd, const uint8_t *data, size_t len) {
+    spi_transaction_t t = {
+        .length = 8,
+        .tx_buffer = &cmd,
+        .user = (void *)0,
+    };
+    esp_err_t err = spi_device_polling_transmit(lcd_spi, &t);
+    if (err != ESP_OK || len == 0) {
+        return err;
+    }
+
+    spi_transaction_t d = {
+        .length = len * 8,
+        .tx_buffer = data,
+        .user = (void *)1,
+    };
+    return spi_device_polling_transmit(lcd_spi, &d);
+}
+
+static esp_err_t lcd_set_window(const display_rect_t *rect) {
+    uint16_t x0 = rect->x + LCD_X_OFFSET;
+    uint16_t x1 = x0 + rect->w - 1;
+    uint16_t y0 = rect->y + LCD_Y_OFFSET;
+    uint16_t y1 = y0 + rect->h - 1;
+    uint8_t caset[4] = { x0 >> 8, x0 & 0xFF, x1 >> 8, x1 & 0xFF };
+    uint8_t raset[4] = { y0 >> 8, y0 & 0xFF, y1 >> 8, y1 & 0xFF };
+
+    esp_err_t err = lcd_send(ST7789_CASET, caset, sizeof(caset));
+    if (err == ESP_OK) {
+        err = lcd_send(ST7789_RASET, raset, sizeof(raset));
+    }
+    if (err == ESP_OK) {
+        err = lcd_send(ST7789_RAMWR, NULL, 0);
+    }
+    return err;
+}
+
+// Undo a partial lcd_init() so a later attempt starts clean
+static void lcd_release(void) {
+    for (int i = 0; i < LCD_CHUNK_BUFFERS; i++) {
+        heap_caps_free(chunk_buf[i]);
+        chunk_buf[i] = NULL;
+    }
+    if (lcd_spi != NULL) {
+        spi_bus_remove_device(lcd_spi);
+        lcd_spi = NULL;
+    }
+}
+
+static esp_err_t lcd_init(void) {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << LCD_DC_PIN) | (1ULL << LCD_RST_PIN) | (1ULL << LCD_BL_PIN),
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    spi_device_interface_config_t devcfg = {
+        .clock_speed_hz = LCD_SPI_CLOCK_HZ,
+        .mode = 0,
+        .spics_io_num = LCD_CS_PIN,
+        .queue_size = LCD_CHUNK_BUFFERS,
+        .pre_cb = lcd_pre_transfer_cb,
+    };
+    err = spi_bus_add_device(SPI2_HOST, &devcfg, &lcd_spi);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add LCD to SPI bus: %s", esp_err_to_name(err));
+        lcd_spi = NULL;
+        return err;
+    }
+
+    for (int i = 0; i < LCD_CHUNK_BUFFERS; i++) {
+        chunk_buf[i] = heap_caps_malloc(LCD_CHUNK_PIXELS * sizeof(uint16_t), MALLOC_CAP_DMA);
+        if (chunk_buf[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate DMA chunk buffer");
+            lcd_release();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Hardware reset
+    gpio_set_level(LCD_RST_PIN, 0);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    gpio_set_level(LCD_RST_PIN, 1);
+    vTaskDelay(pdMS_TO_TICKS(120));
+
+    // Command, one data byte (or none), settle time
+    static const struct {
+        uint8_t cmd;
+        uint8_t len;
+        uint8_t data;
+        uint8_t delay_ms;
+    } sequence[] = {
+        { ST7789_SWRESET, 0, 0x00, 150 },
+        { ST7789_SLPOUT, 0, 0x00, 10 },
+        { ST7789_COLMOD, 1, 0x55, 0 },      // 16 bit/pixel
+        { ST7789_MADCTL, 1, 0x00, 0 },
+        { ST7789_INVON, 0, 0x00, 0 },
+        { ST7789_NORON, 0, 0x00, 0 },
+        { ST7789_DISPON, 0, 0x00, 0 },
+    };
+    for (size_t i = 0; i < sizeof(sequence) / sizeof(sequence[0]); i++) {
+        err = lcd_send(sequence[i].cmd, &sequence[i].data, sequence[i].len);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "LCD init command 0x%02X failed: %s", sequence[i].cmd, esp_err_to_name(err));
+            lcd_release();
+            return err;
+        }
+        if (sequence[i].delay_ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(sequence[i].delay_ms));
+        }
+    }
+
+    gpio_set_level(LCD_BL_PIN, 1);
+    ESP_LOGD(TAG, "ST7789 initialized");
+    return ESP_OK;
+}
+
+// Expand the 1bpp rectangle to RGB565 and queue it in DMA chunks.
+// Returns once the last chunk is queued; the transfer finishes in the background.
+static esp_err_t lcd_flush(const uint8_t *fb, const display_rect_t *rect, size_t *bytes_sent) {
+    // Window commands are polled and must not interleave with queued data
+    lcd_wait_idle();
+
+    esp_err_t err = lcd_set_window(rect);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uint16_t rows_per_chunk = LCD_CHUNK_PIXELS / rect->w;
+    size_t total = 0;
+
+    for (uint16_t y = rect->y; y < rect->y + rect->h; y += rows_per_chunk) {
+        uint16_t rows = rect->y + rect->h - y;
+        if (rows > rows_per_chunk) {
+            rows = rows_per_chunk;
+        }
+
+        // Reuse the oldest buffer once its transfer has completed
+        if (chunks_in_flight == LCD_CHUNK_BUFFERS) {
+            lcd_wait_one();
+        }
+
+        uint16_t *out = chunk_buf[chunk_next];
+        for (uint16_t row = y; row < y + rows; row++) {
+            const uint8_t *line = &fb[row * DISPLAY_FB_STRIDE];
+            for (uint16_t col = rect->x; col < rect->x + rect->w; col++) {
+                *out++ = (line[col >> 3] & (0x80 >> (col & 7))) ? LCD_COLOR_FG : LCD_COLOR_BG;
+            }
+        }
+
+        size_t len = (size_t)rows * rect->w * sizeof(uint16_t);
+        spi_transaction_t *t = &chunk_trans[chunk_next];
+        *t = (spi_transaction_t){
+            .length = len * 8,
+            .tx_buffer = chunk_buf[chunk_next],
+            .user = (void *)1,
+        };
+        err = spi_device_queue_trans(lcd_spi, t, portMAX_DELAY);
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        chunks_in_flight++;
+        chunk_next = (chunk_next + 1) % LCD_CHUNK_BUFFERS;
+        total += len;
+    }
+
+    *bytes_sent = total;
+    return ESP_OK;
+}
+
+const display_backend_t display_backend_lcd_spi = {
+    .name = "st7789-spi",
+    .init = lcd_init,
+    .flush = lcd_flush,
+    .present = NULL,
+};
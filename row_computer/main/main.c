@@ -3,25 +3,48 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "nvs_flash.h"
 #include <math.h>
 #include "driver/i2c.h"
 #include "driver/spi_master.h"
 #include "config/pin_definitions.h"
 #include "sensors/sensors_common.h"
-#include "sensors/mpu6050.h"
+#include "sensors/imu.h"
 #include "tasks/tasks_common.h"
 #include "utils/protocol_init.h"
 #include "utils/boot_progress.h"
+#include "display/display.h"
+#include "utils/power_governor.h"
+#include "utils/cpu_monitor.h"
+#include "utils/event_capture.h"
+#include "utils/multirate.h"
+#include "utils/sensor_health.h"
+#include "storage/session_log.h"
+#include "storage/session_transfer.h"
+#include "storage/ghost_reference.h"
+#include "utils/stats.h"
+#include "utils/data_bus.h"
+#include "utils/deferred_log.h"
+#include "utils/timebase.h"
+#include "utils/runtime_config.h"
+#include "utils/course.h"
+#include "sensors/mag_calibration.h"
+#include "sensors/imu_calibration.h"
+#include "config/common_constants.h"
 
 static const char *TAG = "MAIN";
 
 // Define the global variables that are declared extern in tasks_common.h
 TaskHandle_t imu_task_handle = NULL;
 TaskHandle_t gps_task_handle = NULL;
+TaskHandle_t dsp_task_handle = NULL;
 TaskHandle_t logging_task_handle = NULL;
+TaskHandle_t display_task_handle = NULL;
+TaskHandle_t dlog_task_handle = NULL;
+TaskHandle_t transfer_task_handle = NULL;
 
-QueueHandle_t imu_data_queue = NULL;
-QueueHandle_t gps_data_queue = NULL;
+bus_topic_t *gps_topic = NULL;
+QueueHandle_t dsp_record_queue = NULL;
 
 void app_main(void) {
     ESP_LOGI(TAG, "=== Rowing Computer Starting ===");
@@ -33,9 +56,16 @@ void app_main(void) {
     // Reduce verbosity on subsystems to only show warnings/errors by default
     esp_log_level_set("GPS", ESP_LOG_WARN);
     esp_log_level_set("PROTOCOLS", ESP_LOG_WARN);
+    esp_log_level_set("IMU", ESP_LOG_WARN);
     esp_log_level_set("MPU6050", ESP_LOG_WARN);
+    esp_log_level_set("ICM42688", ESP_LOG_WARN);
+    esp_log_level_set("LSM6DSO", ESP_LOG_WARN);
     esp_log_level_set("MAG", ESP_LOG_WARN);
+    esp_log_level_set("MAG_CAL", ESP_LOG_INFO);   // Calibration progress/results
     esp_log_level_set("LOG_TASK", ESP_LOG_WARN);
+    esp_log_level_set("DSP_TASK", ESP_LOG_WARN);
+    esp_log_level_set("DISPLAY", ESP_LOG_WARN);
+    esp_log_level_set("LCD", ESP_LOG_WARN);
 
     // Keep sensor health reporting visible (INFO level)
     esp_log_level_set("GPS_TASK", ESP_LOG_INFO);  // For GPS health reports
@@ -47,6 +77,21 @@ void app_main(void) {
     // esp_log_level_set("PROTOCOLS", ESP_LOG_DEBUG);
     // esp_log_level_set("BOOT", ESP_LOG_DEBUG);
 
+    // Initialize NVS (calibration and configuration storage)
+    esp_err_t nvs_err = nvs_flash_init();
+    if (nvs_err == ESP_ERR_NVS_NO_FREE_PAGES || nvs_err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        nvs_flash_erase();
+        nvs_err = nvs_flash_init();
+    }
+    if (nvs_err != ESP_OK) {
+        ESP_LOGW(TAG, "NVS init failed: %s - calibration will not persist", esp_err_to_name(nvs_err));
+    }
+
+    // Runtime configuration overrides - everything initialised below starts from them
+    if (runtime_config_init(nvs_err == ESP_OK ? &runtime_config_store_nvs : NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "Stored configuration unreadable - running on defaults");
+    }
+
     // Initialize hardware protocols
     if (protocols_init() != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize protocols - system halt");
@@ -55,10 +100,10 @@ void app_main(void) {
 
     // Initialize sensors
     ESP_LOGD(TAG, "Initializing sensors...");
-    if (mpu6050_init() != ESP_OK) {
-        boot_progress_failure(BOOT_SENSORS, "MPU6050", "Init failed");
+    if (imu_init() != ESP_OK) {
+        boot_progress_failure(BOOT_SENSORS, imu_backend_name, "Init failed");
     } else {
-        boot_progress_success(BOOT_SENSORS, "MPU6050");
+        boot_progress_success(BOOT_SENSORS, imu_backend_name);
     }
 
     if (mag_init() != ESP_OK) {
@@ -87,6 +132,84 @@ void app_main(void) {
     // Report sensor summary
     boot_progress_report_category(BOOT_SENSORS, "SENSORS");
 
+    // Initialize display (optional - system runs headless without it)
+    if (display_init(&display_backend_lcd_spi) != ESP_OK) {
+        boot_progress_failure(BOOT_PERIPHERALS, "Display", "Init failed");
+    } else {
+        boot_progress_success(BOOT_PERIPHERALS, "Display");
+    }
+
+    if (power_governor_init() != ESP_OK) {
+        boot_progress_failure(BOOT_PERIPHERALS, "Power governor", "Init failed");
+    } else {
+        boot_progress_success(BOOT_PERIPHERALS, "Power governor");
+    }
+
+    if (event_capture_init(CAPTURE_RING_SAMPLES, CAPTURE_PRE_SAMPLES, CAPTURE_POST_SAMPLES) != ESP_OK) {
+        boot_progress_failure(BOOT_PERIPHERALS, "Event capture", "Ring allocation failed");
+    } else {
+        boot_progress_success(BOOT_PERIPHERALS, "Event capture");
+    }
+
+    if (session_log_init() != ESP_OK) {
+        boot_progress_failure(BOOT_PERIPHERALS, "Session log", "No SD card");
+    } else {
+        boot_progress_success(BOOT_PERIPHERALS, "Session log");
+    }
+
+    // Course and ghost come from the card too (optional)
+    if (session_log_is_mounted()) {
+        esp_err_t course_err = course_load(COURSE_PATH, COURSE_GHOST_PATH);
+        if (course_err == ESP_ERR_NOT_FOUND) {
+            boot_progress_failure(BOOT_PERIPHERALS, "Course", "None on card");
+        } else if (course_err != ESP_OK) {
+            boot_progress_failure(BOOT_PERIPHERALS, "Course", "Invalid course file");
+        } else {
+            boot_progress_success(BOOT_PERIPHERALS, "Course");
+        }
+    }
+
+    // Ghost boat races a recorded piece chosen in the runtime configuration
+    const runtime_config_t *boot_config = runtime_config_boot();
+    if (session_log_is_mounted() && boot_config->ghost_session != 0) {
+        if (ghost_reference_load(boot_config->ghost_session, (uint16_t)boot_config->ghost_piece) != ESP_OK) {
+            boot_progress_failure(BOOT_PERIPHERALS, "Ghost boat", "Reference piece not usable");
+        } else {
+            boot_progress_success(BOOT_PERIPHERALS, "Ghost boat");
+        }
+    }
+
+    // Downloads only make sense with a card to read from
+    if (!session_log_is_mounted()) {
+        boot_progress_failure(BOOT_PERIPHERALS, "Session download", "No SD card");
+    } else if (session_transfer_init(&transfer_port_uart) != ESP_OK) {
+        boot_progress_failure(BOOT_PERIPHERALS, "Session download", "UART driver failed");
+    } else {
+        boot_progress_success(BOOT_PERIPHERALS, "Session download");
+    }
+
+    if (deferred_log_init() != ESP_OK) {
+        boot_progress_failure(BOOT_PERIPHERALS, "Deferred log", "Ring allocation failed");
+    } else {
+        boot_progress_success(BOOT_PERIPHERALS, "Deferred log");
+    }
+
+    boot_progress_report_category(BOOT_PERIPHERALS, "PERIPHERALS");
+
+    // Decimation tree and its per-rate IMU topics
+    if (multirate_init() != ESP_OK) {
+        boot_progress_failure(BOOT_QUEUES, "IMU topics", "Creation failed");
+    } else {
+        boot_progress_success(BOOT_QUEUES, "IMU topics");
+    }
+
+    // Sensor health checks and their event topics
+    if (sensor_health_init() != ESP_OK) {
+        boot_progress_failure(BOOT_QUEUES, "Health topics", "Creation failed");
+    } else {
+        boot_progress_success(BOOT_QUEUES, "Health topics");
+    }
+
     // Create communication queues
     create_inter_task_comm();
 
@@ -97,9 +220,51 @@ void app_main(void) {
     boot_progress_report_final();
 
     // Main task becomes system monitor
+    uint32_t governor_log_ms = 0;
+    uint32_t stats_export_ms = 0;
     while (1) {
-        // Monitor system health
-        //ESP_LOGI(TAG, "System running - Free heap: %lu bytes", esp_get_free_heap_size());
-        vTaskDelay(pdMS_TO_TICKS(5000)); // Report every 5 seconds
+        // Monitor system health (CPU / stack figures also feed the stats registry)
+        cpu_monitor_log();
+        bus_log_stats();
+
+        // Complete an online magnetometer fit once enough orientations were seen
+        mag_cal_status_t mag_cal;
+        mag_calibration_get_status(&mag_cal);
+        if (mag_cal.state == MAG_CAL_READY) {
+            mag_calibration_finish();
+        }
+
+        uint32_t now_ms = timebase_now_ms();
+
+        // Persist the learned gyro/accel bias model (rate limited for flash wear)
+        imu_calibration_save_if_due(now_ms);
+
+        // Telemetry snapshot: heap, stacks, CPU, queues, drops, bus errors. Skipped
+        // while a session download has the console.
+        if (STATS_EXPORT_INTERVAL_MS > 0 && now_ms - stats_export_ms >= STATS_EXPORT_INTERVAL_MS &&
+            !session_transfer_active()) {
+            stats_export(stdout);
+            stats_export_ms = now_ms;
+        }
+
+        // Power governor duty cycle
+        if (now_ms - governor_log_ms >= GOV_STATS_LOG_INTERVAL_MS) {
+            power_governor_stats_t gov;
+            power_governor_get_stats(&gov, now_ms);
+            uint32_t total_ms = gov.time_in_state_ms[POWER_STATE_ROWING] +
+                                gov.time_in_state_ms[POWER_STATE_REST] +
+                                gov.time_in_state_ms[POWER_STATE_SLEEP];
+            if (total_ms > 0) {
+                ESP_LOGI(TAG, "Power - %s | Rowing: %lu%% | Rest: %lu%% | Sleep: %lu%% | Wakes: %lu (max %lu ms)",
+                        power_state_name(gov.state),
+                        (uint32_t)((uint64_t)gov.time_in_state_ms[POWER_STATE_ROWING] * 100 / total_ms),
+                        (uint32_t)((uint64_t)gov.time_in_state_ms[POWER_STATE_REST] * 100 / total_ms),
+                        (uint32_t)((uint64_t)gov.time_in_state_ms[POWER_STATE_SLEEP] * 100 / total_ms),
+                        gov.wake_events, gov.max_wake_latency_ms);
+            }
+            governor_log_ms = now_ms;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(SYSTEM_MONITOR_PERIOD_MS));
     }
 }
\ No newline at end of file
@@ -3,90 +3,68 @@
 #include "config/pin_definitions.h"
 #include "config/common_constants.h"
 #include "gps.h"
+#include "ubx_command.h"
+#include "utils/deferred_log.h"
+#include "utils/stats.h"
 #include "esp_mac.h"
 #include <string.h>
 
 static const char *TAG = "GPS";
 
-// UBX utility functions
-static uint16_t ubx_calculate_checksum(const uint8_t* data, uint16_t length) {
-    uint8_t ck_a = 0, ck_b = 0;
-    for (uint16_t i = 0; i < length; i++) {
-        ck_a += data[i];
-        ck_b += ck_a;
-    }
-    return (ck_b << 8) | ck_a; // Return as 16-bit value, caller extracts bytes
-}
-
-static bool ubx_parse_header(const uint8_t* buffer, uint8_t* msg_class, uint8_t* msg_id, uint16_t* payload_length) {
-    // Check sync bytes
-    if (buffer[0] != 0xB5 || buffer[1] != 0x62) {
-        return false;
-    }
-
-    *msg_class = buffer[2];
-    *msg_id = buffer[3];
-    *payload_length = (buffer[5] << 8) | buffer[4]; // Little endian
-
-    return true;
-}
-
-static uint16_t ubx_create_packet(uint8_t msg_class, uint8_t msg_id, const uint8_t* payload, uint16_t payload_len, uint8_t* output) {
-    uint16_t index = 0;
-
-    // Sync bytes
-    output[index++] = 0xB5;
-    output[index++] = 0x62;
-
-    // Header
-    output[index++] = msg_class;
-    output[index++] = msg_id;
-    output[index++] = payload_len & 0xFF;        // Length low byte
-    output[index++] = (payload_len >> 8) & 0xFF; // Length high byte
-
-    // Payload
-    for (uint16_t i = 0; i < payload_len; i++) {
-        output[index++] = payload[i];
-    }
+static stats_metric_t *ubx_frames = NULL;
+static stats_metric_t *ubx_checksum_errors = NULL;
+static stats_metric_t *ubx_cmd_retries = NULL;
+static stats_metric_t *ubx_cmd_failures = NULL;
+
+// Navigation period the receiver acknowledged, and the one last asked for
+static uint16_t measurement_period_ms = GPS_TASK_PERIOD_MS;
+static uint16_t requested_period_ms = GPS_TASK_PERIOD_MS;
+
+// Boot configuration, sent pipelined through the command engine
+static const ubx_command_t config_commands[] = {
+    // UART port to UBX in and out only (CFG-PRT)
+    { "CFG-PRT", UBX_CLASS_CFG, UBX_CFG_PRT, 20, {
+        0x01,                   // Port ID (UART1)
+        0x00,                   // Reserved
+        0x00, 0x00,             // TX Ready
+        0xD0, 0x08, 0x00, 0x00, // Mode: 8N1
+        0x80, 0x25, 0x00, 0x00, // Baud rate: 9600
+        0x01, 0x00,             // Input protocols: UBX only
+        0x01, 0x00,             // Output protocols: UBX only
+        0x00, 0x00,             // Flags
+        0x00, 0x00 } },         // Reserved
+    // UBX-NAV-PVT on every navigation solution (CFG-MSG)
+    { "CFG-MSG NAV-PVT", UBX_CLASS_CFG, UBX_CFG_MSG, 3, { UBX_CLASS_NAV, UBX_NAV_PVT, 0x01 } },
+    // Navigation rate 1Hz, one measurement per solution, GPS time (CFG-RATE)
+    { "CFG-RATE", UBX_CLASS_CFG, UBX_CFG_RATE, 6, { 0xE8, 0x03, 0x01, 0x00, 0x01, 0x00 } },
+};
+static uint8_t config_pending = 0;
+static bool config_failed = false;
 
-    // Calculate checksum over class, id, length, and payload
-    uint16_t checksum = ubx_calculate_checksum(&output[2], 4 + payload_len);
-    output[index++] = checksum & 0xFF;      // CK_A
-    output[index++] = (checksum >> 8) & 0xFF; // CK_B
+static gps_data_t gps_data = {0};
+static gps_health_t gps_health = {0};
 
-    return index; // Total packet length
+// Little-endian UBX fields
+static inline uint16_t ubx_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
 }
 
-// UBX configuration commands for pure UBX mode
-static bool ubx_send_config_command(const uint8_t* command, uint16_t length) {
-    uart_write_bytes(GPS_UART_NUM, (const char*)command, length);
-    vTaskDelay(pdMS_TO_TICKS(200)); // Wait for processing
-
-    // Simple ACK check - look for UBX-ACK-ACK (0x05, 0x01)
-    uint8_t response[32];
-    int len = uart_read_bytes(GPS_UART_NUM, response, sizeof(response), pdMS_TO_TICKS(500));
-
-    for (int i = 0; i < len - 5; i++) {
-        if (response[i] == 0xB5 && response[i+1] == 0x62 &&
-            response[i+2] == 0x05 && response[i+3] == 0x01) {
-            return true; // Found ACK
-        }
-    }
-    return false; // No ACK found
+static inline uint32_t ubx_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
 }
 
-static gps_data_t gps_data = {0};
-static gps_health_t gps_health = {0};
-
-// Parse UBX-NAV-PVT message (92 bytes payload)
+// Parse UBX-NAV-PVT message (92 bytes payload). Fields stay in receiver units -
+// no floating point and no string formatting per fix.
 static void parse_ubx_nav_pvt(const uint8_t* payload) {
-    // Extract time fields (bytes 8-10 for HH:MM:SS)
-    uint8_t hour = payload[8];
-    uint8_t min = payload[9];
-    uint8_t sec = payload[10];
-
-    // Format time as HH:MM:SS
-    snprintf(gps_data.time, sizeof(gps_data.time), "%02d:%02d:%02d", hour, min, sec);
+    // GPS time of week (bytes 0-3) and UTC date/time (bytes 4-11)
+    gps_data.itow_ms = ubx_u32(&payload[0]);
+    gps_data.year = ubx_u16(&payload[4]);
+    gps_data.month = payload[6];
+    gps_data.day = payload[7];
+    gps_data.hour = payload[8];
+    gps_data.minute = payload[9];
+    gps_data.second = payload[10];
+    gps_data.valid = payload[11] & (GPS_VALID_DATE | GPS_VALID_TIME);
 
     // Extract fix type (byte 20)
     uint8_t fix_type = payload[20];
@@ -95,38 +73,32 @@ static void parse_ubx_nav_pvt(const uint8_t* payload) {
     // Extract number of satellites (byte 23)
     gps_data.satellites = payload[23];
 
-    // Extract longitude (bytes 24-27, int32_t, 1e-7 degrees)
-    int32_t lon_raw = (int32_t)((payload[27] << 24) | (payload[26] << 16) | (payload[25] << 8) | payload[24]);
-    gps_data.longitude = (double)lon_raw * 1e-7;
+    // Longitude / latitude (bytes 24-31, int32_t, 1e-7 degrees)
+    gps_data.lon_e7 = (int32_t)ubx_u32(&payload[24]);
+    gps_data.lat_e7 = (int32_t)ubx_u32(&payload[28]);
 
-    // Extract latitude (bytes 28-31, int32_t, 1e-7 degrees)
-    int32_t lat_raw = (int32_t)((payload[31] << 24) | (payload[30] << 16) | (payload[29] << 8) | payload[28]);
-    gps_data.latitude = (double)lat_raw * 1e-7;
+    // Ground speed (bytes 60-63, int32_t, mm/s - never negative)
+    int32_t speed_mm_s = (int32_t)ubx_u32(&payload[60]);
+    gps_data.speed_mm_s = speed_mm_s > 0 ? (uint32_t)speed_mm_s : 0;
 
-    // Extract ground speed (bytes 60-63, uint32_t, mm/s)
-    uint32_t speed_mm_s = (payload[63] << 24) | (payload[62] << 16) | (payload[61] << 8) | payload[60];
-    gps_data.speed_knots = (float)speed_mm_s * 0.001944f; // Convert mm/s to knots
-
-    // Extract heading of motion (bytes 64-67, int32_t, 1e-5 degrees)
-    int32_t heading_raw = (int32_t)((payload[67] << 24) | (payload[66] << 16) | (payload[65] << 8) | payload[64]);
-    gps_data.heading = (float)heading_raw * 1e-5f;
-
-    // Ensure heading is in 0-360 range
-    if (gps_data.heading < 0) gps_data.heading += 360.0f;
-    if (gps_data.heading >= 360.0f) gps_data.heading -= 360.0f;
+    // Heading of motion (bytes 64-67, int32_t, 1e-5 degrees), kept in 0-360
+    int32_t heading_e5 = (int32_t)ubx_u32(&payload[64]) % 36000000;
+    gps_data.heading_e5 = heading_e5 < 0 ? heading_e5 + 36000000 : heading_e5;
 
     // Extract health/accuracy data
     // Horizontal accuracy (bytes 40-43, uint32_t, mm)
-    gps_health.horizontal_accuracy = (payload[43] << 24) | (payload[42] << 16) | (payload[41] << 8) | payload[40];
+    gps_health.horizontal_accuracy = ubx_u32(&payload[40]);
 
     // Speed accuracy (bytes 68-71, uint32_t, mm/s)
-    gps_health.speed_accuracy = (payload[71] << 24) | (payload[70] << 16) | (payload[69] << 8) | payload[68];
+    gps_health.speed_accuracy = ubx_u32(&payload[68]);
 
     // Fix type and satellite count (same as main GPS data)
     gps_health.fix_type = fix_type;
     gps_health.satellites = payload[23];
 }
 
+static void gps_parse_ubx_buffer(const uint8_t *buffer, int buffer_len);
+
 // Initialize UART specifically for GPS
 esp_err_t gps_uart_init(void) {
     ESP_LOGD(TAG, "Initializing GPS UART...");
@@ -140,8 +112,9 @@ esp_err_t gps_uart_init(void) {
         .source_clk = UART_SCLK_DEFAULT,
     };
     
-    esp_err_t err = uart_driver_install(GPS_UART_NUM, GPS_UART_BUF_SIZE * 2, 
-                                       0, 0, NULL, 0);
+    // TX ring so that UBX commands are queued, not written out while the caller waits
+    esp_err_t err = uart_driver_install(GPS_UART_NUM, GPS_UART_BUF_SIZE * 2,
+                                       GPS_UART_TX_BUF_SIZE, 0, NULL, 0);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "UART driver install failed: %s", esp_err_to_name(err));
         return err;
@@ -168,18 +141,15 @@ esp_err_t gps_uart_init(void) {
 esp_err_t gps_test_communication(void) {
     ESP_LOGI(TAG, "Testing GPS communication...");
     
-    // Clear any existing data in buffer
-    uart_flush(GPS_UART_NUM);
-    
-    // Wait for some data to arrive (GPS should be transmitting)
-    char test_buffer[256];
-    int len = uart_read_bytes(GPS_UART_NUM, (uint8_t*)test_buffer,
-                             sizeof(test_buffer)-1, pdMS_TO_TICKS(GPS_COMMUNICATION_TEST_TIMEOUT_MS));
+    // Wait for some data to arrive (GPS should be transmitting). What arrives goes
+    // through the parser - it may hold acknowledges for commands in flight.
+    uint8_t test_buffer[256];
+    int len = uart_read_bytes(GPS_UART_NUM, test_buffer,
+                             sizeof(test_buffer), pdMS_TO_TICKS(GPS_COMMUNICATION_TEST_TIMEOUT_MS));
     
     if (len > 0) {
-        test_buffer[len] = '\0';
+        gps_parse_ubx_buffer(test_buffer, len);
         ESP_LOGI(TAG, "GPS communication OK - received %d bytes", len);
-        ESP_LOGI(TAG, "Sample data: %.50s", test_buffer); // Show first 50 chars
         return ESP_OK;
     } else {
         ESP_LOGE(TAG, "No data received from GPS module");
@@ -188,75 +158,110 @@ esp_err_t gps_test_communication(void) {
     }
 }
 
-// Configure GPS module for UBX-only mode
-esp_err_t gps_configure_module(void) {
-    ESP_LOGI(TAG, "Configuring GPS for UBX mode...");
+// Completion of a boot configuration command
+static void config_command_done(const ubx_command_t *command, ubx_result_t result, void *context) {
+    (void)context;
+    if (result == UBX_RESULT_ACK) {
+        DLOGI(TAG, "✓ %s acknowledged", command->name);
+    } else if (result == UBX_RESULT_REPLACED) {
+        DLOGD(TAG, "%s superseded by a rate change", command->name);
+    } else {
+        DLOGW(TAG, "%s failed (%s)", command->name, result == UBX_RESULT_NAK ? "rejected" : "no answer");
+        config_failed = true;
+    }
 
-    uint8_t packet_buffer[64];
-    uint16_t packet_len;
-    bool success = true;
+    if (config_pending > 0 && --config_pending == 0) {
+        if (config_failed) {
+            DLOGW(TAG, "GPS UBX configuration partial - some commands failed");
+        } else {
+            DLOGI(TAG, "GPS UBX configuration complete");
+        }
+    }
+}
 
-    // 1. Configure UART port to UBX output only (CFG-PRT)
-    uint8_t cfg_prt_payload[] = {
-        0x01,               // Port ID (UART1)
-        0x00,               // Reserved
-        0x00, 0x00,         // TX Ready
-        0xD0, 0x08, 0x00, 0x00, // Mode: 8N1
-        0x80, 0x25, 0x00, 0x00, // Baud rate: 9600
-        0x01, 0x00,         // Input protocols: UBX only
-        0x01, 0x00,         // Output protocols: UBX only
-        0x00, 0x00,         // Flags
-        0x00, 0x00          // Reserved
-    };
+// Completion of a measurement rate change
+static void rate_command_done(const ubx_command_t *command, ubx_result_t result, void *context) {
+    (void)context;
+    uint16_t period_ms = ubx_u16(&command->payload[0]);
+    if (result == UBX_RESULT_ACK) {
+        measurement_period_ms = period_ms;
+        DLOGD(TAG, "GPS measurement rate set to %u ms", period_ms);
+    } else if (result == UBX_RESULT_TIMEOUT && period_ms == requested_period_ms) {
+        // Forget the request so the next gps_set_measurement_rate() call sends it again.
+        // A rejected rate stays requested - asking again would only be rejected again.
+        requested_period_ms = measurement_period_ms;
+        DLOGW(TAG, "UBX-CFG-RATE %u ms not applied", period_ms);
+    }
+}
 
-    packet_len = ubx_create_packet(0x06, 0x00, cfg_prt_payload, sizeof(cfg_prt_payload), packet_buffer);
-    if (!ubx_send_config_command(packet_buffer, packet_len)) {
-        ESP_LOGW(TAG, "UBX-CFG-PRT command failed");
-        success = false;
-    } else {
-        ESP_LOGI(TAG, "✓ Switched to UBX protocol");
+// Transmit through the UART TX ring; a frame that does not fit waits for the next poll
+static esp_err_t gps_uart_write(const uint8_t *frame, size_t length) {
+    size_t free_bytes = 0;
+    if (uart_get_tx_buffer_free_size(GPS_UART_NUM, &free_bytes) != ESP_OK || free_bytes < length) {
+        return ESP_ERR_NO_MEM;
     }
+    return uart_write_bytes(GPS_UART_NUM, frame, length) == (int)length ? ESP_OK : ESP_FAIL;
+}
 
-    // 2. Enable UBX-NAV-PVT messages at 1Hz rate (CFG-MSG)
-    uint8_t cfg_msg_payload[] = {
-        0x01, 0x07,         // Message class and ID (NAV-PVT)
-        0x01                // Rate: 1 message per navigation solution
-    };
+// Configure GPS module for UBX-only mode. Queues the commands and returns - they
+// are sent, acknowledged and retried by gps_read() while navigation data keeps flowing.
+esp_err_t gps_configure_module(void) {
+    ESP_LOGI(TAG, "Configuring GPS for UBX mode...");
 
-    packet_len = ubx_create_packet(0x06, 0x01, cfg_msg_payload, sizeof(cfg_msg_payload), packet_buffer);
-    if (!ubx_send_config_command(packet_buffer, packet_len)) {
-        ESP_LOGW(TAG, "UBX-CFG-MSG command failed");
-        success = false;
-    } else {
-        ESP_LOGI(TAG, "✓ Enabled NAV-PVT messages");
+    config_failed = false;
+    for (size_t i = 0; i < sizeof(config_commands) / sizeof(config_commands[0]); i++) {
+        esp_err_t err = ubx_command_submit(&config_commands[i], UBX_SUBMIT_APPEND, config_command_done, NULL);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "%s not queued: %s", config_commands[i].name, esp_err_to_name(err));
+            config_failed = true;
+            continue;
+        }
+        config_pending++;
     }
+    requested_period_ms = measurement_period_ms = GPS_TASK_PERIOD_MS;
 
-    // 3. Set navigation rate to 1Hz (CFG-RATE)
-    uint8_t cfg_rate_payload[] = {
-        0xE8, 0x03,         // Measurement rate: 1000ms = 1Hz
-        0x01, 0x00,         // Navigation rate: 1 cycle
-        0x01, 0x00          // Time reference: GPS time
-    };
+    ubx_command_poll(timebase_now_us());
+    return ESP_OK;
+}
 
-    packet_len = ubx_create_packet(0x06, 0x08, cfg_rate_payload, sizeof(cfg_rate_payload), packet_buffer);
-    if (!ubx_send_config_command(packet_buffer, packet_len)) {
-        ESP_LOGW(TAG, "UBX-CFG-RATE command failed");
-        success = false;
-    } else {
-        ESP_LOGI(TAG, "✓ Set 1Hz update rate");
+// Queue a navigation rate change; a change not sent yet is replaced, not stacked
+esp_err_t gps_set_measurement_rate(uint16_t period_ms) {
+    if (period_ms == requested_period_ms) {
+        return ESP_OK;
     }
 
-    if (success) {
-        ESP_LOGI(TAG, "GPS UBX configuration complete");
-    } else {
-        ESP_LOGW(TAG, "GPS UBX configuration partial - some commands failed");
+    ubx_command_t command = {
+        .name = "CFG-RATE",
+        .msg_class = UBX_CLASS_CFG,
+        .msg_id = UBX_CFG_RATE,
+        .length = 6,
+        .payload = {
+            period_ms & 0xFF, (period_ms >> 8) & 0xFF,  // Measurement rate in ms
+            0x01, 0x00,                                 // Navigation rate: 1 cycle
+            0x01, 0x00                                  // Time reference: GPS time
+        },
+    };
+    esp_err_t err = ubx_command_submit(&command, UBX_SUBMIT_REPLACE, rate_command_done, NULL);
+    if (err != ESP_OK) {
+        return err;
     }
+    requested_period_ms = period_ms;
 
+    ubx_command_poll(timebase_now_us());
     return ESP_OK;
 }
 
+uint16_t gps_measurement_period_ms(void) {
+    return measurement_period_ms;
+}
+
 esp_err_t gps_init(void) {
     ESP_LOGD(TAG, "Initializing GPS module...");
+    ubx_frames = stats_register("gps.ubx_frames", STATS_COUNTER);
+    ubx_checksum_errors = stats_register("gps.ubx_checksum_errors", STATS_COUNTER);
+    ubx_cmd_retries = stats_register("gps.ubx_cmd_retries", STATS_GAUGE);
+    ubx_cmd_failures = stats_register("gps.ubx_cmd_failures", STATS_GAUGE);
+    ubx_command_init(gps_uart_write);
     
     // Initialize UART for GPS
     esp_err_t err = gps_uart_init();
@@ -279,30 +284,27 @@ esp_err_t gps_init(void) {
 }
 
 
-// Read raw UART data with timeout and connection monitoring
-static esp_err_t gps_read_uart_data(uint8_t *buffer, size_t buffer_size, int *bytes_read) {
-    static uint32_t last_data_time = 0;
-
-    *bytes_read = uart_read_bytes(GPS_UART_NUM, buffer, buffer_size, pdMS_TO_TICKS(GPS_TIMEOUT_MS));
+// Data received since the last gps_read(), by it or by gps_wait_until()
+static bool rx_pending = false;
+static timebase_us_t last_data_us = 0;
 
-    if (*bytes_read <= 0) {
-        uint32_t current_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
-        if (current_time - last_data_time > GPS_DATA_TIMEOUT_MS) {
-            ESP_LOGW(TAG, "No GPS data received - check connections");
-            last_data_time = current_time;
-        }
-        return ESP_ERR_NOT_FOUND;
+// Read what the UART delivers within wait_ms and parse it - acknowledges included,
+// so they count before the command deadlines are checked
+static int gps_receive(uint8_t *buffer, size_t buffer_size, uint32_t wait_ms) {
+    int bytes_read = uart_read_bytes(GPS_UART_NUM, buffer, buffer_size, pdMS_TO_TICKS(wait_ms));
+    if (bytes_read <= 0) {
+        return 0;
     }
 
-    // Update last data time and add debug logging
-    last_data_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    last_data_us = timebase_now_us();
+    rx_pending = true;
     static int debug_counter = 0;
     if (++debug_counter >= GPS_DEBUG_LOG_INTERVAL) {
-        ESP_LOGD(TAG, "Raw GPS data (%d bytes): [UBX binary]", *bytes_read);
+        DLOGD(TAG, "Raw GPS data (%d bytes): [UBX binary]", bytes_read);
         debug_counter = 0;
     }
-
-    return ESP_OK;
+    gps_parse_ubx_buffer(buffer, bytes_read);
+    return bytes_read;
 }
 
 // Parse UART buffer for UBX packets
@@ -318,13 +320,13 @@ static void gps_parse_ubx_buffer(const uint8_t *buffer, int buffer_len) {
 
         if (!in_packet) {
             // Look for UBX sync bytes (0xB5, 0x62)
-            if (ubx_pos == 0 && byte == 0xB5) {
+            if (ubx_pos == 0 && byte == UBX_SYNC_1) {
                 ubx_buffer[ubx_pos++] = byte;
-            } else if (ubx_pos == 1 && byte == 0x62) {
+            } else if (ubx_pos == 1 && byte == UBX_SYNC_2) {
                 ubx_buffer[ubx_pos++] = byte;
                 in_packet = true;
-            } else {
-                ubx_pos = 0; // Reset if not sync sequence
+            } else if (byte != UBX_SYNC_1) {
+                ubx_pos = 0; // Reset if not sync sequence (a repeated 0xB5 may still start one)
             }
         } else {
             // Collecting packet data
@@ -338,19 +340,28 @@ static void gps_parse_ubx_buffer(const uint8_t *buffer, int buffer_len) {
 
             // Check if packet is complete
             if (ubx_pos >= 8 && ubx_pos >= expected_length) {
-                uint8_t msg_class, msg_id;
-                uint16_t payload_length;
-
-                if (ubx_parse_header(ubx_buffer, &msg_class, &msg_id, &payload_length)) {
-                    // Check for NAV-PVT message (0x01, 0x07)
-                    if (msg_class == 0x01 && msg_id == 0x07 && payload_length == 92) {
+                uint8_t msg_class = ubx_buffer[2];
+                uint8_t msg_id = ubx_buffer[3];
+                uint16_t payload_length = expected_length - UBX_FRAME_OVERHEAD;
+
+                // Checksum covers class, id, length and payload
+                uint16_t checksum = ubx_checksum(&ubx_buffer[2], expected_length - 4);
+                bool checksum_ok = ubx_buffer[expected_length - 2] == (checksum & 0xFF) &&
+                                   ubx_buffer[expected_length - 1] == (checksum >> 8);
+                stats_add(checksum_ok ? ubx_frames : ubx_checksum_errors, 1);
+
+                if (checksum_ok) {
+                    if (msg_class == UBX_CLASS_ACK) {
+                        // Answer to a configuration command
+                        ubx_command_frame(msg_class, msg_id, &ubx_buffer[6], payload_length, timebase_now_us());
+                    } else if (msg_class == UBX_CLASS_NAV && msg_id == UBX_NAV_PVT && payload_length == 92) {
                         parse_ubx_nav_pvt(&ubx_buffer[6]); // Skip header, point to payload
 
                         // Set timestamp for health data
-                        gps_health.timestamp_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+                        gps_health.timestamp_us = timebase_now_us();
 
                         if (!first_nav_pvt_logged) {
-                            ESP_LOGI(TAG, "✓ UBX-NAV-PVT message received - UBX mode active");
+                            DLOGI(TAG, "✓ UBX-NAV-PVT message received - UBX mode active");
                             first_nav_pvt_logged = true;
                         }
                     }
@@ -363,8 +374,8 @@ static void gps_parse_ubx_buffer(const uint8_t *buffer, int buffer_len) {
             }
 
             // Prevent buffer overflow
-            if (ubx_pos >= sizeof(ubx_buffer)) {
-                ESP_LOGW(TAG, "UBX buffer overflow, resetting");
+            if ((size_t)ubx_pos >= sizeof(ubx_buffer)) {
+                DLOG_RATE(ESP_LOG_WARN, TAG, DLOG_WARN_INTERVAL_MS, "UBX buffer overflow, resetting");
                 ubx_pos = 0;
                 in_packet = false;
             }
@@ -380,22 +391,44 @@ esp_err_t gps_read(gps_data_t *out_data) {
     }
 
     uint8_t rx_buffer[GPS_UART_BUF_SIZE];
-    int bytes_read;
-
-    // Read UART data
-    esp_err_t err = gps_read_uart_data(rx_buffer, sizeof(rx_buffer), &bytes_read);
-    if (err != ESP_OK) {
-        return err;
+    gps_receive(rx_buffer, sizeof(rx_buffer), GPS_TIMEOUT_MS);
+    timebase_us_t now_us = timebase_now_us();
+
+    // Drive the command engine: sends, resends and timeouts
+    ubx_command_poll(now_us);
+    ubx_command_stats_t ubx_stats;
+    ubx_command_get_stats(&ubx_stats);
+    stats_set(ubx_cmd_retries, ubx_stats.retries);
+    stats_set(ubx_cmd_failures, ubx_stats.naked + ubx_stats.timeouts);
+
+    if (!rx_pending) {
+        // 64-bit time: the silence is measured without any wrap to get wrong
+        if (now_us - last_data_us > (timebase_us_t)GPS_DATA_TIMEOUT_MS * 1000) {
+            DLOGW(TAG, "No GPS data received - check connections");
+            last_data_us = now_us;
+        }
+        return ESP_ERR_NOT_FOUND;
     }
-
-    // Parse UBX packets from buffer
-    gps_parse_ubx_buffer(rx_buffer, bytes_read);
+    rx_pending = false;
 
     // Copy parsed data to caller
     *out_data = gps_data;
     return ESP_OK;
 }
 
+void gps_wait_until(timebase_us_t until_us) {
+    uint8_t rx_buffer[GPS_UART_BUF_SIZE];
+    for (timebase_us_t now_us = timebase_now_us(); now_us < until_us; now_us = timebase_now_us()) {
+        // Short waits only while a command expects an answer; otherwise one wait
+        uint64_t wait_ms = (until_us - now_us + 999) / 1000;
+        if (!ubx_command_idle() && wait_ms > UBX_POLL_MS) {
+            wait_ms = UBX_POLL_MS;
+        }
+        gps_receive(rx_buffer, sizeof(rx_buffer), (uint32_t)wait_ms);
+        ubx_command_poll(timebase_now_us());
+    }
+}
+
 // Read GPS health data
 esp_err_t gps_read_health(gps_health_t *out_health) {
     if (out_health == NULL) {
@@ -4,24 +4,42 @@
 #include "esp_err.h"
 #include <stdbool.h>
 #include <stdint.h>
+#include "utils/timebase.h"
 
+// One navigation solution in the receiver's native integer units (40 bytes, 2 of
+// padding). Convert only where a human reads it - see the GPS_*() helpers below.
 typedef struct {
-    char time[16];
-    double latitude;
-    double longitude;
-    float speed_knots;
-    float heading;
-    int satellites;
-    bool valid_fix;
-    uint32_t timestamp_ms;
+    timebase_us_t timestamp_us;    // Local time the fix was received (timebase)
+    int32_t lat_e7;                // 1e-7 degrees
+    int32_t lon_e7;                // 1e-7 degrees
+    uint32_t speed_mm_s;           // Ground speed
+    int32_t heading_e5;            // Heading of motion, 1e-5 degrees [0, 360)
+    uint32_t itow_ms;              // GPS time of week of the solution
+    uint16_t year;                 // UTC date/time (see GPS_VALID_* in valid)
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t valid;                 // GPS_VALID_* flags
+    uint8_t satellites;
+    bool valid_fix;                // 2D or better
 } gps_data_t;
 
+#define GPS_VALID_DATE          (1U << 0)
+#define GPS_VALID_TIME          (1U << 1)
+
+// Edge conversions (display, log output, exporters)
+#define GPS_DEG(e7)             ((e7) * 1e-7)
+#define GPS_HEADING_DEG(e5)     ((e5) * 1e-5f)
+#define GPS_KNOTS(mm_s)         ((mm_s) * 0.00194384f)
+
 typedef struct {
     uint32_t horizontal_accuracy;  // mm - position accuracy estimate
     uint32_t speed_accuracy;       // mm/s - speed accuracy estimate
     uint8_t fix_type;              // 0=no fix, 2=2D, 3=3D, 4=GNSS+DR
     uint8_t satellites;            // Number of satellites (duplicated for convenience)
-    uint32_t timestamp_ms;         // When this health data was captured
+    timebase_us_t timestamp_us;    // When this health data was captured
 } gps_health_t;
 
 // Main GPS functions
@@ -37,4 +55,19 @@ void gps_debug_raw_data(void);
 esp_err_t gps_uart_init(void);
 esp_err_t gps_configure_module(void);
 
+// Change the navigation solution rate (CFG-RATE), e.g. to save power at rest.
+// Queues the command and returns; gps_read() and gps_wait_until() send it and
+// collect the answer.
+// Repeating the rate already asked for does nothing.
+esp_err_t gps_set_measurement_rate(uint16_t period_ms);
+
+// Navigation period the receiver has acknowledged
+uint16_t gps_measurement_period_ms(void);
+
+// Wait on the UART until until_us (timebase) between reads. What arrives is parsed
+// and counts for the next gps_read(). While commands are outstanding the wait is
+// cut into UBX_POLL_MS slices, so answers, resends and timeouts keep to
+// UBX_ACK_TIMEOUT_MS whatever the navigation period.
+void gps_wait_until(timebase_us_t until_us);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "sdkconfig.h"
+#if CONFIG_ROW_IMU_ICM42688
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "imu_backend.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "utils/spi_sensor.h"
+
+// ICM-42688-P over SPI. 16-bit FIFO packets (packet 3) are drained in one DMA
+// burst; the 20-bit high-resolution packets are not needed at the +-2g/+-250dps
+// canonical scale, whose LSB sizes match the MPU6050 exactly.
+
+static const char *TAG = "ICM42688";
+
+#define ICM42688_PACKET_BYTES       16
+#define ICM42688_HEADER_EMPTY       0x80    // FIFO had no data for this packet
+#define ICM42688_HEADER_ACCEL_GYRO  0x60
+#define ICM42688_FS_2G_250DPS       (3 << 5)
+
+const char *const imu_backend_name = "ICM-42688-P";
+const bool imu_backend_has_fifo = true;
+
+static const struct {
+    uint16_t hz;
+    uint8_t code;
+} odr_codes[] = {
+    { 100, 0x08 }, { 200, 0x07 }, { 500, 0x0F }, { 1000, 0x06 }, { 2000, 0x05 }, { 4000, 0x04 }, { 8000, 0x03 },
+};
+
+esp_err_t imu_backend_init(void) {
+    esp_err_t err = spi_sensor_init();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = spi_sensor_write(ICM42688_DEVICE_CONFIG, 0x01);    // Soft reset
+    if (err != ESP_OK) {
+        return err;
+    }
+    vTaskDelay(pdMS_TO_TICKS(SENSOR_STABILIZE_DELAY_MS));
+
+    uint8_t who_am_i = 0;
+    err = spi_sensor_read(ICM42688_WHO_AM_I, &who_am_i, 1);
+    if (err != ESP_OK || who_am_i != ICM42688_WHO_AM_I_VALUE) {
+        ESP_LOGE(TAG, "ICM-42688-P communication failed or wrong chip ID: 0x%02X", who_am_i);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t imu_backend_configure(const imu_backend_config_t *config, uint16_t *actual_odr_hz) {
+    size_t sel = sizeof(odr_codes) / sizeof(odr_codes[0]) - 1;
+    for (size_t i = 0; i < sizeof(odr_codes) / sizeof(odr_codes[0]); i++) {
+        if (odr_codes[i].hz >= config->odr_hz) {
+            sel = i;
+            break;
+        }
+    }
+
+    const uint8_t sequence[][2] = {
+        { ICM42688_INTF_CONFIG0, 0x70 },      // FIFO count in records, big endian count and data
+        { ICM42688_GYRO_CONFIG0, ICM42688_FS_2G_250DPS | odr_codes[sel].code },
+        { ICM42688_ACCEL_CONFIG0, ICM42688_FS_2G_250DPS | odr_codes[sel].code },
+        { ICM42688_FIFO_CONFIG1, 0x07 },      // Accel + gyro + temp -> packet 3
+        { ICM42688_FIFO_CONFIG, 0x40 },       // Stream-to-FIFO
+        { ICM42688_PWR_MGMT0, 0x0F },         // Accel and gyro in low-noise mode
+    };
+    for (size_t i = 0; i < sizeof(sequence) / sizeof(sequence[0]); i++) {
+        esp_err_t err = spi_sensor_write(sequence[i][0], sequence[i][1]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to configure ICM-42688-P: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    // Gyro start-up, then drop whatever was queued while it settled
+    vTaskDelay(pdMS_TO_TICKS(SENSOR_STABILIZE_DELAY_MS));
+    *actual_odr_hz = odr_codes[sel].hz;
+    return spi_sensor_write(ICM42688_SIGNAL_PATH_RESET, 0x02);
+}
+
+esp_err_t imu_backend_read_fifo(const uint8_t **data, size_t *len) {
+    uint8_t count_be[2];
+    esp_err_t err = spi_sensor_read(ICM42688_FIFO_COUNTH, count_be, sizeof(count_be));
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    size_t records = (count_be[0] << 8) | count_be[1];
+    if (records > IMU_FIFO_MAX_SAMPLES) {
+        records = IMU_FIFO_MAX_SAMPLES;     // The rest stays queued for the next read
+    }
+    *len = records * ICM42688_PACKET_BYTES;
+    if (records == 0) {
+        return ESP_OK;
+    }
+    return spi_sensor_read_burst(ICM42688_FIFO_DATA, *len, data);
+}
+
+uint16_t imu_backend_decode(const uint8_t *data, size_t len, imu_fifo_t *fifo) {
+    uint16_t added = 0;
+
+    for (size_t off = 0; off + ICM42688_PACKET_BYTES <= len && fifo->count < IMU_FIFO_MAX_SAMPLES;
+         off += ICM42688_PACKET_BYTES) {
+        const uint8_t *p = data + off;
+        if ((p[0] & ICM42688_HEADER_EMPTY) || (p[0] & ICM42688_HEADER_ACCEL_GYRO) != ICM42688_HEADER_ACCEL_GYRO) {
+            continue;
+        }
+
+        uint16_t n = fifo->count++;
+        fifo->v[MPU6050_AX][n] = (int16_t)((p[1] << 8) | p[2]);
+        fifo->v[MPU6050_AY][n] = (int16_t)((p[3] << 8) | p[4]);
+        fifo->v[MPU6050_AZ][n] = (int16_t)((p[5] << 8) | p[6]);
+        fifo->v[MPU6050_GX][n] = (int16_t)((p[7] << 8) | p[8]);
+        fifo->v[MPU6050_GY][n] = (int16_t)((p[9] << 8) | p[10]);
+        fifo->v[MPU6050_GZ][n] = (int16_t)((p[11] << 8) | p[12]);
+
+        // FIFO temperature: C = t / 2.07 + 25. In MPU6050 counts ((C - 36.53) * 340)
+        // that is t * 164.25 - 3920
+        int32_t t = (int8_t)p[13];
+        fifo->v[MPU6050_TEMP][n] = (int16_t)((t * 657) / 4 - 3920);
+        added++;
+    }
+    return added;
+}
+
+esp_err_t imu_backend_enable_motion_wakeup(uint16_t threshold_mg) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t imu_backend_disable_motion_wakeup(void) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_ROW_IMU_ICM42688
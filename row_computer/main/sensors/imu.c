@@ -0,0 +1,115 @@
+#include "esp_log.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "imu.h"
+#include "imu_calibration.h"
+
+static const char *TAG = "IMU";
+static bool imu_initialized = false;
+static uint16_t odr_hz = 0;
+static uint16_t sample_hz = 0;      // Rate of the samples imu_read last returned
+static uint32_t rate_phase = 0;
+
+esp_err_t imu_init(void) {
+    if (imu_initialized) {
+        ESP_LOGD(TAG, "IMU already initialized");
+        return ESP_OK;
+    }
+
+    esp_err_t err = imu_backend_init();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    imu_backend_config_t config = { .odr_hz = 1000 / IMU_TASK_PERIOD_MS };
+    err = imu_backend_configure(&config, &odr_hz);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    ESP_LOGD(TAG, "%s running at %u Hz (%s)", imu_backend_name, odr_hz,
+             imu_backend_has_fifo ? "FIFO" : "register reads");
+    imu_initialized = true;
+
+    // Stored bias model; without one the first still second auto-zeroes the gyro
+    if (imu_calibration_init() != ESP_OK) {
+        ESP_LOGD(TAG, "No stored IMU bias model - keep still at boot for auto-zero");
+    }
+    return ESP_OK;
+}
+
+esp_err_t imu_read(imu_fifo_t *fifo, uint16_t output_hz) {
+    // Hot path: failures are counted by the caller and the bus manager, not logged
+    fifo->count = 0;
+    if (!imu_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const uint8_t *data;
+    size_t len;
+    esp_err_t err = imu_backend_read_fifo(&data, &len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    imu_backend_decode(data, len, fifo);
+
+    // Register backends return one sample per read, made at output_hz
+    sample_hz = imu_backend_has_fifo && odr_hz < output_hz ? odr_hz : output_hz;
+
+    // Keep output_hz of every odr_hz samples, evenly spaced (phase accumulator).
+    // Only the reduced-rate power states get here; the anti-alias filtering for
+    // the slow streams is the decimation tree's job at full rate.
+    if (imu_backend_has_fifo && output_hz < odr_hz) {
+        uint16_t kept = 0;
+        for (uint16_t i = 0; i < fifo->count; i++) {
+            rate_phase += output_hz;
+            if (rate_phase < odr_hz) {
+                continue;
+            }
+            rate_phase -= odr_hz;
+            for (int c = 0; c < MPU6050_RAW_COUNT; c++) {
+                fifo->v[c][kept] = fifo->v[c][i];
+            }
+            kept++;
+        }
+        fifo->count = kept;
+    }
+    return ESP_OK;
+}
+
+void imu_sample(const imu_fifo_t *fifo, uint16_t index, mpu6050_data_t *data) {
+    mpu6050_raw_t raw;
+    for (int c = 0; c < MPU6050_RAW_COUNT; c++) {
+        raw.v[c] = fifo->v[c][index];
+    }
+
+    // Learn bias from still periods, then remove bias/temperature drift
+    imu_calibration_observe(&raw, sample_hz);
+    imu_calibration_apply(&raw);
+
+    // Convert to physical units
+    data->accel_x = (float)raw.v[MPU6050_AX] / LSB_SENSITIVITY_2g;
+    data->accel_y = (float)raw.v[MPU6050_AY] / LSB_SENSITIVITY_2g;
+    data->accel_z = (float)raw.v[MPU6050_AZ] / LSB_SENSITIVITY_2g;
+
+    data->gyro_x = (float)raw.v[MPU6050_GX] / LSB_SENSITIVITY_250_deg;
+    data->gyro_y = (float)raw.v[MPU6050_GY] / LSB_SENSITIVITY_250_deg;
+    data->gyro_z = (float)raw.v[MPU6050_GZ] / LSB_SENSITIVITY_250_deg;
+
+    data->temperature_c = MPU6050_TEMP_TO_C(raw.v[MPU6050_TEMP]);
+    data->raw = raw;
+}
+
+esp_err_t imu_enable_motion_wakeup(uint16_t threshold_mg) {
+    if (!imu_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return imu_backend_enable_motion_wakeup(threshold_mg);
+}
+
+esp_err_t imu_disable_motion_wakeup(void) {
+    if (!imu_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return imu_backend_disable_motion_wakeup();
+}
@@ -0,0 +1,28 @@
+#ifndef IMU_H
+#define IMU_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include "sensors/mpu6050.h"
+#include "sensors/imu_backend.h"
+
+// Accelerometer/gyroscope front end over the compiled-in backend (imu_backend.h):
+// burst reads, rate adaptation, calibration and unit conversion.
+
+// Initialize the backend at the 1kHz pipeline rate and load the stored bias model
+esp_err_t imu_init(void);
+
+// Drain the sensor into fifo. FIFO backends are thinned to output_hz (the
+// acquisition rate of the current power state); register backends return one sample.
+esp_err_t imu_read(imu_fifo_t *fifo, uint16_t output_hz);
+
+// Calibrated physical-unit sample index of a burst
+void imu_sample(const imu_fifo_t *fifo, uint16_t index, mpu6050_data_t *data);
+
+// Low-power cycle mode that raises IMU_INT_PIN on motion above threshold_mg
+esp_err_t imu_enable_motion_wakeup(uint16_t threshold_mg);
+
+// Return to continuous sampling and clear any pending motion interrupt
+esp_err_t imu_disable_motion_wakeup(void);
+
+#endif // IMU_H
@@ -0,0 +1,55 @@
+#ifndef IMU_BACKEND_H
+#define IMU_BACKEND_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sensors/mpu6050.h"
+
+// Accelerometer/gyroscope driver interface. Exactly one backend is compiled in,
+// selected in menuconfig (CONFIG_ROW_IMU_*), and it defines the functions below
+// directly - the acquisition hot path makes plain calls, never indirect ones.
+//
+// Every backend decodes into the pipeline's canonical frame: mpu6050_raw_t channel
+// order and MPU6050 scale (16384 LSB/g, 131 LSB/deg/s, MPU6050 temperature counts),
+// so calibration, event capture and unit conversion are shared by all parts.
+
+#define IMU_FIFO_MAX_SAMPLES    32      // Samples decoded per burst
+
+// Decoded burst, structure of arrays: v[channel][sample]
+typedef struct {
+    uint16_t count;
+    int16_t v[MPU6050_RAW_COUNT][IMU_FIFO_MAX_SAMPLES];
+} imu_fifo_t;
+
+typedef struct {
+    uint16_t odr_hz;            // Requested output data rate
+} imu_backend_config_t;
+
+// Part name for boot/health reporting
+extern const char *const imu_backend_name;
+
+// false: the backend reads its output registers (one sample per read, whatever
+// the read rate); true: a hardware FIFO accumulates samples at the ODR
+extern const bool imu_backend_has_fifo;
+
+// Reset the part and check its identity
+esp_err_t imu_backend_init(void);
+
+// Ranges are fixed to the canonical scale (+-2g, +-250deg/s). Stores the rate
+// actually selected in actual_odr_hz (nearest supported at or above odr_hz).
+esp_err_t imu_backend_configure(const imu_backend_config_t *config, uint16_t *actual_odr_hz);
+
+// Burst-read everything the FIFO holds (up to IMU_FIFO_MAX_SAMPLES). *data points
+// into the transport buffer and stays valid until the next read.
+esp_err_t imu_backend_read_fifo(const uint8_t **data, size_t *len);
+
+// Append the samples of a burst to fifo; returns the number added
+uint16_t imu_backend_decode(const uint8_t *data, size_t len, imu_fifo_t *fifo);
+
+// Low-power wake-on-motion on the INT pin (ESP_ERR_NOT_SUPPORTED if the backend has none)
+esp_err_t imu_backend_enable_motion_wakeup(uint16_t threshold_mg);
+esp_err_t imu_backend_disable_motion_wakeup(void);
+
+#endif // IMU_BACKEND_H
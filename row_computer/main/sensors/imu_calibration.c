@@ -0,0 +1,256 @@
+#include "esp_log.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "imu_calibration.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "IMU_CAL";
+
+#define NVS_NAMESPACE       "imu_cal"
+#define NVS_KEY             "model"
+#define CAL_BLOB_VERSION    1
+
+typedef struct {
+    uint32_t version;
+    imu_cal_model_t model;
+} imu_cal_blob_t;
+
+// Weighted linear regression of bias against temperature, with forgetting
+typedef struct {
+    float sw, st, stt, sb, stb;
+} bias_fit_t;
+
+// Running sums for the current observation window
+typedef struct {
+    int32_t sum[MPU6050_RAW_COUNT];
+    int64_t sum_sq[MPU6050_RAW_COUNT];
+    uint16_t count;
+    uint32_t span_us;           // Sensor time covered by the observed samples
+} window_t;
+
+static imu_cal_model_t model = {0};
+static imu_cal_fixed_t fixed[2];
+static const imu_cal_fixed_t * volatile active = &fixed[0];
+static int spare = 1;
+
+static window_t window;
+static uint32_t observe_phase = 0;
+static bias_fit_t fits[MPU6050_RAW_COUNT];
+static float accel_reference[3];
+static bool accel_reference_set = false;
+static imu_cal_status_t status = {0};
+static bool dirty = false;
+static uint32_t last_save_ms = 0;
+static portMUX_TYPE model_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline bool is_gyro(int axis) {
+    return axis >= MPU6050_GX;
+}
+
+// Convert the float model to fixed point and swap it in for the hot path
+static void activate_model(void) {
+    imu_cal_fixed_t *next = &fixed[spare];
+    next->temp_ref_raw = (int32_t)lroundf((IMU_CAL_TEMP_REF_C - MPU6050_TEMP_OFFSET_C) * MPU6050_TEMP_LSB_PER_C);
+    for (int i = 0; i < MPU6050_RAW_COUNT; i++) {
+        next->offset_q16[i] = (int32_t)lroundf(model.offset[i] * 65536.0f);
+        next->slope_q16[i] = (int32_t)lroundf(model.slope[i] / MPU6050_TEMP_LSB_PER_C * 65536.0f);
+    }
+    active = next;
+    spare ^= 1;
+}
+
+static void fit_add(bias_fit_t *fit, float t, float bias, float forget) {
+    fit->sw = forget * fit->sw + 1.0f;
+    fit->st = forget * fit->st + t;
+    fit->stt = forget * fit->stt + t * t;
+    fit->sb = forget * fit->sb + bias;
+    fit->stb = forget * fit->stb + t * bias;
+}
+
+// Slope is only trusted once the window temperatures span IMU_CAL_MIN_TEMP_SPAN_C
+static bool fit_slope(const bias_fit_t *fit, float *slope) {
+    float mean_t = fit->st / fit->sw;
+    float var_t = fit->stt / fit->sw - mean_t * mean_t;
+    if (var_t < (IMU_CAL_MIN_TEMP_SPAN_C / 2) * (IMU_CAL_MIN_TEMP_SPAN_C / 2)) {
+        return false;
+    }
+    *slope = (fit->sw * fit->stb - fit->st * fit->sb) / (fit->sw * fit->sw * var_t);
+    return true;
+}
+
+// A still window: gyro mean is pure bias; accel drift is only learned at the reference pose
+static void update_model(const float mean[MPU6050_RAW_COUNT], float temp_c, float forget) {
+    float t = temp_c - IMU_CAL_TEMP_REF_C;
+    bool gyro_slope = true;
+
+    if (!accel_reference_set) {
+        memcpy(accel_reference, mean, sizeof(accel_reference));
+        accel_reference_set = true;
+    }
+    bool same_pose = fabsf(mean[MPU6050_AX] - accel_reference[0]) < IMU_CAL_ORIENT_TOL_LSB &&
+                     fabsf(mean[MPU6050_AY] - accel_reference[1]) < IMU_CAL_ORIENT_TOL_LSB &&
+                     fabsf(mean[MPU6050_AZ] - accel_reference[2]) < IMU_CAL_ORIENT_TOL_LSB;
+
+    taskENTER_CRITICAL(&model_mux);
+    for (int i = 0; i < MPU6050_RAW_COUNT; i++) {
+        if (i == MPU6050_TEMP || (!is_gyro(i) && !same_pose)) {
+            continue;
+        }
+
+        fit_add(&fits[i], t, mean[i], forget);
+        float slope;
+        bool fitted = fit_slope(&fits[i], &slope);
+        if (fitted) {
+            model.slope[i] = slope;
+        }
+
+        if (is_gyro(i)) {
+            // Auto-zero: intercept follows the latest still periods
+            model.offset[i] = (fits[i].sb - model.slope[i] * fits[i].st) / fits[i].sw;
+            gyro_slope = gyro_slope && fitted;
+        }
+        // Accel offset stays orientation-free: only drift relative to T_ref is removed
+    }
+    taskEXIT_CRITICAL(&model_mux);
+
+    activate_model();
+    dirty = true;
+
+    status.gyro_slope_fitted = gyro_slope;
+    for (int i = 0; i < 3; i++) {
+        status.gyro_bias_dps[i] = (model.offset[MPU6050_GX + i] + model.slope[MPU6050_GX + i] * t) /
+                                  LSB_SENSITIVITY_250_deg;
+    }
+}
+
+void imu_calibration_observe(const mpu6050_raw_t *raw, uint16_t sample_hz) {
+    if (sample_hz == 0) {
+        return;
+    }
+
+    // Decimate to IMU_CAL_OBSERVE_HZ (phase accumulator) so windows and forgetting
+    // are in seconds whatever the acquisition rate; slower input is taken whole
+    uint16_t observed_hz = sample_hz;
+    if (sample_hz > IMU_CAL_OBSERVE_HZ) {
+        observe_phase += IMU_CAL_OBSERVE_HZ;
+        if (observe_phase < sample_hz) {
+            return;
+        }
+        observe_phase -= sample_hz;
+        observed_hz = IMU_CAL_OBSERVE_HZ;
+    }
+
+    for (int i = 0; i < MPU6050_RAW_COUNT; i++) {
+        int32_t v = raw->v[i];
+        window.sum[i] += v;
+        window.sum_sq[i] += v * v;
+    }
+    window.count++;
+    window.span_us += 1000000u / observed_hz;
+    if (window.count < IMU_CAL_WINDOW_MIN_SAMPLES || window.span_us < IMU_CAL_WINDOW_MS * 1000u) {
+        return;
+    }
+
+    // Window complete - judge stillness from per-axis variance
+    float mean[MPU6050_RAW_COUNT];
+    bool still = true;
+    for (int i = 0; i < MPU6050_RAW_COUNT; i++) {
+        mean[i] = (float)window.sum[i] / window.count;
+        if (i == MPU6050_TEMP) {
+            continue;
+        }
+        // Exact integer variance scaled by n^2 - no float cancellation on the 1g axis
+        int64_t var_n2 = (int64_t)window.count * window.sum_sq[i] - (int64_t)window.sum[i] * window.sum[i];
+        int64_t limit = (int64_t)(is_gyro(i) ? IMU_CAL_GYRO_STILL_VAR : IMU_CAL_ACCEL_STILL_VAR) *
+                        window.count * window.count;
+        still = still && var_n2 <= limit;
+    }
+
+    float temp_c = mean[MPU6050_TEMP] / MPU6050_TEMP_LSB_PER_C + MPU6050_TEMP_OFFSET_C;
+    status.windows++;
+    status.temperature_c = temp_c;
+
+    if (still) {
+        // IMU_CAL_FORGET is per nominal window; a stretched window forgets more
+        float forget = powf(IMU_CAL_FORGET, (float)window.span_us / (IMU_CAL_WINDOW_MS * 1000.0f));
+        status.still_windows++;
+        update_model(mean, temp_c, forget);
+    }
+
+    memset(&window, 0, sizeof(window));
+}
+
+esp_err_t imu_calibration_init(void) {
+    nvs_handle_t handle;
+    imu_cal_blob_t blob;
+    size_t len = sizeof(blob);
+
+    memset(&window, 0, sizeof(window));
+    observe_phase = 0;
+    memset(fits, 0, sizeof(fits));
+    accel_reference_set = false;
+
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_OK) {
+        err = nvs_get_blob(handle, NVS_KEY, &blob, &len);
+        nvs_close(handle);
+    }
+
+    if (err == ESP_OK && len == sizeof(blob) && blob.version == CAL_BLOB_VERSION) {
+        model = blob.model;
+        status.stored = true;
+        ESP_LOGD(TAG, "Loaded IMU bias model");
+    } else {
+        memset(&model, 0, sizeof(model));
+        status.stored = false;
+        err = ESP_ERR_NOT_FOUND;
+    }
+
+    activate_model();
+    return err;
+}
+
+esp_err_t imu_calibration_save_if_due(uint32_t now_ms) {
+    if (!dirty || (status.stored && now_ms - last_save_ms < IMU_CAL_SAVE_INTERVAL_MS)) {
+        return ESP_OK;
+    }
+
+    imu_cal_blob_t blob = { .version = CAL_BLOB_VERSION };
+    taskENTER_CRITICAL(&model_mux);
+    blob.model = model;
+    taskEXIT_CRITICAL(&model_mux);
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_blob(handle, NVS_KEY, &blob, sizeof(blob));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (err == ESP_OK) {
+        dirty = false;
+        status.stored = true;
+        last_save_ms = now_ms;
+        ESP_LOGD(TAG, "IMU bias model saved");
+    }
+    return err;
+}
+
+esp_err_t imu_calibration_get_status(imu_cal_status_t *out_status) {
+    if (out_status == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_status = status;
+    return ESP_OK;
+}
+
+const imu_cal_fixed_t* imu_calibration_fixed(void) {
+    return active;
+}
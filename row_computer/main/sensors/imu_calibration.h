@@ -0,0 +1,58 @@
+#ifndef IMU_CALIBRATION_H
+#define IMU_CALIBRATION_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "sensors/mpu6050.h"
+
+// Per-axis bias model: bias(T) = offset + slope * (T - IMU_CAL_TEMP_REF_C), in raw LSB
+typedef struct {
+    float offset[MPU6050_RAW_COUNT];
+    float slope[MPU6050_RAW_COUNT];     // LSB per degree C
+} imu_cal_model_t;
+
+// Fixed-point form used by the hot path
+typedef struct {
+    int32_t offset_q16[MPU6050_RAW_COUNT];
+    int32_t slope_q16[MPU6050_RAW_COUNT];   // LSB per raw temperature LSB, Q16
+    int32_t temp_ref_raw;
+} imu_cal_fixed_t;
+
+typedef struct {
+    uint32_t windows;           // Completed observation windows
+    uint32_t still_windows;     // Windows that updated the model
+    float temperature_c;        // Mean temperature of the last window
+    float gyro_bias_dps[3];     // Current gyro bias at that temperature
+    bool gyro_slope_fitted;     // Enough temperature spread for a slope
+    bool stored;                // Model was loaded or saved to NVS
+} imu_cal_status_t;
+
+// Load the stored model from NVS (zero model if none - the first still window auto-zeroes)
+esp_err_t imu_calibration_init(void);
+
+// Feed one raw sample taken at sample_hz to the stationary detector. Decimated to
+// IMU_CAL_OBSERVE_HZ internally. O(1); updates the model at window end.
+void imu_calibration_observe(const mpu6050_raw_t *raw, uint16_t sample_hz);
+
+// Persist the model if it changed and IMU_CAL_SAVE_INTERVAL_MS elapsed (not for hot paths)
+esp_err_t imu_calibration_save_if_due(uint32_t now_ms);
+
+esp_err_t imu_calibration_get_status(imu_cal_status_t *out_status);
+
+const imu_cal_fixed_t* imu_calibration_fixed(void);
+
+// Remove bias in place. Same integer ops on every lane, no data-dependent branches.
+static inline void imu_calibration_apply(mpu6050_raw_t *raw) {
+    const imu_cal_fixed_t *m = imu_calibration_fixed();
+    int32_t dt = raw->v[MPU6050_TEMP] - m->temp_ref_raw;
+
+    for (int i = 0; i < MPU6050_RAW_COUNT; i++) {
+        int32_t corrected = raw->v[i] - ((m->offset_q16[i] + m->slope_q16[i] * dt) >> 16);
+        corrected = corrected < INT16_MIN ? INT16_MIN : corrected;  // min/max, not branches
+        corrected = corrected > INT16_MAX ? INT16_MAX : corrected;
+        raw->v[i] = (int16_t)corrected;
+    }
+}
+
+#endif // IMU_CALIBRATION_H
@@ -0,0 +1,183 @@
+#include "sdkconfig.h"
+#if CONFIG_ROW_IMU_LSM6DSO
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "imu_backend.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "utils/spi_sensor.h"
+
+// LSM6DSO over SPI. The FIFO holds tagged 7-byte words (accelerometer, gyroscope
+// and temperature separately), drained in one DMA burst and paired up here.
+// Native LSB sizes differ from the canonical frame and are rescaled in Q16.
+
+static const char *TAG = "LSM6DSO";
+
+#define LSM6DSO_WORD_BYTES          7
+#define LSM6DSO_TAG_GYRO            0x01
+#define LSM6DSO_TAG_ACCEL           0x02
+#define LSM6DSO_TAG_TEMP            0x03
+#define LSM6DSO_GYRO_TO_CANON_Q16   75121   // 8.75 mdps/LSB -> 1/131 dps/LSB
+#define LSM6DSO_ACCEL_TO_CANON_Q16  65498   // 0.061 mg/LSB  -> 1/16384 g/LSB
+#define LSM6DSO_TEMP_BATCH_12HZ     (0x2 << 4)
+#define LSM6DSO_FIFO_CONTINUOUS     0x06
+
+const char *const imu_backend_name = "LSM6DSO";
+const bool imu_backend_has_fifo = true;
+
+static const struct {
+    uint16_t hz;
+    uint8_t code;       // Same code for ODR_XL/ODR_G and the FIFO batch rates
+} odr_codes[] = {
+    { 104, 0x4 }, { 208, 0x5 }, { 416, 0x6 }, { 833, 0x7 }, { 1667, 0x8 }, { 3333, 0x9 }, { 6667, 0xA },
+};
+
+// A burst may end between the accelerometer and gyroscope words of one sample
+static struct {
+    int16_t accel[3];
+    int16_t gyro[3];
+    int16_t temp;       // Canonical counts, batched far slower than the motion data
+    bool have_accel;
+    bool have_gyro;
+} pending;
+
+static inline int16_t le16(const uint8_t *p) {
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static inline int16_t rescale(int16_t value, int32_t q16) {
+    int32_t scaled = ((int32_t)value * q16) >> 16;
+    return scaled > INT16_MAX ? INT16_MAX : scaled < INT16_MIN ? INT16_MIN : (int16_t)scaled;
+}
+
+esp_err_t imu_backend_init(void) {
+    esp_err_t err = spi_sensor_init();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = spi_sensor_write(LSM6DSO_CTRL3_C, 0x01);     // SW_RESET
+    if (err != ESP_OK) {
+        return err;
+    }
+    vTaskDelay(pdMS_TO_TICKS(SENSOR_STABILIZE_DELAY_MS));
+
+    uint8_t who_am_i = 0;
+    err = spi_sensor_read(LSM6DSO_WHO_AM_I, &who_am_i, 1);
+    if (err != ESP_OK || who_am_i != LSM6DSO_WHO_AM_I_VALUE) {
+        ESP_LOGE(TAG, "LSM6DSO communication failed or wrong chip ID: 0x%02X", who_am_i);
+        return ESP_FAIL;
+    }
+    pending.temp = 0;
+    pending.have_accel = pending.have_gyro = false;
+    return ESP_OK;
+}
+
+esp_err_t imu_backend_configure(const imu_backend_config_t *config, uint16_t *actual_odr_hz) {
+    size_t sel = sizeof(odr_codes) / sizeof(odr_codes[0]) - 1;
+    for (size_t i = 0; i < sizeof(odr_codes) / sizeof(odr_codes[0]); i++) {
+        if (odr_codes[i].hz >= config->odr_hz) {
+            sel = i;
+            break;
+        }
+    }
+    uint8_t code = odr_codes[sel].code;
+
+    const uint8_t sequence[][2] = {
+        { LSM6DSO_CTRL3_C, 0x44 },            // BDU, register auto-increment
+        { LSM6DSO_CTRL1_XL, code << 4 },      // +-2g
+        { LSM6DSO_CTRL2_G, code << 4 },       // +-250dps
+        { LSM6DSO_FIFO_CTRL3, (code << 4) | code },
+        { LSM6DSO_FIFO_CTRL4, LSM6DSO_TEMP_BATCH_12HZ | LSM6DSO_FIFO_CONTINUOUS },
+    };
+    for (size_t i = 0; i < sizeof(sequence) / sizeof(sequence[0]); i++) {
+        esp_err_t err = spi_sensor_write(sequence[i][0], sequence[i][1]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to configure LSM6DSO: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    *actual_odr_hz = odr_codes[sel].hz;
+    return ESP_OK;
+}
+
+esp_err_t imu_backend_read_fifo(const uint8_t **data, size_t *len) {
+    uint8_t status[2];
+    esp_err_t err = spi_sensor_read(LSM6DSO_FIFO_STATUS1, status, sizeof(status));
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Two words per sample plus the occasional temperature word
+    size_t words = status[0] | ((status[1] & 0x03) << 8);
+    size_t max_words = SPI_SENSOR_MAX_BURST / LSM6DSO_WORD_BYTES;
+    if (max_words > 2 * IMU_FIFO_MAX_SAMPLES + 1) {
+        max_words = 2 * IMU_FIFO_MAX_SAMPLES + 1;
+    }
+    if (words > max_words) {
+        words = max_words;
+    }
+    *len = words * LSM6DSO_WORD_BYTES;
+    if (words == 0) {
+        return ESP_OK;
+    }
+    return spi_sensor_read_burst(LSM6DSO_FIFO_DATA_OUT_TAG, *len, data);
+}
+
+uint16_t imu_backend_decode(const uint8_t *data, size_t len, imu_fifo_t *fifo) {
+    uint16_t added = 0;
+
+    for (size_t off = 0; off + LSM6DSO_WORD_BYTES <= len; off += LSM6DSO_WORD_BYTES) {
+        const uint8_t *p = data + off;
+        switch (p[0] >> 3) {
+            case LSM6DSO_TAG_ACCEL:
+                for (int i = 0; i < 3; i++) {
+                    pending.accel[i] = rescale(le16(p + 1 + 2 * i), LSM6DSO_ACCEL_TO_CANON_Q16);
+                }
+                pending.have_accel = true;
+                break;
+            case LSM6DSO_TAG_GYRO:
+                for (int i = 0; i < 3; i++) {
+                    pending.gyro[i] = rescale(le16(p + 1 + 2 * i), LSM6DSO_GYRO_TO_CANON_Q16);
+                }
+                pending.have_gyro = true;
+                break;
+            case LSM6DSO_TAG_TEMP: {
+                // 256 LSB/C, 0 = 25C. In MPU6050 counts ((C - 36.53) * 340) that is
+                // t * 85/64 - 3920
+                int32_t t = le16(p + 1);
+                pending.temp = (int16_t)((t * 85) / 64 - 3920);
+                break;
+            }
+            default:
+                break;      // Timestamp / sensor-hub words are not batched
+        }
+
+        if (pending.have_accel && pending.have_gyro && fifo->count < IMU_FIFO_MAX_SAMPLES) {
+            uint16_t n = fifo->count++;
+            fifo->v[MPU6050_AX][n] = pending.accel[0];
+            fifo->v[MPU6050_AY][n] = pending.accel[1];
+            fifo->v[MPU6050_AZ][n] = pending.accel[2];
+            fifo->v[MPU6050_TEMP][n] = pending.temp;
+            fifo->v[MPU6050_GX][n] = pending.gyro[0];
+            fifo->v[MPU6050_GY][n] = pending.gyro[1];
+            fifo->v[MPU6050_GZ][n] = pending.gyro[2];
+            pending.have_accel = pending.have_gyro = false;
+            added++;
+        }
+    }
+    return added;
+}
+
+esp_err_t imu_backend_enable_motion_wakeup(uint16_t threshold_mg) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t imu_backend_disable_motion_wakeup(void) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_ROW_IMU_LSM6DSO
@@ -2,6 +2,7 @@
 #include "driver/i2c.h"
 #include "config/pin_definitions.h"
 #include "sensors/sensors_common.h"
+#include "sensors/mag_calibration.h"
 
 static const char *TAG = "MAG";
 
@@ -30,6 +31,11 @@ esp_err_t mag_init(void)
         return err;
     }
     
+    // Load hard/soft-iron calibration (starts an online fit if none is stored)
+    if (mag_calibration_init() != ESP_OK) {
+        ESP_LOGW(TAG, "No magnetometer calibration stored - heading uncorrected until fit completes");
+    }
+
     ESP_LOGD(TAG, "Magnetometer initialized successfully");
     return ESP_OK;
 }
@@ -39,18 +45,35 @@ esp_err_t mag_read(float *x, float *y, float *z)
     uint8_t data[6];
     esp_err_t err = mag_read_bytes(HMC5883L_REG_DATA_X_MSB, data, 6);
     
+    // Hot path: failures are counted by the bus manager, not logged
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read HMC5883L data: %s", esp_err_to_name(err));
         return err;
     }
 
+    // Data registers are ordered X, Z, Y
     int16_t raw_x = (int16_t)((data[0] << 8) | data[1]);
     int16_t raw_z = (int16_t)((data[2] << 8) | data[3]);
     int16_t raw_y = (int16_t)((data[4] << 8) | data[5]);
 
-    *x = raw_x * MAG_SCALE_1_3_GAUSS;
-    *y = raw_y * MAG_SCALE_1_3_GAUSS;
-    *z = raw_z * MAG_SCALE_1_3_GAUSS;
+    // A saturated axis reads as the overflow value, not the field: keep it out of
+    // the fit and leave the caller's previous reading in place
+    if (raw_x == HMC5883L_OVERFLOW || raw_y == HMC5883L_OVERFLOW || raw_z == HMC5883L_OVERFLOW) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    const float raw[3] = {
+        raw_x * MAG_SCALE_1_3_GAUSS,
+        raw_y * MAG_SCALE_1_3_GAUSS,
+        raw_z * MAG_SCALE_1_3_GAUSS,
+    };
+    float corrected[3];
+
+    mag_calibration_feed(raw);
+    mag_calibration_apply(mag_calibration_transform(), raw, corrected);
+
+    *x = corrected[0];
+    *y = corrected[1];
+    *z = corrected[2];
 
     return ESP_OK;
 }
@@ -0,0 +1,420 @@
+#include "esp_log.h"
+#include "nvs.h"
+#include "config/common_constants.h"
+#include "mag_calibration.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "MAG_CAL";
+
+#define NVS_NAMESPACE       "mag_cal"
+#define NVS_KEY             "xform"
+#define CAL_BLOB_VERSION    1
+#define FIT_PARAMS          9   // Quadric a,b,c,d,e,f,g,h,i
+#define FIT_UPPER           (FIT_PARAMS * (FIT_PARAMS + 1) / 2)
+
+typedef struct {
+    uint32_t version;
+    mag_cal_transform_t xform;
+    float field_radius;
+    float fit_rms;
+} mag_cal_blob_t;
+
+// Sufficient statistics of the quadric least-squares fit
+//   a x² + b y² + c z² + 2d xy + 2e xz + 2f yz + 2g x + 2h y + 2i z = 1
+// Only D'D (upper triangle) and D'1 are kept, never the point cloud.
+// Accumulated in float (the ESP32 FPU has no double): x, y, z are centred on the
+// transform active at start, each block of samples is summed on its own and then
+// folded into the totals with compensated summation, so the error stays near one
+// block's rounding however long the fit collects.
+typedef struct {
+    float dtd[FIT_UPPER];
+    float dt1[FIT_PARAMS];
+    float dtd_carry[FIT_UPPER];     // Kahan compensation of the totals
+    float dt1_carry[FIT_PARAMS];
+    float block_dtd[FIT_UPPER];
+    float block_dt1[FIT_PARAMS];
+    uint32_t block_count;
+    uint32_t count;
+    float centre[3];
+    float min[3];
+    float max[3];
+    float last[3];
+} fit_accumulator_t;
+
+static const mag_cal_transform_t identity = {
+    .offset = { 0.0f, 0.0f, 0.0f },
+    .matrix = { 1.0f, 0.0f, 0.0f,
+                0.0f, 1.0f, 0.0f,
+                0.0f, 0.0f, 1.0f },
+};
+
+// Double buffered so the hot path never sees a half-written transform
+static mag_cal_transform_t transforms[2];
+static const mag_cal_transform_t * volatile active = &identity;
+static int spare = 0;
+
+static fit_accumulator_t acc;
+static volatile mag_cal_state_t state = MAG_CAL_IDLE;
+static float field_radius = 0.0f;
+static float fit_rms = 0.0f;
+static bool stored = false;
+
+static inline int upper_index(int row, int col) {
+    // Row-major upper triangle, row <= col
+    return row * FIT_PARAMS - row * (row - 1) / 2 + (col - row);
+}
+
+void mag_calibration_start(void) {
+    memset(&acc, 0, sizeof(acc));
+    memcpy(acc.centre, active->offset, sizeof(acc.centre));
+    for (int i = 0; i < 3; i++) {
+        acc.min[i] = INFINITY;
+        acc.max[i] = -INFINITY;
+    }
+    state = MAG_CAL_COLLECTING;
+    ESP_LOGI(TAG, "Collecting magnetometer calibration - rotate the boat/unit through all orientations");
+}
+
+static inline void kahan_add(float *sum, float *carry, float value) {
+    float y = value - *carry;
+    float t = *sum + y;
+    *carry = (t - *sum) - y;
+    *sum = t;
+}
+
+static void fold_block(void) {
+    for (int i = 0; i < FIT_UPPER; i++) {
+        kahan_add(&acc.dtd[i], &acc.dtd_carry[i], acc.block_dtd[i]);
+        acc.block_dtd[i] = 0.0f;
+    }
+    for (int i = 0; i < FIT_PARAMS; i++) {
+        kahan_add(&acc.dt1[i], &acc.dt1_carry[i], acc.block_dt1[i]);
+        acc.block_dt1[i] = 0.0f;
+    }
+    acc.block_count = 0;
+}
+
+void mag_calibration_feed(const float raw[3]) {
+    if (state != MAG_CAL_COLLECTING) {
+        return;
+    }
+
+    // HMC5883L updates at 15Hz but is polled faster - skip repeated samples
+    if (raw[0] == acc.last[0] && raw[1] == acc.last[1] && raw[2] == acc.last[2]) {
+        return;
+    }
+    memcpy(acc.last, raw, sizeof(acc.last));
+
+    float x = (raw[0] - acc.centre[0]) / MAG_CAL_NORM;
+    float y = (raw[1] - acc.centre[1]) / MAG_CAL_NORM;
+    float z = (raw[2] - acc.centre[2]) / MAG_CAL_NORM;
+    const float phi[FIT_PARAMS] = {
+        x * x, y * y, z * z, 2 * x * y, 2 * x * z, 2 * y * z, 2 * x, 2 * y, 2 * z
+    };
+
+    int k = 0;
+    for (int row = 0; row < FIT_PARAMS; row++) {
+        acc.block_dt1[row] += phi[row];
+        for (int col = row; col < FIT_PARAMS; col++) {
+            acc.block_dtd[k++] += phi[row] * phi[col];
+        }
+    }
+    acc.count++;
+    if (++acc.block_count == MAG_CAL_BLOCK_SAMPLES) {
+        fold_block();
+    }
+
+    bool covered = acc.count >= MAG_CAL_MIN_SAMPLES;
+    for (int i = 0; i < 3; i++) {
+        if (raw[i] < acc.min[i]) acc.min[i] = raw[i];
+        if (raw[i] > acc.max[i]) acc.max[i] = raw[i];
+        covered = covered && (acc.max[i] - acc.min[i]) >= MAG_CAL_MIN_SPAN;
+    }
+
+    if (covered) {
+        state = MAG_CAL_READY;
+    }
+}
+
+// Solve the 9x9 normal equations by Gaussian elimination with partial pivoting
+static bool solve_normal_equations(double p[FIT_PARAMS]) {
+    double m[FIT_PARAMS][FIT_PARAMS + 1];
+
+    for (int row = 0; row < FIT_PARAMS; row++) {
+        for (int col = 0; col < FIT_PARAMS; col++) {
+            m[row][col] = row <= col ? acc.dtd[upper_index(row, col)] : acc.dtd[upper_index(col, row)];
+        }
+        m[row][FIT_PARAMS] = acc.dt1[row];
+    }
+
+    for (int col = 0; col < FIT_PARAMS; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < FIT_PARAMS; row++) {
+            if (fabs(m[row][col]) > fabs(m[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (fabs(m[pivot][col]) < 1e-12) {
+            return false;
+        }
+        if (pivot != col) {
+            for (int k = col; k <= FIT_PARAMS; k++) {
+                double tmp = m[col][k];
+                m[col][k] = m[pivot][k];
+                m[pivot][k] = tmp;
+            }
+        }
+        for (int row = col + 1; row < FIT_PARAMS; row++) {
+            double factor = m[row][col] / m[col][col];
+            for (int k = col; k <= FIT_PARAMS; k++) {
+                m[row][k] -= factor * m[col][k];
+            }
+        }
+    }
+
+    for (int row = FIT_PARAMS - 1; row >= 0; row--) {
+        double sum = m[row][FIT_PARAMS];
+        for (int col = row + 1; col < FIT_PARAMS; col++) {
+            sum -= m[row][col] * p[col];
+        }
+        p[row] = sum / m[row][row];
+    }
+    return true;
+}
+
+// Eigen-decomposition of a symmetric 3x3 matrix (cyclic Jacobi).
+// On return a holds eigenvalues on its diagonal, v the eigenvectors in columns.
+static void jacobi_eigen_3x3(double a[3][3], double v[3][3]) {
+    memset(v, 0, 9 * sizeof(double));
+    v[0][0] = v[1][1] = v[2][2] = 1.0;
+
+    for (int sweep = 0; sweep < 16; sweep++) {
+        double off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+        if (off < 1e-15) {
+            break;
+        }
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (fabs(a[p][q]) < 1e-18) {
+                    continue;
+                }
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (int k = 0; k < 3; k++) {
+                    double akp = a[k][p];
+                    double akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double apk = a[p][k];
+                    double aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double vkp = v[k][p];
+                    double vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+// Convert quadric parameters into offset + soft-iron matrix
+static bool quadric_to_transform(const double p[FIT_PARAMS], mag_cal_transform_t *out) {
+    double a[3][3] = {
+        { p[0], p[3], p[4] },
+        { p[3], p[1], p[5] },
+        { p[4], p[5], p[2] },
+    };
+    const double b[3] = { p[6], p[7], p[8] };
+
+    // Center = -A^-1 b (cofactor inverse)
+    double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+               - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+               + a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    if (fabs(det) < 1e-18) {
+        return false;
+    }
+    double inv[3][3] = {
+        { (a[1][1] * a[2][2] - a[1][2] * a[2][1]) / det,
+          (a[0][2] * a[2][1] - a[0][1] * a[2][2]) / det,
+          (a[0][1] * a[1][2] - a[0][2] * a[1][1]) / det },
+        { (a[1][2] * a[2][0] - a[1][0] * a[2][2]) / det,
+          (a[0][0] * a[2][2] - a[0][2] * a[2][0]) / det,
+          (a[0][2] * a[1][0] - a[0][0] * a[1][2]) / det },
+        { (a[1][0] * a[2][1] - a[1][1] * a[2][0]) / det,
+          (a[0][1] * a[2][0] - a[0][0] * a[2][1]) / det,
+          (a[0][0] * a[1][1] - a[0][1] * a[1][0]) / det },
+    };
+    double center[3];
+    for (int i = 0; i < 3; i++) {
+        center[i] = -(inv[i][0] * b[0] + inv[i][1] * b[1] + inv[i][2] * b[2]);
+    }
+
+    // (x-c)' A (x-c) = 1 + c' A c  ->  M = A / k describes the ellipsoid
+    double k = 1.0;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            k += center[i] * a[i][j] * center[j];
+        }
+    }
+    if (k <= 0.0) {
+        return false;
+    }
+
+    double eig[3][3];
+    double vec[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            eig[i][j] = a[i][j] / k;
+        }
+    }
+    jacobi_eigen_3x3(eig, vec);
+
+    double lambda[3] = { eig[0][0], eig[1][1], eig[2][2] };
+    if (lambda[0] <= 0.0 || lambda[1] <= 0.0 || lambda[2] <= 0.0) {
+        return false; // Not an ellipsoid - poor orientation coverage
+    }
+
+    // Keep the mean field strength: radius = (r1 r2 r3)^(1/3), r = 1/sqrt(lambda)
+    double radius = pow(lambda[0] * lambda[1] * lambda[2], -1.0 / 6.0);
+
+    // matrix = radius * V sqrt(Lambda) V'
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            double sum = 0.0;
+            for (int e = 0; e < 3; e++) {
+                sum += vec[i][e] * sqrt(lambda[e]) * vec[j][e];
+            }
+            out->matrix[i * 3 + j] = (float)(radius * sum);
+        }
+        out->offset[i] = (float)(center[i] * MAG_CAL_NORM + acc.centre[i]);
+    }
+
+    field_radius = (float)(radius * MAG_CAL_NORM);
+    return true;
+}
+
+static esp_err_t store_transform(const mag_cal_transform_t *xform) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    mag_cal_blob_t blob = {
+        .version = CAL_BLOB_VERSION,
+        .xform = *xform,
+        .field_radius = field_radius,
+        .fit_rms = fit_rms,
+    };
+    err = nvs_set_blob(handle, NVS_KEY, &blob, sizeof(blob));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+static void activate(const mag_cal_transform_t *xform) {
+    transforms[spare] = *xform;
+    active = &transforms[spare];
+    spare ^= 1;
+}
+
+esp_err_t mag_calibration_init(void) {
+    nvs_handle_t handle;
+    mag_cal_blob_t blob;
+    size_t len = sizeof(blob);
+
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_OK) {
+        err = nvs_get_blob(handle, NVS_KEY, &blob, &len);
+        nvs_close(handle);
+    }
+
+    if (err == ESP_OK && len == sizeof(blob) && blob.version == CAL_BLOB_VERSION) {
+        activate(&blob.xform);
+        field_radius = blob.field_radius;
+        fit_rms = blob.fit_rms;
+        stored = true;
+        ESP_LOGD(TAG, "Loaded calibration (offset %.1f, %.1f, %.1f)",
+                blob.xform.offset[0], blob.xform.offset[1], blob.xform.offset[2]);
+        return ESP_OK;
+    }
+
+    // No usable calibration - run uncorrected and fit online
+    active = &identity;
+    stored = false;
+    mag_calibration_start();
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t mag_calibration_finish(void) {
+    if (state != MAG_CAL_READY) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    fold_block();
+
+    // The solve runs in double - monitor task, once per fit
+    double p[FIT_PARAMS];
+    mag_cal_transform_t xform;
+    if (!solve_normal_equations(p) || !quadric_to_transform(p, &xform)) {
+        ESP_LOGW(TAG, "Ellipsoid fit failed - collecting again");
+        mag_calibration_start();
+        return ESP_FAIL;
+    }
+
+    // Residual of the algebraic fit: p'D'Dp - 2p'D'1 + n
+    double sse = acc.count;
+    for (int row = 0; row < FIT_PARAMS; row++) {
+        sse -= 2.0 * p[row] * acc.dt1[row];
+        for (int col = 0; col < FIT_PARAMS; col++) {
+            double s = row <= col ? acc.dtd[upper_index(row, col)] : acc.dtd[upper_index(col, row)];
+            sse += p[row] * s * p[col];
+        }
+    }
+    fit_rms = (float)sqrt(sse > 0.0 ? sse / acc.count : 0.0);
+
+    activate(&xform);
+    stored = true;
+    state = MAG_CAL_IDLE;
+
+    esp_err_t err = store_transform(&xform);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Calibration active but not saved: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Calibration saved - field %.1f, offset %.1f, %.1f, %.1f, rms %.4f",
+            field_radius, xform.offset[0], xform.offset[1], xform.offset[2], fit_rms);
+    return ESP_OK;
+}
+
+esp_err_t mag_calibration_get_status(mag_cal_status_t *out_status) {
+    if (out_status == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    out_status->state = state;
+    out_status->samples = acc.count;
+    for (int i = 0; i < 3; i++) {
+        out_status->span[i] = acc.count > 0 ? acc.max[i] - acc.min[i] : 0.0f;
+    }
+    out_status->field_radius = field_radius;
+    out_status->fit_rms = fit_rms;
+    out_status->stored = stored;
+    return ESP_OK;
+}
+
+const mag_cal_transform_t* mag_calibration_transform(void) {
+    return active;
+}
@@ -0,0 +1,56 @@
+#ifndef MAG_CALIBRATION_H
+#define MAG_CALIBRATION_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hard/soft-iron correction: corrected = matrix * (raw - offset)
+typedef struct {
+    float offset[3];        // Hard-iron offset (mag_read units, X/Y/Z after axis reorder)
+    float matrix[9];        // Soft-iron correction, row-major
+} mag_cal_transform_t;
+
+typedef enum {
+    MAG_CAL_IDLE,           // Applying the stored (or identity) transform
+    MAG_CAL_COLLECTING,     // Accumulating fit statistics from live samples
+    MAG_CAL_READY,          // Enough coverage - waiting for mag_calibration_finish()
+} mag_cal_state_t;
+
+typedef struct {
+    mag_cal_state_t state;
+    uint32_t samples;
+    float span[3];          // Max - min seen per axis
+    float field_radius;     // Fitted field strength (after finish)
+    float fit_rms;          // Algebraic fit residual (after finish)
+    bool stored;            // Active transform came from NVS / a successful fit
+} mag_cal_status_t;
+
+// Load the stored transform from NVS; starts collecting if none exists
+esp_err_t mag_calibration_init(void);
+
+// Begin a new online fit (previous transform stays active until finish)
+void mag_calibration_start(void);
+
+// Feed one uncalibrated sample. O(1) time and memory; no-op unless collecting.
+void mag_calibration_feed(const float raw[3]);
+
+// Solve the ellipsoid fit, activate and persist the result. Not for hot paths.
+esp_err_t mag_calibration_finish(void);
+
+esp_err_t mag_calibration_get_status(mag_cal_status_t *out_status);
+
+// Active transform (swapped atomically when a new fit is activated)
+const mag_cal_transform_t* mag_calibration_transform(void);
+
+// Hot path: 9 multiply-adds, no branches
+static inline void mag_calibration_apply(const mag_cal_transform_t *t, const float raw[3], float out[3]) {
+    float dx = raw[0] - t->offset[0];
+    float dy = raw[1] - t->offset[1];
+    float dz = raw[2] - t->offset[2];
+    out[0] = t->matrix[0] * dx + t->matrix[1] * dy + t->matrix[2] * dz;
+    out[1] = t->matrix[3] * dx + t->matrix[4] * dy + t->matrix[5] * dz;
+    out[2] = t->matrix[6] * dx + t->matrix[7] * dy + t->matrix[8] * dz;
+}
+
+#endif // MAG_CALIBRATION_H
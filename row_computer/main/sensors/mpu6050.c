@@ -1,20 +1,25 @@
+#include "sdkconfig.h"
+#if CONFIG_ROW_IMU_MPU6050
+
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "mpu6050.h"
+#include "imu_backend.h"
 #include "config/pin_definitions.h"
 #include "config/common_constants.h"
 #include "sensors_common.h"
 
+// MPU6050 over I2C. Its FIFO cannot be drained within the I2C budget at 1kHz, so
+// the backend burst-reads the 14 output registers - a one-sample "FIFO".
+
 static const char *TAG = "MPU6050";
-static bool mpu6050_initialized = false;
+static uint8_t frame[14];   // 6 bytes accel + 2 bytes temp + 6 bytes gyro
 
-esp_err_t mpu6050_init(void) {
-    if (mpu6050_initialized) {
-        ESP_LOGD(TAG, "MPU6050 already initialized");
-        return ESP_OK;
-    }
+const char *const imu_backend_name = "MPU6050";
+const bool imu_backend_has_fifo = false;
 
+esp_err_t imu_backend_init(void) {
     ESP_LOGD(TAG, "Initializing MPU6050 (accelerometer + gyroscope)");
 
     // Wake up the sensor
@@ -28,76 +33,97 @@ esp_err_t mpu6050_init(void) {
     vTaskDelay(pdMS_TO_TICKS(SENSOR_STABILIZE_DELAY_MS));
 
     // Verify communication by reading WHO_AM_I register
-    uint8_t who_am_i;
-    err = mpu6050_read_bytes(0x75, &who_am_i, 1); // WHO_AM_I register
-    if (err == ESP_OK && who_am_i == 0x68) {
-        ESP_LOGD(TAG, "MPU6050 initialized successfully (WHO_AM_I: 0x%02X)", who_am_i);
-        mpu6050_initialized = true;
-        return ESP_OK;
-    } else {
+    uint8_t who_am_i = 0;
+    err = mpu6050_read_bytes(MPU6050_WHO_AM_I, &who_am_i, 1);
+    if (err != ESP_OK || who_am_i != 0x68) {
         ESP_LOGE(TAG, "MPU6050 communication failed or wrong chip ID: 0x%02X", who_am_i);
         return ESP_FAIL;
     }
-}
 
-esp_err_t mpu6050_read_all(mpu6050_data_t *data) {
-    if (!mpu6050_initialized) {
-        ESP_LOGE(TAG, "MPU6050 not initialized");
-        return ESP_ERR_INVALID_STATE;
-    }
+    ESP_LOGD(TAG, "MPU6050 initialized successfully (WHO_AM_I: 0x%02X)", who_am_i);
+    return ESP_OK;
+}
 
-    if (data == NULL) {
-        ESP_LOGE(TAG, "Null data pointer");
-        return ESP_ERR_INVALID_ARG;
+esp_err_t imu_backend_configure(const imu_backend_config_t *config, uint16_t *actual_odr_hz) {
+    // 1kHz output rate with the 188Hz DLPF as the analogue-side anti-alias filter;
+    // 8kHz / (1 + SMPLRT_DIV) only applies with the DLPF off, so 1kHz is the ceiling
+    uint8_t divider = config->odr_hz >= 1000 ? 0 : (uint8_t)(1000 / config->odr_hz - 1);
+    esp_err_t err = mpu6050_write_byte(MPU6050_CONFIG_REG, 0x01);
+    if (err == ESP_OK) {
+        err = mpu6050_write_byte(MPU6050_SMPLRT_DIV, divider);
     }
-
-    uint8_t raw_data[14]; // 6 bytes accel + 2 bytes temp + 6 bytes gyro
-    esp_err_t err = mpu6050_read_bytes(MPU6050_ACCEL_XOUT_H, raw_data, 14);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read MPU6050 data: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to set MPU6050 sample rate: %s", esp_err_to_name(err));
         return err;
     }
 
-    // Parse accelerometer data (first 6 bytes)
-    int16_t raw_accel_x = combine_bytes(raw_data[0], raw_data[1]);
-    int16_t raw_accel_y = combine_bytes(raw_data[2], raw_data[3]);
-    int16_t raw_accel_z = combine_bytes(raw_data[4], raw_data[5]);
+    *actual_odr_hz = 1000 / (1 + divider);
+    return ESP_OK;
+}
 
-    // Parse gyroscope data (bytes 8-13, skip temperature bytes 6-7)
-    int16_t raw_gyro_x = combine_bytes(raw_data[8], raw_data[9]);
-    int16_t raw_gyro_y = combine_bytes(raw_data[10], raw_data[11]);
-    int16_t raw_gyro_z = combine_bytes(raw_data[12], raw_data[13]);
+esp_err_t imu_backend_read_fifo(const uint8_t **data, size_t *len) {
+    esp_err_t err = mpu6050_read_bytes(MPU6050_ACCEL_XOUT_H, frame, sizeof(frame));
+    if (err != ESP_OK) {
+        return err;
+    }
+    *data = frame;
+    *len = sizeof(frame);
+    return ESP_OK;
+}
 
-    // Convert to physical units
-    data->accel_x = (float)raw_accel_x / LSB_SENSITIVITY_2g;
-    data->accel_y = (float)raw_accel_y / LSB_SENSITIVITY_2g;
-    data->accel_z = (float)raw_accel_z / LSB_SENSITIVITY_2g;
+uint16_t imu_backend_decode(const uint8_t *data, size_t len, imu_fifo_t *fifo) {
+    if (len < sizeof(frame) || fifo->count >= IMU_FIFO_MAX_SAMPLES) {
+        return 0;
+    }
 
-    data->gyro_x = (float)raw_gyro_x / LSB_SENSITIVITY_250_deg;
-    data->gyro_y = (float)raw_gyro_y / LSB_SENSITIVITY_250_deg;
-    data->gyro_z = (float)raw_gyro_z / LSB_SENSITIVITY_250_deg;
+    // Registers are big endian in the same order as mpu6050_raw_t
+    uint16_t n = fifo->count++;
+    for (int i = 0; i < MPU6050_RAW_COUNT; i++) {
+        fifo->v[i][n] = combine_bytes(data[2 * i], data[2 * i + 1]);
+    }
+    return 1;
+}
 
+esp_err_t imu_backend_enable_motion_wakeup(uint16_t threshold_mg) {
+    uint8_t mot_thr = threshold_mg / 2; // 2mg per LSB
+    const uint8_t sequence[][2] = {
+        { MPU6050_ACCEL_CONFIG_REG, 0x01 },   // +-2g, 5Hz high-pass for motion detection
+        { MPU6050_MOT_THR, mot_thr > 0 ? mot_thr : 1 },
+        { MPU6050_MOT_DUR, 0x01 },            // 1ms above threshold
+        { MPU6050_INT_PIN_CFG, 0x30 },        // Latched, cleared on any read
+        { MPU6050_INT_ENABLE, 0x40 },         // MOT_EN
+        { MPU6050_PWR_MGMT_2, 0x47 },         // 5Hz wake cycle, gyro in standby
+        { MPU6050_PWR_MGMT_1, 0x20 },         // CYCLE mode
+    };
+
+    for (size_t i = 0; i < sizeof(sequence) / sizeof(sequence[0]); i++) {
+        esp_err_t err = mpu6050_write_byte(sequence[i][0], sequence[i][1]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to enable motion wakeup: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
     return ESP_OK;
 }
 
-esp_err_t mpu6050_read_accel(float *x, float *y, float *z) {
-    mpu6050_data_t data;
-    esp_err_t err = mpu6050_read_all(&data);
-    if (err == ESP_OK) {
-        *x = data.accel_x;
-        *y = data.accel_y;
-        *z = data.accel_z;
+esp_err_t imu_backend_disable_motion_wakeup(void) {
+    const uint8_t sequence[][2] = {
+        { MPU6050_PWR_MGMT_1, 0x00 },
+        { MPU6050_PWR_MGMT_2, 0x00 },
+        { MPU6050_INT_ENABLE, 0x00 },
+        { MPU6050_ACCEL_CONFIG_REG, 0x00 },
+    };
+
+    for (size_t i = 0; i < sizeof(sequence) / sizeof(sequence[0]); i++) {
+        esp_err_t err = mpu6050_write_byte(sequence[i][0], sequence[i][1]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to disable motion wakeup: %s", esp_err_to_name(err));
+            return err;
+        }
     }
-    return err;
+
+    uint8_t status;
+    return mpu6050_read_bytes(MPU6050_INT_STATUS, &status, 1);
 }
 
-esp_err_t mpu6050_read_gyro(float *x, float *y, float *z) {
-    mpu6050_data_t data;
-    esp_err_t err = mpu6050_read_all(&data);
-    if (err == ESP_OK) {
-        *x = data.gyro_x;
-        *y = data.gyro_y;
-        *z = data.gyro_z;
-    }
-    return err;
-}
\ No newline at end of file
+#endif // CONFIG_ROW_IMU_MPU6050
@@ -1,22 +1,27 @@
 #ifndef MPU6050_H
 #define MPU6050_H
 
-#include "esp_err.h"
+#include <stdint.h>
+
+// Raw register values in burst-read order (ACCEL_XOUT_H .. GYRO_ZOUT_L). This is
+// also the canonical frame every IMU backend decodes to, see imu_backend.h.
+enum {
+    MPU6050_AX, MPU6050_AY, MPU6050_AZ,
+    MPU6050_TEMP,
+    MPU6050_GX, MPU6050_GY, MPU6050_GZ,
+    MPU6050_RAW_COUNT
+};
+
+typedef struct {
+    int16_t v[MPU6050_RAW_COUNT];
+} mpu6050_raw_t;
 
 // MPU6050 sensor data structure
 typedef struct {
     float accel_x, accel_y, accel_z;    // Acceleration in g-forces
     float gyro_x, gyro_y, gyro_z;       // Angular velocity in deg/s
+    float temperature_c;                // Die temperature
+    mpu6050_raw_t raw;                  // Bias-corrected counts the floats were derived from
 } mpu6050_data_t;
 
-// Initialize the MPU6050 sensor (both accelerometer and gyroscope)
-esp_err_t mpu6050_init(void);
-
-// Read both accelerometer and gyroscope data in one operation
-esp_err_t mpu6050_read_all(mpu6050_data_t *data);
-
-// Individual read functions for backward compatibility
-esp_err_t mpu6050_read_accel(float *x, float *y, float *z);
-esp_err_t mpu6050_read_gyro(float *x, float *y, float *z);
-
 #endif // MPU6050_H
\ No newline at end of file
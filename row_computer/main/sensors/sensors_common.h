@@ -4,9 +4,10 @@
 #include "sensors/mpu6050.h"
 #include "sensors/mag.h"
 #include "sensors/gps.h"
+#include "utils/timebase.h"
 
 typedef struct {
-    uint32_t timestamp_ms;
+    timebase_us_t timestamp_us;         // Sample time (timebase)
     float accel_x, accel_y, accel_z;    // g-forces
     float gyro_x, gyro_y, gyro_z;       // deg/s
     float mag_x, mag_y, mag_z;          // gauss
@@ -0,0 +1,242 @@
+#include "esp_log.h"
+#include "config/common_constants.h"
+#include "ubx_command.h"
+#include "utils/deferred_log.h"
+#include <string.h>
+
+static const char *TAG = "UBX_CMD";
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_QUEUED,                // Waiting for the in-flight window (or a resend)
+    SLOT_AWAIT_ACK,             // Sent, deadline running
+    SLOT_DRAIN,                 // Answered after a resend: absorbs a late duplicate answer
+} slot_state_t;
+
+typedef struct {
+    slot_state_t state;
+    uint32_t sequence;          // Submission order
+    uint8_t attempts;           // Times sent
+    timebase_us_t deadline_us;
+    ubx_command_t command;
+    ubx_command_done_t done;
+    void *context;
+} ubx_slot_t;
+
+static ubx_slot_t slots[UBX_CMD_QUEUE_LEN];
+static uint32_t next_sequence;
+static ubx_write_t write_frame;
+static ubx_command_stats_t stats;
+
+uint16_t ubx_checksum(const uint8_t *data, size_t length) {
+    uint8_t ck_a = 0, ck_b = 0;
+    for (size_t i = 0; i < length; i++) {
+        ck_a += data[i];
+        ck_b += ck_a;
+    }
+    return (uint16_t)((ck_b << 8) | ck_a);
+}
+
+size_t ubx_frame_encode(uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t length, uint8_t *out) {
+    out[0] = UBX_SYNC_1;
+    out[1] = UBX_SYNC_2;
+    out[2] = msg_class;
+    out[3] = msg_id;
+    out[4] = length & 0xFF;
+    out[5] = (length >> 8) & 0xFF;
+    if (length > 0) {
+        memcpy(&out[6], payload, length);
+    }
+    uint16_t checksum = ubx_checksum(&out[2], 4 + length);
+    out[6 + length] = checksum & 0xFF;
+    out[7 + length] = checksum >> 8;
+    return UBX_FRAME_OVERHEAD + length;
+}
+
+void ubx_command_init(ubx_write_t write) {
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+    next_sequence = 0;
+    write_frame = write;
+}
+
+static bool same_message(const ubx_slot_t *slot, uint8_t msg_class, uint8_t msg_id) {
+    return slot->command.msg_class == msg_class && slot->command.msg_id == msg_id;
+}
+
+static void complete(ubx_slot_t *slot, ubx_result_t result, timebase_us_t now_us) {
+    ubx_command_done_t done = slot->done;
+    void *context = slot->context;
+    ubx_command_t command = slot->command;
+
+    // A resent command may still be answered once more: keep its class/id
+    // blocked for one more timeout so that answer cannot land on the next one
+    if (slot->attempts > 1 && result == UBX_RESULT_ACK) {
+        slot->state = SLOT_DRAIN;
+        slot->deadline_us = now_us + (timebase_us_t)UBX_ACK_TIMEOUT_MS * 1000;
+    } else {
+        slot->state = SLOT_FREE;
+    }
+    if (done != NULL) {
+        done(&command, result, context);
+    }
+}
+
+esp_err_t ubx_command_submit(const ubx_command_t *command, ubx_submit_mode_t mode,
+                             ubx_command_done_t done, void *context) {
+    if (command == NULL || command->length > UBX_CMD_MAX_PAYLOAD) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ubx_slot_t *slot = NULL;
+    if (mode == UBX_SUBMIT_REPLACE) {
+        for (int i = 0; i < UBX_CMD_QUEUE_LEN; i++) {
+            if (slots[i].state == SLOT_QUEUED && slots[i].attempts == 0 &&
+                same_message(&slots[i], command->msg_class, command->msg_id)) {
+                slot = &slots[i];
+                stats.replaced++;
+                complete(slot, UBX_RESULT_REPLACED, 0);
+                break;
+            }
+        }
+    }
+    for (int i = 0; slot == NULL && i < UBX_CMD_QUEUE_LEN; i++) {
+        if (slots[i].state == SLOT_FREE) {
+            slot = &slots[i];
+        }
+    }
+    if (slot == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    *slot = (ubx_slot_t){
+        .state = SLOT_QUEUED,
+        .sequence = next_sequence++,
+        .command = *command,
+        .done = done,
+        .context = context,
+    };
+    stats.submitted++;
+    return ESP_OK;
+}
+
+// Oldest queued command that may go out now: in-flight window not full and
+// nothing of its class/id outstanding
+static ubx_slot_t *next_to_send(void) {
+    uint32_t in_flight = 0;
+    for (int i = 0; i < UBX_CMD_QUEUE_LEN; i++) {
+        in_flight += slots[i].state == SLOT_AWAIT_ACK;
+    }
+    if (in_flight >= UBX_CMD_IN_FLIGHT) {
+        return NULL;
+    }
+
+    ubx_slot_t *best = NULL;
+    for (int i = 0; i < UBX_CMD_QUEUE_LEN; i++) {
+        if (slots[i].state != SLOT_QUEUED || (best != NULL && (int32_t)(slots[i].sequence - best->sequence) > 0)) {
+            continue;
+        }
+        bool blocked = false;
+        for (int j = 0; j < UBX_CMD_QUEUE_LEN && !blocked; j++) {
+            blocked = (slots[j].state == SLOT_AWAIT_ACK || slots[j].state == SLOT_DRAIN) &&
+                      same_message(&slots[j], slots[i].command.msg_class, slots[i].command.msg_id);
+        }
+        if (!blocked) {
+            best = &slots[i];
+        }
+    }
+    return best;
+}
+
+void ubx_command_poll(timebase_us_t now_us) {
+    // Deadlines first: an expired command is resent in the same poll
+    for (int i = 0; i < UBX_CMD_QUEUE_LEN; i++) {
+        ubx_slot_t *slot = &slots[i];
+        if (slot->state == SLOT_DRAIN && now_us >= slot->deadline_us) {
+            slot->state = SLOT_FREE;
+        } else if (slot->state == SLOT_AWAIT_ACK && now_us >= slot->deadline_us) {
+            if (slot->attempts <= UBX_CMD_RETRIES) {
+                slot->state = SLOT_QUEUED;
+                stats.retries++;
+                DLOGD(TAG, "%s not acknowledged - resending", slot->command.name);
+            } else {
+                stats.timeouts++;
+                DLOGW(TAG, "%s not acknowledged after %u attempts", slot->command.name, slot->attempts);
+                complete(slot, UBX_RESULT_TIMEOUT, now_us);
+            }
+        }
+    }
+
+    uint8_t frame[UBX_CMD_MAX_PAYLOAD + UBX_FRAME_OVERHEAD];
+    ubx_slot_t *slot;
+    while (write_frame != NULL && (slot = next_to_send()) != NULL) {
+        size_t length = ubx_frame_encode(slot->command.msg_class, slot->command.msg_id,
+                                         slot->command.payload, slot->command.length, frame);
+        if (write_frame(frame, length) != ESP_OK) {
+            break;      // TX ring full - next poll
+        }
+        slot->state = SLOT_AWAIT_ACK;
+        slot->attempts++;
+        slot->deadline_us = now_us + (timebase_us_t)UBX_ACK_TIMEOUT_MS * 1000;
+        stats.sent++;
+    }
+
+    uint32_t in_flight = 0;
+    for (int i = 0; i < UBX_CMD_QUEUE_LEN; i++) {
+        in_flight += slots[i].state == SLOT_AWAIT_ACK;
+    }
+    if (in_flight > stats.max_in_flight) {
+        stats.max_in_flight = in_flight;
+    }
+}
+
+bool ubx_command_frame(uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t length,
+                       timebase_us_t now_us) {
+    if (msg_class != UBX_CLASS_ACK || (msg_id != UBX_ACK_ACK && msg_id != UBX_ACK_NAK) || length != 2) {
+        return false;
+    }
+
+    // The payload names the class/id answered; at most one such command is outstanding
+    for (int i = 0; i < UBX_CMD_QUEUE_LEN; i++) {
+        ubx_slot_t *slot = &slots[i];
+        if (!same_message(slot, payload[0], payload[1])) {
+            continue;
+        }
+        // A command waiting for its resend may still get the answer to an earlier send
+        if (slot->state == SLOT_AWAIT_ACK || (slot->state == SLOT_QUEUED && slot->attempts > 0)) {
+            if (msg_id == UBX_ACK_ACK) {
+                stats.acked++;
+                complete(slot, UBX_RESULT_ACK, now_us);
+            } else {
+                stats.naked++;
+                DLOGW(TAG, "%s rejected by the receiver", slot->command.name);
+                complete(slot, UBX_RESULT_NAK, now_us);
+            }
+            return true;
+        }
+        if (slot->state == SLOT_DRAIN) {
+            slot->state = SLOT_FREE;    // The duplicate it was waiting for
+            stats.unmatched++;
+            return true;
+        }
+    }
+    stats.unmatched++;
+    return true;
+}
+
+bool ubx_command_idle(void) {
+    for (int i = 0; i < UBX_CMD_QUEUE_LEN; i++) {
+        if (slots[i].state == SLOT_QUEUED || slots[i].state == SLOT_AWAIT_ACK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t ubx_command_get_stats(ubx_command_stats_t *out_stats) {
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_stats = stats;
+    return ESP_OK;
+}
@@ -0,0 +1,108 @@
+#ifndef UBX_COMMAND_H
+#define UBX_COMMAND_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "utils/timebase.h"
+
+// Non-blocking UBX command engine. Commands (CFG-* messages, acknowledged by
+// UBX-ACK-ACK / ACK-NAK) are queued and driven by an explicit state machine per
+// slot - nothing here waits or reads the UART:
+//
+//   QUEUED --send--> AWAIT_ACK --ACK--> done (UBX_RESULT_ACK)
+//                        |      --NAK--> done (UBX_RESULT_NAK)
+//                        +--timeout--> QUEUED again, or done (UBX_RESULT_TIMEOUT)
+//                                      after UBX_CMD_RETRIES resends
+//
+// Up to UBX_CMD_IN_FLIGHT commands are outstanding at once. An acknowledge
+// only names the class/id it answers, so two commands of the same class/id are
+// never in flight together - the later one waits, and the receiver applies both
+// in submission order.
+//
+// The owner of the receive stream hands every ACK frame to ubx_command_frame()
+// and calls ubx_command_poll() regularly; navigation messages keep flowing through
+// the owner's parser while commands are outstanding. Single task.
+
+#define UBX_SYNC_1              0xB5
+#define UBX_SYNC_2              0x62
+#define UBX_FRAME_OVERHEAD      8       // Sync, class, id, length, checksum
+
+#define UBX_CLASS_NAV           0x01
+#define UBX_CLASS_ACK           0x05
+#define UBX_CLASS_CFG           0x06
+#define UBX_NAV_PVT             0x07
+#define UBX_ACK_NAK             0x00
+#define UBX_ACK_ACK             0x01
+#define UBX_CFG_PRT             0x00
+#define UBX_CFG_MSG             0x01
+#define UBX_CFG_RATE            0x08
+
+#define UBX_CMD_MAX_PAYLOAD     20      // CFG-PRT, the longest command sent
+
+typedef struct {
+    const char *name;           // For log lines (static string)
+    uint8_t msg_class;
+    uint8_t msg_id;
+    uint8_t length;
+    uint8_t payload[UBX_CMD_MAX_PAYLOAD];
+} ubx_command_t;
+
+typedef enum {
+    UBX_RESULT_ACK,
+    UBX_RESULT_NAK,             // Receiver rejected it - not retried
+    UBX_RESULT_TIMEOUT,         // No answer after every retry
+    UBX_RESULT_REPLACED,        // Superseded before it was sent (UBX_SUBMIT_REPLACE)
+} ubx_result_t;
+
+typedef enum {
+    UBX_SUBMIT_APPEND,
+    UBX_SUBMIT_REPLACE,         // Overwrite a not yet sent command of the same class/id
+} ubx_submit_mode_t;
+
+// Completion, called from ubx_command_frame() or ubx_command_poll()
+typedef void (*ubx_command_done_t)(const ubx_command_t *command, ubx_result_t result, void *context);
+
+// Transmit a complete frame. Must not block for long (a UART with a TX ring);
+// an error leaves the command queued for the next poll.
+typedef esp_err_t (*ubx_write_t)(const uint8_t *frame, size_t length);
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t sent;              // Frames written, resends included
+    uint32_t acked;
+    uint32_t naked;
+    uint32_t retries;
+    uint32_t timeouts;          // Commands given up
+    uint32_t replaced;
+    uint32_t unmatched;         // ACK/NAK for nothing in flight (late answer to a resent command)
+    uint32_t max_in_flight;
+} ubx_command_stats_t;
+
+// Reset the engine (drops anything queued without completions)
+void ubx_command_init(ubx_write_t write);
+
+// Queue a command. ESP_ERR_NO_MEM when all UBX_CMD_QUEUE_LEN slots are taken.
+esp_err_t ubx_command_submit(const ubx_command_t *command, ubx_submit_mode_t mode,
+                             ubx_command_done_t done, void *context);
+
+// Send what the in-flight window allows and expire overdue commands
+void ubx_command_poll(timebase_us_t now_us);
+
+// A received, checksum-verified frame. Returns true when it was an ACK/NAK.
+bool ubx_command_frame(uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t length,
+                       timebase_us_t now_us);
+
+// Nothing queued or in flight
+bool ubx_command_idle(void);
+
+// Encode a frame into out (UBX_FRAME_OVERHEAD + length bytes); returns its size
+size_t ubx_frame_encode(uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t length, uint8_t *out);
+
+// Fletcher checksum over class, id, length and payload (CK_A low byte, CK_B high)
+uint16_t ubx_checksum(const uint8_t *data, size_t length);
+
+esp_err_t ubx_command_get_stats(ubx_command_stats_t *out_stats);
+
+#endif // UBX_COMMAND_H
@@ -0,0 +1,179 @@
+#include "esp_log.h"
+#include "ghost_reference.h"
+#include "session_index.h"
+#include "session_log.h"
+#include "log_block.h"
+#include "utils/ghost_boat.h"
+#include "utils/timebase.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "GHOST_REF";
+
+#define PENDING_STROKES     16      // Catches waiting for the fix after them
+
+typedef struct {
+    uint32_t timestamp_ms;
+    uint32_t distance_m;
+    uint32_t speed_mm_s;
+} reference_fix_t;
+
+typedef struct {
+    uint32_t pending[PENDING_STROKES];
+    uint32_t pending_count;
+    reference_fix_t previous;
+    bool have_previous;
+    uint32_t origin_ms;
+    float origin_m;
+    uint32_t strokes;
+    bool first;
+    bool full;
+} reference_builder_t;
+
+static void add_stroke(reference_builder_t *builder, uint32_t timestamp_ms, float distance_m, float speed_mm_s) {
+    if (builder->first) {
+        builder->origin_ms = timestamp_ms;
+        builder->origin_m = distance_m;
+        builder->first = false;
+    }
+    // Split as the DSP stage shows it (from the GPS speed)
+    uint16_t split_ds = speed_mm_s >= SPLIT_MIN_SPEED_MM_S ? (uint16_t)(5000000.0f / speed_mm_s) : 0;
+    if (!builder->full &&
+        ghost_boat_reference_stroke(distance_m - builder->origin_m, timestamp_ms - builder->origin_ms, split_ds)) {
+        builder->strokes++;
+    } else {
+        builder->full = true;   // Ghost ends here
+    }
+}
+
+// Place the waiting catches on the line between the previous fix and this one.
+// Catches stamped before the previous fix (written after it) extrapolate back a little.
+static void resolve_pending(reference_builder_t *builder, const reference_fix_t *fix) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < builder->pending_count; i++) {
+        uint32_t timestamp_ms = builder->pending[i];
+        if (fix != NULL && (int32_t)(timestamp_ms - fix->timestamp_ms) > 0) {
+            builder->pending[kept++] = timestamp_ms;
+            continue;
+        }
+        float distance_m;
+        float speed_mm_s;
+        if (fix == NULL) {
+            distance_m = builder->previous.distance_m;
+            speed_mm_s = builder->previous.speed_mm_s;
+        } else if (!builder->have_previous || fix->timestamp_ms == builder->previous.timestamp_ms) {
+            distance_m = fix->distance_m;
+            speed_mm_s = fix->speed_mm_s;
+        } else {
+            float fraction = (float)(int32_t)(timestamp_ms - builder->previous.timestamp_ms) /
+                             (float)(fix->timestamp_ms - builder->previous.timestamp_ms);
+            distance_m = builder->previous.distance_m +
+                         ((float)fix->distance_m - (float)builder->previous.distance_m) * fraction;
+            speed_mm_s = builder->previous.speed_mm_s +
+                         ((float)fix->speed_mm_s - (float)builder->previous.speed_mm_s) * fraction;
+        }
+        add_stroke(builder, timestamp_ms, distance_m, speed_mm_s);
+    }
+    builder->pending_count = kept;
+}
+
+esp_err_t ghost_reference_load(uint32_t session_id, uint16_t piece_number) {
+    char log_path[SESSION_PATH_MAX];
+    char sidecar_path[SESSION_PATH_MAX];
+    session_log_path(session_id, log_path, sidecar_path);
+
+    session_piece_t *pieces = malloc(SESSION_MAX_PIECES * sizeof(session_piece_t));
+    log_block_t *block = malloc(sizeof(log_block_t));
+    reference_builder_t *builder = calloc(1, sizeof(reference_builder_t));
+    int fd = -1;
+    size_t count = 0;
+    session_index_source_t source;
+    esp_err_t err = pieces != NULL && block != NULL && builder != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+
+    if (err == ESP_OK) {
+        err = session_index_load(log_path, sidecar_path, pieces, SESSION_MAX_PIECES, &count, &source);
+    }
+    if (err == ESP_OK && (piece_number >= count || piece_number >= SESSION_MAX_PIECES)) {
+        err = ESP_ERR_NOT_FOUND;
+    }
+    if (err == ESP_OK && pieces[piece_number].avg_split_ds == 0) {
+        err = ESP_ERR_NOT_SUPPORTED;
+    }
+    if (err == ESP_OK) {
+        fd = open(log_path, O_RDONLY);
+        err = fd >= 0 && read(fd, block, sizeof(*block)) == (ssize_t)sizeof(*block) &&
+              log_block_valid(block, block->header.nonce, 0) ? ESP_OK : ESP_ERR_INVALID_VERSION;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Session %lu piece %u: %s", (unsigned long)session_id, piece_number, esp_err_to_name(err));
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(pieces);
+        free(block);
+        free(builder);
+        return err;
+    }
+
+    // Strokes inside the piece's byte range, fixes around them (up to the first
+    // fix after its last stroke)
+    const session_piece_t *piece = &pieces[piece_number];
+    uint32_t nonce = block->header.nonce;
+    bool done = false;
+    builder->first = true;
+    ghost_boat_reference_begin();
+    for (uint32_t seq = piece->offset_start / LOG_BLOCK_SIZE; !done && log_block_read(fd, nonce, seq, block); seq++) {
+        uint32_t pos = 0;
+        timebase_us_t base_us = 0;
+        while (!done && pos + sizeof(session_rec_header_t) <= block->header.length) {
+            session_rec_header_t rec;
+            memcpy(&rec, block->payload + pos, sizeof(rec));
+            uint32_t size = sizeof(rec) + rec.length;
+            if (rec.type == 0 || pos + size > block->header.length) {
+                break;
+            }
+            uint32_t offset = seq * LOG_BLOCK_SIZE + sizeof(log_block_header_t) + pos;
+            const uint8_t *payload = block->payload + pos + sizeof(rec);
+            pos += size;
+
+            if (rec.type == SESSION_REC_TIMEBASE && rec.length >= sizeof(session_timebase_t)) {
+                session_timebase_t timebase;
+                memcpy(&timebase, payload, sizeof(timebase));
+                base_us = timebase.base_us;
+            } else if (rec.type == SESSION_REC_STROKE && offset >= piece->offset_start && offset < piece->offset_end) {
+                if (builder->pending_count == PENDING_STROKES) {
+                    resolve_pending(builder, NULL);
+                }
+                builder->pending[builder->pending_count++] = timebase_delta_to_ms(base_us, rec.delta_ms);
+            } else if (rec.type == SESSION_REC_FIX && rec.length >= sizeof(session_fix_t)) {
+                session_fix_t fix;
+                memcpy(&fix, payload, sizeof(fix));
+                reference_fix_t current = { timebase_delta_to_ms(base_us, rec.delta_ms), fix.distance_m, fix.speed_mm_s };
+                resolve_pending(builder, &current);
+                builder->previous = current;
+                builder->have_previous = true;
+                done = offset >= piece->offset_end && builder->pending_count == 0;
+            }
+        }
+    }
+    if (builder->have_previous) {
+        resolve_pending(builder, NULL);
+    }
+    close(fd);
+
+    err = ghost_boat_reference_end();
+    if (err == ESP_OK) {
+        ghost_boat_stats_t stats;
+        ghost_boat_get_stats(&stats);
+        ESP_LOGI(TAG, "Session %lu piece %u: %lu strokes, %.0f m in %lu.%lu s (%u bytes)%s",
+                 (unsigned long)session_id, piece_number, (unsigned long)stats.strokes, stats.length_m,
+                 (unsigned long)(stats.duration_ms / 1000), (unsigned long)(stats.duration_ms % 1000 / 100),
+                 (unsigned)stats.memory_bytes, builder->full ? " - truncated" : "");
+    }
+    free(pieces);
+    free(block);
+    free(builder);
+    return err;
+}
@@ -0,0 +1,14 @@
+#ifndef GHOST_REFERENCE_H
+#define GHOST_REFERENCE_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+// Load a piece of a recorded session as the ghost boat reference
+// (utils/ghost_boat.h). The piece comes from the session index; its strokes
+// are read from the log blocks it spans and placed at the session distance
+// interpolated between the fixes around each catch. Needs GPS in the piece
+// (ESP_ERR_NOT_SUPPORTED otherwise). Call before the DSP task starts.
+esp_err_t ghost_reference_load(uint32_t session_id, uint16_t piece_number);
+
+#endif // GHOST_REFERENCE_H
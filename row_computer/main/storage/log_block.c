@@ -0,0 +1,48 @@
+#include "esp_rom_crc.h"
+#include "log_block.h"
+#include <string.h>
+#include <unistd.h>
+
+static uint32_t block_crc(const log_block_t *block) {
+    log_block_header_t header = block->header;
+    header.crc = 0;
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&header, sizeof(header));
+    return esp_rom_crc32_le(crc, block->payload, block->header.length);
+}
+
+void log_block_seal(log_block_t *block, uint32_t nonce, uint32_t seq) {
+    block->header.nonce = nonce;
+    block->header.seq = seq;
+    block->header.reserved = 0;
+    block->header.crc = block_crc(block);
+}
+
+bool log_block_valid(const log_block_t *block, uint32_t nonce, uint32_t seq) {
+    return block->header.nonce == nonce && block->header.seq == seq &&
+           block->header.length <= LOG_BLOCK_PAYLOAD && block->header.crc == block_crc(block);
+}
+
+bool log_block_read(int fd, uint32_t nonce, uint32_t seq, log_block_t *block) {
+    if (lseek(fd, (off_t)seq * LOG_BLOCK_SIZE, SEEK_SET) < 0 ||
+        read(fd, block, sizeof(*block)) != (ssize_t)sizeof(*block)) {
+        return false;
+    }
+    return log_block_valid(block, nonce, seq);
+}
+
+uint32_t log_block_find_end(int fd, uint32_t nonce, uint32_t capacity) {
+    log_block_t block;
+
+    // Invariant: block lo - 1 is valid (block 0 is the file header), block hi is not
+    uint32_t lo = 1;
+    uint32_t hi = capacity;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (log_block_read(fd, nonce, mid, &block)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
@@ -0,0 +1,44 @@
+#ifndef LOG_BLOCK_H
+#define LOG_BLOCK_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "config/common_constants.h"
+
+// Fixed-size, sector-aligned blocks of a session log. Block n of a session sits
+// at byte n * LOG_BLOCK_SIZE and carries sequence number n, the session nonce
+// and a CRC32, so every block validates on its own and stale data left in
+// pre-allocated clusters never passes as part of the session. Blocks are
+// written strictly in order: the valid blocks always form a prefix, which
+// lets recovery binary-search for the end of the data.
+
+typedef struct __attribute__((packed)) {
+    uint32_t nonce;             // Random per session
+    uint32_t seq;               // Block index in the file
+    uint16_t length;            // Payload bytes used
+    uint16_t reserved;
+    uint32_t crc;               // CRC32 of header (crc = 0) and payload[0..length)
+} log_block_header_t;
+
+#define LOG_BLOCK_PAYLOAD   (LOG_BLOCK_SIZE - sizeof(log_block_header_t))
+
+typedef struct {
+    log_block_header_t header;
+    uint8_t payload[LOG_BLOCK_PAYLOAD];
+} log_block_t;
+
+// Fill in nonce/seq and the CRC; payload and length must be set
+void log_block_seal(log_block_t *block, uint32_t nonce, uint32_t seq);
+
+bool log_block_valid(const log_block_t *block, uint32_t nonce, uint32_t seq);
+
+// Read block seq of fd; false if short or invalid
+bool log_block_read(int fd, uint32_t nonce, uint32_t seq, log_block_t *block);
+
+// Number of valid blocks (the end of the data) in a file of capacity blocks,
+// in O(log n) block reads. Power loss can only tear the block being written.
+uint32_t log_block_find_end(int fd, uint32_t nonce, uint32_t capacity);
+
+#endif // LOG_BLOCK_H
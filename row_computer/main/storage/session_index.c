@@ -0,0 +1,246 @@
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "session_index.h"
+#include "session_log.h"
+#include "log_block.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "SESSION_INDEX";
+
+void session_index_reset(session_index_t *index) {
+    memset(index, 0, sizeof(*index));
+}
+
+static void update_averages(session_index_t *index, session_piece_t *piece) {
+    piece->distance_m = index->distance_m - index->piece_start_distance_m;
+    // ds per 500m = ms / 100 * 500 / m
+    piece->avg_split_ds = piece->distance_m > 0 ?
+                          (uint16_t)((uint64_t)(piece->end_ms - piece->start_ms) * 5 / piece->distance_m) : 0;
+}
+
+bool session_index_stroke(session_index_t *index, uint32_t offset, uint32_t offset_end, uint32_t timestamp_ms) {
+    bool opened = false;
+
+    if (!index->open) {
+        if (index->count < SESSION_MAX_PIECES) {
+            session_piece_t *piece = &index->pieces[index->count];
+            memset(piece, 0, sizeof(*piece));
+            piece->offset_start = offset;
+            piece->start_ms = timestamp_ms;
+            piece->number = index->count++;
+            index->piece_start_distance_m = index->distance_m;
+            opened = true;
+        } else if (index->count == 0) {
+            return false;
+        }
+        // Index full: later pieces extend the last entry
+        index->open = true;
+        index->pieces[index->count - 1].flags |= SESSION_PIECE_OPEN;
+    }
+
+    session_piece_t *piece = &index->pieces[index->count - 1];
+    piece->offset_end = offset_end;
+    piece->end_ms = timestamp_ms;
+    piece->stroke_count++;
+    update_averages(index, piece);
+    return opened;
+}
+
+void session_index_distance(session_index_t *index, uint32_t distance_m) {
+    index->distance_m = distance_m;
+    if (index->open) {
+        update_averages(index, &index->pieces[index->count - 1]);
+    }
+}
+
+bool session_index_close(session_index_t *index, uint32_t now_ms, bool force) {
+    if (!index->open) {
+        return false;
+    }
+    session_piece_t *piece = &index->pieces[index->count - 1];
+    // Signed: records stamped before the last stroke (shapes, filtered summaries) are no pause
+    if (!force && (int32_t)(now_ms - piece->end_ms) < SESSION_PIECE_GAP_MS) {
+        return false;
+    }
+    piece->flags &= ~SESSION_PIECE_OPEN;
+    index->open = false;
+    return true;
+}
+
+const session_piece_t* session_index_current(const session_index_t *index) {
+    return index->open ? &index->pieces[index->count - 1] : NULL;
+}
+
+// Footer: trailer at the end points back at the piece entries
+static esp_err_t load_footer(FILE *f, session_piece_t *pieces, size_t max, size_t *count) {
+    session_footer_t footer;
+    if (fseek(f, 0, SEEK_END) != 0) {
+        return ESP_FAIL;
+    }
+    long size = ftell(f);
+    if (size < (long)(LOG_BLOCK_SIZE + sizeof(footer)) ||
+        fseek(f, size - (long)sizeof(footer), SEEK_SET) != 0 ||
+        fread(&footer, sizeof(footer), 1, f) != 1) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (footer.magic != SESSION_FOOTER_MAGIC || footer.entry_size != sizeof(session_piece_t) ||
+        (long)footer.index_offset + (long)footer.count * footer.entry_size + (long)sizeof(footer) != size ||
+        fseek(f, footer.index_offset, SEEK_SET) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint32_t crc = 0;
+    for (uint16_t i = 0; i < footer.count; i++) {
+        session_piece_t piece;
+        if (fread(&piece, sizeof(piece), 1, f) != 1) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)&piece, sizeof(piece));
+        if (i < max) {
+            pieces[i] = piece;
+        }
+    }
+    if (crc != footer.crc) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    *count = footer.count;
+    return ESP_OK;
+}
+
+// Sidecar: append-only {piece, crc} checkpoints, the last one of each piece wins.
+// Stops at the first torn entry - everything before it was written whole.
+static esp_err_t load_sidecar(const char *path, session_piece_t *pieces, size_t max, size_t *count) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    struct {
+        session_piece_t piece;
+        uint32_t crc;
+    } entry;
+    size_t found = 0;
+    while (fread(&entry, sizeof(entry), 1, f) == 1) {
+        if (esp_rom_crc32_le(0, (const uint8_t *)&entry.piece, sizeof(entry.piece)) != entry.crc) {
+            break;
+        }
+        if (entry.piece.number < max) {
+            pieces[entry.piece.number] = entry.piece;
+        }
+        if (entry.piece.number + 1u > found) {
+            found = entry.piece.number + 1u;
+        }
+    }
+    fclose(f);
+
+    if (found == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *count = found;
+    return ESP_OK;
+}
+
+// Replay every record of the valid block prefix through the same builder the
+// writer uses
+static esp_err_t scan_blocks(int fd, log_block_t *block, session_index_t *index) {
+    if (read(fd, block, sizeof(*block)) != (ssize_t)sizeof(*block) ||
+        !log_block_valid(block, block->header.nonce, 0)) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    uint32_t nonce = block->header.nonce;
+    session_file_header_t header;
+    memcpy(&header, block->payload, sizeof(header));
+    if (header.magic != SESSION_LOG_MAGIC || header.version != SESSION_LOG_VERSION ||
+        header.block_size != LOG_BLOCK_SIZE) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    session_index_reset(index);
+    for (uint32_t seq = 1; log_block_read(fd, nonce, seq, block); seq++) {
+        uint32_t pos = 0;
+        timebase_us_t base_us = 0;
+        while (pos + sizeof(session_rec_header_t) <= block->header.length) {
+            session_rec_header_t rec;
+            memcpy(&rec, block->payload + pos, sizeof(rec));
+            uint32_t size = sizeof(rec) + rec.length;
+            if (rec.type == 0 || pos + size > block->header.length) {
+                break;
+            }
+
+            if (rec.type == SESSION_REC_TIMEBASE && rec.length >= sizeof(session_timebase_t)) {
+                session_timebase_t timebase;
+                memcpy(&timebase, block->payload + pos + sizeof(rec), sizeof(timebase));
+                base_us = timebase.base_us;
+                pos += size;
+                continue;
+            }
+
+            // Records are at least as frequent as the writer's ticks, so pauses end
+            // pieces at the same points the writer saw
+            uint32_t offset = seq * LOG_BLOCK_SIZE + sizeof(log_block_header_t) + pos;
+            uint32_t timestamp_ms = timebase_delta_to_ms(base_us, rec.delta_ms);
+            session_index_close(index, timestamp_ms, false);
+            if (rec.type == SESSION_REC_STROKE) {
+                session_index_stroke(index, offset, offset + size, timestamp_ms);
+            } else if (rec.type == SESSION_REC_FIX && rec.length >= sizeof(session_fix_t)) {
+                session_fix_t fix;
+                memcpy(&fix, block->payload + pos + sizeof(rec), sizeof(fix));
+                session_index_distance(index, fix.distance_m);
+            }
+            pos += size;
+        }
+    }
+    return ESP_OK;
+}
+
+// Last resort when neither footer nor sidecar is usable
+static esp_err_t load_scan(const char *path, session_piece_t *pieces, size_t max, size_t *count) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    log_block_t *block = malloc(sizeof(log_block_t));
+    session_index_t *index = malloc(sizeof(session_index_t));
+    esp_err_t err = ESP_ERR_NO_MEM;
+    if (block != NULL && index != NULL) {
+        err = scan_blocks(fd, block, index);
+    }
+    if (err == ESP_OK) {
+        *count = index->count;
+        memcpy(pieces, index->pieces, (index->count < max ? index->count : max) * sizeof(session_piece_t));
+    }
+
+    free(block);
+    free(index);
+    close(fd);
+    return err;
+}
+
+esp_err_t session_index_load(const char *log_path, const char *sidecar_path,
+                             session_piece_t *pieces, size_t max, size_t *count,
+                             session_index_source_t *source) {
+    FILE *f = fopen(log_path, "rb");
+    if (f == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    *count = 0;
+    esp_err_t err = load_footer(f, pieces, max, count);
+    *source = SESSION_INDEX_FOOTER;
+    if (err != ESP_OK && sidecar_path != NULL) {
+        err = load_sidecar(sidecar_path, pieces, max, count);
+        *source = SESSION_INDEX_SIDECAR;
+    }
+    fclose(f);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "%s has no usable index - scanning records", log_path);
+        err = load_scan(log_path, pieces, max, count);
+        *source = SESSION_INDEX_SCAN;
+    }
+    return err;
+}
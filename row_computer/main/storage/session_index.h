@@ -0,0 +1,67 @@
+#ifndef SESSION_INDEX_H
+#define SESSION_INDEX_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "config/common_constants.h"
+
+// Piece index of a session log. A piece is a run of strokes without a pause of
+// SESSION_PIECE_GAP_MS. The writer keeps the index incrementally and stores it
+// twice: appended to a sidecar file as pieces progress (survives power loss) and
+// as a footer when the session is closed. Readers list and seek pieces in
+// O(pieces) reads; the record scan is only the last resort.
+
+#define SESSION_PIECE_OPEN          0x0001  // Not closed - session was cut short
+
+typedef struct {
+    uint32_t offset_start;      // Byte range of the piece's records in the session log
+    uint32_t offset_end;
+    uint32_t start_ms;          // First and last stroke (timebase_ms)
+    uint32_t end_ms;
+    uint32_t distance_m;
+    uint16_t avg_split_ds;      // Time per 500m over the piece, deciseconds (0 = no GPS)
+    uint16_t stroke_count;
+    uint16_t number;            // 0-based within the session
+    uint16_t flags;
+} session_piece_t;
+
+// Incremental builder, fed by the writer or by a record scan
+typedef struct {
+    session_piece_t pieces[SESSION_MAX_PIECES];
+    uint16_t count;             // Pieces started (the last one may be open)
+    bool open;
+    uint32_t distance_m;        // Latest cumulative session distance
+    uint32_t piece_start_distance_m;
+} session_index_t;
+
+typedef enum {
+    SESSION_INDEX_FOOTER,       // Clean close
+    SESSION_INDEX_SIDECAR,      // Power loss - rebuilt from the sidecar
+    SESSION_INDEX_SCAN,         // No usable index - rebuilt from the records
+} session_index_source_t;
+
+void session_index_reset(session_index_t *index);
+
+// Stroke record at [offset, offset_end); returns true if it opened a new piece.
+// With the index full, later pieces extend the last entry.
+bool session_index_stroke(session_index_t *index, uint32_t offset, uint32_t offset_end, uint32_t timestamp_ms);
+
+// Cumulative session distance from a fix
+void session_index_distance(session_index_t *index, uint32_t distance_m);
+
+// Close the open piece once no stroke came for SESSION_PIECE_GAP_MS (or force it).
+// Returns true if a piece was closed.
+bool session_index_close(session_index_t *index, uint32_t now_ms, bool force);
+
+// The piece currently being built (NULL if none is open)
+const session_piece_t* session_index_current(const session_index_t *index);
+
+// List the pieces of a session log: footer, else sidecar, else a full record scan.
+// Pieces beyond max are counted in *count but not stored.
+esp_err_t session_index_load(const char *log_path, const char *sidecar_path,
+                             session_piece_t *pieces, size_t max, size_t *count,
+                             session_index_source_t *source);
+
+#endif // SESSION_INDEX_H
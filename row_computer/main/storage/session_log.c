@@ -0,0 +1,472 @@
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_vfs_fat.h"
+#include "driver/sdspi_host.h"
+#include "sdmmc_cmd.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "session_log.h"
+#include "session_index.h"
+#include "log_block.h"
+#include "utils/stats.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "SESSION_LOG";
+
+static bool mounted = false;
+static int log_fd = -1;
+static FILE *sidecar_file = NULL;
+static uint32_t session_id = 0;
+static uint32_t nonce = 0;
+static uint32_t block_seq = 0;          // Next block to write
+static uint32_t capacity = 0;           // Blocks allocated in the file
+static uint32_t block_started_ms = 0;   // First record of the open block
+static timebase_us_t block_base_us = 0; // Timebase record of the open block
+static uint32_t last_sync_ms = 0;
+static bool unsynced = false;
+static uint32_t last_checkpoint_ms = 0;
+static log_block_t block;               // Open block (records accumulate here)
+static session_index_t index_state;
+static session_log_stats_t stats;
+static stats_metric_t *write_time_us = NULL;
+
+void session_log_path(uint32_t id, char *log_path, char *sidecar_path) {
+    if (log_path != NULL) {
+        snprintf(log_path, SESSION_PATH_MAX, "%s/S%04lu.LOG", SESSION_LOG_DIR, (unsigned long)id);
+    }
+    if (sidecar_path != NULL) {
+        snprintf(sidecar_path, SESSION_PATH_MAX, "%s/S%04lu.IDX", SESSION_LOG_DIR, (unsigned long)id);
+    }
+}
+
+bool session_log_id_from_name(const char *name, uint32_t *id) {
+    unsigned long number;
+    char ext[4];
+    if (sscanf(name, "S%4lu.%3s", &number, ext) != 2 || strcmp(ext, "LOG") != 0) {
+        return false;
+    }
+    *id = number;
+    return true;
+}
+
+// Highest session number on the card + 1
+static uint32_t next_session_id(void) {
+    uint32_t next = 1;
+    DIR *dir = opendir(SESSION_LOG_DIR);
+    if (dir == NULL) {
+        return next;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        uint32_t id;
+        if (session_log_id_from_name(entry->d_name, &id) && id >= next) {
+            next = id + 1;
+        }
+    }
+    closedir(dir);
+    return next;
+}
+
+static bool write_at(int fd, uint32_t offset, const void *data, size_t len) {
+    return lseek(fd, offset, SEEK_SET) >= 0 && write(fd, data, len) == (ssize_t)len;
+}
+
+// Grow the file by a whole segment. FAT allocates the clusters without writing
+// them, so the data writes that follow never touch the FAT or the directory.
+static esp_err_t ensure_capacity(void) {
+    if (block_seq < capacity) {
+        return ESP_OK;
+    }
+    uint32_t new_capacity = capacity + SESSION_SEGMENT_BLOCKS;
+    uint8_t zero = 0;
+    if (!write_at(log_fd, new_capacity * LOG_BLOCK_SIZE - 1, &zero, 1)) {
+        return ESP_FAIL;
+    }
+    capacity = new_capacity;
+    stats.segments++;
+    return ESP_OK;
+}
+
+// Seal and write the open block, even if it is only partly used
+static esp_err_t write_block(void) {
+    if (block.header.length == 0) {
+        return ESP_OK;
+    }
+    esp_err_t err = ensure_capacity();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Unused payload is zero so the record walk stops there
+    memset(block.payload + block.header.length, 0, LOG_BLOCK_PAYLOAD - block.header.length);
+    log_block_seal(&block, nonce, block_seq);
+    int64_t start_us = esp_timer_get_time();
+    if (!write_at(log_fd, block_seq * LOG_BLOCK_SIZE, &block, sizeof(block))) {
+        return ESP_FAIL;
+    }
+    stats_observe(write_time_us, (uint32_t)(esp_timer_get_time() - start_us));
+    block_seq++;
+    block.header.length = 0;
+    unsynced = true;
+    stats.blocks_written++;
+    return ESP_OK;
+}
+
+static esp_err_t sync_log(uint32_t now_ms) {
+    last_sync_ms = now_ms;
+    if (!unsynced) {
+        return ESP_OK;
+    }
+    if (fsync(log_fd) != 0) {
+        return ESP_FAIL;                    // Still unsynced: the next sync retries
+    }
+    unsynced = false;
+    stats.syncs++;
+    return ESP_OK;
+}
+
+// Count a failed card write; the caller gets the error back
+static esp_err_t note_error(esp_err_t err) {
+    if (err != ESP_OK) {
+        stats.write_errors++;
+    }
+    return err;
+}
+
+// File position of the next record
+static uint32_t record_offset(void) {
+    return block_seq * LOG_BLOCK_SIZE + sizeof(log_block_header_t) + block.header.length;
+}
+
+static esp_err_t open_session(timebase_us_t timestamp_us) {
+    char log_path[SESSION_PATH_MAX];
+    char sidecar_path[SESSION_PATH_MAX];
+    session_id = next_session_id();
+    session_log_path(session_id, log_path, sidecar_path);
+
+    log_fd = open(log_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    sidecar_file = log_fd >= 0 ? fopen(sidecar_path, "wb") : NULL;
+    if (sidecar_file == NULL) {
+        ESP_LOGE(TAG, "Failed to create %s", log_path);
+        if (log_fd >= 0) {
+            close(log_fd);
+            log_fd = -1;
+        }
+        return ESP_FAIL;
+    }
+
+    nonce = esp_random();
+    block_seq = 0;
+    capacity = 0;
+    session_file_header_t header = {
+        .magic = SESSION_LOG_MAGIC,
+        .version = SESSION_LOG_VERSION,
+        .block_size = LOG_BLOCK_SIZE,
+        .session_id = session_id,
+        .start_us = timestamp_us,
+    };
+    memcpy(block.payload, &header, sizeof(header));
+    block.header.length = sizeof(header);
+    esp_err_t err = write_block();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write the header of %s", log_path);
+        block.header.length = 0;
+        close(log_fd);
+        fclose(sidecar_file);
+        log_fd = -1;
+        sidecar_file = NULL;
+        return err;
+    }
+
+    session_index_reset(&index_state);
+    last_checkpoint_ms = last_sync_ms = timebase_ms(timestamp_us);
+    ESP_LOGI(TAG, "Session %lu started (%s)", session_id, log_path);
+    return ESP_OK;
+}
+
+// Append one piece entry to the sidecar. The log is made durable first so the
+// entry never points past data that could still be lost; if it cannot be, the
+// entry is not written and the next checkpoint tries again.
+static esp_err_t checkpoint_piece(const session_piece_t *piece, uint32_t now_ms) {
+    struct {
+        session_piece_t piece;
+        uint32_t crc;
+    } entry = { *piece, esp_rom_crc32_le(0, (const uint8_t *)piece, sizeof(*piece)) };
+
+    esp_err_t err = write_block();
+    if (err == ESP_OK) {
+        err = sync_log(now_ms);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    last_checkpoint_ms = now_ms;
+    if (fwrite(&entry, sizeof(entry), 1, sidecar_file) != 1 || fflush(sidecar_file) != 0 ||
+        fsync(fileno(sidecar_file)) != 0) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void put_record(session_rec_type_t type, int16_t delta_ms, const void *payload, uint8_t length) {
+    session_rec_header_t rec = { .type = type, .length = length, .delta_ms = delta_ms };
+    memcpy(block.payload + block.header.length, &rec, sizeof(rec));
+    memcpy(block.payload + block.header.length + sizeof(rec), payload, length);
+    block.header.length += sizeof(rec) + length;
+}
+
+esp_err_t session_log_append(session_rec_type_t type, timebase_us_t timestamp_us,
+                             const void *payload, uint8_t length) {
+    if (!mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (log_fd < 0) {
+        if (type != SESSION_REC_STROKE) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        esp_err_t err = open_session(timestamp_us);
+        if (err != ESP_OK) {
+            return note_error(err);
+        }
+    }
+
+    // A record too far from the block's timebase for its delta starts the next block
+    uint32_t timestamp_ms = timebase_ms(timestamp_us);
+    size_t size = sizeof(session_rec_header_t) + length;
+    int16_t delta_ms = 0;
+    if (block.header.length + size > LOG_BLOCK_PAYLOAD ||
+        (block.header.length > 0 && !timebase_delta_ms(block_base_us, timestamp_us, &delta_ms))) {
+        esp_err_t err = write_block();
+        if (err != ESP_OK) {
+            return note_error(err);
+        }
+    }
+    if (block.header.length == 0) {
+        session_timebase_t timebase = { .base_us = timestamp_us };
+        put_record(SESSION_REC_TIMEBASE, 0, &timebase, sizeof(timebase));
+        block_base_us = timestamp_us;
+        block_started_ms = timestamp_ms;
+        delta_ms = 0;
+    }
+
+    uint32_t start = record_offset();
+    put_record(type, delta_ms, payload, length);
+
+    // The record is kept in the open block even if a checkpoint fails
+    esp_err_t err = ESP_OK;
+    if (type == SESSION_REC_STROKE) {
+        // Pauses are noticed by tick(); a stroke after one starts the next piece
+        if (session_index_close(&index_state, timestamp_ms, false)) {
+            err = checkpoint_piece(&index_state.pieces[index_state.count - 1], timestamp_ms);
+        }
+        if (session_index_stroke(&index_state, start, start + size, timestamp_ms)) {
+            esp_err_t opened = checkpoint_piece(session_index_current(&index_state), timestamp_ms);
+            err = err != ESP_OK ? err : opened;
+        }
+    } else if (type == SESSION_REC_FIX && length >= sizeof(session_fix_t)) {
+        session_fix_t fix;
+        memcpy(&fix, payload, sizeof(fix));
+        session_index_distance(&index_state, fix.distance_m);
+    }
+    return note_error(err);
+}
+
+esp_err_t session_log_tick(uint32_t now_ms) {
+    if (log_fd < 0) {
+        return ESP_OK;
+    }
+
+    esp_err_t err = ESP_OK;
+    if (session_index_close(&index_state, now_ms, false)) {
+        err = checkpoint_piece(&index_state.pieces[index_state.count - 1], now_ms);
+    } else if (session_index_current(&index_state) != NULL &&
+               now_ms - last_checkpoint_ms >= SESSION_INDEX_CHECKPOINT_MS) {
+        err = checkpoint_piece(session_index_current(&index_state), now_ms);
+    }
+
+    // Bounded loss: no record waits longer than SESSION_LOG_FLUSH_MS for the card
+    if (err == ESP_OK && block.header.length > 0 && now_ms - block_started_ms >= SESSION_LOG_FLUSH_MS) {
+        err = write_block();
+    }
+    if (err == ESP_OK && now_ms - last_sync_ms >= SESSION_LOG_FLUSH_MS) {
+        err = sync_log(now_ms);
+    }
+    return note_error(err);
+}
+
+// Index entries and trailer right after the last data block, then cut the
+// unused pre-allocation
+static esp_err_t write_footer(int fd, uint32_t end_blocks, const session_piece_t *pieces, uint16_t count) {
+    uint32_t index_offset = end_blocks * LOG_BLOCK_SIZE;
+    session_footer_t footer = {
+        .index_offset = index_offset,
+        .count = count,
+        .entry_size = sizeof(session_piece_t),
+        .crc = esp_rom_crc32_le(0, (const uint8_t *)pieces, count * sizeof(session_piece_t)),
+        .magic = SESSION_FOOTER_MAGIC,
+    };
+    uint32_t footer_offset = index_offset + count * sizeof(session_piece_t);
+    if ((count > 0 && !write_at(fd, index_offset, pieces, count * sizeof(session_piece_t))) ||
+        !write_at(fd, footer_offset, &footer, sizeof(footer)) ||
+        ftruncate(fd, footer_offset + sizeof(footer)) != 0) {
+        return ESP_FAIL;
+    }
+    return fsync(fd) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t session_log_close(uint32_t now_ms) {
+    if (log_fd < 0) {
+        return ESP_OK;
+    }
+
+    // The footer carries the whole index, so a failed last checkpoint costs nothing
+    // if the footer is written; the boot recovery covers the rest
+    if (session_index_close(&index_state, now_ms, true)) {
+        note_error(checkpoint_piece(&index_state.pieces[index_state.count - 1], now_ms));
+    }
+    esp_err_t err = write_block();
+    if (err == ESP_OK) {
+        err = write_footer(log_fd, block_seq, index_state.pieces, index_state.count);
+    }
+    note_error(err);
+    block.header.length = 0;
+    close(log_fd);
+    fclose(sidecar_file);
+    log_fd = -1;
+    sidecar_file = NULL;
+
+    ESP_LOGI(TAG, "Session %lu closed: %u pieces, %lu blocks", session_id, index_state.count, block_seq);
+    return err;
+}
+
+esp_err_t session_log_recover(uint32_t id) {
+    char log_path[SESSION_PATH_MAX];
+    char sidecar_path[SESSION_PATH_MAX];
+    session_log_path(id, log_path, sidecar_path);
+
+    int fd = open(log_path, O_RDWR);
+    if (fd < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Closed cleanly (or already recovered)?
+    off_t size = lseek(fd, 0, SEEK_END);
+    session_footer_t footer;
+    if (size >= (off_t)sizeof(footer) && lseek(fd, size - sizeof(footer), SEEK_SET) >= 0 &&
+        read(fd, &footer, sizeof(footer)) == sizeof(footer) && footer.magic == SESSION_FOOTER_MAGIC) {
+        close(fd);
+        return ESP_OK;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    log_block_t header_block;
+    if (lseek(fd, 0, SEEK_SET) < 0 || read(fd, &header_block, sizeof(header_block)) != sizeof(header_block) ||
+        !log_block_valid(&header_block, header_block.header.nonce, 0)) {
+        close(fd);
+        ESP_LOGW(TAG, "%s has no valid header - left as is", log_path);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    uint32_t end = log_block_find_end(fd, header_block.header.nonce, size / LOG_BLOCK_SIZE);
+
+    // Pieces from the sidecar (or a block scan), cut to the data that survived
+    session_index_t *recovered = &index_state;      // No session is open during init
+    size_t count = 0;
+    session_index_source_t source;
+    session_index_load(log_path, sidecar_path, recovered->pieces, SESSION_MAX_PIECES, &count, &source);
+    uint16_t kept = 0;
+    uint32_t data_end = end * LOG_BLOCK_SIZE;
+    for (size_t i = 0; i < count && i < SESSION_MAX_PIECES; i++) {
+        session_piece_t *piece = &recovered->pieces[i];
+        if (piece->offset_start >= data_end) {
+            break;
+        }
+        if (piece->offset_end > data_end) {
+            piece->offset_end = data_end;
+        }
+        kept++;
+    }
+
+    esp_err_t err = write_footer(fd, end, recovered->pieces, kept);
+    close(fd);
+    stats.recovered_blocks = end - 1;
+    stats.recovery_us = (uint32_t)(esp_timer_get_time() - start_us);
+    ESP_LOGW(TAG, "Session %lu recovered after power loss: %lu data blocks, %u pieces (%s index) in %lu us",
+             id, stats.recovered_blocks, kept, source == SESSION_INDEX_SIDECAR ? "sidecar" : "scanned",
+             stats.recovery_us);
+    return err;
+}
+
+static void collect_stats(void) {
+    static stats_metric_t *blocks, *syncs, *segments, *errors;
+    if (blocks == NULL) {
+        blocks = stats_register("sdlog.blocks", STATS_COUNTER);
+        syncs = stats_register("sdlog.syncs", STATS_COUNTER);
+        segments = stats_register("sdlog.segments", STATS_COUNTER);
+        errors = stats_register("sdlog.errors", STATS_COUNTER);
+    }
+    stats_set(blocks, stats.blocks_written);
+    stats_set(syncs, stats.syncs);
+    stats_set(segments, stats.segments);
+    stats_set(errors, stats.write_errors);
+}
+
+esp_err_t session_log_init(void) {
+    if (mounted) {
+        return ESP_OK;
+    }
+
+    // The card shares SPI2 with the display and the SPI IMUs
+    sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+    host.slot = SPI2_HOST;
+    sdspi_device_config_t slot = SDSPI_DEVICE_CONFIG_DEFAULT();
+    slot.gpio_cs = SD_CS_PIN;
+    slot.host_id = SPI2_HOST;
+    esp_vfs_fat_mount_config_t mount_config = {
+        .format_if_mount_failed = false,
+        .max_files = 4,
+        .allocation_unit_size = 16 * 1024,
+    };
+
+    sdmmc_card_t *card;
+    esp_err_t err = esp_vfs_fat_sdspi_mount(SESSION_LOG_DIR, &host, &slot, &mount_config, &card);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to mount SD card: %s", esp_err_to_name(err));
+        return err;
+    }
+    mounted = true;
+    write_time_us = stats_register("sdlog.write_us", STATS_HISTOGRAM);
+    stats_register_collector(collect_stats);
+
+    // Only the newest session can have been open at power loss
+    uint32_t last = next_session_id() - 1;
+    if (last > 0) {
+        session_log_recover(last);
+    }
+    return ESP_OK;
+}
+
+bool session_log_is_open(void) {
+    return log_fd >= 0;
+}
+
+bool session_log_is_mounted(void) {
+    return mounted;
+}
+
+uint32_t session_log_current_id(void) {
+    return log_fd >= 0 ? session_id : 0;
+}
+
+esp_err_t session_log_get_stats(session_log_stats_t *out_stats) {
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_stats = stats;
+    return ESP_OK;
+}
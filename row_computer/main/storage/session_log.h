@@ -0,0 +1,147 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "utils/timebase.h"
+
+// Session log on the SD card: one file per session (Snnnn.LOG) of checksummed
+// blocks (log_block.h) holding length-prefixed records, a sidecar piece index
+// (Snnnn.IDX) and, once the session is closed, the index again as a footer.
+// Records never span blocks; each data block opens with a timebase record and
+// the records after it carry 16-bit millisecond deltas. The file grows in
+// pre-allocated segments, a block is written when full or SESSION_LOG_FLUSH_MS
+// after its first record, and an unclosed session is recovered at the next
+// boot. Writer side is single-task (logging task).
+
+// Mount point of the card; overridden for off-target runs
+#ifndef SESSION_LOG_DIR
+#define SESSION_LOG_DIR             "/sdcard"
+#endif
+
+// Course and its ghost, next to the sessions (utils/course.h)
+#define COURSE_PATH                 SESSION_LOG_DIR "/COURSE.TXT"
+#define COURSE_GHOST_PATH           SESSION_LOG_DIR "/COURSE.GHO"
+
+#define SESSION_LOG_MAGIC           0x53574F52  // "ROWS"
+#define SESSION_LOG_VERSION         3
+#define SESSION_FOOTER_MAGIC        0x58444952  // "RIDX"
+
+typedef enum {
+    SESSION_REC_STROKE = 1,     // 0 never starts a record (unwritten space reads as 0)
+    SESSION_REC_FIX,
+    SESSION_REC_SUMMARY,
+    SESSION_REC_STROKE_SHAPE,   // stroke_shape_t (utils/stroke_profile.h), stamped at its catch
+    SESSION_REC_TIMEBASE,       // session_timebase_t, first record of every data block
+    SESSION_REC_CAPTURE,        // session_capture_t and its samples, stamped at the first one
+    SESSION_REC_TYPES
+} session_rec_type_t;
+
+// Payload of block 0
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t block_size;
+    uint32_t session_id;
+    uint64_t start_us;          // Timebase of the first stroke
+} session_file_header_t;
+
+// Record time is timebase_delta_to_ms(base_us of the block's timebase record, delta_ms)
+typedef struct __attribute__((packed)) {
+    uint8_t type;               // 0 ends the records of a block
+    uint8_t length;             // Payload bytes
+    int16_t delta_ms;           // Relative to the block's timebase record
+} session_rec_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint64_t base_us;           // Full time the deltas of this block refer to
+} session_timebase_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t peak_cg;           // 0.01 g
+    uint16_t rate_spm;
+} session_stroke_t;
+
+typedef struct __attribute__((packed)) {
+    int32_t lat_e7;
+    int32_t lon_e7;
+    uint32_t speed_mm_s;
+    uint32_t distance_m;        // Cumulative over the session
+    uint16_t split_ds;
+} session_fix_t;
+
+typedef struct __attribute__((packed)) {
+    int16_t accel_mg[3];
+    int16_t gyro_cdps[3];       // 0.01 deg/s
+} session_summary_t;
+
+// Run of an event-capture window (utils/event_capture.h), followed by count
+// 16-byte samples: 7 int16 raw counts in mpu6050_raw_t order and the low 16 bits
+// of their millisecond time. Runs of a window are contiguous in first_seq.
+typedef struct __attribute__((packed)) {
+    uint32_t window_id;
+    uint32_t first_seq;         // Sequence number of the first sample
+    uint8_t trigger;            // capture_trigger_t
+    uint8_t flags;              // SESSION_CAPTURE_TRUNCATED
+    uint8_t count;
+} session_capture_t;
+
+#define SESSION_CAPTURE_TRUNCATED   0x01    // Samples of the window were lost to an overrun
+
+// Last 16 bytes of a closed (or recovered) log; the entries follow the last block
+typedef struct __attribute__((packed)) {
+    uint32_t index_offset;      // First piece entry
+    uint16_t count;
+    uint16_t entry_size;        // sizeof(session_piece_t)
+    uint32_t crc;               // CRC32 of the piece entries
+    uint32_t magic;
+} session_footer_t;
+
+typedef struct {
+    uint32_t blocks_written;
+    uint32_t syncs;
+    uint32_t segments;          // Pre-allocations
+    uint32_t write_errors;      // Failed block writes, syncs and sidecar checkpoints
+    uint32_t recovered_blocks;  // Data blocks kept by the last boot recovery
+    uint32_t recovery_us;
+} session_log_stats_t;
+
+// Mount the SD card and close out the last session if power was lost during it
+esp_err_t session_log_init(void);
+
+// Finalize an unclosed session: find the end of its data (binary search over
+// blocks), rebuild its index from the sidecar (or the blocks) and write the footer
+esp_err_t session_log_recover(uint32_t session_id);
+
+// Append one record. Sessions start with rowing: a stroke opens a new session if
+// none is open, other records are refused (ESP_ERR_INVALID_STATE) until then.
+// A card error is returned; the record is kept unless the block it needed could
+// not be written, and a session whose header fails to write is not opened.
+esp_err_t session_log_append(session_rec_type_t type, timebase_us_t timestamp_us,
+                             const void *payload, uint8_t length);
+
+// Periodic upkeep: close pieces after a pause, checkpoint the sidecar, flush.
+// A failed card write or sync is returned (and counted); the data stays queued
+// and the next tick retries.
+esp_err_t session_log_tick(uint32_t now_ms);
+
+// Write the footer and close the files (next record starts a new session)
+esp_err_t session_log_close(uint32_t now_ms);
+
+bool session_log_is_open(void);
+bool session_log_is_mounted(void);
+
+// Session being written, 0 when none is open
+uint32_t session_log_current_id(void);
+
+esp_err_t session_log_get_stats(session_log_stats_t *out_stats);
+
+// Paths of session id (buffers of SESSION_PATH_MAX)
+void session_log_path(uint32_t session_id, char *log_path, char *sidecar_path);
+
+// Session id of a log file name (Snnnn.LOG); false for any other file
+bool session_log_id_from_name(const char *name, uint32_t *id);
+
+#endif // SESSION_LOG_H
@@ -0,0 +1,432 @@
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config/common_constants.h"
+#include "session_transfer.h"
+#include "session_log.h"
+#include "utils/stats.h"
+#include "utils/runtime_config.h"
+#include "utils/timebase.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *TAG = "TRANSFER";
+
+#define FRAME_HEADER_SIZE   6                           // Sync, type, flags, length
+#define RX_PAYLOAD_MAX      TRANSFER_CONFIG_SET_MAX     // Largest host frame
+#define RX_BUFFER_SIZE      256
+
+typedef struct {
+    int fd;                     // -1 when no download runs
+    uint32_t session_id;
+    uint32_t size;
+    uint32_t next;              // Next offset to send
+    uint32_t acked;             // Host has everything before this
+    uint32_t sent_end;          // Furthest offset sent so far
+    uint32_t window_bytes;
+    uint16_t chunk;
+    uint32_t progress_ms;       // Last time acked moved (or the stream rewound)
+    uint32_t heard_ms;          // Last ACK of any kind
+} transfer_stream_t;
+
+static const transfer_port_t *port = NULL;
+static transfer_stream_t stream = { .fd = -1 };
+static transfer_stats_t stats;
+static vprintf_like_t console_vprintf = NULL;
+static uint32_t muted_lines = 0;        // Written by whichever task logs
+static uint32_t muted_reported = 0;
+
+// One outgoing frame. DATA chunks are read from the card straight into their
+// place behind the header, so each chunk is sent with a single port write.
+static uint8_t tx_frame[FRAME_HEADER_SIZE + sizeof(transfer_data_t) + TRANSFER_CHUNK_MAX + sizeof(uint32_t)];
+static uint8_t *const tx_payload = tx_frame + FRAME_HEADER_SIZE;
+static uint8_t rx_buffer[RX_BUFFER_SIZE];
+static size_t rx_length = 0;
+
+// Header and CRC around tx_payload[0..length)
+static int send_frame(uint8_t type, uint8_t flags, uint16_t length) {
+    tx_frame[0] = TRANSFER_SYNC0;
+    tx_frame[1] = TRANSFER_SYNC1;
+    tx_frame[2] = type;
+    tx_frame[3] = flags;
+    tx_frame[4] = length & 0xFF;
+    tx_frame[5] = length >> 8;
+    uint32_t crc = esp_rom_crc32_le(0, tx_frame + 2, 4 + length);
+    memcpy(tx_payload + length, &crc, sizeof(crc));
+    return port->write(tx_frame, FRAME_HEADER_SIZE + length + sizeof(crc));
+}
+
+static int send_message(uint8_t type, const void *payload, uint16_t length) {
+    memcpy(tx_payload, payload, length);
+    return send_frame(type, 0, length);
+}
+
+static int send_error(uint32_t session_id, esp_err_t err) {
+    transfer_error_t error = { .session_id = session_id, .error = err };
+    return send_message(TRANSFER_ERROR, &error, sizeof(error));
+}
+
+// Log output would share the line with the chunks - drop it during a download.
+// esp_log has a single output for all tasks, so this drops every task's lines;
+// they are counted instead.
+static int muted_vprintf(const char *format, va_list args) {
+    __atomic_fetch_add(&muted_lines, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static void mute_console(bool mute) {
+    if (!port->shares_console) {
+        return;
+    }
+    if (mute && console_vprintf == NULL) {
+        console_vprintf = esp_log_set_vprintf(muted_vprintf);
+    } else if (!mute && console_vprintf != NULL) {
+        esp_log_set_vprintf(console_vprintf);
+        console_vprintf = NULL;
+        uint32_t dropped = __atomic_load_n(&muted_lines, __ATOMIC_RELAXED) - muted_reported;
+        muted_reported += dropped;
+        if (dropped > 0) {
+            ESP_LOGW(TAG, "%lu log lines dropped during the download", dropped);
+        }
+    }
+}
+
+static void end_stream(void) {
+    if (stream.fd >= 0) {
+        close(stream.fd);
+        stream.fd = -1;
+    }
+    mute_console(false);
+}
+
+static int send_entries(void) {
+    const uint16_t per_frame = TRANSFER_CHUNK_MAX / sizeof(transfer_entry_t);
+    uint16_t count = 0;
+    uint32_t open_id = session_log_current_id();
+
+    DIR *dir = opendir(SESSION_LOG_DIR);
+    struct dirent *entry;
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        uint32_t id;
+        char path[SESSION_PATH_MAX];
+        struct stat st;
+        if (!session_log_id_from_name(entry->d_name, &id) || id == open_id) {
+            continue;
+        }
+        session_log_path(id, path, NULL);
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        if (count == per_frame) {
+            if (send_frame(TRANSFER_ENTRIES, TRANSFER_FLAG_MORE, count * sizeof(transfer_entry_t)) < 0) {
+                closedir(dir);
+                return -1;
+            }
+            count = 0;
+        }
+        transfer_entry_t item = { .session_id = id, .size = (uint32_t)st.st_size };
+        memcpy(tx_payload + count * sizeof(item), &item, sizeof(item));
+        count++;
+    }
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    return send_frame(TRANSFER_ENTRIES, 0, count * sizeof(transfer_entry_t));
+}
+
+static esp_err_t open_stream(const transfer_get_t *get) {
+    if (get->session_id == 0 || get->session_id == session_log_current_id()) {
+        return ESP_ERR_INVALID_STATE;   // Still being written - its size is not final
+    }
+    char path[SESSION_PATH_MAX];
+    session_log_path(get->session_id, path, NULL);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || get->offset > (uint32_t)st.st_size) {
+        close(fd);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t now = timebase_now_ms();
+    stream = (transfer_stream_t){
+        .fd = fd,
+        .session_id = get->session_id,
+        .size = (uint32_t)st.st_size,
+        .next = get->offset,
+        .acked = get->offset,
+        .sent_end = get->offset,
+        .chunk = get->chunk == 0 || get->chunk > TRANSFER_CHUNK_MAX ? TRANSFER_CHUNK_MAX : get->chunk,
+        .progress_ms = now,
+        .heard_ms = now,
+    };
+    uint16_t window = get->window == 0 ? 1 : get->window > TRANSFER_WINDOW_MAX ? TRANSFER_WINDOW_MAX : get->window;
+    stream.window_bytes = (uint32_t)window * stream.chunk;
+    return ESP_OK;
+}
+
+static int finish_stream(void) {
+    transfer_end_t end = { .session_id = stream.session_id, .size = stream.size };
+    stats.completed++;
+    end_stream();
+    ESP_LOGI(TAG, "Session %lu sent", end.session_id);
+    return send_message(TRANSFER_END, &end, sizeof(end));
+}
+
+static int start_stream(const transfer_get_t *get) {
+    end_stream();
+    stats.downloads++;
+    esp_err_t err = open_stream(get);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Download of session %lu refused: %s", get->session_id, esp_err_to_name(err));
+        return send_error(get->session_id, err);
+    }
+    ESP_LOGI(TAG, "Sending session %lu from %lu of %lu bytes (%u byte chunks, %lu in flight)",
+             stream.session_id, stream.next, stream.size, stream.chunk, stream.window_bytes / stream.chunk);
+    if (stream.acked == stream.size) {
+        return finish_stream();     // Resumed at the end: nothing left to send
+    }
+    mute_console(true);
+    return 0;
+}
+
+static int send_chunk(void) {
+    uint32_t length = stream.size - stream.next;
+    if (length > stream.chunk) {
+        length = stream.chunk;
+    }
+
+    transfer_data_t header = { .session_id = stream.session_id, .offset = stream.next };
+    memcpy(tx_payload, &header, sizeof(header));
+    uint8_t *data = tx_payload + sizeof(header);
+    if (lseek(stream.fd, stream.next, SEEK_SET) < 0 || read(stream.fd, data, length) != (ssize_t)length) {
+        uint32_t id = stream.session_id;
+        end_stream();
+        return send_error(id, ESP_FAIL);
+    }
+
+    if (stream.next < stream.sent_end) {
+        stats.retransmits++;
+    }
+    stream.next += length;
+    if (stream.next > stream.sent_end) {
+        stream.sent_end = stream.next;
+    }
+    __atomic_fetch_add(&stats.bytes_sent, length, __ATOMIC_RELAXED);
+    return send_frame(TRANSFER_DATA, 0, sizeof(header) + length);
+}
+
+static int handle_ack(const transfer_ack_t *ack, uint8_t flags, uint32_t now) {
+    if (stream.fd < 0 || ack->session_id != stream.session_id || ack->offset > stream.sent_end) {
+        return 0;   // Stale, or for a download that already ended
+    }
+    stream.heard_ms = now;
+    if (ack->offset > stream.acked) {
+        stream.acked = ack->offset;
+        stream.progress_ms = now;
+    }
+    if (stream.acked == stream.size) {
+        return finish_stream();
+    }
+    // The host lost a chunk: go back to it rather than waiting for the timeout
+    if ((flags & TRANSFER_FLAG_REWIND) && ack->offset == stream.acked && stream.next > stream.acked) {
+        stream.next = stream.acked;
+        stream.progress_ms = now;
+        stats.rewinds++;
+    }
+    return 0;
+}
+
+// Configuration as JSON behind the result of the request
+static int send_config(esp_err_t err) {
+    transfer_config_t result = { .error = err };
+    memcpy(tx_payload, &result, sizeof(result));
+    size_t length = runtime_config_json((char *)tx_payload + sizeof(result),
+                                        sizeof(tx_frame) - FRAME_HEADER_SIZE - sizeof(uint32_t) - sizeof(result));
+    return send_frame(TRANSFER_CONFIG, 0, sizeof(result) + length);
+}
+
+static int set_config(const uint8_t *payload, uint16_t length) {
+    esp_err_t err = runtime_config_set((const char *)payload, length);
+    if (err == ESP_OK) {
+        bool restart = false;
+        err = runtime_config_commit(&restart);
+        if (err == ESP_OK && restart) {
+            ESP_LOGW(TAG, "Configuration stored - boot-time fields apply after a restart");
+        }
+    } else {
+        runtime_config_discard();
+    }
+    return send_config(err);
+}
+
+static int handle_frame(uint8_t type, uint8_t flags, const uint8_t *payload, uint16_t length, uint32_t now) {
+    switch (type) {
+        case TRANSFER_LIST:
+            return send_entries();
+        case TRANSFER_GET:
+            if (length == sizeof(transfer_get_t)) {
+                transfer_get_t get;
+                memcpy(&get, payload, sizeof(get));
+                return start_stream(&get);
+            }
+            break;
+        case TRANSFER_ACK:
+            if (length == sizeof(transfer_ack_t)) {
+                transfer_ack_t ack;
+                memcpy(&ack, payload, sizeof(ack));
+                return handle_ack(&ack, flags, now);
+            }
+            break;
+        case TRANSFER_ABORT:
+            end_stream();
+            break;
+        case TRANSFER_STATS:
+            return send_frame(TRANSFER_SNAPSHOT, 0,
+                              stats_snapshot(tx_payload, sizeof(tx_frame) - FRAME_HEADER_SIZE - sizeof(uint32_t)));
+        case TRANSFER_CONFIG_GET:
+            return send_config(ESP_OK);
+        case TRANSFER_CONFIG_SET:
+            return set_config(payload, length);
+        default:
+            break;
+    }
+    return 0;
+}
+
+// Handle every complete frame in rx_buffer, skipping bytes that do not start one
+static int parse_frames(uint32_t now) {
+    size_t pos = 0;
+    int result = 0;
+    while (result >= 0 && rx_length - pos >= FRAME_HEADER_SIZE) {
+        const uint8_t *frame = rx_buffer + pos;
+        uint16_t length = frame[4] | (frame[5] << 8);
+        if (frame[0] != TRANSFER_SYNC0 || frame[1] != TRANSFER_SYNC1 || length > RX_PAYLOAD_MAX) {
+            pos++;
+            continue;
+        }
+        size_t total = FRAME_HEADER_SIZE + length + sizeof(uint32_t);
+        if (rx_length - pos < total) {
+            break;
+        }
+        uint32_t crc;
+        memcpy(&crc, frame + FRAME_HEADER_SIZE + length, sizeof(crc));
+        if (crc != esp_rom_crc32_le(0, frame + 2, 4 + length)) {
+            stats.bad_frames++;
+            pos++;
+            continue;
+        }
+        result = handle_frame(frame[2], frame[3], frame + FRAME_HEADER_SIZE, length, now);
+        pos += total;
+    }
+    memmove(rx_buffer, rx_buffer + pos, rx_length - pos);
+    rx_length -= pos;
+    return result;
+}
+
+static void check_timeouts(uint32_t now) {
+    if (stream.fd < 0) {
+        return;
+    }
+    if (now - stream.heard_ms > TRANSFER_IDLE_TIMEOUT_MS) {
+        ESP_LOGW(TAG, "Host went away during session %lu at %lu/%lu bytes",
+                 stream.session_id, stream.acked, stream.size);
+        end_stream();
+    } else if (now - stream.progress_ms > TRANSFER_ACK_TIMEOUT_MS && stream.next > stream.acked) {
+        stream.next = stream.acked;
+        stream.progress_ms = now;
+        stats.timeouts++;
+    }
+}
+
+static void collect_stats(void) {
+    static stats_metric_t *sent, *retransmits, *timeouts, *bad_frames, *muted;
+    if (sent == NULL) {
+        sent = stats_register("xfer.kbytes", STATS_COUNTER);
+        retransmits = stats_register("xfer.retransmits", STATS_COUNTER);
+        timeouts = stats_register("xfer.timeouts", STATS_COUNTER);
+        bad_frames = stats_register("xfer.bad_frames", STATS_COUNTER);
+        muted = stats_register("xfer.muted_lines", STATS_COUNTER);
+    }
+    // In kB: a 32-bit byte count wraps after 4 GB, a few hundred long downloads.
+    // This can run in the monitor task, so the 64-bit total is read atomically.
+    stats_set(sent, (int32_t)(uint32_t)(__atomic_load_n(&stats.bytes_sent, __ATOMIC_RELAXED) / 1024));
+    stats_set(retransmits, stats.retransmits);
+    stats_set(timeouts, stats.timeouts);
+    stats_set(bad_frames, stats.bad_frames);
+    stats_set(muted, __atomic_load_n(&muted_lines, __ATOMIC_RELAXED));
+}
+
+esp_err_t session_transfer_init(const transfer_port_t *link) {
+    esp_err_t err = link->init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open %s: %s", link->name, esp_err_to_name(err));
+        return err;
+    }
+    memset(&stats, 0, sizeof(stats));
+    rx_length = 0;
+    port = link;
+    stats_register_collector(collect_stats);
+    return ESP_OK;
+}
+
+bool session_transfer_is_ready(void) {
+    return port != NULL;
+}
+
+esp_err_t session_transfer_serve(void) {
+    if (port == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    while (1) {
+        // Keep the window full; block on the link only when there is nothing to send
+        bool can_send = stream.fd >= 0 && stream.next < stream.size &&
+                        stream.next - stream.acked < stream.window_bytes;
+        if (can_send && send_chunk() < 0) {
+            break;
+        }
+
+        int received = port->read(rx_buffer + rx_length, sizeof(rx_buffer) - rx_length,
+                                  can_send ? 0 : TRANSFER_POLL_MS);
+        if (received < 0) {
+            break;
+        }
+        rx_length += received;
+        uint32_t now = timebase_now_ms();
+        if (parse_frames(now) < 0) {
+            break;
+        }
+        check_timeouts(now);
+    }
+
+    end_stream();
+    return ESP_FAIL;
+}
+
+void session_transfer_task(void *parameters) {
+    ESP_LOGD(TAG, "Starting session transfer task on %s", port->name);
+    session_transfer_serve();
+    ESP_LOGE(TAG, "%s failed - session download stopped", port->name);
+    vTaskDelete(NULL);
+}
+
+bool session_transfer_active(void) {
+    return stream.fd >= 0;
+}
+
+esp_err_t session_transfer_get_stats(transfer_stats_t *out_stats) {
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_stats = stats;
+    out_stats->muted_log_lines = __atomic_load_n(&muted_lines, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
@@ -0,0 +1,134 @@
+#ifndef SESSION_TRANSFER_H
+#define SESSION_TRANSFER_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bulk download of session logs over a serial link (the console UART). Every
+// message is one frame:
+//
+//   0xA5 0x5A | type u8 | flags u8 | length u16 | payload[length] | crc32
+//
+// little endian, CRC32 over type..payload. Bytes outside frames (console text
+// from before the download started) are skipped by both ends.
+//
+// The host sends GET with a session and a start offset - a partial file is
+// resumed by asking for its size. The device streams DATA chunks read straight
+// into the transmit frame, keeping at most window chunks beyond the host's
+// cumulative ACK in flight. A chunk that fails its CRC or arrives out of order
+// is dropped; the host's next ACK carries TRANSFER_FLAG_REWIND and the device
+// resends from there (go-back-N). No ACK progress for TRANSFER_ACK_TIMEOUT_MS
+// rewinds as well.
+//
+// On a port that carries the console (shares_console), log output of every task
+// is dropped while a download runs: the lines would take the link's bandwidth
+// and could only be skipped by the host. The dropped lines are counted
+// (transfer_stats_t.muted_log_lines) and the count is logged afterwards.
+//
+// CONFIG_GET / CONFIG_SET read and change the runtime configuration
+// (utils/runtime_config.h) without reflashing; both are answered with CONFIG.
+
+#define TRANSFER_SYNC0              0xA5
+#define TRANSFER_SYNC1              0x5A
+#define TRANSFER_FRAME_OVERHEAD     10      // Sync, type, flags, length, crc
+
+typedef enum {
+    // Host -> device
+    TRANSFER_LIST = 0x01,       // -
+    TRANSFER_GET = 0x02,        // transfer_get_t
+    TRANSFER_ACK = 0x03,        // transfer_ack_t
+    TRANSFER_ABORT = 0x04,      // -
+    TRANSFER_STATS = 0x05,      // -
+    TRANSFER_CONFIG_GET = 0x06, // -
+    TRANSFER_CONFIG_SET = 0x07, // "name=value" lines (up to TRANSFER_CONFIG_SET_MAX), committed together
+    // Device -> host
+    TRANSFER_ENTRIES = 0x81,    // transfer_entry_t[], TRANSFER_FLAG_MORE until the last frame
+    TRANSFER_DATA = 0x82,       // transfer_data_t + chunk
+    TRANSFER_END = 0x83,        // transfer_end_t
+    TRANSFER_ERROR = 0x84,      // transfer_error_t
+    TRANSFER_SNAPSHOT = 0x85,   // Binary stats snapshot (stats.h)
+    TRANSFER_CONFIG = 0x86,     // transfer_config_t + configuration JSON (runtime_config_json)
+} transfer_frame_type_t;
+
+#define TRANSFER_CONFIG_SET_MAX     192
+
+#define TRANSFER_FLAG_MORE          0x01    // ENTRIES: another frame follows
+#define TRANSFER_FLAG_REWIND        0x01    // ACK: resend from this offset now
+
+typedef struct __attribute__((packed)) {
+    uint32_t session_id;
+    uint32_t offset;            // Resume point in bytes
+    uint16_t window;            // Chunks in flight (clamped to TRANSFER_WINDOW_MAX)
+    uint16_t chunk;             // Bytes per chunk (clamped to TRANSFER_CHUNK_MAX)
+} transfer_get_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t session_id;
+    uint32_t offset;            // Everything before this was received intact
+} transfer_ack_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t session_id;
+    uint32_t size;              // File bytes (closed sessions only)
+} transfer_entry_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t session_id;
+    uint32_t offset;
+} transfer_data_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t session_id;
+    uint32_t size;
+} transfer_end_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t session_id;
+    int32_t error;              // esp_err_t
+} transfer_error_t;
+
+typedef struct __attribute__((packed)) {
+    int32_t error;              // esp_err_t of the CONFIG_SET (ESP_OK for CONFIG_GET)
+} transfer_config_t;
+
+// Byte link the protocol runs over
+typedef struct {
+    const char *name;
+    esp_err_t (*init)(void);
+    // Up to len bytes, waiting at most timeout_ms for the first; < 0 when the link is gone
+    int (*read)(uint8_t *data, size_t len, uint32_t timeout_ms);
+    // Queue a whole frame; < 0 when the link is gone
+    int (*write)(const uint8_t *data, size_t len);
+    bool shares_console;        // Log output goes over this link too - muted during a download
+} transfer_port_t;
+
+extern const transfer_port_t transfer_port_uart;   // Console UART
+
+typedef struct {
+    uint32_t downloads;         // GET requests served
+    uint32_t completed;         // ... that reached END
+    uint64_t bytes_sent;        // Chunk payload, retransmissions included
+    uint32_t retransmits;       // Chunks sent again after a rewind or timeout
+    uint32_t rewinds;
+    uint32_t timeouts;
+    uint32_t bad_frames;        // Received frames that failed their CRC
+    uint32_t muted_log_lines;   // Console log lines dropped during downloads
+} transfer_stats_t;
+
+// Bring up the link; the task is only created when this succeeded
+esp_err_t session_transfer_init(const transfer_port_t *port);
+bool session_transfer_is_ready(void);
+
+// Serve requests until the link fails
+esp_err_t session_transfer_serve(void);
+
+// Download server: lowest priority, idle until the host asks for something
+void session_transfer_task(void *parameters);
+
+bool session_transfer_active(void);
+
+esp_err_t session_transfer_get_stats(transfer_stats_t *out_stats);
+
+#endif // SESSION_TRANSFER_H
@@ -0,0 +1,36 @@
+#include "driver/uart.h"
+#include "esp_vfs_dev.h"
+#include "config/pin_definitions.h"
+#include "session_transfer.h"
+
+// The console UART keeps the line settings the bootloader and console gave it;
+// installing the driver only adds the interrupt-driven ring buffers.
+static esp_err_t uart_port_init(void) {
+    esp_err_t err = uart_driver_install(TRANSFER_UART_NUM, TRANSFER_UART_RX_BUF_SIZE,
+                                        TRANSFER_UART_TX_BUF_SIZE, 0, NULL, 0);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // Console writes go through the driver as well, so a log line queues behind
+    // a frame instead of landing in the middle of it
+    esp_vfs_dev_uart_use_driver(TRANSFER_UART_NUM);
+    return ESP_OK;
+}
+
+static int uart_port_read(uint8_t *data, size_t len, uint32_t timeout_ms) {
+    return uart_read_bytes(TRANSFER_UART_NUM, data, len, pdMS_TO_TICKS(timeout_ms));
+}
+
+// Copies into the TX ring and returns; blocks only while the ring is full,
+// which paces the sender at the line rate
+static int uart_port_write(const uint8_t *data, size_t len) {
+    return uart_write_bytes(TRANSFER_UART_NUM, data, len);
+}
+
+const transfer_port_t transfer_port_uart = {
+    .name = "UART0",
+    .init = uart_port_init,
+    .read = uart_port_read,
+    .write = uart_port_write,
+    .shares_console = true,
+};
@@ -0,0 +1,54 @@
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "tasks/tasks_common.h"
+#include "tasks/display_task.h"
+#include "config/common_constants.h"
+#include "display/display.h"
+
+static const char *TAG = "DISPLAY_TASK";
+
+static portMUX_TYPE metrics_mux = portMUX_INITIALIZER_UNLOCKED;
+static display_metrics_t latest_metrics = {0};
+
+void display_task_publish_metrics(const display_metrics_t *metrics) {
+    taskENTER_CRITICAL(&metrics_mux);
+    latest_metrics = *metrics;
+    taskEXIT_CRITICAL(&metrics_mux);
+}
+
+// Lowest priority task: renders changed fields and queues partial updates.
+// SPI transfers run on DMA, so the CPU is released while pixels go out.
+void display_task(void *parameters) {
+    ESP_LOGD(TAG, "Starting display task at %dHz", 1000/DISPLAY_TASK_PERIOD_MS);
+
+    display_metrics_t metrics;
+    TickType_t last_wake_time = xTaskGetTickCount();
+    uint32_t stats_counter = 0;
+
+    while (1) {
+        taskENTER_CRITICAL(&metrics_mux);
+        metrics = latest_metrics;
+        taskEXIT_CRITICAL(&metrics_mux);
+
+        if (display_render(&metrics) > 0) {
+            esp_err_t err = display_flush();
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Display flush failed: %s", esp_err_to_name(err));
+            }
+        }
+
+        if (++stats_counter >= DISPLAY_STATS_LOG_INTERVAL) {
+            display_stats_t stats;
+            display_get_stats(&stats);
+            ESP_LOGD(TAG, "Display - Frames: %lu | Avg: %lu us | Max: %lu us | Bytes/frame: %lu",
+                    stats.frames,
+                    stats.frames > 0 ? (uint32_t)(stats.total_render_us / stats.frames) : 0,
+                    stats.max_render_us,
+                    stats.frames > 0 ? (uint32_t)(stats.bytes_pushed / stats.frames) : 0);
+            stats_counter = 0;
+        }
+
+        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(DISPLAY_TASK_PERIOD_MS));
+    }
+}
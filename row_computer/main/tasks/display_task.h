@@ -0,0 +1,11 @@
+#ifndef DISPLAY_TASK
+#define DISPLAY_TASK
+
+#include "display/display.h"
+
+void display_task(void *parameters);
+
+// Hand the latest metrics to the display task (safe from any task/core)
+void display_task_publish_metrics(const display_metrics_t *metrics);
+
+#endif
@@ -0,0 +1,262 @@
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+#include "tasks/tasks_common.h"
+#include "tasks/dsp_task.h"
+#include "tasks/display_task.h"
+#include "config/common_constants.h"
+#include "sensors_common.h"
+#include "utils/batch_notify.h"
+#include "utils/event_capture.h"
+#include "utils/multirate.h"
+#include "utils/data_bus.h"
+#include "utils/deferred_log.h"
+#include "utils/course.h"
+#include "utils/geo.h"
+#include "utils/ghost_boat.h"
+#include "utils/sensor_health.h"
+#include "utils/stats.h"
+#include "utils/stroke_profile.h"
+#include "utils/timebase.h"
+#include "utils/runtime_config.h"
+
+static const char *TAG = "DSP_TASK";
+
+// Processing stage: woken by the acquisition tasks once a batch is queued.
+// Runs stroke detection, stroke shape analysis, boat metrics, course tracking
+// and the ghost boat, then hands records to storage. Sensor health events set
+// how much each sensor counts.
+void dsp_task(void *parameters) {
+    ESP_LOGD(TAG, "Starting DSP task");
+
+    imu_data_t imu_data;
+    gps_data_t gps_data;
+    dsp_record_t record;
+    display_metrics_t metrics = {0};
+    bool above_threshold = false;
+    timebase_us_t last_stroke_us = 0;
+    bool have_last_fix = false;
+    int32_t last_lat_e7 = 0;
+    int32_t last_lon_e7 = 0;
+    geo_ltp_t ltp = {0};
+    float distance_m = 0.0f;
+    timebase_us_t last_fix_us = 0;
+    float last_speed_m_s = 0.0f;       // Counted speed (0 below split_min_speed)
+    float last_position_weight = 1.0f;
+    uint8_t health_weight[HEALTH_SENSORS];
+    health_event_t health_event;
+    course_position_t position = {0};
+    course_result_t course_result;
+    ghost_boat_delta_t ghost_delta;
+    stats_metric_t *shapes = stats_register("stroke.shapes", STATS_COUNTER);
+    stats_metric_t *shape_time_us = stats_register("stroke.shape_us", STATS_HISTOGRAM);
+    runtime_config_reader_t *config_reader = runtime_config_register_reader("dsp");
+
+    // Stroke detection runs on the full-rate stream
+    bus_subscriber_t *imu_sub = bus_subscribe(multirate_topic(MULTIRATE_1KHZ), "dsp",
+                                              xTaskGetCurrentTaskHandle(), IMU_BATCH_WATERMARK);
+    bus_subscriber_t *gps_sub = bus_subscribe(gps_topic, "dsp", xTaskGetCurrentTaskHandle(), GPS_BATCH_WATERMARK);
+    // Health changes are rare and ride along with the next batch
+    bus_subscriber_t *health_subs[HEALTH_SOURCES];
+    for (int s = 0; s < HEALTH_SOURCES; s++) {
+        health_subs[s] = bus_subscribe(sensor_health_topic(s), "dsp", NULL, 1);
+    }
+    for (int i = 0; i < HEALTH_SENSORS; i++) {
+        health_weight[i] = HEALTH_WEIGHT_FULL;
+    }
+    if (imu_sub == NULL || gps_sub == NULL || health_subs[HEALTH_SOURCE_IMU] == NULL ||
+        health_subs[HEALTH_SOURCE_GPS] == NULL) {
+        ESP_LOGE(TAG, "Bus subscription failed - DSP stage stopped");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    while (1) {
+        // Detection parameters stay fixed for the whole batch
+        const runtime_config_t *config = runtime_config_quiescent(config_reader);
+
+        // Block until a producer signals a batch (or its latency bound expires)
+        batch_notify_wait(config->dsp_max_latency_ms);
+
+        // Sensor health before the data: a GPS fix is published after the event it caused
+        for (int s = 0; s < HEALTH_SOURCES; s++) {
+            while (bus_receive(health_subs[s], &health_event)) {
+                health_weight[health_event.sensor] = health_event.weight;
+            }
+        }
+
+        // Process IMU data (high frequency)
+        while (bus_receive(imu_sub, &imu_data)) {
+            float accel_magnitude = sqrtf(imu_data.accel_x * imu_data.accel_x +
+                                          imu_data.accel_y * imu_data.accel_y +
+                                          imu_data.accel_z * imu_data.accel_z);
+
+            // Detect potential stroke (rising edge of a high acceleration event),
+            // not from an accelerometer that failed its health checks
+            bool above = accel_magnitude > config->stroke_threshold_g && health_weight[HEALTH_ACCEL] != 0;
+            if (above && !above_threshold &&
+                imu_data.timestamp_us - last_stroke_us >= (timebase_us_t)config->stroke_min_interval_ms * 1000) {
+                record.type = DSP_RECORD_STROKE;
+                record.timestamp_us = imu_data.timestamp_us;
+                record.stroke.peak_g = accel_magnitude;
+                record.stroke.rate_spm = 0;
+                timebase_us_t stroke_start_us = last_stroke_us;
+                bool piece_start = last_stroke_us == 0 ||
+                                   imu_data.timestamp_us - last_stroke_us >= (timebase_us_t)SESSION_PIECE_GAP_MS * 1000;
+                if (last_stroke_us != 0) {
+                    metrics.stroke_rate_spm = (uint16_t)(60000000ULL / (imu_data.timestamp_us - last_stroke_us));
+                    record.stroke.rate_spm = metrics.stroke_rate_spm;
+                }
+                last_stroke_us = imu_data.timestamp_us;
+
+                // Ghost deltas at the catch itself: the distance is carried on from the
+                // last fix, course progress interpolated between fixes. A piece starts
+                // after a pause, as in the session index.
+                float catch_distance_m = distance_m;
+                float since_fix_s = (float)(int64_t)(imu_data.timestamp_us - last_fix_us) * 1e-6f;
+                if (have_last_fix && fabsf(since_fix_s) * 1000.0f < GHOST_CATCH_EXTRAPOLATE_MS) {
+                    catch_distance_m += last_speed_m_s * since_fix_s;
+                }
+                if (piece_start) {
+                    ghost_boat_start(catch_distance_m, imu_data.timestamp_us);
+                }
+                record.stroke.has_ghost = ghost_boat_stroke(catch_distance_m, imu_data.timestamp_us,
+                                                            piece_start ? 0 : record.stroke.rate_spm,
+                                                            metrics.split_ds, &ghost_delta);
+                record.stroke.ghost_delta_ms = record.stroke.has_ghost ? ghost_delta.delta_ms : 0;
+                record.stroke.ghost_rate_delta_spm = record.stroke.has_ghost ? ghost_delta.rate_delta_spm : 0;
+                record.stroke.ghost_split_delta_ds = record.stroke.has_ghost ? ghost_delta.split_delta_ds : 0;
+
+                // The display races the course ghost during a course run, else the ghost boat
+                if (course_position_at(imu_data.timestamp_us, &position) && position.has_ghost) {
+                    metrics.has_ghost = true;
+                    metrics.ghost_delta_ds = position.ghost_delta_ms / 100;
+                } else {
+                    metrics.has_ghost = record.stroke.has_ghost;
+                    metrics.ghost_delta_ds = record.stroke.ghost_delta_ms / 100;
+                }
+                display_task_publish_metrics(&metrics);
+
+                // Record the catch at full resolution (pre-trigger ring covers DSP latency)
+                event_capture_trigger(CAPTURE_TRIGGER_STROKE, imu_data.timestamp_us);
+
+                record.created_us = (uint32_t)timebase_now_us();
+                if (xQueueSend(dsp_record_queue, &record, 0) != pdTRUE) {
+                    DLOG_RATE(ESP_LOG_WARN, TAG, DLOG_WARN_INTERVAL_MS, "Record queue full - dropping stroke");
+                } else {
+                    // Strokes are latency critical - wake storage/telemetry now
+                    batch_notify_post(dsp_record_queue, logging_task_handle, LOG_BATCH_WATERMARK, true);
+                }
+
+                // This catch closes the previous stroke - its shape is logged at that catch
+                timebase_us_t shape_start_us = timebase_now_us();
+                if (stroke_profile_catch(imu_data.timestamp_us, &record.shape)) {
+                    stats_observe(shape_time_us, (uint32_t)(timebase_now_us() - shape_start_us));
+                    stats_add(shapes, 1);
+                    record.type = DSP_RECORD_STROKE_SHAPE;
+                    record.timestamp_us = stroke_start_us;
+                    record.created_us = (uint32_t)timebase_now_us();
+                    if (xQueueSend(dsp_record_queue, &record, 0) != pdTRUE) {
+                        DLOG_RATE(ESP_LOG_WARN, TAG, DLOG_WARN_INTERVAL_MS,
+                                  "Record queue full - dropping stroke shape");
+                    } else {
+                        batch_notify_post(dsp_record_queue, logging_task_handle, LOG_BATCH_WATERMARK, false);
+                    }
+                }
+            }
+            above_threshold = above;
+            stroke_profile_push(imu_data.BOAT_SURGE_AXIS * BOAT_SURGE_SIGN, imu_data.timestamp_us);
+        }
+
+        // Process GPS data (low frequency)
+        while (bus_receive(gps_sub, &gps_data)) {
+            if (!gps_data.valid_fix) {
+                have_last_fix = false;
+                continue;
+            }
+
+            // Split per 500m from ground speed (none while the speed is gated out)
+            float position_weight = health_weight[HEALTH_GPS_POSITION] / (float)HEALTH_WEIGHT_FULL;
+            bool speed_trusted = health_weight[HEALTH_GPS_SPEED] != 0;
+            uint32_t speed_mm_s = gps_data.speed_mm_s;
+            bool moving = speed_mm_s >= config->split_min_speed_mm_s;
+            metrics.split_ds = moving && speed_trusted ? 5000000 / speed_mm_s : 0;
+
+            // Distance along the track in the local tangent plane, ignoring position
+            // jitter while the boat is stopped. A step from or to a position that is
+            // not fully trusted leans on speed x time in proportion.
+            geo_ltp_follow(&ltp, gps_data.lat_e7, gps_data.lon_e7);
+            float step_weight = fminf(position_weight, last_position_weight);
+            if (have_last_fix && moving) {
+                float step_m = geo_ltp_distance_m(&ltp, last_lat_e7, last_lon_e7, gps_data.lat_e7, gps_data.lon_e7);
+                if (step_weight < 1.0f && speed_trusted) {
+                    float dt_s = (float)(int64_t)(gps_data.timestamp_us - last_fix_us) * 1e-6f;
+                    float dead_reckoned_m = 0.5f * (last_speed_m_s + speed_mm_s / 1000.0f) * dt_s;
+                    step_m = step_weight * step_m + (1.0f - step_weight) * dead_reckoned_m;
+                }
+                distance_m += step_m;
+            }
+            have_last_fix = true;
+            last_lat_e7 = gps_data.lat_e7;
+            last_lon_e7 = gps_data.lon_e7;
+            last_fix_us = gps_data.timestamp_us;
+            last_speed_m_s = moving && speed_trusted ? speed_mm_s / 1000.0f : 0.0f;
+            last_position_weight = position_weight;
+            metrics.distance_m = (uint32_t)distance_m;
+
+            // During a course run the display counts down the distance to go. Gated
+            // positions are kept from the course match (it rides out gaps on its own).
+            course_event_t course_event = COURSE_EVENT_NONE;
+            if (position_weight > 0.0f) {
+                course_event = course_update(gps_data.lat_e7, gps_data.lon_e7, gps_data.timestamp_us, &position);
+            }
+            metrics.course_active = position.running;
+            metrics.course_remaining_m = (uint32_t)position.remaining_m;
+
+            // Ghost boat piece ends with the pause that ends the session piece
+            if (ghost_boat_active() &&
+                gps_data.timestamp_us - last_stroke_us >= (timebase_us_t)SESSION_PIECE_GAP_MS * 1000) {
+                ghost_boat_stop();
+            }
+            if (position.running) {
+                metrics.has_ghost = position.has_ghost;
+                metrics.ghost_delta_ds = position.ghost_delta_ms / 100;
+            } else {
+                metrics.has_ghost = ghost_boat_update(distance_m, gps_data.timestamp_us, &ghost_delta);
+                metrics.ghost_delta_ds = metrics.has_ghost ? ghost_delta.delta_ms / 100 : 0;
+            }
+            if (course_event == COURSE_EVENT_START) {
+                DLOGI(TAG, "Course run started");
+            } else if (course_event == COURSE_EVENT_ABORT) {
+                DLOGI(TAG, "Course run abandoned at %.0f m", position.progress_m);
+            }
+            display_task_publish_metrics(&metrics);
+
+            record.type = DSP_RECORD_FIX;
+            record.timestamp_us = gps_data.timestamp_us;
+            record.fix.lat_e7 = gps_data.lat_e7;
+            record.fix.lon_e7 = gps_data.lon_e7;
+            record.fix.speed_mm_s = gps_data.speed_mm_s;
+            record.fix.split_ds = metrics.split_ds;
+            record.fix.distance_m = metrics.distance_m;
+            record.created_us = (uint32_t)timebase_now_us();
+            if (xQueueSend(dsp_record_queue, &record, 0) != pdTRUE) {
+                DLOG_RATE(ESP_LOG_WARN, TAG, DLOG_WARN_INTERVAL_MS, "Record queue full - dropping fix");
+            } else {
+                batch_notify_post(dsp_record_queue, logging_task_handle, LOG_BATCH_WATERMARK, false);
+            }
+
+            if (course_event == COURSE_EVENT_FINISH && course_get_result(&course_result)) {
+                record.type = DSP_RECORD_COURSE_FINISH;
+                record.course = course_result;
+                record.created_us = (uint32_t)timebase_now_us();
+                if (xQueueSend(dsp_record_queue, &record, 0) != pdTRUE) {
+                    DLOG_RATE(ESP_LOG_WARN, TAG, DLOG_WARN_INTERVAL_MS, "Record queue full - dropping course finish");
+                } else {
+                    batch_notify_post(dsp_record_queue, logging_task_handle, LOG_BATCH_WATERMARK, true);
+                }
+            }
+        }
+    }
+}
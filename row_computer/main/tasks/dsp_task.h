@@ -0,0 +1,44 @@
+#ifndef DSP_TASK
+#define DSP_TASK
+
+#include <stdint.h>
+#include "utils/course.h"
+#include "utils/stroke_profile.h"
+#include "utils/timebase.h"
+
+// Processed output handed from the DSP stage to storage/telemetry
+typedef enum {
+    DSP_RECORD_STROKE,
+    DSP_RECORD_FIX,
+    DSP_RECORD_STROKE_SHAPE,    // Previous stroke, closed by the catch of this one
+    DSP_RECORD_COURSE_FINISH,   // Course run completed (utils/course.h)
+} dsp_record_type_t;
+
+typedef struct {
+    dsp_record_type_t type;
+    timebase_us_t timestamp_us;
+    uint32_t created_us;                // Low 32 bits of the timebase when produced (latency only)
+    union {
+        struct {
+            float peak_g;               // Acceleration magnitude at the catch
+            uint16_t rate_spm;          // 0 until two strokes were seen
+            bool has_ghost;             // Ghost boat deltas below are valid
+            int16_t ghost_rate_delta_spm;
+            int16_t ghost_split_delta_ds;
+            int32_t ghost_delta_ms;     // Behind (+) / ahead (-) of the reference piece
+        } stroke;
+        struct {
+            int32_t lat_e7;             // 1e-7 degrees
+            int32_t lon_e7;
+            uint32_t speed_mm_s;
+            uint32_t split_ds;          // Time per 500m in deciseconds
+            uint32_t distance_m;
+        } fix;
+        stroke_shape_t shape;
+        course_result_t course;
+    };
+} dsp_record_t;
+
+void dsp_task(void *parameters);
+
+#endif
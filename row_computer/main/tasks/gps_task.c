@@ -5,6 +5,12 @@
 #include "config/common_constants.h"
 #include "sensors/gps.h"
 #include "sensors/sensors_common.h"
+#include "utils/power_governor.h"
+#include "utils/data_bus.h"
+#include "utils/sensor_health.h"
+#include "utils/deferred_log.h"
+#include "utils/stats.h"
+#include "utils/timebase.h"
 
 static const char *TAG = "GPS_TASK";
 
@@ -14,8 +20,9 @@ void gps_task(void *parameters) {
     gps_data_t gps_data;
     gps_health_t gps_health;
     uint32_t consecutive_failures = 0;
-    uint32_t total_reads = 0;
-    uint32_t successful_reads = 0;
+    stats_metric_t *reads = stats_register("gps.reads", STATS_COUNTER);
+    stats_metric_t *read_errors = stats_register("gps.read_errors", STATS_COUNTER);
+    stats_metric_t *fixes = stats_register("gps.fixes", STATS_COUNTER);
     
     // Add a startup delay to let GPS module settle
     ESP_LOGD(TAG, "Waiting for GPS module to initialize...");
@@ -29,50 +36,54 @@ void gps_task(void *parameters) {
     }
     
     while (1) {
-        total_reads++;
+        // Follow the power governor's navigation rate - queued, acknowledged while waiting below
+        gps_set_measurement_rate(power_governor_profile()->gps_period_ms);
+
+        stats_add(reads, 1);
         esp_err_t gps_err = gps_read(&gps_data);
+        timebase_us_t now_us = timebase_now_us();
+        sensor_health_read(HEALTH_GPS_POSITION, gps_err == ESP_OK, now_us);
+        sensor_health_read(HEALTH_GPS_SPEED, gps_err == ESP_OK, now_us);
         
         if (gps_err == ESP_OK) {
             consecutive_failures = 0;
-            successful_reads++;
+            if (gps_data.valid_fix) {
+                stats_add(fixes, 1);
+            }
             
             // Add timestamp
-            gps_data.timestamp_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+            gps_data.timestamp_us = now_us;
+
+            // Accuracy gates first: a fix that fails them reaches fusion after its event
+            gps_read_health(&gps_health);
+            sensor_health_gps_fix(&gps_data, &gps_health);
             
-            // Send to queue
-            if (xQueueSend(gps_data_queue, &gps_data, pdMS_TO_TICKS(TIMEOUT_QUEUE_MS)) != pdTRUE) {
-                ESP_LOGW(TAG, "Failed to send GPS data to queue");
-            }
+            // Publish to every subscriber (never blocks; slow readers lose their oldest fixes)
+            bus_publish(gps_topic, &gps_data, false);
 
-            // Log GPS status periodically with health data
+            // Log GPS status periodically with the receiver's accuracy estimates
             static int gps_log_counter = 0;
             if (++gps_log_counter >= GPS_LOG_INTERVAL) { // Every N successful reads
-                // Read health data for debug output
-                gps_read_health(&gps_health);
-
-                uint32_t success_rate = total_reads > 0 ? (successful_reads * 100) / total_reads : 0;
-
                 if (gps_data.valid_fix) {
-                    ESP_LOGI(TAG, "GPS Health - Fix: %lu%% | Sats: %d | Status: GOOD FIX | Pos: %.6f°, %.6f° | Speed: %.1f kts",
-                            success_rate, gps_data.satellites,
-                            gps_data.latitude, gps_data.longitude, gps_data.speed_knots);
+                    DLOGI(TAG, "GPS - Sats: %d | hAcc %.1f m | sAcc %.2f m/s | Pos: %.6f°, %.6f° | Speed: %.1f kts",
+                          gps_data.satellites, gps_health.horizontal_accuracy / 1000.0f,
+                          gps_health.speed_accuracy / 1000.0f,
+                          GPS_DEG(gps_data.lat_e7), GPS_DEG(gps_data.lon_e7), GPS_KNOTS(gps_data.speed_mm_s));
                 } else {
-                    ESP_LOGI(TAG, "GPS Health - Fix: %lu%% | Sats: %d | Status: NO FIX",
-                            success_rate, gps_data.satellites);
+                    DLOGI(TAG, "GPS - Sats: %d | NO FIX", gps_data.satellites);
                 }
                 gps_log_counter = 0;
             }
             
         } else {
             consecutive_failures++;
+            stats_add(read_errors, 1);
             
             // Log failures but don't spam
             if (consecutive_failures == 1) {
-                ESP_LOGW(TAG, "GPS read failed: %s", esp_err_to_name(gps_err));
+                DLOGW(TAG, "GPS read failed: %s", esp_err_to_name(gps_err));
             } else if (consecutive_failures % 30 == 0) { // Every 30 failures
-                ESP_LOGE(TAG, "GPS has failed %lu consecutive times. Check hardware!", consecutive_failures);
-                ESP_LOGE(TAG, "Success rate: %lu%% (%lu/%lu)", 
-                        (successful_reads * 100) / total_reads, successful_reads, total_reads);
+                DLOGE(TAG, "GPS has failed %lu consecutive times. Check hardware!", consecutive_failures);
                 
                 // Optionally run a debug session
                 ESP_LOGI(TAG, "Running GPS debug...");
@@ -80,7 +91,8 @@ void gps_task(void *parameters) {
             }
         }
         
-        // Standard GPS update rate
-        vTaskDelay(pdMS_TO_TICKS(GPS_TASK_PERIOD_MS));
+        // GPS update rate of the current power state, waited out on the UART so that
+        // outstanding commands keep their own deadlines
+        gps_wait_until(timebase_now_us() + (timebase_us_t)gps_measurement_period_ms() * 1000);
     }
 }
\ No newline at end of file
@@ -1,52 +1,242 @@
 #include "esp_log.h"
-#include "driver/i2c.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include <math.h>
 #include "tasks/tasks_common.h"
-#include "config/pin_definitions.h"
+#include "tasks/dsp_task.h"
 #include "config/common_constants.h"
-#include "sensors_common.h"
+#include "utils/batch_notify.h"
+#include "utils/course.h"
+#include "utils/event_capture.h"
+#include "utils/multirate.h"
+#include "utils/data_bus.h"
+#include "utils/power_governor.h"
+#include "utils/timebase.h"
+#include "utils/runtime_config.h"
+#include "storage/session_log.h"
+#include <string.h>
 
-// Data processing and logging task
+// Consumer-side latency and wakeup accounting
+typedef struct {
+    uint32_t wakeups;
+    uint32_t records;
+    uint32_t stroke_count;
+    uint64_t stroke_latency_total_us;
+    uint32_t stroke_latency_max_us;
+    uint32_t capture_samples;
+    uint32_t capture_unlogged;  // Capture samples released with no session open to take them
+    uint32_t card_errors;       // Failed session log flushes, syncs and closes
+} logging_stats_t;
+
+static const char *capture_trigger_names[CAPTURE_TRIGGER_COUNT] = { "stroke", "crab", "manual" };
+
+// Compact on-card form of a DSP record
+static void log_record(const dsp_record_t *record) {
+    switch (record->type) {
+        case DSP_RECORD_STROKE: {
+            session_stroke_t stroke = {
+                .peak_cg = (uint16_t)(record->stroke.peak_g * 100.0f),
+                .rate_spm = record->stroke.rate_spm,
+            };
+            session_log_append(SESSION_REC_STROKE, record->timestamp_us, &stroke, sizeof(stroke));
+            break;
+        }
+        case DSP_RECORD_FIX: {
+            session_fix_t fix = {
+                .lat_e7 = record->fix.lat_e7,
+                .lon_e7 = record->fix.lon_e7,
+                .speed_mm_s = record->fix.speed_mm_s,
+                .distance_m = record->fix.distance_m,
+                .split_ds = (uint16_t)record->fix.split_ds,
+            };
+            session_log_append(SESSION_REC_FIX, record->timestamp_us, &fix, sizeof(fix));
+            break;
+        }
+        case DSP_RECORD_STROKE_SHAPE:
+            session_log_append(SESSION_REC_STROKE_SHAPE, record->timestamp_us, &record->shape, sizeof(record->shape));
+            break;
+        case DSP_RECORD_COURSE_FINISH:
+            break;  // The run is in the fixes; the ghost is stored next to the sessions
+    }
+}
+
+static void log_summary(const imu_data_t *summary) {
+    session_summary_t out = {
+        .accel_mg = { (int16_t)(summary->accel_x * 1000.0f), (int16_t)(summary->accel_y * 1000.0f),
+                      (int16_t)(summary->accel_z * 1000.0f) },
+        .gyro_cdps = { (int16_t)(summary->gyro_x * 100.0f), (int16_t)(summary->gyro_y * 100.0f),
+                       (int16_t)(summary->gyro_z * 100.0f) },
+    };
+    session_log_append(SESSION_REC_SUMMARY, summary->timestamp_us, &out, sizeof(out));
+}
+
+// Samples of one SESSION_REC_CAPTURE record (the payload length is 8 bits)
+#define CAPTURE_RECORD_SAMPLES ((UINT8_MAX - sizeof(session_capture_t)) / sizeof(capture_sample_t))
+
+// Full time of a capture sample from its 16-bit millisecond stamp and a nearby
+// full time (the previous run, or the trigger for the first one)
+static timebase_us_t capture_sample_us(timebase_us_t near_us, const capture_sample_t *sample) {
+    int16_t offset_ms = (int16_t)(sample->timestamp_ms - (uint16_t)timebase_ms(near_us));
+    return near_us - near_us % 1000 + (timebase_us_t)((int64_t)offset_ms * 1000);
+}
+
+// Stream ready event-capture samples from the ring into the session log. Each
+// run is released only as far as the log took it: after a card error the rest
+// stays pinned for the next wakeup. With no session (or no card) open there is
+// nowhere to keep them, so they are let go rather than stall the producer.
+static void drain_event_capture(logging_stats_t *stats) {
+    static timebase_us_t run_us = 0;
+    const capture_sample_t *samples;
+    uint32_t first_seq;
+    capture_window_t window;
+    size_t count;
+    uint8_t record[sizeof(session_capture_t) + CAPTURE_RECORD_SAMPLES * sizeof(capture_sample_t)];
+
+    while ((count = event_capture_peek(&samples, &first_seq, &window)) > 0) {
+        if (first_seq == window.first_seq) {
+            ESP_LOGI("LOG_TASK", "Capture %lu (%s) at %lu ms: %lu samples in window",
+                    window.id, capture_trigger_names[window.trigger], timebase_ms(window.trigger_us),
+                    window.end_seq - window.first_seq);
+            run_us = window.trigger_us;
+        }
+
+        size_t taken = 0;
+        esp_err_t err = ESP_OK;
+        while (taken < count) {
+            size_t run = count - taken < CAPTURE_RECORD_SAMPLES ? count - taken : CAPTURE_RECORD_SAMPLES;
+            session_capture_t header = {
+                .window_id = window.id,
+                .first_seq = first_seq + taken,
+                .trigger = (uint8_t)window.trigger,
+                .flags = window.truncated ? SESSION_CAPTURE_TRUNCATED : 0,
+                .count = (uint8_t)run,
+            };
+            memcpy(record, &header, sizeof(header));
+            memcpy(record + sizeof(header), &samples[taken], run * sizeof(capture_sample_t));
+            timebase_us_t time_us = capture_sample_us(run_us, &samples[taken]);
+            err = session_log_append(SESSION_REC_CAPTURE, time_us, record,
+                                     (uint8_t)(sizeof(header) + run * sizeof(capture_sample_t)));
+            if (err != ESP_OK) {
+                break;
+            }
+            run_us = time_us;
+            taken += run;
+        }
+
+        if (err == ESP_ERR_INVALID_STATE) {
+            stats->capture_unlogged += count - taken;
+            taken = count;
+        }
+        stats->capture_samples += taken;
+        event_capture_release(taken);
+        if (taken < count) {
+            stats->card_errors++;
+            break;
+        }
+    }
+}
+
+// Storage/telemetry stage - consumes processed records from the DSP stage.
+// Sleeps until a batch is ready: strokes wake it immediately, other records
+// after LOG_BATCH_WATERMARK items or the configured latency bound.
 void logging_task(void *parameters) {
     ESP_LOGD("LOG_TASK", "Starting logging task");
-    
-    imu_data_t imu_data;
-    gps_data_t gps_data;
-    
+
+    dsp_record_t record;
+    imu_data_t summary;
+    logging_stats_t stats = {0};
+    uint32_t stats_start_ms = timebase_now_ms();
+    runtime_config_reader_t *config_reader = runtime_config_register_reader("log");
+
+    event_capture_set_consumer(xTaskGetCurrentTaskHandle());
+
+    // 1Hz anti-aliased motion summary for the session log
+    bus_subscriber_t *summary_sub = bus_subscribe(multirate_topic(MULTIRATE_1HZ), "log",
+                                                  xTaskGetCurrentTaskHandle(), 1);
+    if (summary_sub == NULL) {
+        ESP_LOGW("LOG_TASK", "No 1Hz motion summary - subscription failed");
+    }
+
     while (1) {
-        // Process IMU data (high frequency)
-        while (xQueueReceive(imu_data_queue, &imu_data, 0) == pdTRUE) {
-            // Here you would:
-            // 1. Apply filtering/calibration
-            // 2. Detect rowing strokes (to come later after more data)
-            // 3. Calculate boat motion metrics
-            // 4. Log to SD card
-            
-            // For now, just log interesting events
-            float accel_magnitude = sqrt(imu_data.accel_x * imu_data.accel_x + 
-                                       imu_data.accel_y * imu_data.accel_y + 
-                                       imu_data.accel_z * imu_data.accel_z);
-            
-            // Detect potential stroke (high acceleration event)
-            if (accel_magnitude > STROKE_DETECTION_THRESHOLD) {
-                ESP_LOGI("LOG_TASK", "Stroke detected: %.2fg at %lu ms",
-                        accel_magnitude, imu_data.timestamp_ms);
+        batch_notify_wait(runtime_config_quiescent(config_reader)->log_max_latency_ms);
+        stats.wakeups++;
+
+        while (xQueueReceive(dsp_record_queue, &record, 0) == pdTRUE) {
+            stats.records++;
+            log_record(&record);
+
+            switch (record.type) {
+                case DSP_RECORD_STROKE: {
+                    uint32_t latency_us = (uint32_t)timebase_now_us() - record.created_us;
+                    stats.stroke_count++;
+                    stats.stroke_latency_total_us += latency_us;
+                    if (latency_us > stats.stroke_latency_max_us) {
+                        stats.stroke_latency_max_us = latency_us;
+                    }
+                    if (record.stroke.has_ghost) {
+                        ESP_LOGI("LOG_TASK", "Stroke detected: %.2fg at %lu ms (%u spm) | ghost %+.1f s, %+d spm, "
+                                "split %+.1f s", record.stroke.peak_g, timebase_ms(record.timestamp_us),
+                                record.stroke.rate_spm, record.stroke.ghost_delta_ms / 1000.0f,
+                                record.stroke.ghost_rate_delta_spm, record.stroke.ghost_split_delta_ds / 10.0f);
+                    } else {
+                        ESP_LOGI("LOG_TASK", "Stroke detected: %.2fg at %lu ms (%u spm)",
+                                record.stroke.peak_g, timebase_ms(record.timestamp_us), record.stroke.rate_spm);
+                    }
+                    break;
+                }
+                case DSP_RECORD_FIX:
+                    ESP_LOGI("LOG_TASK", "GPS logged: %.6f,%.6f @ %.1f kts (%lu ms)",
+                            GPS_DEG(record.fix.lat_e7), GPS_DEG(record.fix.lon_e7),
+                            GPS_KNOTS(record.fix.speed_mm_s), timebase_ms(record.timestamp_us));
+                    break;
+                case DSP_RECORD_STROKE_SHAPE:
+                    ESP_LOGD("LOG_TASK", "Stroke shape @ %lu ms: drive %u/%u ms, peak %u%% %.2fg, check %.2fg, "
+                            "impulse %d mm/s, consistency %u%%", timebase_ms(record.timestamp_us), record.shape.drive_ms,
+                            record.shape.cycle_ms, record.shape.peak_pct, record.shape.peak_cg / 100.0f,
+                            record.shape.check_cg / 100.0f, record.shape.impulse_mm_s, record.shape.consistency_pct);
+                    break;
+                case DSP_RECORD_COURSE_FINISH:
+                    ESP_LOGI("LOG_TASK", "Course finished in %lu.%lu s%s", record.course.elapsed_ms / 1000,
+                            record.course.elapsed_ms % 1000 / 100, record.course.new_best ? " - new best" : "");
+                    if (record.course.new_best && course_save_ghost(COURSE_GHOST_PATH) != ESP_OK) {
+                        ESP_LOGW("LOG_TASK", "Ghost not saved");
+                    }
+                    break;
             }
         }
-        
-        // Process GPS data (low frequency)
-        if (xQueueReceive(gps_data_queue, &gps_data, 0) == pdTRUE) {
-            if (gps_data.valid_fix) {
-                // Calculate distance, track boat path, etc.
-                ESP_LOGI("LOG_TASK", "GPS logged: %.6f,%.6f @ %.1f kts (%lu ms)",
-                        gps_data.latitude, gps_data.longitude, 
-                        gps_data.speed_knots, gps_data.timestamp_ms);
+
+        while (summary_sub != NULL && bus_receive(summary_sub, &summary)) {
+            log_summary(&summary);
+            ESP_LOGD("LOG_TASK", "Motion 1Hz @ %lu ms: a=(%.2f,%.2f,%.2f)g g=(%.1f,%.1f,%.1f)dps",
+                    timebase_ms(summary.timestamp_us), summary.accel_x, summary.accel_y, summary.accel_z,
+                    summary.gyro_x, summary.gyro_y, summary.gyro_z);
+        }
+
+        // Everything else is logged at the decimated record rate above
+        drain_event_capture(&stats);
+
+        // Pieces end after a pause; the session ends when the boat goes to sleep
+        uint32_t now_ms = timebase_now_ms();
+        esp_err_t card_err = power_governor_state() == POWER_STATE_SLEEP ? session_log_close(now_ms)
+                                                                          : session_log_tick(now_ms);
+        stats.card_errors += card_err != ESP_OK;
+
+        uint32_t elapsed_ms = now_ms - stats_start_ms;
+        if (elapsed_ms >= LOG_STATS_INTERVAL_MS) {
+            ESP_LOGI("LOG_TASK", "Consumer - Wakeups: %lu/s | Records: %lu | Stroke latency avg: %lu us, max: %lu us",
+                    stats.wakeups * 1000 / elapsed_ms, stats.records,
+                    stats.stroke_count > 0 ? (uint32_t)(stats.stroke_latency_total_us / stats.stroke_count) : 0,
+                    stats.stroke_latency_max_us);
+            if (stats.card_errors > 0) {
+                ESP_LOGW("LOG_TASK", "SD card - %lu failed flushes/syncs (data kept queued)", stats.card_errors);
             }
+            capture_stats_t capture;
+            event_capture_get_stats(&capture);
+            ESP_LOGI("LOG_TASK", "Capture - Windows: %lu (%lu merged, %lu dropped) | Streamed: %lu samples "
+                    "(%lu unlogged) | Overruns: %lu",
+                    capture.windows, capture.retriggers, capture.dropped, stats.capture_samples,
+                    stats.capture_unlogged, capture.overruns);
+            stats = (logging_stats_t){0};
+            stats_start_ms = now_ms;
         }
-        
-        // Run at moderate frequency to process queued data
-        vTaskDelay(pdMS_TO_TICKS(LOG_TASK_PERIOD_MS));
     }
-}
\ No newline at end of file
+}
@@ -6,6 +6,17 @@
 #include "config/pin_definitions.h"
 #include "config/common_constants.h"
 #include "sensors_common.h"
+#include "sensors/imu.h"
+#include "utils/power_governor.h"
+#include "utils/batch_notify.h"
+#include "utils/event_capture.h"
+#include "utils/multirate.h"
+#include "utils/i2c_bus.h"
+#include "utils/deferred_log.h"
+#include "utils/stats.h"
+#include "utils/timebase.h"
+#include "utils/runtime_config.h"
+#include "utils/sensor_health.h"
 
 // High-frequency IMU task - combines all motion sensors
 void imu_task(void *parameters) {
@@ -13,61 +24,116 @@ void imu_task(void *parameters) {
 
     imu_data_t imu_data;
     mpu6050_data_t mpu_data;
+    imu_fifo_t fifo;
     TickType_t last_wake_time = xTaskGetTickCount();
-    static uint32_t health_counter = 0;
+    uint32_t bus_log_counter = 0;
 
-    // Health tracking counters
-    static uint32_t mpu_total_reads = 0;
-    static uint32_t mpu_successful_reads = 0;
-    static uint32_t mag_total_reads = 0;
-    static uint32_t mag_successful_reads = 0;
+    // Read counters (exported through the stats registry); per-sample checks in sensor_health
+    stats_metric_t *imu_reads = stats_register("imu.reads", STATS_COUNTER);
+    stats_metric_t *imu_errors = stats_register("imu.read_errors", STATS_COUNTER);
+    stats_metric_t *imu_burst = stats_register("imu.burst_samples", STATS_HISTOGRAM);
+    stats_metric_t *mag_reads = stats_register("mag.reads", STATS_COUNTER);
+    stats_metric_t *mag_errors = stats_register("mag.read_errors", STATS_COUNTER);
+    bool wom_armed = false;
+    uint32_t sample_counter = 0;
+    esp_err_t mag_err = ESP_OK;
+    runtime_config_reader_t *config_reader = runtime_config_register_reader("imu");
+    const runtime_config_t *applied_config = NULL;
 
     while (1) {
-        // Read MPU6050 data (accelerometer + gyroscope) in one efficient operation
-        esp_err_t mpu_err = mpu6050_read_all(&mpu_data);
-        esp_err_t mag_err = mag_read(&imu_data.mag_x, &imu_data.mag_y, &imu_data.mag_z);
+        // Safe point for configuration changes: rates and thresholds switch here,
+        // between two reads
+        const runtime_config_t *config = runtime_config_quiescent(config_reader);
+        if (config != applied_config) {
+            power_governor_apply_config(config);
+            event_capture_set_crab_threshold(config->crab_gyro_dps);
+            applied_config = config;
+        }
+
+        // Sleeping: the IMU is in wake-on-motion, block until its interrupt fires
+        if (power_governor_profile()->imu_period_ms == 0) {
+            if (!wom_armed) {
+                wom_armed = power_governor_arm_wake_on_motion() == ESP_OK;
+            }
+            // Never sleep without a working wake source
+            if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GOV_SLEEP_POLL_MS)) > 0 || !wom_armed) {
+                power_governor_disarm_wake_on_motion();
+                wom_armed = false;
+                power_governor_wake(timebase_now_ms());
+                last_wake_time = xTaskGetTickCount();
+            }
+            continue;
+        }
+
+        // Acquisition period selects where samples enter the decimation tree
+        uint16_t period_ms = power_governor_profile()->imu_period_ms;
+        multirate_set_input(multirate_stream_for_period(period_ms));
+
+        // Drain the IMU: one sample from register backends, everything queued
+        // since the last wakeup (thinned to this state's rate) from FIFO backends
+        esp_err_t imu_err = imu_read(&fifo, 1000 / period_ms);
 
         // Update health tracking counters
-        mpu_total_reads++;
-        if (mpu_err == ESP_OK) {
-            mpu_successful_reads++;
+        timebase_us_t now_us = timebase_now_us();
+        stats_add(imu_reads, 1);
+        if (imu_err == ESP_OK) {
+            stats_observe(imu_burst, fifo.count);
+        } else {
+            stats_add(imu_errors, 1);
         }
+        sensor_health_read(HEALTH_ACCEL, imu_err == ESP_OK, now_us);
+        sensor_health_read(HEALTH_GYRO, imu_err == ESP_OK, now_us);
 
-        mag_total_reads++;
-        if (mag_err == ESP_OK) {
-            mag_successful_reads++;
+        // Magnetometer is far slower than the MPU - read every MAG_READ_PERIOD_MS, hold between
+        uint32_t mag_divider = period_ms < MAG_READ_PERIOD_MS ? MAG_READ_PERIOD_MS / period_ms : 1;
+        if (sample_counter++ % mag_divider == 0) {
+            mag_err = mag_read(&imu_data.mag_x, &imu_data.mag_y, &imu_data.mag_z);
+            stats_add(mag_reads, 1);
+            if (mag_err != ESP_OK) {
+                stats_add(mag_errors, 1);
+            } else {
+                sensor_health_mag_sample(imu_data.mag_x, imu_data.mag_y, imu_data.mag_z, now_us);
+            }
+            sensor_health_read(HEALTH_MAG, mag_err == ESP_OK, now_us);
         }
 
-        // Copy MPU6050 data to IMU structure
-        if (mpu_err == ESP_OK) {
+        // Samples are period_ms apart, the newest one is from now
+        for (uint16_t i = 0; imu_err == ESP_OK && i < fifo.count; i++) {
+            imu_sample(&fifo, i, &mpu_data);
             imu_data.accel_x = mpu_data.accel_x;
             imu_data.accel_y = mpu_data.accel_y;
             imu_data.accel_z = mpu_data.accel_z;
             imu_data.gyro_x = mpu_data.gyro_x;
             imu_data.gyro_y = mpu_data.gyro_y;
             imu_data.gyro_z = mpu_data.gyro_z;
-            imu_data.timestamp_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+            imu_data.timestamp_us = now_us - (timebase_us_t)(fifo.count - 1 - i) * period_ms * 1000;
+
+            // Full-resolution copy for event capture (pre-trigger ring)
+            event_capture_push(&mpu_data.raw, imu_data.timestamp_us);
+            sensor_health_imu_sample(&mpu_data.raw, imu_data.timestamp_us);
+
+            // Publish every rate to its bus topic (non-blocking to maintain timing)
+            uint32_t produced = multirate_push(&imu_data);
 
-            // Send to queue (non-blocking to maintain timing)
-            if (xQueueSend(imu_data_queue, &imu_data, 0) != pdTRUE) {
-                ESP_LOGW("IMU_TASK", "Queue full - dropping IMU sample");
+            // Governor smoothing is tuned for 100Hz - feed it the anti-aliased stream
+            if (produced & MULTIRATE_BIT(MULTIRATE_100HZ)) {
+                const imu_data_t *governed = multirate_latest(MULTIRATE_100HZ);
+                power_governor_update(governed->accel_x, governed->accel_y, governed->accel_z,
+                                      governed->gyro_x, governed->gyro_y, governed->gyro_z,
+                                      timebase_ms(imu_data.timestamp_us));
             }
-        } else {
-            ESP_LOGW("IMU_TASK", "Failed to read MPU6050: %s", esp_err_to_name(mpu_err));
         }
 
-        // Log sensor health periodically
-        if (++health_counter >= SENSOR_HEALTH_LOG_INTERVAL) {
-            uint32_t mpu_success_rate = mpu_total_reads > 0 ? (mpu_successful_reads * 100) / mpu_total_reads : 0;
-            uint32_t mag_success_rate = mag_total_reads > 0 ? (mag_successful_reads * 100) / mag_total_reads : 0;
-
-            ESP_LOGI("IMU_TASK", "IMU Health - MPU6050: %lu%% (%s) | Mag: %lu%% (%s)",
-                    mpu_success_rate, (mpu_err == ESP_OK) ? "OK" : "FAIL",
-                    mag_success_rate, (mag_err == ESP_OK) ? "OK" : "FAIL");
-            health_counter = 0;
+        // Bus error counters periodically (sensor health reports its own changes)
+        if (++bus_log_counter >= I2C_STATS_LOG_INTERVAL) {
+            i2c_bus_log_stats();
+            bus_log_counter = 0;
         }
 
-        // Maintain exact timing using common constants
-        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(IMU_TASK_PERIOD_MS));
+        // Maintain exact timing at the rate of the current power state
+        period_ms = power_governor_profile()->imu_period_ms;
+        if (period_ms > 0) {
+            vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(period_ms));
+        }
     }
 }
\ No newline at end of file
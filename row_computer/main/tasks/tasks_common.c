@@ -8,84 +8,111 @@
 #include "sensors_common.h"
 #include "utils/error_utils.h"
 #include "utils/boot_progress.h"
+#include "display/display.h"
+#include "utils/deferred_log.h"
+#include "storage/session_transfer.h"
+#include "utils/stats.h"
+#include "utils/runtime_config.h"
+#include <stddef.h>
 
 static const char *TAG = "TASKS_COMMON";
 
-// Create inter-task communication queues
+typedef struct {
+    TaskFunction_t function;
+    const char *name;
+    const char *label;              // Boot progress item name
+    uint32_t stack_size;
+    UBaseType_t priority;
+    size_t priority_config;         // runtime_config_t field that replaces priority (FIXED_PRIORITY: none)
+    BaseType_t core;
+    TaskHandle_t *handle;
+    bool (*enabled)(void);          // NULL = always created
+} task_stage_t;
+
+#define FIXED_PRIORITY          SIZE_MAX
+#define CONFIG_PRIORITY(field)  offsetof(runtime_config_t, field)
+
+// Pipeline stage layout - re-balance cores and priorities here.
+// Consumers are listed first so producers never notify a task that does not exist yet.
+static const task_stage_t task_layout[] = {
+    // Storage / telemetry / UI (low priority)
+    { deferred_log_task,     "DLOG_TASK",    "Deferred log",     DLOG_TASK_STACK_SIZE,     DLOG_TASK_PRIORITY,     FIXED_PRIORITY,                      STORAGE_CORE,     &dlog_task_handle,     NULL },
+    { logging_task,          "LOG_TASK",     "LOG task",         LOG_TASK_STACK_SIZE,      LOG_TASK_PRIORITY,      CONFIG_PRIORITY(log_task_priority),  STORAGE_CORE,     &logging_task_handle,  NULL },
+    { display_task,          "DISPLAY_TASK", "Display task",     DISPLAY_TASK_STACK_SIZE,  DISPLAY_TASK_PRIORITY,  FIXED_PRIORITY,                      STORAGE_CORE,     &display_task_handle,  display_is_ready },
+    { session_transfer_task, "XFER_TASK",    "Session download", TRANSFER_TASK_STACK_SIZE, TRANSFER_TASK_PRIORITY, FIXED_PRIORITY,                      STORAGE_CORE,     &transfer_task_handle, session_transfer_is_ready },
+    // Processing (DSP / fusion / stroke detection)
+    { dsp_task,              "DSP_TASK",     "DSP task",         DSP_TASK_STACK_SIZE,      DSP_TASK_PRIORITY,      CONFIG_PRIORITY(dsp_task_priority),  PROCESSING_CORE,  &dsp_task_handle,      NULL },
+    // Acquisition
+    { imu_task,              "IMU_TASK",     "IMU task",         IMU_TASK_STACK_SIZE,      IMU_TASK_PRIORITY,      CONFIG_PRIORITY(imu_task_priority),  ACQUISITION_CORE, &imu_task_handle,      NULL },
+    { gps_task,              "GPS_TASK",     "GPS task",         GPS_TASK_STACK_SIZE,      GPS_TASK_PRIORITY,      FIXED_PRIORITY,                      ACQUISITION_CORE, &gps_task_handle,      NULL },
+};
+
+// Depth of the FreeRTOS queues (bus topics report their own readers)
+static void collect_queue_stats(void) {
+    static stats_metric_t *dsp_records;
+    if (dsp_records == NULL) {
+        dsp_records = stats_register("queue.dsp_record", STATS_GAUGE);
+    }
+    stats_set(dsp_records, dsp_record_queue != NULL ? (int32_t)uxQueueMessagesWaiting(dsp_record_queue) : 0);
+}
+
+// Create inter-task communication topics and queues.
+// IMU topics belong to the decimation tree (multirate_init).
 esp_err_t create_inter_task_comm(void){
-    imu_data_queue = xQueueCreate(IMU_QUEUE_SIZE, sizeof(imu_data_t));
-    gps_data_queue = xQueueCreate(GPS_QUEUE_SIZE, sizeof(gps_data_t));
+    gps_topic = bus_topic_create("gps", sizeof(gps_data_t), GPS_TOPIC_DEPTH);
+    dsp_record_queue = xQueueCreate(runtime_config_boot()->dsp_record_queue_size, sizeof(dsp_record_t));
 
-    if (imu_data_queue == NULL) {
-        boot_progress_failure(BOOT_QUEUES, "IMU queue", "Creation failed");
+    if (gps_topic == NULL) {
+        boot_progress_failure(BOOT_QUEUES, "GPS topic", "Creation failed");
         return ESP_FAIL;
     } else {
-        boot_progress_success(BOOT_QUEUES, "IMU queue");
+        boot_progress_success(BOOT_QUEUES, "GPS topic");
     }
 
-    if (gps_data_queue == NULL) {
-        boot_progress_failure(BOOT_QUEUES, "GPS queue", "Creation failed");
+    if (dsp_record_queue == NULL) {
+        boot_progress_failure(BOOT_QUEUES, "DSP queue", "Creation failed");
         return ESP_FAIL;
     } else {
-        boot_progress_success(BOOT_QUEUES, "GPS queue");
+        boot_progress_success(BOOT_QUEUES, "DSP queue");
     }
+    stats_register_collector(collect_queue_stats);
 
     boot_progress_report_category(BOOT_QUEUES, "QUEUES");
     return ESP_OK;
 }
 
-// Create sensor tasks with appropriate priorities
+// Create pipeline tasks from the stage layout
 esp_err_t create_tasks(void){
-    BaseType_t result;
+    for (size_t i = 0; i < sizeof(task_layout) / sizeof(task_layout[0]); i++) {
+        const task_stage_t *stage = &task_layout[i];
 
-    result = xTaskCreatePinnedToCore(
-        imu_task,
-        "IMU_TASK",
-        IMU_TASK_STACK_SIZE,
-        NULL,
-        IMU_TASK_PRIORITY,
-        &imu_task_handle,
-        1                   // Pin to core 1 (app core)
-    );
-    if (result != pdPASS) {
-        boot_progress_failure(BOOT_TASKS, "IMU task", "Creation failed");
-        return ESP_FAIL;
-    } else {
-        boot_progress_success(BOOT_TASKS, "IMU task");
-    }
+        if (stage->enabled != NULL && !stage->enabled()) {
+            ESP_LOGD(TAG, "Skipping %s (disabled)", stage->name);
+            continue;
+        }
 
-    result = xTaskCreatePinnedToCore(
-        gps_task,
-        "GPS_TASK",
-        GPS_TASK_STACK_SIZE,
-        NULL,
-        GPS_TASK_PRIORITY,
-        &gps_task_handle,
-        1                   // Pin to core 1
-    );
-    if (result != pdPASS) {
-        boot_progress_failure(BOOT_TASKS, "GPS task", "Creation failed");
-        return ESP_FAIL;
-    } else {
-        boot_progress_success(BOOT_TASKS, "GPS task");
-    }
+        UBaseType_t priority = stage->priority;
+        if (stage->priority_config != FIXED_PRIORITY) {
+            priority = *(const uint32_t *)((const uint8_t *)runtime_config_boot() + stage->priority_config);
+        }
 
-    result = xTaskCreatePinnedToCore(
-        logging_task,
-        "LOG_TASK",
-        LOG_TASK_STACK_SIZE,
-        NULL,
-        LOG_TASK_PRIORITY,
-        &logging_task_handle,
-        0                   // Pin to core 0 (protocol core)
-    );
-    if (result != pdPASS) {
-        boot_progress_failure(BOOT_TASKS, "LOG task", "Creation failed");
-        return ESP_FAIL;
-    } else {
-        boot_progress_success(BOOT_TASKS, "LOG task");
+        BaseType_t result = xTaskCreatePinnedToCore(
+            stage->function,
+            stage->name,
+            stage->stack_size,
+            NULL,
+            priority,
+            stage->handle,
+            stage->core
+        );
+        if (result != pdPASS) {
+            boot_progress_failure(BOOT_TASKS, stage->label, "Creation failed");
+            return ESP_FAIL;
+        } else {
+            boot_progress_success(BOOT_TASKS, stage->label);
+        }
     }
 
     boot_progress_report_category(BOOT_TASKS, "TASKS");
     return ESP_OK;
-}
\ No newline at end of file
+}
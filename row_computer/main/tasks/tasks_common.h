@@ -6,11 +6,15 @@
 #include "freertos/queue.h"
 #include "sensors/sensors_common.h"
 #include "sensors/gps.h"
+#include "tasks/dsp_task.h"
+#include "utils/data_bus.h"
 
 // Task function declarations
 void imu_task(void *parameters);
 void gps_task(void *parameters);
+void dsp_task(void *parameters);
 void logging_task(void *parameters);
+void display_task(void *parameters);
 
 // Task management functions
 esp_err_t create_tasks(void);
@@ -19,10 +23,15 @@ esp_err_t create_inter_task_comm(void);
 // Global task handles (extern declarations for use in other files)
 extern TaskHandle_t imu_task_handle;
 extern TaskHandle_t gps_task_handle;
+extern TaskHandle_t dsp_task_handle;
 extern TaskHandle_t logging_task_handle;
+extern TaskHandle_t display_task_handle;
+extern TaskHandle_t dlog_task_handle;
+extern TaskHandle_t transfer_task_handle;
 
-// Global queue handles (extern declarations for use in other files)
-extern QueueHandle_t imu_data_queue;
-extern QueueHandle_t gps_data_queue;
+// Global topics and queues (extern declarations for use in other files).
+// IMU streams are the multi-rate topics, see multirate_topic().
+extern bus_topic_t *gps_topic;
+extern QueueHandle_t dsp_record_queue;
 
 #endif
\ No newline at end of file
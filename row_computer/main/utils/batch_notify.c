@@ -0,0 +1,30 @@
+#include "batch_notify.h"
+
+void batch_notify_post(QueueHandle_t queue, TaskHandle_t consumer, UBaseType_t watermark, bool urgent) {
+    if (consumer == NULL) {
+        return;
+    }
+
+    batch_notify_signal(consumer, uxQueueMessagesWaiting(queue), watermark, urgent);
+}
+
+void batch_notify_signal(TaskHandle_t consumer, uint32_t depth, uint32_t watermark, bool urgent) {
+    if (urgent || depth >= watermark) {
+        xTaskNotify(consumer, BATCH_NOTIFY_FLUSH, eSetBits);
+    } else if (depth == 1) {
+        xTaskNotify(consumer, BATCH_NOTIFY_FIRST, eSetBits);
+    }
+}
+
+uint32_t batch_notify_wait(uint32_t max_latency_ms) {
+    uint32_t bits = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+
+    // Only the first item so far - hold on until the watermark or the latency bound
+    if (!(bits & BATCH_NOTIFY_FLUSH) && max_latency_ms > 0) {
+        uint32_t more = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &more, pdMS_TO_TICKS(max_latency_ms));
+        bits |= more;
+    }
+    return bits;
+}
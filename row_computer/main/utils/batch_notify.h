@@ -0,0 +1,26 @@
+#ifndef BATCH_NOTIFY_H
+#define BATCH_NOTIFY_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Notification bits used between a producer and its consumer task
+#define BATCH_NOTIFY_FIRST      (1UL << 0)  // Queue went from empty to non-empty
+#define BATCH_NOTIFY_FLUSH      (1UL << 1)  // Watermark reached or urgent item queued
+
+// Call after a successful xQueueSend. Wakes the consumer immediately for urgent
+// items or once the queue holds watermark items; otherwise only the first item
+// of a batch is signalled so the consumer can arm its max-latency timer.
+void batch_notify_post(QueueHandle_t queue, TaskHandle_t consumer, UBaseType_t watermark, bool urgent);
+
+// Same policy for any buffer: depth is the number of items now waiting for consumer
+void batch_notify_signal(TaskHandle_t consumer, uint32_t depth, uint32_t watermark, bool urgent);
+
+// Block the calling consumer until a batch is ready: a flush request, or
+// max_latency_ms after the first item arrived. Returns the notification bits.
+uint32_t batch_notify_wait(uint32_t max_latency_ms);
+
+#endif // BATCH_NOTIFY_H
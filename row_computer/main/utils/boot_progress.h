@@ -8,6 +8,7 @@
 typedef enum {
     BOOT_PROTOCOLS,
     BOOT_SENSORS,
+    BOOT_PERIPHERALS,
     BOOT_QUEUES,
     BOOT_TASKS,
     BOOT_CATEGORY_MAX
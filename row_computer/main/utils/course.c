@@ -0,0 +1,681 @@
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "config/common_constants.h"
+#include "course.h"
+#include "geo.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "COURSE";
+
+#define GHOST_MAGIC         0x4743  // "CG"
+#define GHOST_VERSION       1
+#define HISTORY_FIXES       8       // Matched fixes kept for course_position_at (0.7s at 10Hz)
+#define LINE_MAX_CHARS      96
+
+typedef struct {
+    float x;                        // East of the start (m)
+    float y;                        // North of the start (m)
+    float s;                        // Along the course up to here (m)
+} course_point_t;
+
+typedef struct {
+    float s;
+    char label[COURSE_LABEL_MAX];
+} course_marker_t;
+
+typedef struct {
+    float distance;                 // From the course line
+    float cross;                    // Signed, positive to the right
+    float s;
+} course_match_t;
+
+typedef struct {
+    timebase_us_t timestamp_us;
+    float s;
+} course_history_t;
+
+// Ghost file: header, then one u32 elapsed time per step
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t step_m;
+    uint32_t steps;
+    float length_m;
+    uint32_t total_ms;
+} ghost_header_t;
+
+// Geometry
+static geo_ltp_t ltp;
+static course_point_t *points = NULL;
+static uint32_t point_count = 0;
+static course_marker_t markers[COURSE_MAX_MARKERS];
+static uint32_t marker_count = 0;
+static float length_m = 0.0f;
+
+// Segment grid: the segments touching cell c are cell_segments[cell_start[c] .. cell_start[c + 1])
+static float grid_x0, grid_y0, cell_m;
+static uint32_t grid_cols, grid_rows;
+static uint32_t *cell_start = NULL;
+static uint16_t *cell_segments = NULL;
+
+// Ghost and the run being recorded - swapped when a run beats the ghost
+static uint32_t *ghost = NULL;
+static uint32_t *run = NULL;
+static uint32_t step_count = 0;
+static bool have_ghost = false;
+
+// Tracking
+static course_state_t state = COURSE_NONE;
+static course_history_t history[HISTORY_FIXES];
+static uint32_t history_count = 0;
+static uint32_t history_head = 0;
+static float speed_m_s = 0.0f;      // Along the course
+static float last_cross_m = 0.0f;
+static float fix_x, fix_y;          // Previous fix, matched or not (direction of motion)
+static timebase_us_t fix_us = 0;
+static bool have_fix = false;
+static timebase_us_t lost_us = 0;
+static int16_t next_marker = 0;
+
+// Run
+static bool running = false;
+static timebase_us_t start_us = 0;
+static uint32_t next_step = 0;
+static timebase_us_t run_last_us = 0;
+static float run_last_s = 0.0f;
+static bool have_run_last = false;
+static course_result_t result;
+static bool have_result = false;
+
+static course_stats_t stats;
+
+static float step_position(uint32_t step) {
+    return fminf((float)step * COURSE_GHOST_STEP_M, length_m);
+}
+
+// Closest point of segment i. The first and last segment continue straight on,
+// so positions before the start and past the finish have a progress too.
+static void project(uint32_t i, float x, float y, course_match_t *m) {
+    const course_point_t *a = &points[i];
+    const course_point_t *b = &points[i + 1];
+    float dx = b->x - a->x;
+    float dy = b->y - a->y;
+    float length = b->s - a->s;
+    float px = x - a->x;
+    float py = y - a->y;
+    float t = (px * dx + py * dy) / (length * length);
+    if (t < 0.0f && i > 0) {
+        t = 0.0f;
+    } else if (t > 1.0f && i + 2 < point_count) {
+        t = 1.0f;
+    }
+    float ex = px - t * dx;
+    float ey = py - t * dy;
+    m->distance = sqrtf(ex * ex + ey * ey);
+    m->cross = copysignf(m->distance, px * dy - py * dx);
+    m->s = a->s + t * length;
+}
+
+static uint32_t cell_of(float x, float y, int32_t *col, int32_t *row) {
+    *col = (int32_t)floorf((x - grid_x0) / cell_m);
+    *row = (int32_t)floorf((y - grid_y0) / cell_m);
+    return (uint32_t)*row * grid_cols + (uint32_t)*col;
+}
+
+// Cells a segment passes through (cells whose centre is within half a diagonal)
+static void segment_cells(uint32_t i, void (*visit)(uint32_t cell, uint32_t segment)) {
+    const course_point_t *a = &points[i];
+    const course_point_t *b = &points[i + 1];
+    int32_t col0, row0, col1, row1;
+    cell_of(fminf(a->x, b->x), fminf(a->y, b->y), &col0, &row0);
+    cell_of(fmaxf(a->x, b->x), fmaxf(a->y, b->y), &col1, &row1);
+    float reach = cell_m * 0.7072f;
+
+    for (int32_t row = row0; row <= row1; row++) {
+        for (int32_t col = col0; col <= col1; col++) {
+            float cx = grid_x0 + (col + 0.5f) * cell_m;
+            float cy = grid_y0 + (row + 0.5f) * cell_m;
+            course_match_t m;
+            project(i, cx, cy, &m);
+            // project() extends the end segments - keep those cells near the segment itself
+            bool inside = m.s >= a->s - reach && m.s <= b->s + reach;
+            if (inside && m.distance <= reach) {
+                visit((uint32_t)row * grid_cols + (uint32_t)col, i);
+            }
+        }
+    }
+}
+
+static void count_cell(uint32_t cell, uint32_t segment) {
+    cell_start[cell]++;
+}
+
+static void fill_cell(uint32_t cell, uint32_t segment) {
+    cell_segments[--cell_start[cell]] = (uint16_t)segment;
+}
+
+// Uniform grid over the course. Cells are at least the match radius wide, so any
+// segment within reach of a fix touches one of the 3x3 cells around it.
+static esp_err_t build_grid(void) {
+    float min_x = points[0].x, max_x = points[0].x;
+    float min_y = points[0].y, max_y = points[0].y;
+    for (uint32_t i = 1; i < point_count; i++) {
+        min_x = fminf(min_x, points[i].x);
+        max_x = fmaxf(max_x, points[i].x);
+        min_y = fminf(min_y, points[i].y);
+        max_y = fmaxf(max_y, points[i].y);
+    }
+    float width = max_x - min_x + 2 * COURSE_MATCH_RADIUS_M;
+    float height = max_y - min_y + 2 * COURSE_MATCH_RADIUS_M;
+    cell_m = fmaxf(COURSE_GRID_CELL_M, sqrtf(width * height / COURSE_GRID_MAX_CELLS));
+    grid_x0 = min_x - COURSE_MATCH_RADIUS_M;
+    grid_y0 = min_y - COURSE_MATCH_RADIUS_M;
+    grid_cols = (uint32_t)(width / cell_m) + 1;
+    grid_rows = (uint32_t)(height / cell_m) + 1;
+    uint32_t cells = grid_cols * grid_rows;
+
+    cell_start = heap_caps_calloc(cells + 1, sizeof(uint32_t), MALLOC_CAP_8BIT);
+    if (cell_start == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Count per cell, turn the counts into cell ends, then fill backwards so every
+    // cell_start ends up at its first entry
+    for (uint32_t i = 0; i + 1 < point_count; i++) {
+        segment_cells(i, count_cell);
+    }
+    uint32_t total = 0;
+    for (uint32_t c = 0; c < cells; c++) {
+        if (cell_start[c] > stats.max_cell_segments) {
+            stats.max_cell_segments = cell_start[c];
+        }
+        total += cell_start[c];
+        cell_start[c] = total;
+    }
+    cell_start[cells] = total;
+
+    cell_segments = heap_caps_malloc((total > 0 ? total : 1) * sizeof(uint16_t), MALLOC_CAP_8BIT);
+    if (cell_segments == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t i = 0; i + 1 < point_count; i++) {
+        segment_cells(i, fill_cell);
+    }
+
+    stats.grid_cells = cells;
+    stats.grid_entries = total;
+    return ESP_OK;
+}
+
+static esp_err_t parse_course(FILE *f, bool fill, uint32_t *count, int32_t marker_e7[][2]) {
+    char line[LINE_MAX_CHARS];
+    uint32_t line_number = 0;
+    *count = 0;
+    marker_count = 0;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char kind;
+        double lat, lon;
+        char label[COURSE_LABEL_MAX] = "";
+        line_number++;
+        int fields = sscanf(line, " %c %lf %lf %11s", &kind, &lat, &lon, label);  // COURSE_LABEL_MAX - 1
+        if (fields <= 0 || kind == '#') {
+            continue;
+        }
+        if (fields < 3 || fabs(lat) > 90.0 || fabs(lon) > 180.0 || (kind != 'P' && kind != 'M')) {
+            ESP_LOGE(TAG, "Bad course line %lu", (unsigned long)line_number);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        int32_t lat_e7 = (int32_t)lround(lat * 1e7);
+        int32_t lon_e7 = (int32_t)lround(lon * 1e7);
+        if (kind == 'M') {
+            if (marker_count < COURSE_MAX_MARKERS) {
+                marker_e7[marker_count][0] = lat_e7;
+                marker_e7[marker_count][1] = lon_e7;
+                memcpy(markers[marker_count].label, label, sizeof(label));
+                marker_count++;
+            }
+            continue;
+        }
+
+        if (!fill) {
+            (*count)++;
+            continue;
+        }
+        if (*count == 0) {
+            geo_ltp_init(&ltp, lat_e7, lon_e7);
+        }
+        course_point_t *point = &points[*count];
+        geo_ltp_project(&ltp, lat_e7, lon_e7, &point->x, &point->y);
+        if (*count > 0) {
+            const course_point_t *prev = &points[*count - 1];
+            float step = hypotf(point->x - prev->x, point->y - prev->y);
+            if (step < 0.01f) {
+                continue;   // Repeated vertex - no zero-length segments
+            }
+            point->s = prev->s + step;
+        } else {
+            point->s = 0.0f;
+        }
+        (*count)++;
+    }
+    return ESP_OK;
+}
+
+// Markers sit at the progress of their nearest course point (load time only)
+static void place_markers(int32_t marker_e7[][2]) {
+    for (uint32_t m = 0; m < marker_count; m++) {
+        float x, y;
+        course_match_t best = { .distance = INFINITY };
+        geo_ltp_project(&ltp, marker_e7[m][0], marker_e7[m][1], &x, &y);
+        for (uint32_t i = 0; i + 1 < point_count; i++) {
+            course_match_t match;
+            project(i, x, y, &match);
+            if (match.distance < best.distance) {
+                best = match;
+            }
+        }
+        markers[m].s = fminf(fmaxf(best.s, 0.0f), length_m);
+    }
+
+    // Insertion sort by progress (a few dozen at most)
+    for (uint32_t i = 1; i < marker_count; i++) {
+        course_marker_t marker = markers[i];
+        uint32_t j = i;
+        while (j > 0 && markers[j - 1].s > marker.s) {
+            markers[j] = markers[j - 1];
+            j--;
+        }
+        markers[j] = marker;
+    }
+}
+
+static void load_ghost(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return;
+    }
+    ghost_header_t header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              header.magic == GHOST_MAGIC && header.version == GHOST_VERSION &&
+              header.step_m == COURSE_GHOST_STEP_M && header.steps == step_count &&
+              fabsf(header.length_m - length_m) < 0.5f &&
+              fread(ghost, sizeof(uint32_t), step_count, f) == step_count;
+    fclose(f);
+
+    have_ghost = ok;
+    if (ok) {
+        ESP_LOGI(TAG, "Ghost loaded: %lu.%lu s", (unsigned long)(header.total_ms / 1000),
+                 (unsigned long)(header.total_ms % 1000 / 100));
+    } else {
+        ESP_LOGW(TAG, "Ghost %s does not match this course - ignored", path);
+    }
+}
+
+void course_unload(void) {
+    heap_caps_free(points);
+    heap_caps_free(cell_start);
+    heap_caps_free(cell_segments);
+    heap_caps_free(ghost);
+    heap_caps_free(run);
+    points = NULL;
+    cell_start = NULL;
+    cell_segments = NULL;
+    ghost = run = NULL;
+    point_count = marker_count = step_count = 0;
+    have_ghost = running = have_result = have_fix = have_run_last = false;
+    history_count = 0;
+    state = COURSE_NONE;
+    memset(&stats, 0, sizeof(stats));
+}
+
+esp_err_t course_load(const char *path, const char *ghost_path) {
+    static int32_t marker_e7[COURSE_MAX_MARKERS][2];
+    uint32_t count;
+
+    course_unload();
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t err = parse_course(f, false, &count, marker_e7);
+    if (err == ESP_OK && (count < 2 || count > COURSE_MAX_POINTS)) {
+        ESP_LOGE(TAG, "Course needs 2 to %d points, %s has %lu", COURSE_MAX_POINTS, path, (unsigned long)count);
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    if (err == ESP_OK) {
+        points = heap_caps_malloc(count * sizeof(course_point_t), MALLOC_CAP_8BIT);
+        err = points != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+    }
+    if (err == ESP_OK) {
+        rewind(f);
+        err = parse_course(f, true, &point_count, marker_e7);
+    }
+    fclose(f);
+    if (err == ESP_OK && point_count < 2) {
+        err = ESP_ERR_INVALID_SIZE;
+    }
+
+    if (err == ESP_OK) {
+        length_m = points[point_count - 1].s;
+        err = build_grid();
+    }
+    if (err == ESP_OK) {
+        step_count = (uint32_t)ceilf(length_m / COURSE_GHOST_STEP_M) + 1;
+        ghost = heap_caps_malloc(step_count * sizeof(uint32_t), MALLOC_CAP_8BIT);
+        run = heap_caps_malloc(step_count * sizeof(uint32_t), MALLOC_CAP_8BIT);
+        err = ghost != NULL && run != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+    }
+    if (err != ESP_OK) {
+        course_unload();
+        return err;
+    }
+
+    place_markers(marker_e7);
+    if (ghost_path != NULL) {
+        load_ghost(ghost_path);
+    }
+
+    state = COURSE_SEARCHING;
+    stats.points = point_count;
+    stats.markers = marker_count;
+    stats.length_m = length_m;
+    stats.memory_bytes = point_count * sizeof(course_point_t) + (stats.grid_cells + 1) * sizeof(uint32_t) +
+                         stats.grid_entries * sizeof(uint16_t) + 2 * step_count * sizeof(uint32_t);
+    ESP_LOGI(TAG, "Course: %lu points, %.0f m, %lu markers | grid %lux%lu of %.0f m, %u bytes%s",
+             (unsigned long)point_count, length_m, (unsigned long)marker_count, (unsigned long)grid_cols,
+             (unsigned long)grid_rows, cell_m, (unsigned)stats.memory_bytes, have_ghost ? " | ghost" : "");
+    return ESP_OK;
+}
+
+bool course_loaded(void) {
+    return state != COURSE_NONE;
+}
+
+// Best segment for a fix. Tracking: nearest within the progress window around the
+// prediction. Searching: nearest, segments against the direction of motion only
+// when nothing else is in reach (out-and-back legs side by side).
+static bool match_fix(float x, float y, bool tracking, float predicted_s, float window_m,
+                      float motion_x, float motion_y, bool moving, course_match_t *best) {
+    int32_t col, row;
+    cell_of(x, y, &col, &row);
+    float best_cost = INFINITY;
+
+    for (int32_t r = row - 1; r <= row + 1; r++) {
+        for (int32_t c = col - 1; c <= col + 1; c++) {
+            if (r < 0 || c < 0 || r >= (int32_t)grid_rows || c >= (int32_t)grid_cols) {
+                continue;
+            }
+            uint32_t cell = (uint32_t)r * grid_cols + (uint32_t)c;
+            for (uint32_t e = cell_start[cell]; e < cell_start[cell + 1]; e++) {
+                uint32_t segment = cell_segments[e];
+                course_match_t m;
+                stats.candidates++;
+                if (tracking && (points[segment + 1].s < predicted_s - window_m ||
+                                 points[segment].s > predicted_s + window_m) &&
+                    segment != 0 && segment + 2 != point_count) {
+                    continue;   // Whole segment outside the window (end segments extend)
+                }
+                project(segment, x, y, &m);
+                if (m.distance > COURSE_MATCH_RADIUS_M) {
+                    continue;
+                }
+                float cost = m.distance;
+                if (tracking) {
+                    if (fabsf(m.s - predicted_s) > window_m) {
+                        continue;
+                    }
+                } else if (moving) {
+                    float dx = points[segment + 1].x - points[segment].x;
+                    float dy = points[segment + 1].y - points[segment].y;
+                    if (dx * motion_x + dy * motion_y < 0.0f) {
+                        cost += COURSE_MATCH_RADIUS_M;
+                    }
+                }
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    *best = m;
+                }
+            }
+        }
+    }
+    return best_cost < INFINITY;
+}
+
+static timebase_us_t crossing_time(timebase_us_t t0, float s0, timebase_us_t t1, float s1, float target) {
+    if (s1 <= s0) {
+        return t1;
+    }
+    float fraction = fminf(fmaxf((target - s0) / (s1 - s0), 0.0f), 1.0f);
+    return t0 + (timebase_us_t)(fraction * (float)(t1 - t0));
+}
+
+// Start, ghost steps and finish crossed between the previous match and this one
+static course_event_t run_update(timebase_us_t t, float s) {
+    course_event_t event = COURSE_EVENT_NONE;
+    bool recent = have_run_last && t - run_last_us < (timebase_us_t)COURSE_LOST_ABORT_MS * 1000;
+
+    if (!running && recent && run_last_s < 0.0f && s >= 0.0f) {
+        start_us = crossing_time(run_last_us, run_last_s, t, s, 0.0f);
+        running = true;
+        next_step = 0;
+        event = COURSE_EVENT_START;
+    } else if (running && s < -COURSE_START_MARGIN_M) {
+        running = false;
+        event = COURSE_EVENT_ABORT;
+    }
+
+    if (running) {
+        while (next_step < step_count && step_position(next_step) <= s) {
+            timebase_us_t crossed = crossing_time(run_last_us, run_last_s, t, s, step_position(next_step));
+            run[next_step++] = (uint32_t)((crossed - start_us) / 1000);
+        }
+        if (next_step == step_count) {
+            result.elapsed_ms = run[step_count - 1];
+            result.new_best = !have_ghost || result.elapsed_ms < ghost[step_count - 1];
+            if (result.new_best) {
+                uint32_t *previous = ghost;
+                ghost = run;
+                run = previous;
+                have_ghost = true;
+            }
+            have_result = true;
+            running = false;
+            event = COURSE_EVENT_FINISH;
+        }
+    }
+
+    run_last_us = t;
+    run_last_s = s;
+    have_run_last = true;
+    return event;
+}
+
+static float ghost_time_ms(float s) {
+    if (s <= 0.0f) {
+        return 0.0f;
+    }
+    if (s >= length_m) {
+        return (float)ghost[step_count - 1];
+    }
+    uint32_t k = (uint32_t)(s / COURSE_GHOST_STEP_M);
+    float s0 = step_position(k);
+    float s1 = step_position(k + 1);
+    return ghost[k] + ((float)ghost[k + 1] - (float)ghost[k]) * (s - s0) / (s1 - s0);
+}
+
+static void fill_position(timebase_us_t t, float s, course_position_t *out) {
+    // Marker pointer walks with the progress - O(1) per update however it moves
+    while (next_marker < (int16_t)marker_count && markers[next_marker].s <= s) {
+        next_marker++;
+    }
+    while (next_marker > 0 && markers[next_marker - 1].s > s) {
+        next_marker--;
+    }
+
+    out->state = state;
+    out->running = running;
+    out->progress_m = s;
+    out->remaining_m = fmaxf(length_m - s, 0.0f);
+    out->cross_track_m = last_cross_m;
+    out->elapsed_ms = running && t > start_us ? (uint32_t)((t - start_us) / 1000) : 0;
+    out->has_ghost = running && have_ghost;
+    out->ghost_delta_ms = out->has_ghost ? (int32_t)out->elapsed_ms - (int32_t)lrintf(ghost_time_ms(s)) : 0;
+    out->next_marker = next_marker < (int16_t)marker_count ? next_marker : -1;
+    out->marker_distance_m = out->next_marker >= 0 ? markers[next_marker].s - s : 0.0f;
+}
+
+course_event_t course_update(int32_t lat_e7, int32_t lon_e7, timebase_us_t timestamp_us, course_position_t *out) {
+    course_event_t event = COURSE_EVENT_NONE;
+    if (state == COURSE_NONE) {
+        if (out != NULL) {
+            memset(out, 0, sizeof(*out));
+        }
+        return event;
+    }
+    stats.updates++;
+
+    float x, y;
+    geo_ltp_project(&ltp, lat_e7, lon_e7, &x, &y);
+    float motion_x = x - fix_x;
+    float motion_y = y - fix_y;
+    bool moving = have_fix && timestamp_us - fix_us < 5000000 && motion_x * motion_x + motion_y * motion_y > 1.0f;
+    fix_x = x;
+    fix_y = y;
+    fix_us = timestamp_us;
+    have_fix = true;
+
+    bool tracking = state == COURSE_TRACKING;
+    const course_history_t *last = &history[history_head];
+    float dt_s = tracking ? (float)(timestamp_us - last->timestamp_us) * 1e-6f : 0.0f;
+    float predicted_s = tracking ? last->s + speed_m_s * dt_s : 0.0f;
+    float window_m = COURSE_TRACK_WINDOW_M + 0.5f * fabsf(speed_m_s) * dt_s;
+
+    course_match_t m = { 0 };
+    if (!match_fix(x, y, tracking, predicted_s, window_m, motion_x, motion_y, moving, &m)) {
+        if (tracking) {
+            state = COURSE_SEARCHING;
+            lost_us = timestamp_us;
+        }
+        if (running && timestamp_us - lost_us >= (timebase_us_t)COURSE_LOST_ABORT_MS * 1000) {
+            running = false;
+            event = COURSE_EVENT_ABORT;
+        }
+        if (out != NULL) {
+            memset(out, 0, sizeof(*out));
+            out->state = state;
+            out->running = running;
+            out->next_marker = -1;
+        }
+        return event;
+    }
+
+    if (!tracking) {
+        state = COURSE_TRACKING;
+        history_count = 0;
+        speed_m_s = 0.0f;
+        stats.acquisitions++;
+    }
+    stats.matched++;
+
+    if (history_count > 0 && timestamp_us > last->timestamp_us) {
+        speed_m_s = (m.s - last->s) / ((float)(timestamp_us - last->timestamp_us) * 1e-6f);
+    }
+    history_head = (history_head + 1) % HISTORY_FIXES;
+    history[history_head] = (course_history_t){ .timestamp_us = timestamp_us, .s = m.s };
+    if (history_count < HISTORY_FIXES) {
+        history_count++;
+    }
+    last_cross_m = m.cross;
+
+    event = run_update(timestamp_us, m.s);
+    if (out != NULL) {
+        fill_position(timestamp_us, m.s, out);
+    }
+    return event;
+}
+
+bool course_position_at(timebase_us_t timestamp_us, course_position_t *out) {
+    if (state != COURSE_TRACKING || history_count == 0) {
+        return false;
+    }
+
+    const course_history_t *newest = &history[history_head];
+    float s;
+    if (timestamp_us >= newest->timestamp_us) {
+        timebase_us_t ahead_us = timestamp_us - newest->timestamp_us;
+        if (ahead_us > (timebase_us_t)COURSE_EXTRAPOLATE_MS * 1000) {
+            return false;
+        }
+        s = newest->s + speed_m_s * (float)ahead_us * 1e-6f;
+    } else {
+        // Walk back to the pair of fixes around the time
+        uint32_t i = history_head;
+        uint32_t n = 1;
+        while (n < history_count) {
+            const course_history_t *older = &history[(i + HISTORY_FIXES - 1) % HISTORY_FIXES];
+            if (older->timestamp_us <= timestamp_us) {
+                const course_history_t *newer = &history[i];
+                float fraction = (float)(timestamp_us - older->timestamp_us) /
+                                 (float)(newer->timestamp_us - older->timestamp_us);
+                s = older->s + (newer->s - older->s) * fraction;
+                break;
+            }
+            i = (i + HISTORY_FIXES - 1) % HISTORY_FIXES;
+            n++;
+        }
+        if (n == history_count) {
+            return false;
+        }
+    }
+
+    fill_position(timestamp_us, s, out);
+    return true;
+}
+
+bool course_get_result(course_result_t *out_result) {
+    if (!have_result || out_result == NULL) {
+        return false;
+    }
+    *out_result = result;
+    return true;
+}
+
+esp_err_t course_save_ghost(const char *path) {
+    const uint32_t *table = ghost;
+    if (!have_ghost || table == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return ESP_FAIL;
+    }
+    ghost_header_t header = {
+        .magic = GHOST_MAGIC,
+        .version = GHOST_VERSION,
+        .step_m = COURSE_GHOST_STEP_M,
+        .steps = step_count,
+        .length_m = length_m,
+        .total_ms = table[step_count - 1],
+    };
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(table, sizeof(uint32_t), step_count, f) == step_count;
+    ok = fclose(f) == 0 && ok;
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+const char *course_marker_label(int16_t marker) {
+    return marker >= 0 && marker < (int16_t)marker_count ? markers[marker].label : "";
+}
+
+esp_err_t course_get_stats(course_stats_t *out_stats) {
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_stats = stats;
+    return ESP_OK;
+}
@@ -0,0 +1,99 @@
+#ifndef COURSE_H
+#define COURSE_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "utils/timebase.h"
+
+// Course engine: follows the boat along a fixed course (polyline from start to
+// finish, with buoys and distance markers) and gives progress, distance to go,
+// cross-track error and the time delta to a ghost - the fastest completed run
+// of the course, kept as elapsed time every COURSE_GHOST_STEP_M.
+//
+// Course file (text, one item per line, '#' comments, decimal degrees):
+//
+//   P <lat> <lon>             polyline vertex, start first
+//   M <lat> <lon> <label>     marker - placed where it projects onto the course
+//
+// Fixes are matched through a uniform grid of segment lists over the course, so
+// an update tests the segments of 3x3 cells around the fix whatever the course
+// length. While tracking, only segments close to the predicted progress count:
+// out-and-back courses and crossing lanes do not make the match jump legs.
+//
+// Single task (DSP stage), except course_save_ghost - see there.
+
+#define COURSE_LABEL_MAX    12
+
+typedef enum {
+    COURSE_NONE,                // No course loaded
+    COURSE_SEARCHING,           // No segment within COURSE_MATCH_RADIUS_M (or heading the wrong way)
+    COURSE_TRACKING,
+} course_state_t;
+
+typedef enum {
+    COURSE_EVENT_NONE,
+    COURSE_EVENT_START,         // Start line crossed - a run began
+    COURSE_EVENT_FINISH,        // Finish line crossed - course_get_result()
+    COURSE_EVENT_ABORT,         // Run given up (back over the start line or lost too long)
+} course_event_t;
+
+typedef struct {
+    course_state_t state;
+    bool running;               // Between start and finish
+    float progress_m;           // Along the course from the start (negative before it)
+    float remaining_m;          // Distance to go
+    float cross_track_m;        // Offset from the course line, positive to the right
+    uint32_t elapsed_ms;        // Since the start (running only)
+    bool has_ghost;
+    int32_t ghost_delta_ms;     // Time behind (+) or ahead (-) of the ghost at this progress
+    int16_t next_marker;        // -1 after the last one
+    float marker_distance_m;
+} course_position_t;
+
+typedef struct {
+    uint32_t elapsed_ms;
+    bool new_best;              // Became the ghost (course_save_ghost stores it)
+} course_result_t;
+
+typedef struct {
+    uint32_t points;
+    uint32_t markers;
+    float length_m;
+    uint32_t grid_cells;
+    uint32_t grid_entries;      // Segment references over all cells
+    uint32_t max_cell_segments;
+    size_t memory_bytes;
+    uint32_t updates;
+    uint32_t matched;
+    uint64_t candidates;        // Segment tests over all updates
+    uint32_t acquisitions;      // SEARCHING -> TRACKING
+} course_stats_t;
+
+// Load a course file (replaces the current course) and, when ghost_path names
+// a ghost recorded on this course, the ghost
+esp_err_t course_load(const char *path, const char *ghost_path);
+void course_unload(void);
+bool course_loaded(void);
+
+// Match one fix. out (may be NULL) receives the position at the fix.
+course_event_t course_update(int32_t lat_e7, int32_t lon_e7, timebase_us_t timestamp_us, course_position_t *out);
+
+// Position at any time up to COURSE_EXTRAPOLATE_MS after the last matched fix,
+// interpolated between the recent fixes (stroke-synchronous progress and ghost
+// delta at a catch). False while not tracking.
+bool course_position_at(timebase_us_t timestamp_us, course_position_t *out);
+
+// Outcome of the last finished run
+bool course_get_result(course_result_t *out_result);
+
+// Store the ghost. Another task may call this after a FINISH with new_best: the
+// ghost table is only replaced by the next faster finish.
+esp_err_t course_save_ghost(const char *path);
+
+const char *course_marker_label(int16_t marker);
+
+esp_err_t course_get_stats(course_stats_t *out_stats);
+
+#endif // COURSE_H
@@ -0,0 +1,123 @@
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "cpu_monitor.h"
+#include "stats.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "CPU_MON";
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS && CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+
+// Snapshots kept static - too large for the monitor task's stack
+static TaskStatus_t previous[CPU_MONITOR_MAX_TASKS];
+static TaskStatus_t current[CPU_MONITOR_MAX_TASKS];
+static UBaseType_t previous_count = 0;
+static uint32_t previous_total = 0;
+static uint32_t task_delta[CPU_MONITOR_MAX_TASKS];
+
+static uint32_t runtime_delta(const TaskStatus_t *task) {
+    for (UBaseType_t i = 0; i < previous_count; i++) {
+        if (previous[i].xHandle == task->xHandle) {
+            return task->ulRunTimeCounter - previous[i].ulRunTimeCounter;
+        }
+    }
+    return task->ulRunTimeCounter; // Created since the last sample
+}
+
+// Core load, per-task CPU share (0.1%) and stack headroom (bytes never used)
+static void publish_stats(const cpu_usage_t *usage, UBaseType_t count) {
+    static stats_metric_t *core_load[portNUM_PROCESSORS];
+    char name[STATS_NAME_MAX];
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        if (core_load[core] == NULL) {
+            snprintf(name, sizeof(name), "cpu.core%d_pct", core);
+            core_load[core] = stats_register(name, STATS_GAUGE);
+        }
+        stats_set(core_load[core], usage->core_load_pct[core]);
+    }
+    for (UBaseType_t i = 0; i < count && usage->elapsed_us > 0; i++) {
+        snprintf(name, sizeof(name), "cpu.%s", current[i].pcTaskName);
+        stats_set(stats_register(name, STATS_GAUGE), (int32_t)((uint64_t)task_delta[i] * 1000 / usage->elapsed_us));
+        snprintf(name, sizeof(name), "stack.%s", current[i].pcTaskName);
+        stats_set(stats_register(name, STATS_GAUGE), (int32_t)current[i].usStackHighWaterMark);
+    }
+}
+
+esp_err_t cpu_monitor_sample(cpu_usage_t *out_usage) {
+    if (out_usage == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(current, CPU_MONITOR_MAX_TASKS, &total);
+    if (count == 0) {
+        return ESP_ERR_INVALID_SIZE; // More tasks than CPU_MONITOR_MAX_TASKS
+    }
+
+    uint32_t elapsed = total - previous_total;
+    uint32_t idle[portNUM_PROCESSORS] = {0};
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        task_delta[i] = runtime_delta(&current[i]);
+        BaseType_t core = current[i].xCoreID;
+        if (strncmp(current[i].pcTaskName, "IDLE", 4) == 0 && core >= 0 && core < portNUM_PROCESSORS) {
+            idle[core] += task_delta[i];
+        }
+    }
+
+    memset(out_usage, 0, sizeof(*out_usage));
+    out_usage->elapsed_us = elapsed;
+    out_usage->task_count = count;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t idle_pct = elapsed > 0 ? (uint32_t)((uint64_t)idle[core] * 100 / elapsed) : 100;
+        out_usage->core_load_pct[core] = idle_pct >= 100 ? 0 : 100 - idle_pct;
+    }
+
+    bool primed = previous_total != 0;
+    if (primed) {
+        publish_stats(out_usage, count);
+    }
+    memcpy(previous, current, count * sizeof(TaskStatus_t));
+    previous_count = count;
+    previous_total = total;
+    return primed ? ESP_OK : ESP_ERR_NOT_FINISHED;
+}
+
+void cpu_monitor_log(void) {
+    cpu_usage_t usage;
+    esp_err_t err = cpu_monitor_sample(&usage);
+    if (err != ESP_OK) {
+        if (err != ESP_ERR_NOT_FINISHED) {
+            ESP_LOGW(TAG, "CPU sample failed: %s", esp_err_to_name(err));
+        }
+        return;
+    }
+
+    ESP_LOGI(TAG, "CPU - Core0: %u%% | Core1: %u%% | Tasks: %u",
+            usage.core_load_pct[0], usage.core_load_pct[portNUM_PROCESSORS - 1], usage.task_count);
+
+    for (UBaseType_t i = 0; i < usage.task_count && usage.elapsed_us > 0; i++) {
+        ESP_LOGD(TAG, "  %-14s core %d: %lu.%lu%%", previous[i].pcTaskName,
+                (int)previous[i].xCoreID,
+                (uint32_t)((uint64_t)task_delta[i] * 100 / usage.elapsed_us),
+                (uint32_t)((uint64_t)task_delta[i] * 1000 / usage.elapsed_us % 10));
+    }
+}
+
+#else
+
+esp_err_t cpu_monitor_sample(cpu_usage_t *out_usage) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void cpu_monitor_log(void) {
+    static bool warned = false;
+    if (!warned) {
+        ESP_LOGW(TAG, "Enable FreeRTOS trace facility, run-time stats and core ID for CPU reports");
+        warned = true;
+    }
+}
+
+#endif
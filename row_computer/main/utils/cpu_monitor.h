@@ -0,0 +1,23 @@
+#ifndef CPU_MONITOR_H
+#define CPU_MONITOR_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+
+#define CPU_MONITOR_MAX_TASKS       24
+
+typedef struct {
+    uint8_t core_load_pct[portNUM_PROCESSORS];  // 100 - idle share since previous sample
+    uint32_t elapsed_us;                        // Run-time counter span of the sample
+    uint8_t task_count;
+} cpu_usage_t;
+
+// Per-core utilisation since the previous call (first call primes the baseline).
+// Needs FreeRTOS trace facility, run-time stats and core ID in task status.
+esp_err_t cpu_monitor_sample(cpu_usage_t *out_usage);
+
+// Sample and log per-core load, plus per-task share at debug level
+void cpu_monitor_log(void);
+
+#endif // CPU_MONITOR_H
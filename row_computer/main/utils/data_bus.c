@@ -0,0 +1,211 @@
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "config/common_constants.h"
+#include "data_bus.h"
+#include "batch_notify.h"
+#include "stats.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "BUS";
+
+struct bus_subscriber {
+    bus_topic_t *topic;
+    const char *name;
+    TaskHandle_t consumer;
+    uint32_t watermark;
+    uint32_t cursor;            // Next sequence number to read (owned by the reader)
+    uint32_t received;
+    uint32_t dropped;
+    uint32_t max_lag;
+    uint32_t logged_drops;
+    stats_metric_t *lag_metric;     // Registered on first collection
+    stats_metric_t *dropped_metric;
+};
+
+struct bus_topic {
+    const char *name;
+    uint8_t *items;
+    size_t item_size;
+    uint32_t mask;              // capacity - 1
+    uint32_t head;              // Sequence number of the next item to publish
+    uint8_t subscriber_count;
+    bus_subscriber_t subscribers[BUS_MAX_SUBSCRIBERS];
+};
+
+static bus_topic_t *topics[BUS_MAX_TOPICS];
+static uint8_t topic_count = 0;
+
+static inline uint8_t *slot(bus_topic_t *topic, uint32_t seq) {
+    return topic->items + (size_t)(seq & topic->mask) * topic->item_size;
+}
+
+// Reader queue depth and losses of every subscriber
+static void collect_stats(void) {
+    char name[STATS_NAME_MAX];
+    for (uint8_t t = 0; t < topic_count; t++) {
+        bus_topic_t *topic = topics[t];
+        uint8_t count = __atomic_load_n(&topic->subscriber_count, __ATOMIC_ACQUIRE);
+        for (uint8_t i = 0; i < count; i++) {
+            bus_subscriber_t *subscriber = &topic->subscribers[i];
+            if (subscriber->lag_metric == NULL) {
+                snprintf(name, sizeof(name), "bus.%s.%s.lag", topic->name, subscriber->name);
+                subscriber->lag_metric = stats_register(name, STATS_GAUGE);
+                snprintf(name, sizeof(name), "bus.%s.%s.dropped", topic->name, subscriber->name);
+                subscriber->dropped_metric = stats_register(name, STATS_COUNTER);
+            }
+            stats_set(subscriber->lag_metric, __atomic_load_n(&topic->head, __ATOMIC_ACQUIRE) - subscriber->cursor);
+            stats_set(subscriber->dropped_metric, subscriber->dropped);
+        }
+    }
+}
+
+bus_topic_t* bus_topic_create(const char *name, size_t item_size, uint32_t capacity) {
+    static bool collecting = false;
+    if (!collecting) {
+        collecting = stats_register_collector(collect_stats) == ESP_OK;
+    }
+    if (topic_count >= BUS_MAX_TOPICS || item_size == 0 || capacity < 2) {
+        ESP_LOGE(TAG, "Cannot create topic %s", name);
+        return NULL;
+    }
+
+    uint32_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    bus_topic_t *topic = heap_caps_calloc(1, sizeof(bus_topic_t), MALLOC_CAP_8BIT);
+    uint8_t *items = heap_caps_malloc(size * item_size, MALLOC_CAP_8BIT);
+    if (topic == NULL || items == NULL) {
+        heap_caps_free(topic);
+        heap_caps_free(items);
+        ESP_LOGE(TAG, "Failed to allocate topic %s (%u bytes)", name, (unsigned)(size * item_size));
+        return NULL;
+    }
+
+    topic->name = name;
+    topic->items = items;
+    topic->item_size = item_size;
+    topic->mask = size - 1;
+    topics[topic_count++] = topic;
+
+    ESP_LOGD(TAG, "Topic %s: %lu x %u bytes", name, size, (unsigned)item_size);
+    return topic;
+}
+
+bus_subscriber_t* bus_subscribe(bus_topic_t *topic, const char *name, TaskHandle_t consumer, uint32_t watermark) {
+    if (topic == NULL || topic->subscriber_count >= BUS_MAX_SUBSCRIBERS) {
+        ESP_LOGE(TAG, "Cannot subscribe %s", name);
+        return NULL;
+    }
+
+    bus_subscriber_t *subscriber = &topic->subscribers[topic->subscriber_count];
+    memset(subscriber, 0, sizeof(*subscriber));
+    subscriber->topic = topic;
+    subscriber->name = name;
+    subscriber->consumer = consumer;
+    subscriber->watermark = watermark > 0 ? watermark : 1;
+    subscriber->cursor = __atomic_load_n(&topic->head, __ATOMIC_ACQUIRE);
+
+    // Publish the entry only once it is complete - the publisher may be running
+    __atomic_store_n(&topic->subscriber_count, topic->subscriber_count + 1, __ATOMIC_RELEASE);
+    return subscriber;
+}
+
+void bus_publish(bus_topic_t *topic, const void *item, bool urgent) {
+    uint32_t head = topic->head;
+    memcpy(slot(topic, head), item, topic->item_size);
+    __atomic_store_n(&topic->head, head + 1, __ATOMIC_RELEASE);
+
+    uint8_t count = __atomic_load_n(&topic->subscriber_count, __ATOMIC_ACQUIRE);
+    for (uint8_t i = 0; i < count; i++) {
+        bus_subscriber_t *subscriber = &topic->subscribers[i];
+        if (subscriber->consumer != NULL) {
+            batch_notify_signal(subscriber->consumer, head + 1 - subscriber->cursor,
+                                subscriber->watermark, urgent);
+        }
+    }
+}
+
+bool bus_receive(bus_subscriber_t *subscriber, void *out) {
+    bus_topic_t *topic = subscriber->topic;
+    uint32_t capacity = topic->mask + 1;
+
+    while (1) {
+        uint32_t head = __atomic_load_n(&topic->head, __ATOMIC_ACQUIRE);
+        uint32_t cursor = subscriber->cursor;
+        uint32_t lag = head - cursor;
+        if (lag == 0) {
+            return false;
+        }
+        if (lag > subscriber->max_lag) {
+            subscriber->max_lag = lag;
+        }
+
+        // The publisher reuses a slot as soon as head reaches cursor + capacity
+        if (lag >= capacity) {
+            subscriber->dropped += lag - (capacity - 1);
+            cursor = head - (capacity - 1);
+        }
+
+        memcpy(out, slot(topic, cursor), topic->item_size);
+
+        // Lapped during the copy: the item may be torn - skip ahead and retry
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&topic->head, __ATOMIC_ACQUIRE) - cursor >= capacity) {
+            subscriber->cursor = cursor;
+            continue;
+        }
+
+        subscriber->cursor = cursor + 1;
+        subscriber->received++;
+        return true;
+    }
+}
+
+const char* bus_topic_name(const bus_topic_t *topic) {
+    return topic->name;
+}
+
+uint32_t bus_topic_published(const bus_topic_t *topic) {
+    return __atomic_load_n(&topic->head, __ATOMIC_ACQUIRE);
+}
+
+esp_err_t bus_get_subscriber_stats(const bus_subscriber_t *subscriber, bus_subscriber_stats_t *out_stats) {
+    if (subscriber == NULL || out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    out_stats->name = subscriber->name;
+    out_stats->received = subscriber->received;
+    out_stats->dropped = subscriber->dropped;
+    out_stats->lag = __atomic_load_n(&subscriber->topic->head, __ATOMIC_ACQUIRE) - subscriber->cursor;
+    out_stats->max_lag = subscriber->max_lag;
+    return ESP_OK;
+}
+
+void bus_log_stats(void) {
+    for (uint8_t t = 0; t < topic_count; t++) {
+        bus_topic_t *topic = topics[t];
+        uint8_t count = __atomic_load_n(&topic->subscriber_count, __ATOMIC_ACQUIRE);
+
+        for (uint8_t i = 0; i < count; i++) {
+            bus_subscriber_t *subscriber = &topic->subscribers[i];
+            bus_subscriber_stats_t stats;
+            if (bus_get_subscriber_stats(subscriber, &stats) != ESP_OK) {
+                continue;
+            }
+
+            if (stats.dropped != subscriber->logged_drops) {
+                ESP_LOGI(TAG, "%s -> %s: lag %lu (max %lu) | dropped %lu of %lu",
+                        topic->name, stats.name, stats.lag, stats.max_lag,
+                        stats.dropped, bus_topic_published(topic));
+                subscriber->logged_drops = stats.dropped;
+            } else {
+                ESP_LOGD(TAG, "%s -> %s: lag %lu (max %lu) | received %lu",
+                        topic->name, stats.name, stats.lag, stats.max_lag, stats.received);
+            }
+        }
+    }
+}
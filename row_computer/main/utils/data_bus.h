@@ -0,0 +1,47 @@
+#ifndef DATA_BUS_H
+#define DATA_BUS_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Typed publish/subscribe topics. Each topic is one ring written once by its
+// single publisher; every subscriber reads it through its own cursor, so adding
+// a consumer adds no copies on the publish side. A subscriber that falls more
+// than a ring behind loses its oldest items (counted) - the publisher never blocks.
+typedef struct bus_topic bus_topic_t;
+typedef struct bus_subscriber bus_subscriber_t;
+
+typedef struct {
+    const char *name;
+    uint32_t received;
+    uint32_t dropped;           // Overwritten before this subscriber read them
+    uint32_t lag;               // Items published but not yet read
+    uint32_t max_lag;
+} bus_subscriber_stats_t;
+
+// Create a topic of capacity items (rounded up to a power of two). NULL on failure.
+bus_topic_t* bus_topic_create(const char *name, size_t item_size, uint32_t capacity);
+
+// Register a reader starting at the next published item. consumer (may be NULL) is
+// woken through batch_notify once watermark items are unread. Safe while publishing.
+bus_subscriber_t* bus_subscribe(bus_topic_t *topic, const char *name, TaskHandle_t consumer, uint32_t watermark);
+
+// Single publisher per topic. urgent wakes every consumer regardless of watermark.
+void bus_publish(bus_topic_t *topic, const void *item, bool urgent);
+
+// Copy the subscriber's next item to out. Returns false when it is up to date.
+bool bus_receive(bus_subscriber_t *subscriber, void *out);
+
+const char* bus_topic_name(const bus_topic_t *topic);
+uint32_t bus_topic_published(const bus_topic_t *topic);
+
+esp_err_t bus_get_subscriber_stats(const bus_subscriber_t *subscriber, bus_subscriber_stats_t *out_stats);
+
+// Log lag/drops of every subscriber on every topic (INFO when new drops occurred)
+void bus_log_stats(void);
+
+#endif // DATA_BUS_H
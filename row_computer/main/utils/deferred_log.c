@@ -0,0 +1,247 @@
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "config/common_constants.h"
+#include "deferred_log.h"
+#include "batch_notify.h"
+#include "stats.h"
+#include <stdio.h>
+
+static const char *TAG = "DLOG";
+
+// Bounded multi-producer ring: a slot is free for position p when seq == p and
+// holds a committed record when seq == p + 1. Producers claim positions with a
+// CAS on head, so IMU (core 1) and GPS/DSP (core 0) never take a lock.
+typedef struct {
+    uint32_t seq;
+    dlog_site_t *site;
+    uint32_t timestamp_ms;
+    uint32_t suppressed;
+    uint64_t args[DLOG_MAX_ARGS];
+} dlog_record_t;
+
+static dlog_record_t *ring = NULL;
+static uint32_t head = 0;           // Next position to claim (producers)
+static uint32_t tail = 0;           // Next position to format (consumer)
+static deferred_log_stats_t stats;
+static TaskHandle_t consumer = NULL;
+
+static const char level_letters[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+
+static void collect_stats(void) {
+    static stats_metric_t *written, *dropped, *high_water;
+    if (written == NULL) {
+        written = stats_register("dlog.written", STATS_COUNTER);
+        dropped = stats_register("dlog.dropped", STATS_COUNTER);
+        high_water = stats_register("dlog.high_water", STATS_GAUGE);
+    }
+    deferred_log_stats_t current;
+    deferred_log_get_stats(&current);
+    stats_set(written, current.written);
+    stats_set(dropped, current.dropped);
+    stats_set(high_water, current.high_water);
+}
+
+esp_err_t deferred_log_init(void) {
+    if (ring != NULL) {
+        return ESP_OK;
+    }
+
+    dlog_record_t *records = heap_caps_malloc(DLOG_RING_RECORDS * sizeof(dlog_record_t), MALLOC_CAP_8BIT);
+    if (records == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate %u byte log ring", (unsigned)(DLOG_RING_RECORDS * sizeof(dlog_record_t)));
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t i = 0; i < DLOG_RING_RECORDS; i++) {
+        records[i].seq = i;
+    }
+    head = 0;
+    tail = 0;
+    memset(&stats, 0, sizeof(stats));
+    stats_register_collector(collect_stats);
+
+    __atomic_store_n(&ring, records, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+void deferred_log_write(dlog_site_t *site, const uint64_t *args) {
+    dlog_record_t *records = __atomic_load_n(&ring, __ATOMIC_ACQUIRE);
+    if (records == NULL) {
+        return;
+    }
+
+    // Claim a slot
+    dlog_record_t *record;
+    uint32_t pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    while (1) {
+        record = &records[pos & (DLOG_RING_RECORDS - 1)];
+        int32_t diff = (int32_t)(__atomic_load_n(&record->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full - the consumer has not formatted this slot's previous record yet
+            site->suppressed++;
+            __atomic_fetch_add(&stats.dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        }
+    }
+
+    record->site = site;
+    record->timestamp_ms = timebase_now_ms();
+    record->suppressed = site->suppressed;
+    for (uint8_t i = 0; i < site->nargs; i++) {
+        record->args[i] = args[i];
+    }
+    site->suppressed = 0;
+    site->emitted++;
+    __atomic_store_n(&record->seq, pos + 1, __ATOMIC_RELEASE);
+
+    __atomic_fetch_add(&stats.written, 1, __ATOMIC_RELAXED);
+    // The consumer may already be past this record; the depth is then zero, not a wrap
+    int32_t waiting = (int32_t)(pos + 1 - __atomic_load_n(&tail, __ATOMIC_RELAXED));
+    uint32_t depth = waiting > 0 ? (uint32_t)waiting : 0;
+    uint32_t high_water = __atomic_load_n(&stats.high_water, __ATOMIC_RELAXED);
+    while (depth > high_water &&
+           !__atomic_compare_exchange_n(&stats.high_water, &high_water, depth, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    TaskHandle_t task = __atomic_load_n(&consumer, __ATOMIC_ACQUIRE);
+    if (task != NULL) {
+        batch_notify_signal(task, depth, DLOG_BATCH_WATERMARK,
+                            site->level <= ESP_LOG_WARN);
+    }
+}
+
+// printf one record into line; each conversion gets its argument with the C type it expects
+static void format_record(const dlog_record_t *record, char *line, size_t size) {
+    const char *fmt = record->site->format;
+    size_t len = 0;
+    uint8_t arg = 0;
+
+    while (*fmt != '\0' && len < size - 1) {
+        if (*fmt != '%') {
+            line[len++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            line[len++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        // Copy one conversion spec: flags, width, precision, length, type
+        char spec[16];
+        size_t spec_len = 0;
+        int longs = 0;
+        spec[spec_len++] = *fmt++;
+        while (*fmt != '\0' && strchr("-+ #0123456789.hlzjt", *fmt) != NULL) {
+            longs += (*fmt == 'l');
+            if (spec_len < sizeof(spec) - 2) {
+                spec[spec_len++] = *fmt;
+            }
+            fmt++;
+        }
+        char type = *fmt;
+        if (type == '\0') {
+            break;
+        }
+        spec[spec_len++] = *fmt++;
+        spec[spec_len] = '\0';
+
+        uint64_t word = arg < record->site->nargs ? record->args[arg] : 0;
+        arg++;
+
+        char *out = line + len;
+        size_t room = size - len;
+        int written;
+        switch (type) {
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                double value;
+                memcpy(&value, &word, sizeof(value));
+                written = snprintf(out, room, spec, value);
+                break;
+            }
+            case 's':
+                written = snprintf(out, room, spec, word != 0 ? (const char *)(uintptr_t)word : "(null)");
+                break;
+            case 'p':
+                written = snprintf(out, room, spec, (void *)(uintptr_t)word);
+                break;
+            default:
+                if (longs >= 2) {
+                    written = snprintf(out, room, spec, (long long)word);
+                } else if (longs == 1) {
+                    written = snprintf(out, room, spec, (long)word);
+                } else {
+                    written = snprintf(out, room, spec, (int)word);
+                }
+                break;
+        }
+        if (written < 0) {
+            break;
+        }
+        len += (size_t)written < room ? (size_t)written : room - 1;
+    }
+    line[len] = '\0';
+}
+
+uint32_t deferred_log_flush(void) {
+    dlog_record_t *records = __atomic_load_n(&ring, __ATOMIC_ACQUIRE);
+    if (records == NULL) {
+        return 0;
+    }
+
+    char line[DLOG_LINE_MAX];
+    uint32_t count = 0;
+    while (1) {
+        dlog_record_t *record = &records[tail & (DLOG_RING_RECORDS - 1)];
+        if (__atomic_load_n(&record->seq, __ATOMIC_ACQUIRE) != tail + 1) {
+            break;      // Empty, or the next producer has not committed yet
+        }
+
+        dlog_record_t copy = *record;
+        __atomic_store_n(&record->seq, tail + DLOG_RING_RECORDS, __ATOMIC_RELEASE);
+        __atomic_store_n(&tail, tail + 1, __ATOMIC_RELAXED);
+
+        format_record(&copy, line, sizeof(line));
+        const dlog_site_t *site = copy.site;
+        if (copy.suppressed > 0) {
+            esp_log_write(site->level, site->tag, "%c (%lu) %s: %s (+%lu suppressed)\n",
+                          level_letters[site->level], copy.timestamp_ms, site->tag, line, copy.suppressed);
+        } else {
+            esp_log_write(site->level, site->tag, "%c (%lu) %s: %s\n",
+                          level_letters[site->level], copy.timestamp_ms, site->tag, line);
+        }
+        count++;
+    }
+
+    stats.formatted += count;
+    return count;
+}
+
+void deferred_log_task(void *parameters) {
+    ESP_LOGD(TAG, "Starting deferred log task");
+    __atomic_store_n(&consumer, xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
+
+    // Records written during boot, before there was anyone to signal
+    deferred_log_flush();
+
+    while (1) {
+        batch_notify_wait(DLOG_MAX_LATENCY_MS);
+        deferred_log_flush();
+    }
+}
+
+esp_err_t deferred_log_get_stats(deferred_log_stats_t *out_stats) {
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    out_stats->written = __atomic_load_n(&stats.written, __ATOMIC_RELAXED);
+    out_stats->formatted = stats.formatted;
+    out_stats->dropped = __atomic_load_n(&stats.dropped, __ATOMIC_RELAXED);
+    out_stats->high_water = __atomic_load_n(&stats.high_water, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
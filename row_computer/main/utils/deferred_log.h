@@ -0,0 +1,123 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "timebase.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Deferred binary logging for real-time tasks. A DLOGx() call stores only its
+// callsite and raw arguments in a lock-free ring; the text is formatted later by
+// deferred_log_task() at idle priority. Task context only (not from ISRs).
+//
+// %s arguments are stored as pointers and must outlive the record - string
+// literals and esp_err_to_name() are fine, stack buffers are not. Integers are
+// kept as 64-bit, floats are promoted to double exactly as printf would.
+
+#define DLOG_MAX_ARGS       8
+
+// One per callsite (static, created by the macros below)
+typedef struct {
+    const char *tag;
+    const char *format;
+    esp_log_level_t level;
+    uint8_t nargs;
+    uint32_t interval_ms;       // Rate limit, 0 = every call
+    uint32_t last_ms;
+    uint32_t emitted;
+    uint32_t suppressed;        // Rate-limited or dropped since the last record
+} dlog_site_t;
+
+typedef struct {
+    uint32_t written;           // Records stored by producers
+    uint32_t formatted;         // Records printed by the consumer
+    uint32_t dropped;           // Ring full
+    uint32_t high_water;        // Most records waiting at once
+} deferred_log_stats_t;
+
+// Rate-limited, deferred log. interval_ (ms) limits this callsite to one record per
+// interval; the suppressed count is reported with the next record that gets through.
+#define DLOG_RATE(level_, tag_, interval_, format_, ...) do {                                  \
+        static dlog_site_t dlog_site_ = { NULL, format_, level_,                               \
+                                          DLOG_NARGS(__VA_ARGS__), interval_, 0, 0, 0 };       \
+        if ((level_) <= LOG_LOCAL_LEVEL && dlog_admit(&dlog_site_)) {                          \
+            dlog_site_.tag = (tag_);                                                           \
+            const uint64_t dlog_args_[] = { DLOG_PACK(__VA_ARGS__) };                          \
+            deferred_log_write(&dlog_site_, dlog_args_);                                       \
+        }                                                                                      \
+    } while (0)
+
+#define DLOGE(tag, format, ...)     DLOG_RATE(ESP_LOG_ERROR, tag, 0, format, ##__VA_ARGS__)
+#define DLOGW(tag, format, ...)     DLOG_RATE(ESP_LOG_WARN, tag, 0, format, ##__VA_ARGS__)
+#define DLOGI(tag, format, ...)     DLOG_RATE(ESP_LOG_INFO, tag, 0, format, ##__VA_ARGS__)
+#define DLOGD(tag, format, ...)     DLOG_RATE(ESP_LOG_DEBUG, tag, 0, format, ##__VA_ARGS__)
+
+// Allocate the ring. Records written before this are dropped.
+esp_err_t deferred_log_init(void);
+
+// Store one record; prefer the macros. Wakes the consumer for warnings and errors
+// immediately, otherwise in batches (DLOG_BATCH_WATERMARK / DLOG_MAX_LATENCY_MS).
+void deferred_log_write(dlog_site_t *site, const uint64_t *args);
+
+// Format and print everything waiting. Consumer task only.
+uint32_t deferred_log_flush(void);
+
+// Consumer: lowest priority, formats batches as they are signalled
+void deferred_log_task(void *parameters);
+
+esp_err_t deferred_log_get_stats(deferred_log_stats_t *out_stats);
+
+// Per-callsite rate limit (hot path - inline)
+static inline bool dlog_admit(dlog_site_t *site) {
+    if (site->interval_ms == 0) {
+        return true;
+    }
+    uint32_t now_ms = timebase_now_ms();
+    if (site->emitted > 0 && now_ms - site->last_ms < site->interval_ms) {
+        site->suppressed++;
+        return false;
+    }
+    site->last_ms = now_ms;
+    return true;
+}
+
+// Argument packing: every argument becomes one 64-bit word
+static inline uint64_t dlog_arg_int(long long value) { return (uint64_t)value; }
+static inline uint64_t dlog_arg_uint(unsigned long long value) { return value; }
+static inline uint64_t dlog_arg_ptr(const void *value) { return (uint64_t)(uintptr_t)value; }
+static inline uint64_t dlog_arg_double(double value) {
+    uint64_t word;
+    memcpy(&word, &value, sizeof(word));
+    return word;
+}
+
+#define DLOG_ARG(x) _Generic((x),                                                   \
+        float: dlog_arg_double, double: dlog_arg_double,                            \
+        char: dlog_arg_int, signed char: dlog_arg_int, short: dlog_arg_int,         \
+        int: dlog_arg_int, long: dlog_arg_int, long long: dlog_arg_int,             \
+        _Bool: dlog_arg_uint, unsigned char: dlog_arg_uint,                         \
+        unsigned short: dlog_arg_uint, unsigned int: dlog_arg_uint,                 \
+        unsigned long: dlog_arg_uint, unsigned long long: dlog_arg_uint,            \
+        default: dlog_arg_ptr)(x)
+
+#define DLOG_NARGS(...)     DLOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+
+#define DLOG_CAT(a, b)      DLOG_CAT_(a, b)
+#define DLOG_CAT_(a, b)     a##b
+#define DLOG_PACK(...)      DLOG_CAT(DLOG_PACK_, DLOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define DLOG_PACK_0()                           0
+#define DLOG_PACK_1(a)                          DLOG_ARG(a)
+#define DLOG_PACK_2(a, b)                       DLOG_ARG(a), DLOG_PACK_1(b)
+#define DLOG_PACK_3(a, b, c)                    DLOG_ARG(a), DLOG_PACK_2(b, c)
+#define DLOG_PACK_4(a, b, c, d)                 DLOG_ARG(a), DLOG_PACK_3(b, c, d)
+#define DLOG_PACK_5(a, b, c, d, e)              DLOG_ARG(a), DLOG_PACK_4(b, c, d, e)
+#define DLOG_PACK_6(a, b, c, d, e, f)           DLOG_ARG(a), DLOG_PACK_5(b, c, d, e, f)
+#define DLOG_PACK_7(a, b, c, d, e, f, g)        DLOG_ARG(a), DLOG_PACK_6(b, c, d, e, f, g)
+#define DLOG_PACK_8(a, b, c, d, e, f, g, h)     DLOG_ARG(a), DLOG_PACK_7(b, c, d, e, f, g, h)
+
+#endif // DEFERRED_LOG_H
@@ -0,0 +1,240 @@
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "config/common_constants.h"
+#include "config/pin_definitions.h"
+#include "event_capture.h"
+#include "batch_notify.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "CAPTURE";
+
+// Sequence numbers count every pushed sample; slot = seq % ring_samples.
+// While a window is open the consumer's tail pins the ring: the producer
+// never overwrites [tail, head), so streaming needs no copy of the ring.
+static capture_sample_t *ring = NULL;
+static size_t ring_samples = 0;
+static uint32_t pre_samples = 0;
+static uint32_t post_samples = 0;
+static int32_t crab_gyro_lsb = 0;
+static bool crab_above = false;
+
+static uint32_t head = 0;               // Next sequence number to write
+static uint32_t tail = 0;               // Next sequence number to stream
+static bool open = false;               // window has samples left to stream
+static bool pending = false;            // next starts once window is drained
+static capture_window_t window = {0};   // Keeps its bounds after closing (no re-streaming)
+static capture_window_t next = {0};
+static uint32_t window_id = 0;
+static uint32_t gap_seq = 0;            // head at the last refused sample (0: none yet)
+
+static TaskHandle_t consumer = NULL;
+static capture_stats_t stats = {0};
+static portMUX_TYPE capture_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Caller holds capture_mux. Returns true when the consumer should be woken.
+static bool trigger_locked(capture_trigger_t trigger, timebase_us_t timestamp_us) {
+    uint32_t start = head > pre_samples ? head - pre_samples : 0;
+    capture_window_t *last = pending ? &next : &window;
+
+    // Overlaps the open window: extend it so the boundary has no gap and no duplicate
+    if ((open || pending) && start <= last->end_seq) {
+        if (head + post_samples > last->end_seq) {
+            last->end_seq = head + post_samples;
+        }
+        last->truncated |= gap_seq > last->first_seq;
+        stats.retriggers++;
+        return false;
+    }
+
+    // The waiting window is kept as it was - its trigger came first
+    if (pending) {
+        stats.dropped++;
+        return false;
+    }
+
+    // A closed window's samples were already streamed - start after it
+    if (start < last->end_seq) {
+        start = last->end_seq;
+    }
+
+    capture_window_t w = {
+        .id = ++window_id,
+        .trigger = trigger,
+        .first_seq = start,
+        .end_seq = head + post_samples,
+        .trigger_us = timestamp_us,
+        .truncated = gap_seq > start,   // Pre-trigger history already has a hole
+    };
+    stats.windows++;
+
+    if (open) {
+        next = w;
+        pending = true;
+        return false;
+    }
+    window = w;
+    tail = start;
+    open = true;
+    return true;    // Pre-trigger samples are ready now
+}
+
+esp_err_t event_capture_init(size_t samples, size_t pre, size_t post) {
+    if (samples == 0 || pre + post >= samples) {
+        ESP_LOGE(TAG, "Ring of %u samples cannot hold %u + %u", (unsigned)samples, (unsigned)pre, (unsigned)post);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (ring == NULL) {
+        ring = heap_caps_malloc(samples * sizeof(capture_sample_t), MALLOC_CAP_8BIT);
+        if (ring == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate %u byte capture ring", (unsigned)(samples * sizeof(capture_sample_t)));
+            return ESP_ERR_NO_MEM;
+        }
+        ring_samples = samples;
+    } else if (samples != ring_samples) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    taskENTER_CRITICAL(&capture_mux);
+    pre_samples = pre;
+    post_samples = post;
+    crab_gyro_lsb = (int32_t)(CAPTURE_CRAB_GYRO_DPS * LSB_SENSITIVITY_250_deg);
+    head = tail = gap_seq = 0;
+    open = pending = false;
+    memset(&window, 0, sizeof(window));
+    memset(&stats, 0, sizeof(stats));
+    stats.ring_samples = samples;
+    taskEXIT_CRITICAL(&capture_mux);
+
+    ESP_LOGD(TAG, "Capture ring: %u samples (%u bytes), window %u + %u",
+            (unsigned)samples, (unsigned)(samples * sizeof(capture_sample_t)), (unsigned)pre, (unsigned)post);
+    return ESP_OK;
+}
+
+void event_capture_set_consumer(TaskHandle_t task) {
+    consumer = task;
+}
+
+void event_capture_set_crab_threshold(float gyro_dps) {
+    crab_gyro_lsb = (int32_t)(gyro_dps * LSB_SENSITIVITY_250_deg);
+}
+
+void event_capture_push(const mpu6050_raw_t *raw, timebase_us_t timestamp_us) {
+    if (ring == NULL) {
+        return;
+    }
+
+    // Crab detection on raw counts: rising edge of a large rotation on any axis
+    bool above = abs(raw->v[MPU6050_GX]) > crab_gyro_lsb ||
+                 abs(raw->v[MPU6050_GY]) > crab_gyro_lsb ||
+                 abs(raw->v[MPU6050_GZ]) > crab_gyro_lsb;
+    bool crab = above && !crab_above;
+    crab_above = above;
+    uint16_t timestamp_ms = (uint16_t)timebase_ms(timestamp_us);
+    bool wake = false;
+
+    taskENTER_CRITICAL(&capture_mux);
+    if (open && head - tail >= ring_samples) {
+        // Consumer has fallen a full ring behind the frozen window. The sample
+        // would have gone between head - 1 and head: a window spanning that is cut.
+        stats.overruns++;
+        gap_seq = head;
+        if (pending && head > next.first_seq && head < next.end_seq) {
+            next.truncated = true;
+        }
+        taskEXIT_CRITICAL(&capture_mux);
+        return;
+    }
+
+    capture_sample_t *slot = &ring[head % ring_samples];
+    memcpy(slot->v, raw->v, sizeof(slot->v));
+    slot->timestamp_ms = timestamp_ms;
+    head++;
+    stats.samples++;
+
+    if (crab) {
+        wake = trigger_locked(CAPTURE_TRIGGER_THRESHOLD, timestamp_us);
+    }
+    if (open && head <= window.end_seq &&
+        (head == window.end_seq || (head - window.first_seq) % CAPTURE_DRAIN_CHUNK == 0)) {
+        wake = true;
+    }
+    taskEXIT_CRITICAL(&capture_mux);
+
+    if (wake && consumer != NULL) {
+        xTaskNotify(consumer, BATCH_NOTIFY_FLUSH, eSetBits);
+    }
+}
+
+void event_capture_trigger(capture_trigger_t trigger, timebase_us_t timestamp_us) {
+    if (ring == NULL) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&capture_mux);
+    bool wake = trigger_locked(trigger, timestamp_us);
+    taskEXIT_CRITICAL(&capture_mux);
+
+    if (wake && consumer != NULL) {
+        xTaskNotify(consumer, BATCH_NOTIFY_FLUSH, eSetBits);
+    }
+}
+
+size_t event_capture_peek(const capture_sample_t **samples, uint32_t *first_seq, capture_window_t *out_window) {
+    size_t count = 0;
+
+    taskENTER_CRITICAL(&capture_mux);
+    if (open) {
+        uint32_t ready_end = head < window.end_seq ? head : window.end_seq;
+        if (ready_end > tail) {
+            // Stop at the physical end of the ring so the run is contiguous
+            size_t index = tail % ring_samples;
+            count = ready_end - tail;
+            if (count > ring_samples - index) {
+                count = ring_samples - index;
+            }
+            *samples = &ring[index];
+            *first_seq = tail;
+            if (out_window != NULL) {
+                *out_window = window;
+            }
+        }
+    }
+    taskEXIT_CRITICAL(&capture_mux);
+
+    return count;
+}
+
+void event_capture_release(size_t count) {
+    taskENTER_CRITICAL(&capture_mux);
+    if (open) {
+        tail += count;
+        stats.streamed += count;
+        if (tail >= window.end_seq) {
+            if (pending) {
+                window = next;
+                tail = window.first_seq;
+                pending = false;
+            } else {
+                open = false;
+            }
+        }
+    }
+    taskEXIT_CRITICAL(&capture_mux);
+}
+
+bool event_capture_window_open(void) {
+    return open;
+}
+
+esp_err_t event_capture_get_stats(capture_stats_t *out_stats) {
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&capture_mux);
+    *out_stats = stats;
+    taskEXIT_CRITICAL(&capture_mux);
+    return ESP_OK;
+}
@@ -0,0 +1,74 @@
+#ifndef EVENT_CAPTURE_H
+#define EVENT_CAPTURE_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sensors/mpu6050.h"
+#include "utils/timebase.h"
+
+// One full-resolution sample as stored in the pre-trigger ring (16 bytes)
+typedef struct {
+    int16_t v[MPU6050_RAW_COUNT];       // Bias-corrected raw counts, mpu6050_raw_t order
+    uint16_t timestamp_ms;              // Low 16 bits of timebase_ms() - full time is in the window header
+} capture_sample_t;
+
+typedef enum {
+    CAPTURE_TRIGGER_STROKE,             // Stroke detector (catch)
+    CAPTURE_TRIGGER_THRESHOLD,          // Raw gyro threshold in the producer (crab)
+    CAPTURE_TRIGGER_MANUAL,
+    CAPTURE_TRIGGER_COUNT
+} capture_trigger_t;
+
+// Frozen window currently being streamed out
+typedef struct {
+    uint32_t id;                        // Increments per window (re-triggers extend, not restart)
+    capture_trigger_t trigger;          // Trigger that opened the window
+    uint32_t first_seq;                 // Sample sequence number of the window start
+    uint32_t end_seq;                   // One past the last sample (moves on re-trigger)
+    timebase_us_t trigger_us;           // Full timestamp of the opening trigger
+    bool truncated;                     // Samples in its span were refused (overrun) - time has a gap
+} capture_window_t;
+
+typedef struct {
+    uint32_t samples;                   // Total samples pushed
+    uint32_t windows;
+    uint32_t retriggers;                // Triggers merged into an open window
+    uint32_t streamed;                  // Samples handed to the consumer
+    uint32_t overruns;                  // Samples refused because a frozen window filled the ring
+    uint32_t dropped;                   // Triggers refused: a window was already waiting behind the open one
+    size_t ring_samples;
+} capture_stats_t;
+
+// Allocate the ring (ring_samples * 16 bytes). pre + post must leave room for the consumer.
+esp_err_t event_capture_init(size_t ring_samples, size_t pre_samples, size_t post_samples);
+
+// Task to notify when window samples are ready (call from the consumer task itself)
+void event_capture_set_consumer(TaskHandle_t consumer);
+
+// Crab trigger level (init uses CAPTURE_CRAB_GYRO_DPS). Call from the producer task.
+void event_capture_set_crab_threshold(float gyro_dps);
+
+// Producer: append one sample. O(1), no copies beyond the 16-byte slot.
+void event_capture_push(const mpu6050_raw_t *raw, timebase_us_t timestamp_us);
+
+// Freeze the last pre_samples plus the next post_samples. Safe from any task.
+// A trigger inside an open window extends it, so back-to-back events stay contiguous.
+// One further window can wait behind the open one; a trigger past both is dropped.
+void event_capture_trigger(capture_trigger_t trigger, timebase_us_t timestamp_us);
+
+// Consumer: borrow the next contiguous run of window samples directly from the ring.
+// Returns the run length (0 if nothing is ready); the slots stay valid until released.
+size_t event_capture_peek(const capture_sample_t **samples, uint32_t *first_seq, capture_window_t *window);
+
+// Consumer: return count samples from the last peek to the producer
+void event_capture_release(size_t count);
+
+bool event_capture_window_open(void);
+
+esp_err_t event_capture_get_stats(capture_stats_t *out_stats);
+
+#endif // EVENT_CAPTURE_H
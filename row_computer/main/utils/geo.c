@@ -0,0 +1,54 @@
+#include <math.h>
+#include <stdlib.h>
+#include "config/common_constants.h"
+#include "geo.h"
+
+#define WGS84_A         6378137.0f          // Semi-major axis (m)
+#define WGS84_E2        6.69437999014e-3f   // First eccentricity squared
+#define E7_TO_RAD       (3.14159265358979f / 180.0f * 1e-7f)
+
+// Signed difference of two longitudes, wrapped across the antimeridian
+static inline int32_t lon_delta_e7(int32_t lon_e7, int32_t lon0_e7) {
+    int64_t delta = (int64_t)lon_e7 - lon0_e7;
+    if (delta > 1800000000) {
+        delta -= 3600000000LL;
+    } else if (delta < -1800000000) {
+        delta += 3600000000LL;
+    }
+    return (int32_t)delta;
+}
+
+void geo_ltp_init(geo_ltp_t *ltp, int32_t lat_e7, int32_t lon_e7) {
+    float lat_rad = lat_e7 * E7_TO_RAD;
+    float sin_lat = sinf(lat_rad);
+    float w = 1.0f - WGS84_E2 * sin_lat * sin_lat;
+    float meridian_m = WGS84_A * (1.0f - WGS84_E2) / (w * sqrtf(w));
+    float prime_vertical_m = WGS84_A / sqrtf(w);
+
+    ltp->lat0_e7 = lat_e7;
+    ltp->lon0_e7 = lon_e7;
+    ltp->north_m_per_e7 = meridian_m * E7_TO_RAD;
+    ltp->east_m_per_e7 = prime_vertical_m * cosf(lat_rad) * E7_TO_RAD;
+    ltp->valid = true;
+}
+
+bool geo_ltp_follow(geo_ltp_t *ltp, int32_t lat_e7, int32_t lon_e7) {
+    if (ltp->valid &&
+        abs(lat_e7 - ltp->lat0_e7) < GEO_LTP_REANCHOR_E7 &&
+        abs(lon_delta_e7(lon_e7, ltp->lon0_e7)) < GEO_LTP_REANCHOR_E7) {
+        return false;
+    }
+    geo_ltp_init(ltp, lat_e7, lon_e7);
+    return true;
+}
+
+void geo_ltp_project(const geo_ltp_t *ltp, int32_t lat_e7, int32_t lon_e7, float *east_m, float *north_m) {
+    *north_m = (float)(lat_e7 - ltp->lat0_e7) * ltp->north_m_per_e7;
+    *east_m = (float)lon_delta_e7(lon_e7, ltp->lon0_e7) * ltp->east_m_per_e7;
+}
+
+float geo_ltp_distance_m(const geo_ltp_t *ltp, int32_t lat1_e7, int32_t lon1_e7, int32_t lat2_e7, int32_t lon2_e7) {
+    float north_m = (float)(lat2_e7 - lat1_e7) * ltp->north_m_per_e7;
+    float east_m = (float)lon_delta_e7(lon2_e7, lon1_e7) * ltp->east_m_per_e7;
+    return sqrtf(north_m * north_m + east_m * east_m);
+}
@@ -0,0 +1,32 @@
+#ifndef GEO_H
+#define GEO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Local tangent plane (east/north metres) around an origin, working directly on
+// 1e-7 degree integers. Scale factors come from the WGS84 radii of curvature at
+// the origin, so a fix costs two integer subtractions and two float multiplies.
+// Accurate to well under 0.1% within GEO_LTP_REANCHOR_E7 of the origin.
+typedef struct {
+    int32_t lat0_e7;
+    int32_t lon0_e7;
+    float north_m_per_e7;       // Metres per 1e-7 degree of latitude
+    float east_m_per_e7;        // Metres per 1e-7 degree of longitude at lat0
+    bool valid;
+} geo_ltp_t;
+
+// Place the origin (computes the scale factors - trig, call rarely)
+void geo_ltp_init(geo_ltp_t *ltp, int32_t lat_e7, int32_t lon_e7);
+
+// Move the origin to this position once it has drifted GEO_LTP_REANCHOR_E7 away.
+// Returns true if the origin moved.
+bool geo_ltp_follow(geo_ltp_t *ltp, int32_t lat_e7, int32_t lon_e7);
+
+// Position relative to the origin
+void geo_ltp_project(const geo_ltp_t *ltp, int32_t lat_e7, int32_t lon_e7, float *east_m, float *north_m);
+
+// Straight-line distance between two nearby positions
+float geo_ltp_distance_m(const geo_ltp_t *ltp, int32_t lat1_e7, int32_t lon1_e7, int32_t lat2_e7, int32_t lon2_e7);
+
+#endif // GEO_H
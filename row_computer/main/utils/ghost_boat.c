@@ -0,0 +1,184 @@
+#include "esp_log.h"
+#include "config/common_constants.h"
+#include "ghost_boat.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "GHOST_BOAT";
+
+// One reference stroke: distance (never 0) and time since the previous one, split at its end
+typedef struct {
+    uint16_t distance_dm;
+    uint16_t time_ms;
+    uint16_t split_ds;
+} ghost_step_t;
+
+// Reference
+static ghost_step_t table[GHOST_MAX_STROKES];
+static uint32_t step_count = 0;
+static bool loaded = false;
+static bool building_first = false;
+static uint32_t build_distance_dm;
+static uint32_t build_time_ms;
+
+// Live piece and the lookup cursor: entry `cursor` spans
+// [cursor_dm, cursor_dm + table[cursor].distance_dm) of the reference
+static bool active = false;
+static timebase_us_t start_us;
+static float start_distance_m;
+static uint32_t cursor;
+static uint32_t cursor_dm;
+static uint32_t cursor_ms;
+
+static ghost_boat_stats_t stats;
+
+void ghost_boat_reference_begin(void) {
+    loaded = false;
+    active = false;
+    step_count = 0;
+    building_first = true;
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool ghost_boat_reference_stroke(float distance_m, uint32_t elapsed_ms, uint16_t split_ds) {
+    uint32_t distance_dm = (uint32_t)lroundf(fmaxf(distance_m, 0.0f) * 10.0f);
+    if (building_first) {
+        build_distance_dm = distance_dm;
+        build_time_ms = elapsed_ms;
+        building_first = false;
+        return true;
+    }
+    if (step_count >= GHOST_MAX_STROKES) {
+        return false;
+    }
+
+    // Steps are 16-bit: a longer one can only be a pause, which already ends a piece
+    uint32_t step_dm = distance_dm > build_distance_dm ? distance_dm - build_distance_dm : 0;
+    uint32_t step_ms = elapsed_ms - build_time_ms;
+    if (step_dm > UINT16_MAX || step_ms > UINT16_MAX || elapsed_ms < build_time_ms) {
+        return false;
+    }
+    // A catch at the distance of the previous one (the first strokes of a standing
+    // start) gets no entry of its own: its time goes into the next step, so every
+    // entry has a length to interpolate over
+    if (step_dm == 0) {
+        return true;
+    }
+    table[step_count++] = (ghost_step_t){
+        .distance_dm = (uint16_t)step_dm,
+        .time_ms = (uint16_t)step_ms,
+        .split_ds = split_ds,
+    };
+    build_distance_dm += step_dm;
+    build_time_ms = elapsed_ms;
+    return true;
+}
+
+esp_err_t ghost_boat_reference_end(void) {
+    if (step_count == 0 || build_distance_dm == 0) {
+        ESP_LOGW(TAG, "Reference has no distance - ghost boat off");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    stats.strokes = step_count + 1;
+    stats.length_m = build_distance_dm / 10.0f;
+    stats.duration_ms = build_time_ms;
+    stats.memory_bytes = step_count * sizeof(ghost_step_t);
+    loaded = true;
+    return ESP_OK;
+}
+
+bool ghost_boat_loaded(void) {
+    return loaded;
+}
+
+void ghost_boat_start(float distance_m, timebase_us_t timestamp_us) {
+    if (!loaded) {
+        return;
+    }
+    active = true;
+    start_us = timestamp_us;
+    start_distance_m = distance_m;
+    cursor = 0;
+    cursor_dm = 0;
+    cursor_ms = 0;
+    stats.pieces++;
+}
+
+void ghost_boat_stop(void) {
+    active = false;
+}
+
+bool ghost_boat_active(void) {
+    return active;
+}
+
+// Reference time at a piece distance. Walks the cursor to the step containing
+// it - forwards as the boat moves, backwards only after a GPS correction.
+static bool reference_at(float distance_m, float *time_ms, const ghost_step_t **step) {
+    float distance_dm = fmaxf(distance_m, 0.0f) * 10.0f;
+    stats.lookups++;
+
+    while (cursor < step_count && (float)(cursor_dm + table[cursor].distance_dm) <= distance_dm) {
+        cursor_dm += table[cursor].distance_dm;
+        cursor_ms += table[cursor].time_ms;
+        cursor++;
+        stats.cursor_steps++;
+    }
+    while (cursor > 0 && (float)cursor_dm > distance_dm) {
+        cursor--;
+        cursor_dm -= table[cursor].distance_dm;
+        cursor_ms -= table[cursor].time_ms;
+        stats.cursor_steps++;
+    }
+    if (cursor == step_count) {
+        return false;   // Past the reference finish
+    }
+
+    *step = &table[cursor];
+    *time_ms = cursor_ms + (*step)->time_ms * (distance_dm - cursor_dm) / (*step)->distance_dm;
+    return true;
+}
+
+static bool piece_delta(float distance_m, timebase_us_t timestamp_us, const ghost_step_t **step,
+                        ghost_boat_delta_t *out) {
+    float reference_ms;
+    if (!active || !reference_at(distance_m - start_distance_m, &reference_ms, step)) {
+        return false;
+    }
+    out->elapsed_ms = timestamp_us > start_us ? (uint32_t)((timestamp_us - start_us) / 1000) : 0;
+    out->delta_ms = (int32_t)out->elapsed_ms - (int32_t)lrintf(reference_ms);
+    out->rate_delta_spm = 0;
+    out->split_delta_ds = 0;
+    return true;
+}
+
+bool ghost_boat_update(float distance_m, timebase_us_t timestamp_us, ghost_boat_delta_t *out) {
+    const ghost_step_t *step;
+    return piece_delta(distance_m, timestamp_us, &step, out);
+}
+
+bool ghost_boat_stroke(float distance_m, timebase_us_t catch_us, uint16_t rate_spm, uint32_t split_ds,
+                       ghost_boat_delta_t *out) {
+    const ghost_step_t *step;
+    if (!piece_delta(distance_m, catch_us, &step, out)) {
+        return false;
+    }
+
+    // The reference stroke covering this distance: rate from its length in time
+    if (rate_spm != 0 && step->time_ms != 0) {
+        out->rate_delta_spm = (int16_t)((int32_t)rate_spm - (int32_t)(60000 / step->time_ms));
+    }
+    if (split_ds != 0 && step->split_ds != 0) {
+        int32_t delta = (int32_t)split_ds - (int32_t)step->split_ds;
+        out->split_delta_ds = (int16_t)(delta > INT16_MAX ? INT16_MAX : delta < INT16_MIN ? INT16_MIN : delta);
+    }
+    return true;
+}
+
+esp_err_t ghost_boat_get_stats(ghost_boat_stats_t *out_stats) {
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_stats = stats;
+    return ESP_OK;
+}
@@ -0,0 +1,67 @@
+#ifndef GHOST_BOAT_H
+#define GHOST_BOAT_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "utils/timebase.h"
+
+// Ghost boat: races the current piece against a reference piece (a previous
+// piece from the card, storage/ghost_reference.h) by distance rowed.
+//
+// The reference is a distance->time table with one entry per reference stroke
+// (a stroke that did not move the boat is folded into the next one), kept as
+// 16-bit distance and time steps plus the split the boat showed (6 bytes a
+// stroke, GHOST_MAX_STROKES entries in a static table - a 6 km piece at 36spm
+// takes about 5 kB). Live distances only ever move a little between updates,
+// so lookups walk a cursor from the previous position and accumulate the steps
+// as they go: O(1) per update, no search and no absolute table needed.
+//
+// Reference building (begin/stroke/end) happens before the DSP task starts;
+// everything else is called from the DSP task only.
+
+typedef struct {
+    uint32_t elapsed_ms;        // Since the start of the live piece
+    int32_t delta_ms;           // Behind (+) or ahead (-) of the reference at this distance
+    int16_t rate_delta_spm;     // Live minus reference stroke rate (ghost_boat_stroke only)
+    int16_t split_delta_ds;     // Live minus reference split, + = slower (ghost_boat_stroke only)
+} ghost_boat_delta_t;
+
+typedef struct {
+    uint32_t strokes;           // Reference table entries
+    float length_m;             // Reference piece
+    uint32_t duration_ms;
+    size_t memory_bytes;        // Table size
+    uint32_t pieces;            // Live pieces started
+    uint32_t lookups;
+    uint64_t cursor_steps;      // Entries walked over all lookups
+} ghost_boat_stats_t;
+
+// Build a reference: strokes in order, distance and time from the piece start
+// (the first stroke is at 0, 0) and the split at the catch (0 = unknown).
+// Strokes beyond GHOST_MAX_STROKES are dropped - the ghost then ends early. The
+// reference is in use after ghost_boat_reference_end().
+void ghost_boat_reference_begin(void);
+bool ghost_boat_reference_stroke(float distance_m, uint32_t elapsed_ms, uint16_t split_ds);
+esp_err_t ghost_boat_reference_end(void);
+bool ghost_boat_loaded(void);
+
+// Live piece from its first stroke (distance is the running session distance)
+void ghost_boat_start(float distance_m, timebase_us_t timestamp_us);
+void ghost_boat_stop(void);
+bool ghost_boat_active(void);
+
+// Time delta at the current distance. False without a live piece, or once it
+// went past the end of the reference.
+bool ghost_boat_update(float distance_m, timebase_us_t timestamp_us, ghost_boat_delta_t *out);
+
+// Same at a catch, plus the rate and split deltas against the reference stroke
+// at this distance (split_ds 0 = unknown, no split delta). Splits come from the
+// GPS speed on both sides, so they compare like for like.
+bool ghost_boat_stroke(float distance_m, timebase_us_t catch_us, uint16_t rate_spm, uint32_t split_ds,
+                       ghost_boat_delta_t *out);
+
+esp_err_t ghost_boat_get_stats(ghost_boat_stats_t *out_stats);
+
+#endif // GHOST_BOAT_H
@@ -0,0 +1,251 @@
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "driver/i2c.h"
+#include "driver/gpio.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "i2c_bus.h"
+#include "deferred_log.h"
+#include "stats.h"
+#include "timebase.h"
+#include <stdio.h>
+
+static const char *TAG = "I2C_BUS";
+
+#define I2C_RECOVERY_CLOCKS     9       // Enough for a slave to finish any byte it is sending
+#define I2C_RECOVERY_HALF_US    5       // ~100kHz bit-banged clock
+
+typedef struct {
+    uint8_t address;
+    const char *name;
+} i2c_device_info_t;
+
+typedef struct {
+    i2c_device_stats_t stats;
+    uint32_t consecutive_failures;
+    uint32_t open_until_ms;
+} i2c_device_state_t;
+
+static const i2c_device_info_t devices[I2C_DEV_COUNT] = {
+    [I2C_DEV_MPU6050] = { MPU6050_ADDR, "MPU6050" },
+    [I2C_DEV_MAG]     = { HMC5883L_ADDR, "HMC5883L" },
+};
+
+static const char *breaker_names[] = { "CLOSED", "OPEN", "HALF_OPEN" };
+
+static i2c_device_state_t state[I2C_DEV_COUNT];
+static uint32_t recoveries = 0;
+static uint32_t last_recovery_ms = 0;
+
+// Nominal wire time of a register transaction, times a safety margin, in ticks.
+// Write-read: addr + reg + addr + len bytes at 9 clocks each, plus start/restart/stop.
+static TickType_t transaction_timeout(size_t write_len, size_t read_len) {
+    size_t bytes = 1 + write_len + (read_len > 0 ? 1 + read_len : 0);
+    uint32_t wire_us = (uint32_t)((bytes * 9 + 4) * 1000000ULL / I2C_MASTER_FREQ_HZ);
+    uint32_t timeout_ms = (wire_us * I2C_TIMEOUT_MARGIN + 999) / 1000;
+    if (timeout_ms < I2C_TIMEOUT_MIN_MS) {
+        timeout_ms = I2C_TIMEOUT_MIN_MS;
+    }
+    // +1 tick: a single tick may already be almost over when the wait starts
+    return pdMS_TO_TICKS(timeout_ms) + 1;
+}
+
+// Fast fail while open; let exactly one probe through once the backoff expired
+static bool breaker_allows(i2c_device_state_t *dev) {
+    if (dev->stats.state != I2C_BREAKER_OPEN) {
+        return true;
+    }
+    if ((int32_t)(timebase_now_ms() - dev->open_until_ms) >= 0) {
+        dev->stats.state = I2C_BREAKER_HALF_OPEN;
+        return true;
+    }
+    dev->stats.rejected++;
+    return false;
+}
+
+static void breaker_record(i2c_device_t device, esp_err_t err) {
+    i2c_device_state_t *dev = &state[device];
+    dev->stats.transactions++;
+
+    if (err == ESP_OK) {
+        dev->consecutive_failures = 0;
+        if (dev->stats.state != I2C_BREAKER_CLOSED) {
+            dev->stats.state = I2C_BREAKER_CLOSED;
+            dev->stats.backoff_ms = I2C_BACKOFF_MIN_MS;
+        }
+        return;
+    }
+
+    dev->stats.failures++;
+    if (err == ESP_ERR_TIMEOUT) {
+        dev->stats.timeouts++;
+    }
+
+    bool probe_failed = dev->stats.state == I2C_BREAKER_HALF_OPEN;
+    if (!probe_failed && ++dev->consecutive_failures < I2C_BREAKER_THRESHOLD) {
+        return;
+    }
+
+    // Trip: a failed probe doubles the open period, a fresh trip starts at the minimum
+    if (probe_failed) {
+        dev->stats.backoff_ms = dev->stats.backoff_ms * 2 > I2C_BACKOFF_MAX_MS ?
+                                I2C_BACKOFF_MAX_MS : dev->stats.backoff_ms * 2;
+    }
+    dev->stats.state = I2C_BREAKER_OPEN;
+    dev->stats.trips++;
+    dev->open_until_ms = timebase_now_ms() + dev->stats.backoff_ms;
+
+    // A timeout usually means SDA is held low - free the bus for the other devices
+    if (err == ESP_ERR_TIMEOUT) {
+        i2c_bus_recover();
+    }
+}
+
+static esp_err_t driver_install(void) {
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_MASTER_SDA_IO,
+        .scl_io_num = I2C_MASTER_SCL_IO,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+    };
+
+    esp_err_t err = i2c_param_config(I2C_MASTER_NUM, &conf);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return i2c_driver_install(I2C_MASTER_NUM, conf.mode, I2C_MASTER_RX_BUF_DISABLE,
+                              I2C_MASTER_TX_BUF_DISABLE, 0);
+}
+
+static void collect_stats(void) {
+    static stats_metric_t *metrics[I2C_DEV_COUNT][4];
+    static stats_metric_t *recovery_count;
+    static const char *const fields[] = { "failures", "timeouts", "rejected", "trips" };
+    if (recovery_count == NULL) {
+        char name[STATS_NAME_MAX];
+        for (int i = 0; i < I2C_DEV_COUNT; i++) {
+            for (int f = 0; f < 4; f++) {
+                snprintf(name, sizeof(name), "i2c.%s.%s", devices[i].name, fields[f]);
+                metrics[i][f] = stats_register(name, STATS_COUNTER);
+            }
+        }
+        recovery_count = stats_register("i2c.recoveries", STATS_COUNTER);
+    }
+    for (int i = 0; i < I2C_DEV_COUNT; i++) {
+        const i2c_device_stats_t *s = &state[i].stats;
+        stats_set(metrics[i][0], s->failures);
+        stats_set(metrics[i][1], s->timeouts);
+        stats_set(metrics[i][2], s->rejected);
+        stats_set(metrics[i][3], s->trips);
+    }
+    stats_set(recovery_count, recoveries);
+}
+
+esp_err_t i2c_bus_init(void) {
+    static bool collecting = false;
+    if (!collecting) {
+        collecting = stats_register_collector(collect_stats) == ESP_OK;
+    }
+    for (int i = 0; i < I2C_DEV_COUNT; i++) {
+        state[i] = (i2c_device_state_t){ .stats.backoff_ms = I2C_BACKOFF_MIN_MS };
+    }
+    recoveries = 0;
+    return driver_install();
+}
+
+esp_err_t i2c_bus_read(i2c_device_t device, uint8_t reg_addr, uint8_t *data, size_t len) {
+    if (!breaker_allows(&state[device])) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = i2c_master_write_read_device(I2C_MASTER_NUM, devices[device].address, &reg_addr, 1,
+                                                 data, len, transaction_timeout(1, len));
+    breaker_record(device, err);
+    return err;
+}
+
+esp_err_t i2c_bus_write(i2c_device_t device, uint8_t reg_addr, uint8_t value) {
+    if (!breaker_allows(&state[device])) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t write_buf[2] = {reg_addr, value};
+    esp_err_t err = i2c_master_write_to_device(I2C_MASTER_NUM, devices[device].address, write_buf, 2,
+                                               transaction_timeout(2, 0));
+    breaker_record(device, err);
+    return err;
+}
+
+esp_err_t i2c_bus_recover(void) {
+    uint32_t now = timebase_now_ms();
+    if (recoveries > 0 && now - last_recovery_ms < I2C_RECOVERY_INTERVAL_MS) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    last_recovery_ms = now;
+    recoveries++;
+
+    i2c_driver_delete(I2C_MASTER_NUM);
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << I2C_MASTER_SDA_IO) | (1ULL << I2C_MASTER_SCL_IO),
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    gpio_config(&io_conf);
+    gpio_set_level(I2C_MASTER_SDA_IO, 1);
+    gpio_set_level(I2C_MASTER_SCL_IO, 1);
+
+    // Toggle SCL until the slave releases SDA
+    for (int i = 0; i < I2C_RECOVERY_CLOCKS && gpio_get_level(I2C_MASTER_SDA_IO) == 0; i++) {
+        gpio_set_level(I2C_MASTER_SCL_IO, 0);
+        esp_rom_delay_us(I2C_RECOVERY_HALF_US);
+        gpio_set_level(I2C_MASTER_SCL_IO, 1);
+        esp_rom_delay_us(I2C_RECOVERY_HALF_US);
+    }
+
+    // STOP condition: SDA low -> high while SCL is high
+    gpio_set_level(I2C_MASTER_SCL_IO, 0);
+    gpio_set_level(I2C_MASTER_SDA_IO, 0);
+    esp_rom_delay_us(I2C_RECOVERY_HALF_US);
+    gpio_set_level(I2C_MASTER_SCL_IO, 1);
+    esp_rom_delay_us(I2C_RECOVERY_HALF_US);
+    gpio_set_level(I2C_MASTER_SDA_IO, 1);
+    esp_rom_delay_us(I2C_RECOVERY_HALF_US);
+
+    return driver_install();
+}
+
+uint32_t i2c_bus_recoveries(void) {
+    return recoveries;
+}
+
+esp_err_t i2c_bus_get_stats(i2c_device_t device, i2c_device_stats_t *out_stats) {
+    if (device >= I2C_DEV_COUNT || out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_stats = state[device].stats;
+    return ESP_OK;
+}
+
+const char* i2c_breaker_state_name(i2c_breaker_state_t breaker) {
+    return breaker <= I2C_BREAKER_HALF_OPEN ? breaker_names[breaker] : "?";
+}
+
+void i2c_bus_log_stats(void) {
+    for (int i = 0; i < I2C_DEV_COUNT; i++) {
+        const i2c_device_stats_t *s = &state[i].stats;
+        if (s->failures == 0 && s->rejected == 0) {
+            continue;
+        }
+        DLOGI(TAG, "%s %s - Fail: %lu/%lu (timeouts %lu) | Fast-failed: %lu | Trips: %lu | Backoff: %lu ms",
+              devices[i].name, breaker_names[s->state], s->failures, s->transactions,
+              s->timeouts, s->rejected, s->trips, s->backoff_ms);
+    }
+    if (recoveries > 0) {
+        DLOGI(TAG, "Bus recoveries: %lu", recoveries);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Devices on the shared sensor bus
+typedef enum {
+    I2C_DEV_MPU6050,
+    I2C_DEV_MAG,
+    I2C_DEV_COUNT
+} i2c_device_t;
+
+// Per-device circuit breaker
+typedef enum {
+    I2C_BREAKER_CLOSED,         // Healthy - transactions go to the bus
+    I2C_BREAKER_OPEN,           // Failing - calls fail fast until the backoff expires
+    I2C_BREAKER_HALF_OPEN,      // Backoff expired - the next call is a probe
+} i2c_breaker_state_t;
+
+typedef struct {
+    i2c_breaker_state_t state;
+    uint32_t transactions;      // Calls that reached the bus
+    uint32_t failures;
+    uint32_t timeouts;          // Failures that looked like a stuck bus
+    uint32_t rejected;          // Fast-failed while the breaker was open
+    uint32_t trips;             // CLOSED/HALF_OPEN -> OPEN transitions
+    uint32_t backoff_ms;        // Current open period
+} i2c_device_stats_t;
+
+// Configure and install the I2C master driver
+esp_err_t i2c_bus_init(void);
+
+// Register transactions with a timeout sized to the transfer length. While a device's
+// breaker is open these return ESP_ERR_INVALID_STATE immediately. Nothing is logged
+// per failure - see i2c_bus_get_stats() / i2c_bus_log_stats().
+esp_err_t i2c_bus_read(i2c_device_t device, uint8_t reg_addr, uint8_t *data, size_t len);
+esp_err_t i2c_bus_write(i2c_device_t device, uint8_t reg_addr, uint8_t value);
+
+// Clock SCL until a slave holding SDA low lets go, issue a STOP and reinstall the driver
+esp_err_t i2c_bus_recover(void);
+
+uint32_t i2c_bus_recoveries(void);
+
+esp_err_t i2c_bus_get_stats(i2c_device_t device, i2c_device_stats_t *out_stats);
+
+const char* i2c_breaker_state_name(i2c_breaker_state_t state);
+
+// One line per device with counters since boot
+void i2c_bus_log_stats(void);
+
+#endif // I2C_BUS_H
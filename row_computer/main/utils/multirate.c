@@ -0,0 +1,199 @@
+#include "esp_log.h"
+#include "config/common_constants.h"
+#include "multirate.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "MULTIRATE";
+
+#define CHANNELS        9       // accel xyz, gyro xyz, mag xyz
+#define FILTER_TAPS     (MULTIRATE_FACTOR * MULTIRATE_PHASE_TAPS)
+
+// One decimate-by-MULTIRATE_FACTOR stage in input-driven polyphase form: each input
+// adds into the partial sums of the PHASE_TAPS outputs it contributes to, so no delay
+// line is kept and work is done only for outputs that survive decimation.
+typedef struct {
+    float acc[MULTIRATE_PHASE_TAPS][CHANNELS];
+    uint8_t phase;              // Input index within the current decimation cycle
+    uint8_t warmup;             // Outputs completed since the restart (saturates)
+} stage_t;
+
+// Polyphase coefficients: coef[r][j] = h[j * M + (M - 1 - r)] for input phase r
+static float coef[MULTIRATE_FACTOR][MULTIRATE_PHASE_TAPS];
+static stage_t stages[MULTIRATE_STREAM_COUNT - 1];     // stage s turns stream s into s + 1
+static imu_data_t latest[MULTIRATE_STREAM_COUNT];
+static bus_topic_t *topics[MULTIRATE_STREAM_COUNT];
+static const char *topic_names[MULTIRATE_STREAM_COUNT] = { "imu_1khz", "imu_100hz", "imu_10hz", "imu_1hz" };
+static const uint32_t topic_depths[MULTIRATE_STREAM_COUNT] = {
+    IMU_TOPIC_DEPTH, IMU_TOPIC_DEPTH_SLOW, IMU_TOPIC_DEPTH_SLOW, IMU_TOPIC_DEPTH_SLOW
+};
+static multirate_stats_t stats = {0};
+static multirate_stream_t input = MULTIRATE_1KHZ;
+
+static inline void unpack(const imu_data_t *s, float x[CHANNELS]) {
+    x[0] = s->accel_x; x[1] = s->accel_y; x[2] = s->accel_z;
+    x[3] = s->gyro_x;  x[4] = s->gyro_y;  x[5] = s->gyro_z;
+    x[6] = s->mag_x;   x[7] = s->mag_y;   x[8] = s->mag_z;
+}
+
+static inline void pack(const float x[CHANNELS], imu_data_t *s) {
+    s->accel_x = x[0]; s->accel_y = x[1]; s->accel_z = x[2];
+    s->gyro_x = x[3];  s->gyro_y = x[4];  s->gyro_z = x[5];
+    s->mag_x = x[6];   s->mag_y = x[7];   s->mag_z = x[8];
+}
+
+// Hamming-windowed sinc low-pass, unity DC gain, shared by every stage
+static void design_filter(void) {
+    float h[FILTER_TAPS];
+    float fc = MULTIRATE_CUTOFF / MULTIRATE_FACTOR;     // Cycles per input sample
+    float centre = (FILTER_TAPS - 1) / 2.0f;
+    float sum = 0.0f;
+
+    for (int n = 0; n < FILTER_TAPS; n++) {
+        float t = n - centre;
+        float sinc = t == 0.0f ? 2.0f * fc : sinf(2.0f * (float)M_PI * fc * t) / ((float)M_PI * t);
+        float window = 0.54f - 0.46f * cosf(2.0f * (float)M_PI * n / (FILTER_TAPS - 1));
+        h[n] = sinc * window;
+        sum += h[n];
+    }
+
+    for (int r = 0; r < MULTIRATE_FACTOR; r++) {
+        for (int j = 0; j < MULTIRATE_PHASE_TAPS; j++) {
+            coef[r][j] = h[j * MULTIRATE_FACTOR + (MULTIRATE_FACTOR - 1 - r)] / sum;
+        }
+    }
+}
+
+static void publish(multirate_stream_t stream, const imu_data_t *sample) {
+    latest[stream] = *sample;
+    stats.published[stream]++;
+    bus_publish(topics[stream], sample, false);
+}
+
+// Feed one input; returns true and writes out when a decimated sample is complete
+static bool stage_feed(stage_t *stage, multirate_stream_t in_stream, const imu_data_t *in, imu_data_t *out) {
+    float x[CHANNELS];
+    unpack(in, x);
+
+    const float *c = coef[stage->phase];
+    for (int j = 0; j < MULTIRATE_PHASE_TAPS; j++) {
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            stage->acc[j][ch] += c[j] * x[ch];
+        }
+    }
+
+    if (++stage->phase < MULTIRATE_FACTOR) {
+        return false;
+    }
+    stage->phase = 0;
+
+    // Oldest partial sum is complete - emit it and shift in an empty one
+    pack(stage->acc[0], out);
+    memmove(stage->acc[0], stage->acc[1], sizeof(stage->acc) - sizeof(stage->acc[0]));
+    memset(stage->acc[MULTIRATE_PHASE_TAPS - 1], 0, sizeof(stage->acc[0]));
+
+    // After a restart the first outputs only saw part of the filter window (and
+    // their centred timestamps would precede the restart) - hold them back
+    if (stage->warmup < MULTIRATE_PHASE_TAPS - 1) {
+        stage->warmup++;
+        return false;
+    }
+
+    // Centre the timestamp on the filter so every stream shares one timebase
+    uint32_t delay_us = (FILTER_TAPS - 1) * multirate_stream_period_ms(in_stream) * 500;
+    out->timestamp_us = in->timestamp_us - delay_us;
+    return true;
+}
+
+esp_err_t multirate_init(void) {
+    design_filter();
+    memset(stages, 0, sizeof(stages));
+    memset(latest, 0, sizeof(latest));
+    input = MULTIRATE_1KHZ;
+    stats.input = input;
+
+    for (int s = 0; s < MULTIRATE_STREAM_COUNT; s++) {
+        if (topics[s] == NULL) {
+            topics[s] = bus_topic_create(topic_names[s], sizeof(imu_data_t), topic_depths[s]);
+            if (topics[s] == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+    }
+
+    ESP_LOGD(TAG, "%d-tap anti-alias filter, %d phases of %d taps per stage",
+            FILTER_TAPS, MULTIRATE_FACTOR, MULTIRATE_PHASE_TAPS);
+    return ESP_OK;
+}
+
+bus_topic_t* multirate_topic(multirate_stream_t stream) {
+    return stream < MULTIRATE_STREAM_COUNT ? topics[stream] : NULL;
+}
+
+multirate_stream_t multirate_stream_for_period(uint32_t period_ms) {
+    for (int s = MULTIRATE_STREAM_COUNT - 1; s > MULTIRATE_1KHZ; s--) {
+        if (period_ms >= multirate_stream_period_ms(s)) {
+            return (multirate_stream_t)s;
+        }
+    }
+    return MULTIRATE_1KHZ;
+}
+
+void multirate_set_input(multirate_stream_t stream) {
+    if (stream == input || stream >= MULTIRATE_STREAM_COUNT) {
+        return;
+    }
+
+    // Stages that sat idle above the old entry hold stale partial sums - restart
+    // them. Stages from the old entry down keep their input rate and carry on.
+    for (multirate_stream_t s = stream; s < input; s++) {
+        memset(&stages[s], 0, sizeof(stages[s]));
+    }
+    input = stream;
+    stats.input = stream;
+}
+
+uint32_t multirate_push(const imu_data_t *sample) {
+    uint32_t produced = 0;
+
+    // Streams faster than the entry point carry the reduced-rate input as is
+    for (multirate_stream_t s = MULTIRATE_1KHZ; s < input; s++) {
+        publish(s, sample);
+        produced |= MULTIRATE_BIT(s);
+    }
+
+    imu_data_t current = *sample;
+    imu_data_t decimated;
+    for (int s = input; s < MULTIRATE_STREAM_COUNT; s++) {
+        publish((multirate_stream_t)s, &current);
+        produced |= MULTIRATE_BIT(s);
+
+        if (s == MULTIRATE_STREAM_COUNT - 1 ||
+            !stage_feed(&stages[s], (multirate_stream_t)s, &current, &decimated)) {
+            break;
+        }
+        current = decimated;
+    }
+
+    return produced;
+}
+
+const imu_data_t* multirate_latest(multirate_stream_t stream) {
+    return &latest[stream];
+}
+
+uint32_t multirate_stream_period_ms(multirate_stream_t stream) {
+    uint32_t period_ms = IMU_TASK_PERIOD_MS;
+    for (multirate_stream_t s = MULTIRATE_1KHZ; s < stream; s++) {
+        period_ms *= MULTIRATE_FACTOR;
+    }
+    return period_ms;
+}
+
+esp_err_t multirate_get_stats(multirate_stats_t *out_stats) {
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_stats = stats;
+    return ESP_OK;
+}
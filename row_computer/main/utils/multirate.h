@@ -0,0 +1,52 @@
+#ifndef MULTIRATE_H
+#define MULTIRATE_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "sensors/sensors_common.h"
+#include "utils/data_bus.h"
+
+// Synchronised output streams, each a decimate-by-MULTIRATE_FACTOR of the one above
+typedef enum {
+    MULTIRATE_1KHZ,         // Acquisition rate (stroke detection, event capture)
+    MULTIRATE_100HZ,
+    MULTIRATE_10HZ,         // Display rate
+    MULTIRATE_1HZ,          // Summary logs
+    MULTIRATE_STREAM_COUNT
+} multirate_stream_t;
+
+#define MULTIRATE_BIT(stream)   (1UL << (stream))
+
+typedef struct {
+    uint32_t published[MULTIRATE_STREAM_COUNT];     // Samples produced per stream
+    multirate_stream_t input;                       // Stream currently fed by acquisition
+} multirate_stats_t;
+
+// Design the anti-aliasing filter, reset all stages and create one bus topic
+// (of imu_data_t) per stream. Call before tasks start.
+esp_err_t multirate_init(void);
+
+// Topic carrying a stream - consumers subscribe with bus_subscribe()
+bus_topic_t* multirate_topic(multirate_stream_t stream);
+
+// Stream whose period matches the acquisition period (reduced rates skip stages)
+multirate_stream_t multirate_stream_for_period(uint32_t period_ms);
+
+// Select where acquisition enters the tree; faster streams then carry the input
+// unfiltered. Stages that resume after running idle restart and publish again once
+// their filter window is full, so no stream steps back in time. Acquisition task only.
+void multirate_set_input(multirate_stream_t stream);
+
+// Feed one acquisition sample. Returns MULTIRATE_BIT()s of the streams that produced
+// a sample; timestamps are shifted by the filter group delay so all streams align.
+uint32_t multirate_push(const imu_data_t *sample);
+
+// Most recent sample of a stream (acquisition task only)
+const imu_data_t* multirate_latest(multirate_stream_t stream);
+
+uint32_t multirate_stream_period_ms(multirate_stream_t stream);
+
+esp_err_t multirate_get_stats(multirate_stats_t *out_stats);
+
+#endif // MULTIRATE_H
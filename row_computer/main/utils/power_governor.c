@@ -0,0 +1,270 @@
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "sensors/imu.h"
+#include "tasks/tasks_common.h"
+#include "deferred_log.h"
+#include "power_governor.h"
+#include "timebase.h"
+#include "runtime_config.h"
+#include <math.h>
+#include <string.h>
+#ifdef CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+static const char *TAG = "POWER_GOV";
+
+// IMU/GPS periods are replaced by the runtime configuration (power_governor_apply_config)
+static power_profile_t profiles[POWER_STATE_COUNT] = {
+    [POWER_STATE_ROWING] = {
+        .imu_period_ms = IMU_TASK_PERIOD_MS,
+        .gps_period_ms = GPS_TASK_PERIOD_MS,
+        .cpu_max_mhz = 240,
+        .cpu_min_mhz = 80,
+        .light_sleep = false,
+    },
+    [POWER_STATE_REST] = {
+        .imu_period_ms = GOV_REST_IMU_PERIOD_MS,
+        .gps_period_ms = GOV_REST_GPS_PERIOD_MS,
+        .cpu_max_mhz = 80,
+        .cpu_min_mhz = 40,
+        .light_sleep = true,
+    },
+    [POWER_STATE_SLEEP] = {
+        .imu_period_ms = 0,
+        .gps_period_ms = GOV_SLEEP_GPS_PERIOD_MS,
+        .cpu_max_mhz = 80,
+        .cpu_min_mhz = 40,
+        .light_sleep = true,
+    },
+};
+
+static const char *state_names[POWER_STATE_COUNT] = { "ROWING", "REST", "SLEEP" };
+
+typedef struct {
+    float wake_accel_g;
+    float wake_gyro_dps;
+    float rest_accel_g;
+    uint32_t rest_hold_ms;
+    uint32_t sleep_hold_ms;
+} governor_thresholds_t;
+
+static governor_thresholds_t thresholds;
+
+// Written by the IMU task, copied by the monitor task (power_governor_get_stats)
+static power_governor_stats_t stats = {0};
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t state_entered_ms = 0;
+static uint32_t last_motion_ms = 0;
+static uint32_t last_sample_ms = 0;
+static uint32_t last_account_ms = 0;
+static timebase_us_t wom_irq_us = 0;         // Guarded by stats_mux: 64-bit, torn otherwise
+
+static void apply_profile(const power_profile_t *profile) {
+#ifdef CONFIG_PM_ENABLE
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = profile->cpu_max_mhz,
+        .min_freq_mhz = profile->cpu_min_mhz,
+        .light_sleep_enable = profile->light_sleep,
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "esp_pm_configure failed: %s", esp_err_to_name(err));
+    }
+#endif
+}
+
+// Caller holds stats_mux
+static void account_time(uint32_t now_ms) {
+    stats.time_in_state_ms[stats.state] += now_ms - last_account_ms;
+    last_account_ms = now_ms;
+}
+
+static void set_state(power_state_t state, uint32_t now_ms) {
+    power_state_t previous = stats.state;
+    if (state == previous) {
+        return;
+    }
+    taskENTER_CRITICAL(&stats_mux);
+    account_time(now_ms);
+    stats.state = state;
+    stats.transitions++;
+    taskEXIT_CRITICAL(&stats_mux);
+    DLOGD(TAG, "%s -> %s", state_names[previous], state_names[state]);
+    state_entered_ms = now_ms;
+    apply_profile(&profiles[state]);
+}
+
+static void record_wake(uint32_t latency_ms, uint32_t now_ms) {
+    taskENTER_CRITICAL(&stats_mux);
+    stats.wake_events++;
+    stats.last_wake_latency_ms = latency_ms;
+    if (latency_ms > stats.max_wake_latency_ms) {
+        stats.max_wake_latency_ms = latency_ms;
+    }
+    taskEXIT_CRITICAL(&stats_mux);
+    last_motion_ms = now_ms;
+    set_state(POWER_STATE_ROWING, now_ms);
+}
+
+static void IRAM_ATTR wom_isr_handler(void *arg) {
+    BaseType_t higher_priority_woken = pdFALSE;
+    gpio_intr_disable(IMU_INT_PIN);  // Level interrupt - rearmed by the IMU task
+    timebase_us_t irq_us = timebase_now_us();
+    taskENTER_CRITICAL_ISR(&stats_mux);
+    wom_irq_us = irq_us;
+    taskEXIT_CRITICAL_ISR(&stats_mux);
+    if (imu_task_handle != NULL) {
+        vTaskNotifyGiveFromISR(imu_task_handle, &higher_priority_woken);
+    }
+    portYIELD_FROM_ISR(higher_priority_woken);
+}
+
+esp_err_t power_governor_init(void) {
+    taskENTER_CRITICAL(&stats_mux);
+    memset(&stats, 0, sizeof(stats));
+    stats.state = POWER_STATE_ROWING;
+    last_account_ms = timebase_now_ms();    // Residency counts from init, not from boot
+    wom_irq_us = 0;
+    taskEXIT_CRITICAL(&stats_mux);
+    state_entered_ms = last_motion_ms = last_sample_ms = 0;
+    power_governor_apply_config(runtime_config_boot());
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << IMU_INT_PIN,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) { // Already installed is fine
+        return err;
+    }
+
+    err = gpio_isr_handler_add(IMU_INT_PIN, wom_isr_handler, NULL);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = esp_sleep_enable_gpio_wakeup();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    apply_profile(&profiles[POWER_STATE_ROWING]);
+    return ESP_OK;
+}
+
+power_state_t power_governor_update(float ax, float ay, float az,
+                                    float gx, float gy, float gz, uint32_t now_ms) {
+    float deviation = fabsf(sqrtf(ax * ax + ay * ay + az * az) - 1.0f);
+    float rotation = fmaxf(fabsf(gx), fmaxf(fabsf(gy), fabsf(gz)));
+
+    taskENTER_CRITICAL(&stats_mux);
+    stats.activity_g += GOV_ACTIVITY_EWMA_ALPHA * (deviation - stats.activity_g);
+    account_time(now_ms);
+    taskEXIT_CRITICAL(&stats_mux);
+
+    // Fast attack: a single strong sample restores full rates so the first
+    // stroke after rest is sampled at the rowing rate
+    if (deviation > thresholds.wake_accel_g || rotation > thresholds.wake_gyro_dps) {
+        if (stats.state != POWER_STATE_ROWING) {
+            record_wake(now_ms - last_sample_ms, now_ms);
+        }
+        last_motion_ms = now_ms;
+    } else if (stats.activity_g >= thresholds.rest_accel_g) {
+        last_motion_ms = now_ms;
+    }
+
+    // Slow release with hysteresis
+    if (stats.state == POWER_STATE_ROWING && now_ms - last_motion_ms >= thresholds.rest_hold_ms) {
+        set_state(POWER_STATE_REST, now_ms);
+    } else if (stats.state == POWER_STATE_REST && now_ms - state_entered_ms >= thresholds.sleep_hold_ms) {
+        set_state(POWER_STATE_SLEEP, now_ms);
+    }
+
+    last_sample_ms = now_ms;
+    return stats.state;
+}
+
+void power_governor_wake(uint32_t now_ms) {
+    if (stats.state == POWER_STATE_ROWING) {
+        return;
+    }
+    taskENTER_CRITICAL(&stats_mux);
+    account_time(now_ms);
+    timebase_us_t irq_us = wom_irq_us;
+    wom_irq_us = 0;
+    taskEXIT_CRITICAL(&stats_mux);
+    record_wake(irq_us != 0 ? now_ms - timebase_ms(irq_us) : 0, now_ms);
+    taskENTER_CRITICAL(&stats_mux);
+    stats.activity_g = thresholds.rest_accel_g; // Hold off REST until activity is re-measured
+    taskEXIT_CRITICAL(&stats_mux);
+}
+
+esp_err_t power_governor_arm_wake_on_motion(void) {
+    esp_err_t err = imu_enable_motion_wakeup(GOV_WOM_THRESHOLD_MG);
+    if (err != ESP_OK) {
+        return err;
+    }
+    gpio_wakeup_enable(IMU_INT_PIN, GPIO_INTR_HIGH_LEVEL);
+    return gpio_intr_enable(IMU_INT_PIN);
+}
+
+esp_err_t power_governor_disarm_wake_on_motion(void) {
+    gpio_intr_disable(IMU_INT_PIN);
+    gpio_wakeup_disable(IMU_INT_PIN);
+    return imu_disable_motion_wakeup();
+}
+
+void power_governor_apply_config(const runtime_config_t *config) {
+    thresholds = (governor_thresholds_t){
+        .wake_accel_g = config->gov_wake_accel_g,
+        .wake_gyro_dps = config->gov_wake_gyro_dps,
+        .rest_accel_g = config->gov_rest_accel_g,
+        .rest_hold_ms = config->gov_rest_hold_ms,
+        .sleep_hold_ms = config->gov_sleep_hold_ms,
+    };
+
+    // Periods are single 16-bit stores - the GPS task may read them at any time
+    profiles[POWER_STATE_ROWING].imu_period_ms = (uint16_t)config->imu_period_ms;
+    profiles[POWER_STATE_ROWING].gps_period_ms = (uint16_t)config->gps_period_ms;
+    profiles[POWER_STATE_REST].imu_period_ms = (uint16_t)config->rest_imu_period_ms;
+    profiles[POWER_STATE_REST].gps_period_ms = (uint16_t)config->rest_gps_period_ms;
+    profiles[POWER_STATE_SLEEP].gps_period_ms = (uint16_t)config->sleep_gps_period_ms;
+}
+
+power_state_t power_governor_state(void) {
+    return stats.state;
+}
+
+const power_profile_t* power_governor_profile(void) {
+    return &profiles[stats.state];
+}
+
+esp_err_t power_governor_get_stats(power_governor_stats_t *out_stats, uint32_t now_ms) {
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Counters and the accounting mark together, or the time in state can tear
+    taskENTER_CRITICAL(&stats_mux);
+    *out_stats = stats;
+    out_stats->time_in_state_ms[stats.state] += now_ms - last_account_ms;
+    taskEXIT_CRITICAL(&stats_mux);
+    return ESP_OK;
+}
+
+const char* power_state_name(power_state_t state) {
+    return state < POWER_STATE_COUNT ? state_names[state] : "UNKNOWN";
+}
@@ -0,0 +1,62 @@
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "runtime_config.h"
+
+typedef enum {
+    POWER_STATE_ROWING,     // Full sample rates, full CPU clock
+    POWER_STATE_REST,       // Boat still - reduced IMU/GPS rate, light sleep allowed
+    POWER_STATE_SLEEP,      // Long rest - IMU waits on wake-on-motion interrupt
+    POWER_STATE_COUNT
+} power_state_t;
+
+// Rates and clocks applied in each state
+typedef struct {
+    uint16_t imu_period_ms;     // 0 = block on wake-on-motion interrupt
+    uint16_t gps_period_ms;
+    uint16_t cpu_max_mhz;
+    uint16_t cpu_min_mhz;
+    bool light_sleep;
+} power_profile_t;
+
+typedef struct {
+    power_state_t state;
+    uint32_t time_in_state_ms[POWER_STATE_COUNT];   // Duty cycle accounting
+    uint32_t transitions;
+    uint32_t wake_events;                           // REST/SLEEP -> ROWING
+    uint32_t last_wake_latency_ms;                  // Upper bound: gap since last still sample
+    uint32_t max_wake_latency_ms;
+    float activity_g;                               // Smoothed |a|-1g
+} power_governor_stats_t;
+
+// Configure wake-on-motion GPIO and power management, start in ROWING
+esp_err_t power_governor_init(void);
+
+// Feed one IMU sample (g, deg/s); returns the state to run in next.
+// Pure state machine, replayable off-target with recorded timestamps.
+power_state_t power_governor_update(float ax, float ay, float az,
+                                    float gx, float gy, float gz, uint32_t now_ms);
+
+// Take rates and thresholds from a configuration snapshot. Called from the IMU
+// task (the only caller of power_governor_update) whenever its snapshot changes.
+void power_governor_apply_config(const runtime_config_t *config);
+
+// Motion interrupt fired while sleeping - go straight back to ROWING
+void power_governor_wake(uint32_t now_ms);
+
+// Put the IMU into wake-on-motion and enable the INT pin as a light-sleep wake source
+esp_err_t power_governor_arm_wake_on_motion(void);
+esp_err_t power_governor_disarm_wake_on_motion(void);
+
+power_state_t power_governor_state(void);
+const power_profile_t* power_governor_profile(void);
+
+// Copy statistics; time in the current state is accounted up to now_ms
+esp_err_t power_governor_get_stats(power_governor_stats_t *out_stats, uint32_t now_ms);
+
+const char* power_state_name(power_state_t state);
+
+#endif // POWER_GOVERNOR_H
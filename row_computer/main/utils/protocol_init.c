@@ -6,29 +6,15 @@
 #include "driver/spi_master.h"
 #include "esp_log.h"
 #include "boot_progress.h"
+#include "i2c_bus.h"
 
 static const char *TAG = "PROTOCOLS";
 
 esp_err_t i2c_master_init(void) {
     ESP_LOGD(TAG, "Initializing I2C master...");
 
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
-    };
-
-    esp_err_t err = i2c_param_config(I2C_MASTER_NUM, &conf);
-    if (err != ESP_OK) {
-        boot_progress_failure(BOOT_PROTOCOLS, "I2C config", esp_err_to_name(err));
-        return err;
-    }
-
-    err = i2c_driver_install(I2C_MASTER_NUM, conf.mode, I2C_MASTER_RX_BUF_DISABLE,
-                            I2C_MASTER_TX_BUF_DISABLE, 0);
+    // Bus health manager owns the driver so it can reinstall it after bus recovery
+    esp_err_t err = i2c_bus_init();
     if (err != ESP_OK) {
         boot_progress_failure(BOOT_PROTOCOLS, "I2C driver", esp_err_to_name(err));
         return err;
@@ -75,7 +61,7 @@ esp_err_t spi_master_init(void) {
         .sclk_io_num = SPI_SCLK_PIN,
         .quadwp_io_num = -1,
         .quadhd_io_num = -1,
-        .max_transfer_sz = 4092,
+        .max_transfer_sz = SPI_MAX_TRANSFER_SZ,
     };
 
     esp_err_t err = spi_bus_initialize(SPI2_HOST, &buscfg, SPI_DMA_CH_AUTO);
@@ -104,12 +90,17 @@ esp_err_t protocols_init(void) {
 
     // Note: GPS UART is now initialized in gps_init() to avoid conflicts
 
-    // Initialize SPI (if needed for additional sensors)
-    // Uncomment if you have SPI sensors
-    // err = spi_master_init();
-    // if (err != ESP_OK) {
-    //     return err;
-    // }
+    // Initialize SPI (display and any SPI sensors)
+    err = spi_master_init();
+    if (err != ESP_OK) {
+#if CONFIG_ROW_IMU_ICM42688 || CONFIG_ROW_IMU_LSM6DSO
+        // The IMU sits on this bus - nothing to row with without it
+        return err;
+#else
+        // Only the optional display uses it; display_init() fails and the system runs headless
+        ESP_LOGW(TAG, "SPI bus unavailable - display disabled");
+#endif
+    }
 
     boot_progress_report_category(BOOT_PROTOCOLS, "PROTOCOLS");
     return ESP_OK;
@@ -120,7 +111,7 @@ esp_err_t protocols_deinit(void) {
     
     i2c_driver_delete(I2C_MASTER_NUM);
     // Note: GPS UART cleanup is handled in GPS module
-    // spi_bus_free(SPI2_HOST);  // If SPI was initialized
+    spi_bus_free(SPI2_HOST);
     
     ESP_LOGI(TAG, "All protocols deinitialized");
     return ESP_OK;
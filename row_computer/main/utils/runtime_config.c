@@ -0,0 +1,431 @@
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config/common_constants.h"
+#include "runtime_config.h"
+#include "multirate.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "CONFIG";
+
+#define LINE_MAX_CHARS      64
+
+typedef enum {
+    FIELD_U32,
+    FIELD_F32,
+} field_kind_t;
+
+typedef enum {
+    APPLY_LIVE,
+    APPLY_BOOT,
+} field_apply_t;
+
+typedef struct {
+    const char *name;
+    field_kind_t kind;
+    field_apply_t apply;
+    size_t offset;
+    double def;
+    double min;
+    double max;
+    const char *unit;
+    const char *help;
+} field_t;
+
+#define FIELD_ENTRY(name, kind, def, min, max, apply, unit, help) \
+    { #name, FIELD_##kind, APPLY_##apply, offsetof(runtime_config_t, name), def, min, max, unit, help },
+#define DEFAULT_ENTRY(name, kind, def, min, max, apply, unit, help) .name = def,
+#define DEFAULTS { RUNTIME_CONFIG_FIELDS(DEFAULT_ENTRY) }
+
+static const field_t fields[] = { RUNTIME_CONFIG_FIELDS(FIELD_ENTRY) };
+#define FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+
+struct runtime_config_reader {
+    const char *name;
+    uint32_t seen;                  // Generation at its last safe point
+};
+
+static const runtime_config_t defaults = DEFAULTS;
+static const runtime_config_store_t *store = NULL;
+static runtime_config_t boot_config = DEFAULTS;
+
+// Reader side: the published snapshot and its generation
+static runtime_config_t snapshots[2] = { DEFAULTS, DEFAULTS };
+static const runtime_config_t *active = &snapshots[0];
+static int spare = 1;
+static uint32_t generation = 0;
+static runtime_config_reader_t readers[RUNTIME_CONFIG_MAX_READERS];
+static uint32_t reader_count = 0;
+static portMUX_TYPE reader_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Writer side
+static runtime_config_t stored = DEFAULTS;      // Persisted values (BOOT fields may be ahead of boot_config)
+static runtime_config_t staged = DEFAULTS;
+static char text[RUNTIME_CONFIG_TEXT_MAX];
+
+static double field_get(const runtime_config_t *config, const field_t *field) {
+    const uint8_t *value = (const uint8_t *)config + field->offset;
+    if (field->kind == FIELD_F32) {
+        return *(const float *)value;
+    }
+    return *(const uint32_t *)value;
+}
+
+static void field_put(runtime_config_t *config, const field_t *field, double value) {
+    uint8_t *target = (uint8_t *)config + field->offset;
+    if (field->kind == FIELD_F32) {
+        *(float *)target = (float)value;
+    } else {
+        *(uint32_t *)target = (uint32_t)value;
+    }
+}
+
+static int format_value(char *out, size_t size, const field_t *field, double value) {
+    if (field->kind == FIELD_F32) {
+        return snprintf(out, size, "%g", value);
+    }
+    return snprintf(out, size, "%lu", (unsigned long)value);
+}
+
+static const field_t *find_field(const char *name) {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (strcmp(fields[i].name, name) == 0) {
+            return &fields[i];
+        }
+    }
+    return NULL;
+}
+
+// Floats are range checked as stored (1.1 must pass a 1.1f minimum); NaN would
+// pass any range check, so non-finite values are refused first
+static esp_err_t parse_value(const field_t *field, const char *value, double *out) {
+    char *end;
+    double parsed;
+    if (field->kind == FIELD_F32) {
+        parsed = (float)strtod(value, &end);
+    } else if (*value == '-') {
+        return ESP_ERR_INVALID_ARG;
+    } else {
+        parsed = (double)strtoul(value, &end, 10);
+    }
+    if (end == value || *end != '\0' || !isfinite(parsed) || parsed < field->min || parsed > field->max) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = parsed;
+    return ESP_OK;
+}
+
+static char *trim(char *s) {
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+    return s;
+}
+
+// Apply "name=value" lines to config. Blank lines and '#' comments are skipped.
+// strict: stop at the first bad line, otherwise warn and carry on (stored text
+// from another firmware version).
+static esp_err_t parse_text(runtime_config_t *config, const char *input, size_t length, bool strict) {
+    size_t pos = 0;
+    while (pos < length) {
+        const char *eol = memchr(input + pos, '\n', length - pos);
+        size_t line_length = (eol != NULL ? (size_t)(eol - input) : length) - pos;
+        char line[LINE_MAX_CHARS];
+        esp_err_t err = ESP_ERR_INVALID_ARG;
+
+        if (line_length < sizeof(line)) {
+            memcpy(line, input + pos, line_length);
+            line[line_length] = '\0';
+            char *name = trim(line);
+            char *separator = strchr(name, '=');
+            if (*name == '\0' || *name == '#') {
+                err = ESP_OK;
+            } else if (separator != NULL) {
+                *separator = '\0';
+                const field_t *field = find_field(trim(name));
+                double value;
+                err = field == NULL ? ESP_ERR_NOT_FOUND : parse_value(field, trim(separator + 1), &value);
+                if (err == ESP_OK) {
+                    field_put(config, field, value);
+                }
+            }
+        }
+
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "%s config line: %.*s", err == ESP_ERR_NOT_FOUND ? "Unknown" : "Invalid",
+                     (int)line_length, input + pos);
+            if (strict) {
+                return err;
+            }
+        }
+        pos += line_length + 1;
+    }
+    return ESP_OK;
+}
+
+// Only fields that differ from their default are stored, so a firmware update
+// that changes a default reaches every device that never overrode it.
+// ESP_ERR_INVALID_SIZE when the lines do not fit: an empty text would erase
+// the stored configuration.
+static esp_err_t format_text(const runtime_config_t *config, char *out, size_t size, size_t *length_out) {
+    size_t length = 0;
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        double value = field_get(config, &fields[i]);
+        if (value == field_get(&defaults, &fields[i])) {
+            continue;
+        }
+        int n = snprintf(out + length, size - length, "%s=", fields[i].name);
+        if (n > 0 && (size_t)n < size - length) {
+            length += n;
+            n = format_value(out + length, size - length, &fields[i], value);
+        }
+        if (n <= 0 || (size_t)n + 1 >= size - length) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        length += n;
+        out[length++] = '\n';
+    }
+    *length_out = length;
+    return ESP_OK;
+}
+
+static bool is_stream_period(uint32_t period_ms) {
+    for (int s = 0; s < MULTIRATE_STREAM_COUNT; s++) {
+        if (period_ms == multirate_stream_period_ms((multirate_stream_t)s)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool all_finite(const runtime_config_t *config) {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (!isfinite(field_get(config, &fields[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rules that span fields (single field limits are checked while parsing)
+static esp_err_t validate(const runtime_config_t *config) {
+    const char *problem = NULL;
+    if (!all_finite(config)) {
+        problem = "Fields must be finite numbers";
+    } else if (!is_stream_period(config->imu_period_ms) || !is_stream_period(config->rest_imu_period_ms)) {
+        problem = "IMU periods must match a multi-rate stream";
+    } else if (config->gov_rest_accel_g >= config->gov_wake_accel_g) {
+        problem = "gov_rest_accel_g must be below gov_wake_accel_g";
+    } else if (config->imu_task_priority <= config->dsp_task_priority ||
+               config->dsp_task_priority <= config->log_task_priority) {
+        problem = "Task priorities must be ordered IMU > DSP > LOG";
+    }
+    if (problem != NULL) {
+        ESP_LOGW(TAG, "%s", problem);
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+static bool boot_fields_differ(const runtime_config_t *a, const runtime_config_t *b) {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (fields[i].apply == APPLY_BOOT && field_get(a, &fields[i]) != field_get(b, &fields[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Grace period: true once every reader has passed a safe point since the last
+// publish, i.e. none of them can still hold the spare snapshot
+static bool wait_for_readers(void) {
+    uint32_t waited_ms = 0;
+    for (;;) {
+        uint32_t current = __atomic_load_n(&generation, __ATOMIC_SEQ_CST);
+        bool all_passed = true;
+        taskENTER_CRITICAL(&reader_mux);
+        for (uint32_t i = 0; i < reader_count; i++) {
+            if (__atomic_load_n(&readers[i].seen, __ATOMIC_SEQ_CST) != current) {
+                all_passed = false;
+            }
+        }
+        taskEXIT_CRITICAL(&reader_mux);
+
+        if (all_passed) {
+            return true;
+        }
+        if (waited_ms >= RUNTIME_CONFIG_GRACE_MS) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+        waited_ms += 10;
+    }
+}
+
+esp_err_t runtime_config_init(const runtime_config_store_t *config_store) {
+    runtime_config_t loaded = defaults;
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+
+    store = config_store;
+    if (store != NULL) {
+        size_t length = 0;
+        err = store->load(text, sizeof(text), &length);
+        if (err == ESP_OK) {
+            parse_text(&loaded, text, length, false);
+            if (validate(&loaded) != ESP_OK) {
+                ESP_LOGW(TAG, "Stored configuration rejected - using defaults");
+                loaded = defaults;
+            }
+        } else if (err != ESP_ERR_NOT_FOUND) {
+            ESP_LOGW(TAG, "Loading configuration from %s failed: %s", store->name, esp_err_to_name(err));
+        }
+    }
+
+    boot_config = stored = staged = loaded;
+    snapshots[0] = snapshots[1] = loaded;
+    active = &snapshots[0];
+    spare = 1;
+
+    int overridden = 0;
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        overridden += field_get(&loaded, &fields[i]) != fields[i].def;
+    }
+    ESP_LOGI(TAG, "%d of %u fields set (%s)", overridden, (unsigned)FIELD_COUNT,
+             store != NULL ? store->name : "defaults only");
+    return err == ESP_ERR_NOT_FOUND ? ESP_OK : err;
+}
+
+const runtime_config_t *runtime_config_boot(void) {
+    return &boot_config;
+}
+
+runtime_config_reader_t *runtime_config_register_reader(const char *name) {
+    runtime_config_reader_t *reader = NULL;
+    taskENTER_CRITICAL(&reader_mux);
+    if (reader_count < RUNTIME_CONFIG_MAX_READERS) {
+        reader = &readers[reader_count++];
+        reader->name = name;
+        reader->seen = __atomic_load_n(&generation, __ATOMIC_SEQ_CST);
+    }
+    taskEXIT_CRITICAL(&reader_mux);
+
+    if (reader == NULL) {
+        ESP_LOGW(TAG, "No reader slot for %s - it keeps the boot configuration", name);
+    }
+    return reader;
+}
+
+const runtime_config_t *runtime_config_quiescent(runtime_config_reader_t *reader) {
+    if (reader == NULL) {
+        return &boot_config;
+    }
+    // Announce the generation first: a snapshot loaded after that is at least as
+    // new, so the writer never recycles it before this reader's next safe point
+    __atomic_store_n(&reader->seen, __atomic_load_n(&generation, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&active, __ATOMIC_SEQ_CST);
+}
+
+esp_err_t runtime_config_set(const char *input, size_t length) {
+    runtime_config_t next = staged;
+    esp_err_t err = parse_text(&next, input, length, true);
+    if (err == ESP_OK) {
+        staged = next;
+    }
+    return err;
+}
+
+esp_err_t runtime_config_commit(bool *restart) {
+    esp_err_t err = validate(&staged);
+    if (err != ESP_OK) {
+        staged = stored;
+        return err;
+    }
+
+    // Persist first: what runs is always what the next boot loads
+    if (store != NULL && memcmp(&staged, &stored, sizeof(staged)) != 0) {
+        size_t length = 0;
+        err = format_text(&staged, text, sizeof(text), &length);
+        if (err == ESP_OK) {
+            err = store->save(text, length);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Saving configuration to %s failed: %s", store->name, esp_err_to_name(err));
+            staged = stored;
+            return err;
+        }
+    }
+    stored = staged;
+    if (restart != NULL) {
+        *restart = boot_fields_differ(&stored, &boot_config);
+    }
+
+    // BOOT fields keep their running values until the restart
+    runtime_config_t next = stored;
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (fields[i].apply == APPLY_BOOT) {
+            field_put(&next, &fields[i], field_get(&boot_config, &fields[i]));
+        }
+    }
+    if (memcmp(&next, active, sizeof(next)) == 0) {
+        return ESP_OK;
+    }
+
+    if (!wait_for_readers()) {
+        ESP_LOGW(TAG, "Readers did not reach a safe point - change stored, not applied");
+        return ESP_ERR_TIMEOUT;
+    }
+    snapshots[spare] = next;
+    __atomic_store_n(&active, &snapshots[spare], __ATOMIC_SEQ_CST);
+    spare ^= 1;
+    uint32_t published = __atomic_add_fetch(&generation, 1, __ATOMIC_SEQ_CST);
+    ESP_LOGI(TAG, "Configuration %lu published", (unsigned long)published);
+    return ESP_OK;
+}
+
+void runtime_config_discard(void) {
+    staged = stored;
+}
+
+size_t runtime_config_json(char *out, size_t size) {
+    const runtime_config_t *current = active;
+    size_t length = 0;
+    char value[16], def[16], min[16], max[16];
+
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        const field_t *field = &fields[i];
+        format_value(value, sizeof(value), field, field_get(current, field));
+        format_value(def, sizeof(def), field, field->def);
+        format_value(min, sizeof(min), field, field->min);
+        format_value(max, sizeof(max), field, field->max);
+        int n = snprintf(out + length, size - length,
+                         "%s\"%s\":{\"value\":%s,\"default\":%s,\"min\":%s,\"max\":%s,\"unit\":\"%s\",\"apply\":\"%s\"",
+                         i == 0 ? "{" : ",", field->name, value, def, min, max, field->unit,
+                         field->apply == APPLY_BOOT ? "boot" : "live");
+        if (n > 0 && (size_t)n < size - length && field_get(&stored, field) != field_get(current, field)) {
+            length += n;
+            format_value(value, sizeof(value), field, field_get(&stored, field));
+            n = snprintf(out + length, size - length, ",\"stored\":%s", value);
+        }
+        if (n > 0 && (size_t)n < size - length) {
+            length += n;
+            n = snprintf(out + length, size - length, ",\"help\":\"%s\"}", field->help);
+        }
+        if (n <= 0 || (size_t)n >= size - length) {
+            return 0;
+        }
+        length += n;
+    }
+    if (length + 1 >= size) {
+        return 0;
+    }
+    out[length++] = '}';
+    out[length] = '\0';
+    return length;
+}
@@ -0,0 +1,81 @@
+#ifndef RUNTIME_CONFIG_H
+#define RUNTIME_CONFIG_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "config/runtime_config_schema.h"
+
+// Typed runtime configuration (fields: config/runtime_config_schema.h), stored
+// as "name=value" lines in NVS (or a file in host builds).
+//
+// Tasks never see a half-applied change: the writer fills the spare of two
+// snapshots and publishes it with one pointer store. Each reader task registers
+// once and calls runtime_config_quiescent() at the top of its loop - that is
+// the safe point where it lets go of the old snapshot and picks up the current
+// one, and the pointer it returns is then read without locks for the rest of
+// the iteration. A snapshot is only reused for the next change once every
+// reader has passed such a point (RCU-style grace period), so readers must not
+// keep the pointer across iterations.
+//
+// Writer side (runtime_config_set/commit) runs in one task at a time - the
+// session transfer task, or main before the tasks start.
+
+#define RUNTIME_CONFIG_TYPE_U32     uint32_t
+#define RUNTIME_CONFIG_TYPE_F32     float
+
+typedef struct {
+#define RUNTIME_CONFIG_MEMBER(name, kind, def, min, max, apply, unit, help) RUNTIME_CONFIG_TYPE_##kind name;
+    RUNTIME_CONFIG_FIELDS(RUNTIME_CONFIG_MEMBER)
+#undef RUNTIME_CONFIG_MEMBER
+} runtime_config_t;
+
+typedef struct runtime_config_reader runtime_config_reader_t;
+
+// Persistent storage of the "name=value" text
+typedef struct {
+    const char *name;
+    // Stored text into text[0..size), length in *length; ESP_ERR_NOT_FOUND when nothing is stored
+    esp_err_t (*load)(char *text, size_t size, size_t *length);
+    esp_err_t (*save)(const char *text, size_t length);
+} runtime_config_store_t;
+
+// Available stores
+extern const runtime_config_store_t runtime_config_store_nvs;   // NVS blob (target)
+extern const runtime_config_store_t runtime_config_store_file;  // Text file (host builds)
+
+// Load and validate the stored configuration; defaults where nothing (or nothing
+// valid) is stored. store may be NULL (defaults, nothing persisted).
+esp_err_t runtime_config_init(const runtime_config_store_t *store);
+
+// Configuration as loaded at boot - never changes. BOOT fields are read from here.
+const runtime_config_t *runtime_config_boot(void);
+
+// Register a reader task (once, from that task). NULL when all slots are taken -
+// runtime_config_quiescent(NULL) then returns the boot snapshot.
+runtime_config_reader_t *runtime_config_register_reader(const char *name);
+
+// Safe point: the previous snapshot is released, the current one returned
+const runtime_config_t *runtime_config_quiescent(runtime_config_reader_t *reader);
+
+// Stage "name=value" lines (newline separated). All or nothing: on a bad line
+// (unknown name ESP_ERR_NOT_FOUND, bad or out of range value ESP_ERR_INVALID_ARG)
+// nothing is staged.
+esp_err_t runtime_config_set(const char *text, size_t length);
+
+// Validate the staged values, persist them and publish the LIVE fields.
+// *restart is set when a BOOT field differs from the running value.
+// ESP_ERR_TIMEOUT: stored, but a reader did not reach a safe point in time -
+// the change applies with the next commit or boot.
+esp_err_t runtime_config_commit(bool *restart);
+
+// Drop staged changes
+void runtime_config_discard(void);
+
+// Every field as one JSON object: value, default, limits, unit, apply mode, and
+// "stored" where a BOOT field waits for the next boot. Returns the length
+// written (0 when it does not fit).
+size_t runtime_config_json(char *out, size_t size);
+
+#endif // RUNTIME_CONFIG_H
@@ -0,0 +1,42 @@
+#include "runtime_config.h"
+#include <stdio.h>
+
+// Keeps the configuration in a text file so off-target runs load, change and
+// persist it like the device does. Same "name=value" lines as NVS - the file
+// can be edited by hand.
+
+#ifndef RUNTIME_CONFIG_FILE
+#define RUNTIME_CONFIG_FILE     "runtime_config.txt"
+#endif
+
+static esp_err_t file_store_load(char *text, size_t size, size_t *length) {
+    FILE *f = fopen(RUNTIME_CONFIG_FILE, "rb");
+    if (f == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *length = fread(text, 1, size, f);
+    bool complete = feof(f) && !ferror(f);
+    fclose(f);
+    return complete ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+// Written next to the old file and renamed over it, so a crash never leaves half a file
+static esp_err_t file_store_save(const char *text, size_t length) {
+    FILE *f = fopen(RUNTIME_CONFIG_FILE ".tmp", "wb");
+    if (f == NULL) {
+        return ESP_FAIL;
+    }
+    size_t written = fwrite(text, 1, length, f);
+    bool ok = fclose(f) == 0 && written == length;
+    if (!ok || rename(RUNTIME_CONFIG_FILE ".tmp", RUNTIME_CONFIG_FILE) != 0) {
+        remove(RUNTIME_CONFIG_FILE ".tmp");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+const runtime_config_store_t runtime_config_store_file = {
+    .name = "file",
+    .load = file_store_load,
+    .save = file_store_save,
+};
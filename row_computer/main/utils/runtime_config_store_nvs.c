@@ -0,0 +1,43 @@
+#include "nvs.h"
+#include "runtime_config.h"
+
+#define NVS_NAMESPACE       "config"
+#define NVS_KEY             "runtime"
+
+static esp_err_t nvs_store_load(char *text, size_t size, size_t *length) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_ERR_NOT_FOUND;   // Namespace is created by the first save
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    *length = size;
+    err = nvs_get_blob(handle, NVS_KEY, text, length);
+    nvs_close(handle);
+    return err == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : err;
+}
+
+static esp_err_t nvs_store_save(const char *text, size_t length) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = length > 0 ? nvs_set_blob(handle, NVS_KEY, text, length) : nvs_erase_key(handle, NVS_KEY);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = ESP_OK;               // Back to defaults with nothing stored
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+const runtime_config_store_t runtime_config_store_nvs = {
+    .name = "nvs",
+    .load = nvs_store_load,
+    .save = nvs_store_save,
+};
@@ -0,0 +1,320 @@
+#include "esp_log.h"
+#include "config/common_constants.h"
+#include "sensor_health.h"
+#include "deferred_log.h"
+#include "stats.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "HEALTH";
+
+#define MAX_CHANNELS    3
+
+// Per-sensor check parameters (0 disables a check)
+typedef struct {
+    const char *name;
+    health_source_t source;
+    uint8_t channels;
+    float alpha;                    // EWMA weight of one sample
+    float noise_max;                // Sample step std that means a noise-floor jump
+    uint16_t stuck_samples;
+    uint32_t accuracy_good;         // GNSS accuracy gates (mm or mm/s)
+    uint32_t accuracy_gate;
+} health_sensor_config_t;
+
+static const health_sensor_config_t sensor_config[HEALTH_SENSORS] = {
+    [HEALTH_ACCEL]        = { "accel", HEALTH_SOURCE_IMU, 3, HEALTH_IMU_ALPHA, HEALTH_ACCEL_NOISE_LSB,
+                              HEALTH_IMU_STUCK_SAMPLES, 0, 0 },
+    [HEALTH_GYRO]         = { "gyro", HEALTH_SOURCE_IMU, 3, HEALTH_IMU_ALPHA, HEALTH_GYRO_NOISE_LSB,
+                              HEALTH_IMU_STUCK_SAMPLES, 0, 0 },
+    [HEALTH_MAG]          = { "mag", HEALTH_SOURCE_IMU, 3, HEALTH_MAG_ALPHA, HEALTH_MAG_NOISE,
+                              HEALTH_MAG_STUCK_SAMPLES, 0, 0 },
+    [HEALTH_GPS_POSITION] = { "gps.position", HEALTH_SOURCE_GPS, 1, HEALTH_GPS_ALPHA, 0.0f,
+                              HEALTH_GPS_STUCK_FIXES, HEALTH_GPS_HACC_GOOD_MM, HEALTH_GPS_HACC_GATE_MM },
+    [HEALTH_GPS_SPEED]    = { "gps.speed", HEALTH_SOURCE_GPS, 1, HEALTH_GPS_ALPHA, 0.0f,
+                              HEALTH_GPS_STUCK_FIXES, HEALTH_GPS_SACC_GOOD_MM_S, HEALTH_GPS_SACC_GATE_MM_S },
+};
+
+static const char *const state_names[] = { "OK", "DEGRADED", "FAILED" };
+static const char *const check_names[] = { "none", "read errors", "stuck", "saturation", "range", "noise", "accuracy" };
+static const char *const topic_names[HEALTH_SOURCES] = { "imu.health", "gps.health" };
+
+typedef struct {
+    int32_t last_key;               // Exact reading, compared for the stuck check
+    float last_value;
+    uint16_t same_run;
+    float step_var;                 // Running variance of value - last_value
+} health_channel_t;
+
+typedef struct {
+    health_channel_t channel[MAX_CHANNELS];
+    bool primed;                    // Channels hold a previous sample
+    float error_rate;
+    float saturation_rate;
+    float range_rate;
+    uint32_t accuracy;
+    health_state_t state;
+    health_check_t check;
+    bool recovering;                // Better than state since recover_start_us
+    timebase_us_t recover_start_us;
+    uint32_t samples;
+    uint32_t events;
+    stats_metric_t *weight_gauge;
+} health_sensor_state_t;
+
+static health_sensor_state_t sensors[HEALTH_SENSORS];
+static bus_topic_t *topics[HEALTH_SOURCES];
+static stats_metric_t *event_counter;
+
+static const uint8_t state_weight[] = { HEALTH_WEIGHT_FULL, HEALTH_WEIGHT_DEGRADED, 0 };
+
+esp_err_t sensor_health_init(void) {
+    memset(sensors, 0, sizeof(sensors));
+    for (int s = 0; s < HEALTH_SOURCES; s++) {
+        if (topics[s] == NULL) {
+            topics[s] = bus_topic_create(topic_names[s], sizeof(health_event_t), HEALTH_TOPIC_DEPTH);
+            if (topics[s] == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+    }
+
+    // Gauges carry the fusion weight of each sensor
+    char name[STATS_NAME_MAX];
+    for (int i = 0; i < HEALTH_SENSORS; i++) {
+        snprintf(name, sizeof(name), "health.%s", sensor_config[i].name);
+        sensors[i].weight_gauge = stats_register(name, STATS_GAUGE);
+        stats_set(sensors[i].weight_gauge, HEALTH_WEIGHT_FULL);
+    }
+    event_counter = stats_register("health.events", STATS_COUNTER);
+    return ESP_OK;
+}
+
+bus_topic_t* sensor_health_topic(health_source_t source) {
+    return source < HEALTH_SOURCES ? topics[source] : NULL;
+}
+
+static inline void ewma(float *rate, bool hit, float alpha) {
+    *rate += alpha * ((hit ? 1.0f : 0.0f) - *rate);
+}
+
+static inline uint16_t detail_rate(float rate) {
+    return (uint16_t)lroundf(rate * 1000.0f);
+}
+
+static inline uint16_t detail_clamp(float value) {
+    return value >= UINT16_MAX ? UINT16_MAX : (uint16_t)lroundf(value);
+}
+
+// A rate check: DEGRADED above HEALTH_DEGRADED_RATE, FAILED above HEALTH_FAILED_RATE
+static void worst_rate(health_state_t *state, health_check_t *check, uint16_t *detail,
+                       float rate, health_check_t rate_check) {
+    health_state_t rated = rate > HEALTH_FAILED_RATE ? HEALTH_FAILED :
+                           rate > HEALTH_DEGRADED_RATE ? HEALTH_DEGRADED : HEALTH_OK;
+    if (rated > *state) {
+        *state = rated;
+        *check = rate_check;
+        *detail = detail_rate(rate);
+    }
+}
+
+// Rate the sensor from its running figures and publish when the rating changes.
+// Worse takes effect at once, better only once it has held HEALTH_RECOVER_MS.
+static void evaluate(health_sensor_t sensor, timebase_us_t timestamp_us) {
+    const health_sensor_config_t *config = &sensor_config[sensor];
+    health_sensor_state_t *s = &sensors[sensor];
+    health_state_t state = HEALTH_OK;
+    health_check_t check = HEALTH_CHECK_NONE;
+    uint16_t detail = 0;
+
+    // Failing checks first: among equally bad ones the first named wins
+    uint16_t stuck_run = 0;
+    float step_var = 0.0f;
+    for (int c = 0; c < config->channels; c++) {
+        stuck_run = s->channel[c].same_run > stuck_run ? s->channel[c].same_run : stuck_run;
+        step_var = fmaxf(step_var, s->channel[c].step_var);
+    }
+    if (config->stuck_samples != 0 && stuck_run >= config->stuck_samples) {
+        state = HEALTH_FAILED;
+        check = HEALTH_CHECK_STUCK;
+        detail = stuck_run;
+    }
+    if (config->accuracy_gate != 0 && s->accuracy > config->accuracy_good) {
+        health_state_t rated = s->accuracy > config->accuracy_gate ? HEALTH_FAILED : HEALTH_DEGRADED;
+        if (rated > state) {
+            state = rated;
+            check = HEALTH_CHECK_ACCURACY;
+            detail = detail_clamp(s->accuracy / 10.0f);
+        }
+    }
+    worst_rate(&state, &check, &detail, s->error_rate, HEALTH_CHECK_READ_ERRORS);
+    worst_rate(&state, &check, &detail, s->saturation_rate, HEALTH_CHECK_SATURATION);
+    worst_rate(&state, &check, &detail, s->range_rate, HEALTH_CHECK_RANGE);
+    if (state == HEALTH_OK && config->noise_max > 0.0f && step_var > config->noise_max * config->noise_max) {
+        state = HEALTH_DEGRADED;
+        check = HEALTH_CHECK_NOISE;
+        detail = detail_clamp(sqrtf(step_var));
+    }
+
+    if (state >= s->state) {
+        s->recovering = false;
+        if (state == s->state) {
+            s->check = check;   // Same rating, possibly for another reason: not an event
+            return;
+        }
+    } else {
+        if (!s->recovering) {
+            s->recovering = true;
+            s->recover_start_us = timestamp_us;
+        }
+        if (timestamp_us - s->recover_start_us < (timebase_us_t)HEALTH_RECOVER_MS * 1000) {
+            return;
+        }
+        s->recovering = false;
+    }
+
+    s->state = state;
+    s->check = check;
+    s->events++;
+    health_event_t event = {
+        .timestamp_us = timestamp_us,
+        .sensor = (uint8_t)sensor,
+        .state = (uint8_t)state,
+        .check = (uint8_t)check,
+        .weight = state_weight[state],
+        .detail = detail,
+    };
+    bus_publish(topics[config->source], &event, state != HEALTH_OK);
+    stats_set(s->weight_gauge, event.weight);
+    stats_add(event_counter, 1);
+
+    if (state == HEALTH_OK) {
+        DLOGI(TAG, "%s OK - fusion weight restored", config->name);
+    } else {
+        DLOGW(TAG, "%s %s (%s, %u) - fusion weight %u/255", config->name, state_names[state],
+              check_names[check], detail, event.weight);
+    }
+}
+
+// Stuck and noise checks of one channel. key is the exact reading, value the same
+// in sample units. Readings at or beyond the range limit belong to the saturation
+// and range checks: a held rail is not stuck and a jump to it is not noise.
+static inline void channel_push(health_channel_t *channel, bool primed, float alpha, int32_t key, float value,
+                                bool at_limit) {
+    if (at_limit) {
+        channel->same_run = 0;
+        return;
+    }
+    if (primed) {
+        channel->same_run = key != channel->last_key ? 0 :
+                            channel->same_run < UINT16_MAX ? channel->same_run + 1 : UINT16_MAX;
+        float step = value - channel->last_value;
+        channel->step_var += alpha * (step * step - channel->step_var);
+    }
+    channel->last_key = key;
+    channel->last_value = value;
+}
+
+void sensor_health_read(health_sensor_t sensor, bool ok, timebase_us_t timestamp_us) {
+    if (sensor >= HEALTH_SENSORS) {
+        return;
+    }
+    ewma(&sensors[sensor].error_rate, !ok, sensor_config[sensor].alpha);
+    evaluate(sensor, timestamp_us);
+}
+
+void sensor_health_imu_sample(const mpu6050_raw_t *raw, timebase_us_t timestamp_us) {
+    static const uint8_t first_channel[] = { [HEALTH_ACCEL] = MPU6050_AX, [HEALTH_GYRO] = MPU6050_GX };
+
+    for (health_sensor_t sensor = HEALTH_ACCEL; sensor <= HEALTH_GYRO; sensor++) {
+        health_sensor_state_t *s = &sensors[sensor];
+        float alpha = sensor_config[sensor].alpha;
+        bool saturated = false;
+        for (int c = 0; c < 3; c++) {
+            int16_t v = raw->v[first_channel[sensor] + c];
+            bool at_limit = v >= HEALTH_IMU_SATURATION_LSB || v <= -HEALTH_IMU_SATURATION_LSB;
+            channel_push(&s->channel[c], s->primed, alpha, v, v, at_limit);
+            saturated |= at_limit;
+        }
+        ewma(&s->saturation_rate, saturated, alpha);
+        s->primed = true;
+        s->samples++;
+        evaluate(sensor, timestamp_us);
+    }
+}
+
+void sensor_health_mag_sample(float x, float y, float z, timebase_us_t timestamp_us) {
+    health_sensor_state_t *s = &sensors[HEALTH_MAG];
+    const float axis[3] = { x, y, z };
+    bool out_of_range = false;
+    for (int c = 0; c < 3; c++) {
+        int32_t key;
+        memcpy(&key, &axis[c], sizeof(key));
+        bool beyond = fabsf(axis[c]) > HEALTH_MAG_RANGE;
+        channel_push(&s->channel[c], s->primed, HEALTH_MAG_ALPHA, key, axis[c], beyond);
+        out_of_range |= beyond;
+    }
+    ewma(&s->range_rate, out_of_range, HEALTH_MAG_ALPHA);
+    s->primed = true;
+    s->samples++;
+    evaluate(HEALTH_MAG, timestamp_us);
+}
+
+void sensor_health_gps_fix(const gps_data_t *fix, const gps_health_t *health) {
+    // A solution without a fix has no usable accuracy, whatever the receiver says
+    uint32_t accuracy[] = {
+        [HEALTH_GPS_POSITION - HEALTH_GPS_POSITION] = fix->valid_fix ? health->horizontal_accuracy : UINT32_MAX,
+        [HEALTH_GPS_SPEED - HEALTH_GPS_POSITION] = fix->valid_fix ? health->speed_accuracy : UINT32_MAX,
+    };
+    bool out_of_range[] = {
+        [HEALTH_GPS_POSITION - HEALTH_GPS_POSITION] = fix->lat_e7 > 900000000 || fix->lat_e7 < -900000000 ||
+                                                      fix->lon_e7 > 1800000000 || fix->lon_e7 < -1800000000,
+        [HEALTH_GPS_SPEED - HEALTH_GPS_POSITION] = fix->speed_mm_s > HEALTH_GPS_MAX_SPEED_MM_S,
+    };
+
+    // Solutions are keyed by time of week: a receiver that stopped solving repeats it
+    for (health_sensor_t sensor = HEALTH_GPS_POSITION; sensor <= HEALTH_GPS_SPEED; sensor++) {
+        health_sensor_state_t *s = &sensors[sensor];
+        channel_push(&s->channel[0], s->primed, HEALTH_GPS_ALPHA, (int32_t)fix->itow_ms, 0.0f, false);
+        s->accuracy = accuracy[sensor - HEALTH_GPS_POSITION];
+        ewma(&s->range_rate, out_of_range[sensor - HEALTH_GPS_POSITION], HEALTH_GPS_ALPHA);
+        s->primed = true;
+        s->samples++;
+        evaluate(sensor, fix->timestamp_us);
+    }
+}
+
+const char* sensor_health_sensor_name(health_sensor_t sensor) {
+    return sensor < HEALTH_SENSORS ? sensor_config[sensor].name : "?";
+}
+
+const char* sensor_health_check_name(health_check_t check) {
+    return check <= HEALTH_CHECK_ACCURACY ? check_names[check] : "?";
+}
+
+esp_err_t sensor_health_get_status(health_sensor_t sensor, sensor_health_status_t *out_status) {
+    if (sensor >= HEALTH_SENSORS || out_status == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const health_sensor_state_t *s = &sensors[sensor];
+    float step_var = 0.0f;
+    uint16_t stuck_run = 0;
+    for (int c = 0; c < sensor_config[sensor].channels; c++) {
+        step_var = fmaxf(step_var, s->channel[c].step_var);
+        stuck_run = s->channel[c].same_run > stuck_run ? s->channel[c].same_run : stuck_run;
+    }
+    *out_status = (sensor_health_status_t){
+        .state = s->state,
+        .check = s->check,
+        .weight = state_weight[s->state],
+        .error_rate = s->error_rate,
+        .saturation_rate = s->saturation_rate,
+        .range_rate = s->range_rate,
+        .noise_std = sqrtf(step_var),
+        .stuck_run = stuck_run,
+        .accuracy = s->accuracy,
+        .samples = s->samples,
+        .events = s->events,
+    };
+    return ESP_OK;
+}
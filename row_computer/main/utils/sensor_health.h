@@ -0,0 +1,110 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "sensors/mpu6050.h"
+#include "sensors/gps.h"
+#include "utils/data_bus.h"
+#include "utils/timebase.h"
+
+// Online sensor health: every sample runs a fixed set of O(1) checks (no
+// windows, no history) and each sensor is rated OK / DEGRADED / FAILED:
+//
+//   read errors     rate of failed reads (EWMA)
+//   stuck           the same raw reading (or GNSS solution) over and over
+//   saturation      rate of readings at the end of the measurement range
+//   range           rate of physically implausible readings
+//   noise           running variance of the sample-to-sample step - the noise
+//                   floor, since rowing motion barely moves consecutive samples
+//   accuracy        GNSS horizontal and speed accuracy estimates against gates
+//
+// A sensor gets worse at once and better only after HEALTH_RECOVER_MS clean.
+// Each change is published as a health_event_t on the topic of the task that
+// feeds the sensor; fusion (DSP stage) scales what it takes from a sensor by the
+// weight of its latest event. Sensors start OK at full weight.
+
+typedef enum {
+    HEALTH_SOURCE_IMU,              // Accelerometer, gyroscope, magnetometer (IMU task)
+    HEALTH_SOURCE_GPS,              // GPS task
+    HEALTH_SOURCES
+} health_source_t;
+
+typedef enum {
+    HEALTH_ACCEL,
+    HEALTH_GYRO,
+    HEALTH_MAG,
+    HEALTH_GPS_POSITION,
+    HEALTH_GPS_SPEED,
+    HEALTH_SENSORS
+} health_sensor_t;
+
+typedef enum {
+    HEALTH_OK,
+    HEALTH_DEGRADED,
+    HEALTH_FAILED,
+} health_state_t;
+
+typedef enum {
+    HEALTH_CHECK_NONE,
+    HEALTH_CHECK_READ_ERRORS,
+    HEALTH_CHECK_STUCK,
+    HEALTH_CHECK_SATURATION,
+    HEALTH_CHECK_RANGE,
+    HEALTH_CHECK_NOISE,
+    HEALTH_CHECK_ACCURACY,
+} health_check_t;
+
+#define HEALTH_WEIGHT_FULL      255
+
+// State change of one sensor (16 bytes)
+typedef struct {
+    timebase_us_t timestamp_us;     // Sample that changed it
+    uint8_t sensor;                 // health_sensor_t
+    uint8_t state;                  // health_state_t
+    uint8_t check;                  // health_check_t behind the state, NONE when OK
+    uint8_t weight;                 // Fusion weight, 0 (ignore) .. HEALTH_WEIGHT_FULL
+    uint16_t detail;                // Measure of the check: rate in 0.1%, run length,
+                                    // noise std (sample units), accuracy in cm or cm/s
+} health_event_t;
+
+typedef struct {
+    health_state_t state;
+    health_check_t check;
+    uint8_t weight;
+    float error_rate;
+    float saturation_rate;
+    float range_rate;
+    float noise_std;                // Worst channel, sample units
+    uint16_t stuck_run;             // Longest current run of identical readings
+    uint32_t accuracy;              // GNSS only: last estimate, mm or mm/s
+    uint32_t samples;
+    uint32_t events;
+} sensor_health_status_t;
+
+// Create one event topic per source and register the health gauges. Call before tasks start.
+esp_err_t sensor_health_init(void);
+
+// Event topic of a source - consumers subscribe with bus_subscribe()
+bus_topic_t* sensor_health_topic(health_source_t source);
+
+// Outcome of a read that should have produced a sample (IMU task for
+// ACCEL/GYRO/MAG, GPS task for the GPS sensors)
+void sensor_health_read(health_sensor_t sensor, bool ok, timebase_us_t timestamp_us);
+
+// One accelerometer/gyroscope sample in bias-corrected counts (IMU task)
+void sensor_health_imu_sample(const mpu6050_raw_t *raw, timebase_us_t timestamp_us);
+
+// One fresh magnetometer reading in mag_read units (IMU task)
+void sensor_health_mag_sample(float x, float y, float z, timebase_us_t timestamp_us);
+
+// One navigation solution with its accuracy estimates (GPS task)
+void sensor_health_gps_fix(const gps_data_t *fix, const gps_health_t *health);
+
+const char* sensor_health_sensor_name(health_sensor_t sensor);
+const char* sensor_health_check_name(health_check_t check);
+
+esp_err_t sensor_health_get_status(health_sensor_t sensor, sensor_health_status_t *out_status);
+
+#endif // SENSOR_HEALTH_H
@@ -0,0 +1,85 @@
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "driver/spi_master.h"
+#include "config/pin_definitions.h"
+#include "config/common_constants.h"
+#include "spi_sensor.h"
+#include <string.h>
+
+static const char *TAG = "SPI_SENSOR";
+
+#define SPI_SENSOR_READ         0x80    // Register address MSB selects a read
+
+static spi_device_handle_t sensor_spi = NULL;
+static uint8_t *dma_tx = NULL;          // Address byte + dummy clocks
+static uint8_t *dma_rx = NULL;
+
+esp_err_t spi_sensor_init(void) {
+    if (sensor_spi != NULL) {
+        return ESP_OK;
+    }
+
+    dma_tx = heap_caps_calloc(1, SPI_SENSOR_MAX_BURST + 1, MALLOC_CAP_DMA);
+    dma_rx = heap_caps_malloc(SPI_SENSOR_MAX_BURST + 1, MALLOC_CAP_DMA);
+    if (dma_tx == NULL || dma_rx == NULL) {
+        heap_caps_free(dma_tx);
+        heap_caps_free(dma_rx);
+        dma_tx = dma_rx = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The display shares SPI2; transactions are arbitrated per device, and
+    // the sensor's own FIFO absorbs the wait behind a display DMA chunk
+    spi_device_interface_config_t devcfg = {
+        .clock_speed_hz = IMU_SPI_CLOCK_HZ,
+        .mode = 3,
+        .spics_io_num = IMU_SPI_CS_PIN,
+        .queue_size = 1,
+    };
+    esp_err_t err = spi_bus_add_device(SPI2_HOST, &devcfg, &sensor_spi);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add SPI sensor: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t spi_sensor_write(uint8_t reg_addr, uint8_t value) {
+    spi_transaction_t t = {
+        .flags = SPI_TRANS_USE_TXDATA,
+        .length = 16,
+        .tx_data = { reg_addr & ~SPI_SENSOR_READ, value },
+    };
+    return spi_device_polling_transmit(sensor_spi, &t);
+}
+
+esp_err_t spi_sensor_read_burst(uint8_t reg_addr, size_t len, const uint8_t **data) {
+    if (len == 0 || len > SPI_SENSOR_MAX_BURST) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    dma_tx[0] = reg_addr | SPI_SENSOR_READ;
+    spi_transaction_t t = {
+        .length = (len + 1) * 8,
+        .tx_buffer = dma_tx,
+        .rx_buffer = dma_rx,
+    };
+
+    // Short register reads poll (cheaper than an interrupt round trip); FIFO
+    // bursts block on the DMA completion interrupt and leave the CPU free
+    esp_err_t err = len <= SPI_SENSOR_POLL_MAX ? spi_device_polling_transmit(sensor_spi, &t)
+                                               : spi_device_transmit(sensor_spi, &t);
+    if (err != ESP_OK) {
+        return err;
+    }
+    *data = dma_rx + 1;     // Skip the byte clocked in during the address phase
+    return ESP_OK;
+}
+
+esp_err_t spi_sensor_read(uint8_t reg_addr, uint8_t *data, size_t len) {
+    const uint8_t *burst;
+    esp_err_t err = spi_sensor_read_burst(reg_addr, len, &burst);
+    if (err == ESP_OK) {
+        memcpy(data, burst, len);
+    }
+    return err;
+}
@@ -0,0 +1,24 @@
+#ifndef SPI_SENSOR_H
+#define SPI_SENSOR_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Register access to an SPI sensor on the shared SPI2 bus (spi_master_init).
+// Bursts go through DMA into an internal DMA-capable buffer and are handed out
+// in place, so draining a FIFO costs one transaction and no copies.
+
+// Add the sensor as a device on the bus (mode 3, IMU_SPI_CLOCK_HZ, IMU_SPI_CS_PIN)
+esp_err_t spi_sensor_init(void);
+
+esp_err_t spi_sensor_write(uint8_t reg_addr, uint8_t value);
+
+// Copying read for short register blocks
+esp_err_t spi_sensor_read(uint8_t reg_addr, uint8_t *data, size_t len);
+
+// Read len bytes from reg_addr (auto-increment / FIFO port) into the DMA buffer.
+// *data is valid until the next spi_sensor_* call. len <= SPI_SENSOR_MAX_BURST.
+esp_err_t spi_sensor_read_burst(uint8_t reg_addr, size_t len, const uint8_t **data);
+
+#endif // SPI_SENSOR_H
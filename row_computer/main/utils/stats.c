@@ -0,0 +1,248 @@
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "config/common_constants.h"
+#include "stats.h"
+#include "timebase.h"
+#include <stdarg.h>
+#include <string.h>
+
+static const char *TAG = "STATS";
+
+// System metrics owned by the registry itself, always the first entries
+enum { HEAP_FREE, HEAP_MIN_FREE, HEAP_LARGEST_BLOCK, HEAP_FRAG_PCT, BUILTIN_METRICS };
+
+// Entries are only ever appended: readers walk [0, count) without the lock,
+// registration publishes count after the entry is complete
+static stats_metric_t metrics[STATS_MAX_METRICS] = {
+    [HEAP_FREE]          = { "heap.free", STATS_GAUGE },
+    [HEAP_MIN_FREE]      = { "heap.min_free", STATS_GAUGE },
+    [HEAP_LARGEST_BLOCK] = { "heap.largest_block", STATS_GAUGE },
+    [HEAP_FRAG_PCT]      = { "heap.frag_pct", STATS_GAUGE },
+};
+static uint32_t metric_count = BUILTIN_METRICS;
+static stats_histogram_t histograms[STATS_MAX_HISTOGRAMS];
+static uint32_t histogram_count = 0;
+static portMUX_TYPE registry_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void collect_heap(void);
+
+static void (*collectors[STATS_MAX_COLLECTORS])(void) = { collect_heap };
+static uint32_t collector_count = 1;
+
+static char json_line[STATS_JSON_MAX];  // Export buffer (monitor task only)
+
+static stats_metric_t *find(const char *name, uint32_t from, uint32_t to) {
+    for (uint32_t i = from; i < to; i++) {
+        if (strncmp(metrics[i].name, name, STATS_NAME_MAX - 1) == 0) {
+            return &metrics[i];
+        }
+    }
+    return NULL;
+}
+
+stats_metric_t *stats_register(const char *name, stats_kind_t kind) {
+    uint32_t seen = __atomic_load_n(&metric_count, __ATOMIC_ACQUIRE);
+    stats_metric_t *metric = find(name, 0, seen);
+    if (metric != NULL) {
+        return metric;
+    }
+
+    taskENTER_CRITICAL(&registry_mux);
+    metric = find(name, seen, metric_count);
+    if (metric == NULL && metric_count < STATS_MAX_METRICS &&
+        (kind != STATS_HISTOGRAM || histogram_count < STATS_MAX_HISTOGRAMS)) {
+        metric = &metrics[metric_count];
+        strncpy(metric->name, name, STATS_NAME_MAX - 1);
+        metric->kind = kind;
+        metric->value = 0;
+        metric->histogram = kind == STATS_HISTOGRAM ? &histograms[histogram_count++] : NULL;
+        __atomic_store_n(&metric_count, metric_count + 1, __ATOMIC_RELEASE);
+    }
+    taskEXIT_CRITICAL(&registry_mux);
+
+    if (metric == NULL) {
+        ESP_LOGW(TAG, "Registry full - %s not tracked", name);
+    }
+    return metric;
+}
+
+esp_err_t stats_register_collector(void (*collect)(void)) {
+    taskENTER_CRITICAL(&registry_mux);
+    bool added = collector_count < STATS_MAX_COLLECTORS;
+    if (added) {
+        collectors[collector_count++] = collect;
+    }
+    taskEXIT_CRITICAL(&registry_mux);
+    return added ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void stats_observe(stats_metric_t *metric, uint32_t value) {
+    if (metric == NULL || metric->histogram == NULL) {
+        return;
+    }
+    stats_histogram_t *histogram = metric->histogram;
+    uint32_t bucket = value == 0 ? 0 : 32 - __builtin_clz(value);
+    if (bucket >= STATS_HIST_BUCKETS) {
+        bucket = STATS_HIST_BUCKETS - 1;
+    }
+    __atomic_fetch_add(&histogram->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->sum, value, __ATOMIC_RELAXED);
+    uint32_t max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    while (value > max && !__atomic_compare_exchange_n(&histogram->max, &max, value, true,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Fragmentation: share of the free heap that is not in the largest block
+static void collect_heap(void) {
+    size_t free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    stats_set(&metrics[HEAP_FREE], (int32_t)free_size);
+    stats_set(&metrics[HEAP_MIN_FREE], (int32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    stats_set(&metrics[HEAP_LARGEST_BLOCK], (int32_t)largest);
+    stats_set(&metrics[HEAP_FRAG_PCT], free_size > 0 ? (int32_t)(100 - (uint64_t)largest * 100 / free_size) : 0);
+}
+
+static uint32_t collect(void) {
+    uint32_t collectors_now = __atomic_load_n(&collector_count, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < collectors_now; i++) {
+        collectors[i]();
+    }
+    return __atomic_load_n(&metric_count, __ATOMIC_ACQUIRE);
+}
+
+static inline uint32_t load(const uint32_t *value) {
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+// Serialised size of one metric (binary)
+static size_t metric_size(const stats_metric_t *metric, uint16_t *mask) {
+    size_t size = 2 + strlen(metric->name);
+    if (metric->histogram == NULL) {
+        return size + sizeof(uint32_t);
+    }
+    *mask = 0;
+    size += 3 * sizeof(uint32_t) + sizeof(uint16_t);
+    for (int b = 0; b < STATS_HIST_BUCKETS; b++) {
+        if (load(&metric->histogram->buckets[b]) != 0) {
+            *mask |= 1 << b;
+            size += sizeof(uint32_t);
+        }
+    }
+    return size;
+}
+
+static uint8_t *put_u32(uint8_t *out, uint32_t value) {
+    memcpy(out, &value, sizeof(value));
+    return out + sizeof(value);
+}
+
+size_t stats_snapshot(uint8_t *buffer, size_t size) {
+    if (buffer == NULL || size < sizeof(stats_snapshot_header_t)) {
+        return 0;
+    }
+    uint32_t count = collect();
+    stats_snapshot_header_t header = {
+        .magic = STATS_SNAPSHOT_MAGIC,
+        .version = STATS_SNAPSHOT_VERSION,
+        .uptime_ms = timebase_now_ms(),
+    };
+
+    uint8_t *out = buffer + sizeof(header);
+    for (uint32_t i = 0; i < count; i++) {
+        const stats_metric_t *metric = &metrics[i];
+        uint16_t mask = 0;
+        if ((size_t)(out - buffer) + metric_size(metric, &mask) > size) {
+            header.flags |= STATS_SNAPSHOT_TRUNCATED;
+            break;
+        }
+        size_t name_length = strlen(metric->name);
+        *out++ = metric->kind;
+        *out++ = (uint8_t)name_length;
+        memcpy(out, metric->name, name_length);
+        out += name_length;
+        if (metric->histogram == NULL) {
+            out = put_u32(out, load(&metric->value));
+            header.count++;
+            continue;
+        }
+        // Buckets can have moved on since metric_size - the mask decides what is written
+        const stats_histogram_t *histogram = metric->histogram;
+        out = put_u32(out, load(&histogram->count));
+        out = put_u32(out, load(&histogram->sum));
+        out = put_u32(out, load(&histogram->max));
+        memcpy(out, &mask, sizeof(mask));
+        out += sizeof(mask);
+        for (int b = 0; b < STATS_HIST_BUCKETS; b++) {
+            if (mask & (1 << b)) {
+                out = put_u32(out, load(&histogram->buckets[b]));
+            }
+        }
+        header.count++;
+    }
+    memcpy(buffer, &header, sizeof(header));
+    return out - buffer;
+}
+
+static void append(char *buffer, size_t size, int *length, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t room = (size_t)*length < size ? size - *length : 0;
+    int written = vsnprintf(room > 0 ? buffer + *length : NULL, room, format, args);
+    va_end(args);
+    if (written > 0) {
+        *length += written;
+    }
+}
+
+int stats_snapshot_json(char *buffer, size_t size) {
+    static const char *const sections[] = { "counters", "gauges", "histograms" };
+    uint32_t count = collect();
+    int length = 0;
+
+    append(buffer, size, &length, "{\"uptime_ms\":%lu", (unsigned long)timebase_now_ms());
+    for (int kind = STATS_COUNTER; kind <= STATS_HISTOGRAM; kind++) {
+        append(buffer, size, &length, ",\"%s\":{", sections[kind]);
+        const char *separator = "";
+        for (uint32_t i = 0; i < count; i++) {
+            const stats_metric_t *metric = &metrics[i];
+            if (metric->kind != (stats_kind_t)kind) {
+                continue;
+            }
+            if (kind == STATS_COUNTER) {
+                append(buffer, size, &length, "%s\"%s\":%lu", separator, metric->name,
+                       (unsigned long)load(&metric->value));
+            } else if (kind == STATS_GAUGE) {
+                append(buffer, size, &length, "%s\"%s\":%ld", separator, metric->name,
+                       (long)(int32_t)load(&metric->value));
+            } else {
+                const stats_histogram_t *histogram = metric->histogram;
+                append(buffer, size, &length, "%s\"%s\":{\"count\":%lu,\"sum\":%lu,\"max\":%lu,\"buckets\":[",
+                       separator, metric->name, (unsigned long)load(&histogram->count),
+                       (unsigned long)load(&histogram->sum), (unsigned long)load(&histogram->max));
+                for (int b = 0; b < STATS_HIST_BUCKETS; b++) {
+                    append(buffer, size, &length, b == 0 ? "%lu" : ",%lu", (unsigned long)load(&histogram->buckets[b]));
+                }
+                append(buffer, size, &length, "]}");
+            }
+            separator = ",";
+        }
+        append(buffer, size, &length, "}");
+    }
+    append(buffer, size, &length, "}");
+    return length;
+}
+
+esp_err_t stats_export(FILE *stream) {
+    int length = stats_snapshot_json(json_line, sizeof(json_line));
+    if (length >= (int)sizeof(json_line)) {
+        ESP_LOGW(TAG, "Snapshot needs %d bytes, STATS_JSON_MAX is %u", length + 1, (unsigned)sizeof(json_line));
+        return ESP_ERR_INVALID_SIZE;
+    }
+    fputs(json_line, stream);
+    fputc('\n', stream);
+    fflush(stream);
+    return ESP_OK;
+}
@@ -0,0 +1,95 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Runtime statistics registry. Modules register named counters, gauges and
+// histograms once (at init) and update them through the returned handle with
+// relaxed atomics - no locks, any task, either core. Totals a module already
+// keeps in its own *_get_stats() struct are not mirrored on its hot path: a
+// collector copies them in right before each snapshot.
+//
+// Snapshots go out as compact binary (session download STATS frame, decoded by
+// tools/session_download.py) or as one JSON line (stats_export - the console on
+// target, stdout or a pipe in host builds).
+
+#define STATS_NAME_MAX          32
+#define STATS_HIST_BUCKETS      16      // Bucket 0: 0, bucket b: [2^(b-1), 2^b), last: everything above
+
+#define STATS_SNAPSHOT_MAGIC    0x5453  // "ST"
+#define STATS_SNAPSHOT_VERSION  1
+#define STATS_SNAPSHOT_TRUNCATED 0x01   // Buffer too small - trailing metrics left out
+
+typedef enum {
+    STATS_COUNTER,              // Only goes up (wraps at 2^32)
+    STATS_GAUGE,                // Signed level
+    STATS_HISTOGRAM,            // Distribution in log2 buckets
+} stats_kind_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t sum;
+    uint32_t max;
+    uint32_t buckets[STATS_HIST_BUCKETS];
+} stats_histogram_t;
+
+typedef struct {
+    char name[STATS_NAME_MAX];
+    stats_kind_t kind;
+    uint32_t value;             // Counter total or gauge level
+    stats_histogram_t *histogram;
+} stats_metric_t;
+
+// Binary snapshot header. Each metric follows as kind u8, name length u8, name,
+// then value u32 (counter/gauge) or count, sum, max u32, bucket mask u16 and one
+// u32 per set bit (histogram). Little endian.
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t uptime_ms;
+    uint16_t count;
+} stats_snapshot_header_t;
+
+// Register a metric, or return the one already registered under name. NULL when
+// the registry is full - the update functions accept NULL and do nothing.
+stats_metric_t *stats_register(const char *name, stats_kind_t kind);
+
+// Pulled metrics: collect() runs before every snapshot, in the task taking it -
+// the monitor loop (stats_export) or the session transfer task (STATS frame),
+// possibly both at once. A collector must tolerate that and read totals another
+// task updates without tearing them (32-bit fields, or atomics for wider ones).
+esp_err_t stats_register_collector(void (*collect)(void));
+
+static inline void stats_add(stats_metric_t *metric, uint32_t amount) {
+    if (metric != NULL) {
+        __atomic_fetch_add(&metric->value, amount, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void stats_set(stats_metric_t *metric, int32_t value) {
+    if (metric != NULL) {
+        __atomic_store_n(&metric->value, (uint32_t)value, __ATOMIC_RELAXED);
+    }
+}
+
+static inline uint32_t stats_value(const stats_metric_t *metric) {
+    return metric != NULL ? __atomic_load_n(&metric->value, __ATOMIC_RELAXED) : 0;
+}
+
+void stats_observe(stats_metric_t *metric, uint32_t value);
+
+// Run the collectors and serialise every metric. Returns the bytes written.
+size_t stats_snapshot(uint8_t *buffer, size_t size);
+
+// Same as one JSON object. Returns the length (snprintf semantics: >= size means cut).
+int stats_snapshot_json(char *buffer, size_t size);
+
+// Write a JSON snapshot line to stream
+esp_err_t stats_export(FILE *stream);
+
+#endif // STATS_H
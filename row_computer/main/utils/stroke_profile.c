@@ -0,0 +1,191 @@
+#include "stroke_profile.h"
+#include <math.h>
+#include <string.h>
+
+#define STROKE_BINS     (STROKE_PROFILE_MAX_MS / STROKE_PROFILE_BIN_MS)
+#define GRAVITY_MM_S2   9806.65f
+
+// Running cycle: bin b holds the samples of [catch + b * BIN_MS, catch + (b + 1) * BIN_MS).
+// Bins are cleared as the cycle reaches them, so a stroke costs its own length.
+static float bin_sum[STROKE_BINS];
+static uint16_t bin_count[STROKE_BINS];
+static uint32_t bins_used = 0;
+static timebase_us_t catch_us = 0;
+static bool in_cycle = false;
+static bool overflow = false;
+
+static float template[STROKE_PROFILE_POINTS];
+static bool have_template = false;
+
+void stroke_profile_reset(void) {
+    in_cycle = false;
+    overflow = false;
+    bins_used = 0;
+    have_template = false;
+}
+
+void stroke_profile_push(float surge_g, timebase_us_t timestamp_us) {
+    if (!in_cycle || overflow) {
+        return;
+    }
+    timebase_us_t elapsed_us = timestamp_us - catch_us;
+    uint32_t bin = elapsed_us < (timebase_us_t)STROKE_PROFILE_MAX_MS * 1000 ?
+                   (uint32_t)elapsed_us / (STROKE_PROFILE_BIN_MS * 1000) : STROKE_BINS;
+    if (bin >= STROKE_BINS) {
+        overflow = true;
+        return;
+    }
+    while (bins_used <= bin) {
+        bin_sum[bins_used] = 0.0f;
+        bin_count[bins_used] = 0;
+        bins_used++;
+    }
+    bin_sum[bin] += surge_g;
+    bin_count[bin]++;
+}
+
+static int8_t quantise_profile(float g) {
+    float steps = g * 50.0f;
+    if (steps > 127.0f) {
+        return 127;
+    }
+    if (steps < -127.0f) {
+        return -127;
+    }
+    return (int8_t)lrintf(steps);
+}
+
+static uint16_t to_cg(float g) {
+    float cg = g * 100.0f;
+    return cg <= 0.0f ? 0 : cg >= 65535.0f ? 65535 : (uint16_t)lrintf(cg);
+}
+
+// Pearson correlation of the profile with the template (0 when either is flat)
+static float correlate(const float *a, const float *b) {
+    float mean_a = 0.0f, mean_b = 0.0f;
+    for (int i = 0; i < STROKE_PROFILE_POINTS; i++) {
+        mean_a += a[i];
+        mean_b += b[i];
+    }
+    mean_a /= STROKE_PROFILE_POINTS;
+    mean_b /= STROKE_PROFILE_POINTS;
+
+    float cov = 0.0f, var_a = 0.0f, var_b = 0.0f;
+    for (int i = 0; i < STROKE_PROFILE_POINTS; i++) {
+        float da = a[i] - mean_a;
+        float db = b[i] - mean_b;
+        cov += da * db;
+        var_a += da * da;
+        var_b += db * db;
+    }
+    return var_a > 0.0f && var_b > 0.0f ? cov / sqrtf(var_a * var_b) : 0.0f;
+}
+
+// Shape of the cycle held in the first bins bins (bin_sum becomes the acceleration curve)
+static bool analyse(uint32_t bins, uint32_t cycle_ms, stroke_shape_t *out) {
+    float *accel = bin_sum;
+
+    // Bin means; bins without a sample (acquisition slower than the bin rate) hold the last value
+    uint32_t first = 0;
+    while (first < bins_used && bin_count[first] == 0) {
+        first++;
+    }
+    if (first >= bins_used) {
+        return false;
+    }
+    float last = accel[first] / bin_count[first];
+    float mean = 0.0f;
+    for (uint32_t i = 0; i < bins; i++) {
+        if (i < bins_used && bin_count[i] > 0) {
+            last = accel[i] / bin_count[i];
+        }
+        accel[i] = last;
+        mean += last;
+    }
+    mean /= bins;
+
+    // Steady boat speed over a cycle: what is left of the mean is tilt/gravity
+    uint32_t peak = 0;
+    float check = 0.0f;
+    for (uint32_t i = 0; i < bins; i++) {
+        accel[i] -= mean;
+        if (accel[i] > accel[peak]) {
+            peak = i;
+        }
+        if (accel[i] < check) {
+            check = accel[i];
+        }
+    }
+    if (accel[peak] <= 0.0f) {
+        return false;
+    }
+
+    uint32_t finish = peak + 1;
+    while (finish < bins && accel[finish] >= 0.0f) {
+        finish++;
+    }
+    if (finish < 2) {
+        return false;
+    }
+
+    float impulse = 0.0f;
+    for (uint32_t i = 0; i < finish; i++) {
+        impulse += accel[i];
+    }
+    impulse *= GRAVITY_MM_S2 * STROKE_PROFILE_BIN_MS / 1000.0f;
+
+    // Time-normalised drive: linear interpolation onto STROKE_PROFILE_POINTS
+    float profile[STROKE_PROFILE_POINTS];
+    float step = (float)(finish - 1) / (STROKE_PROFILE_POINTS - 1);
+    for (int k = 0; k < STROKE_PROFILE_POINTS; k++) {
+        float x = k * step;
+        uint32_t i = (uint32_t)x;
+        if (i >= finish - 1) {
+            profile[k] = accel[finish - 1];
+        } else {
+            profile[k] = accel[i] + (accel[i + 1] - accel[i]) * (x - i);
+        }
+        out->profile[k] = quantise_profile(profile[k]);
+    }
+
+    float consistency = 0.0f;
+    if (have_template) {
+        consistency = correlate(profile, template);
+        for (int k = 0; k < STROKE_PROFILE_POINTS; k++) {
+            template[k] += STROKE_TEMPLATE_ALPHA * (profile[k] - template[k]);
+        }
+    } else {
+        memcpy(template, profile, sizeof(template));
+        have_template = true;
+    }
+
+    uint32_t drive_ms = finish * STROKE_PROFILE_BIN_MS;
+    if (drive_ms > cycle_ms) {
+        drive_ms = cycle_ms;
+    }
+    out->cycle_ms = (uint16_t)cycle_ms;
+    out->drive_ms = (uint16_t)drive_ms;
+    out->peak_cg = to_cg(accel[peak]);
+    out->check_cg = to_cg(-check);
+    out->impulse_mm_s = impulse >= 32767.0f ? 32767 : impulse <= -32767.0f ? -32767 : (int16_t)lrintf(impulse);
+    out->peak_pct = (uint8_t)(peak * 100 / finish);
+    out->rhythm_pct = (uint8_t)(drive_ms * 100 / cycle_ms);
+    out->consistency_pct = consistency > 0.0f ? (uint8_t)lrintf(consistency * 100.0f) : 0;
+    return true;
+}
+
+bool stroke_profile_catch(timebase_us_t timestamp_us, stroke_shape_t *out) {
+    bool complete = false;
+    timebase_us_t cycle_us = timestamp_us - catch_us;
+    if (in_cycle && !overflow && cycle_us < (timebase_us_t)STROKE_PROFILE_MAX_MS * 1000) {
+        uint32_t cycle_ms = (uint32_t)cycle_us / 1000;
+        uint32_t bins = cycle_ms / STROKE_PROFILE_BIN_MS;
+        complete = bins >= 2 && analyse(bins, cycle_ms, out);
+    }
+
+    catch_us = timestamp_us;
+    bins_used = 0;
+    overflow = false;
+    in_cycle = true;
+    return complete;
+}
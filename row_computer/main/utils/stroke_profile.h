@@ -0,0 +1,48 @@
+#ifndef STROKE_PROFILE_H
+#define STROKE_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "config/common_constants.h"
+#include "utils/timebase.h"
+
+// Stroke shape from boat-axis (surge) acceleration - the force-curve proxy a
+// single hull-mounted IMU can give. Samples between two catches are binned to
+// STROKE_PROFILE_BIN_MS in a static buffer that holds the longest stroke
+// (STROKE_PROFILE_MAX_MS); when the next catch arrives the finished cycle is
+// analysed in place:
+//
+//   - the cycle mean is removed (mount tilt, speed change over the stroke)
+//   - the drive runs from the catch to the first drop below zero after the
+//     acceleration peak (the finish)
+//   - the drive is resampled to STROKE_PROFILE_POINTS, time-normalised
+//   - consistency compares the profile with a running template of the crew's
+//     recent strokes (Pearson correlation)
+//
+// Nothing is allocated; one DSP-task instance (module state).
+
+// Per-stroke record, logged as is (SESSION_REC_STROKE_SHAPE)
+typedef struct __attribute__((packed)) {
+    uint16_t cycle_ms;          // Catch to catch
+    uint16_t drive_ms;          // Catch to finish
+    uint16_t peak_cg;           // Highest drive acceleration, 0.01 g
+    uint16_t check_cg;          // Check depth: deepest deceleration of the cycle, 0.01 g
+    int16_t impulse_mm_s;       // Drive impulse: boat speed gained over the drive
+    uint8_t peak_pct;           // Peak time, % of the drive
+    uint8_t rhythm_pct;         // Rhythm ratio: drive share of the cycle
+    uint8_t consistency_pct;    // Shape match with the template, 0 for the first stroke
+    int8_t profile[STROKE_PROFILE_POINTS];     // Drive acceleration, 0.02 g (saturates)
+} stroke_shape_t;
+
+// Start over (first catch after this opens a new cycle, the template is dropped)
+void stroke_profile_reset(void);
+
+// Feed one surge sample (g, positive towards the bow) at the acquisition rate
+void stroke_profile_push(float surge_g, timebase_us_t timestamp_us);
+
+// A catch was detected at timestamp_us. Closes the running cycle and returns true
+// with its shape in out when it was a complete stroke (false for the first catch
+// and for cycles longer than STROKE_PROFILE_MAX_MS or without a drive).
+bool stroke_profile_catch(timebase_us_t timestamp_us, stroke_shape_t *out);
+
+#endif // STROKE_PROFILE_H
@@ -0,0 +1,11 @@
+#include "timebase.h"
+
+bool timebase_delta_ms(timebase_us_t base_us, timebase_us_t time_us, int16_t *delta_ms) {
+    // Whole milliseconds on both sides, so decoding reproduces timebase_ms() exactly
+    int64_t delta = (int64_t)(time_us / 1000) - (int64_t)(base_us / 1000);
+    if (delta < INT16_MIN || delta > INT16_MAX) {
+        return false;
+    }
+    *delta_ms = (int16_t)delta;
+    return true;
+}
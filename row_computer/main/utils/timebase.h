@@ -0,0 +1,40 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_timer.h"
+
+// One clock for every sample, fix and record: microseconds since boot from
+// esp_timer (64 bit - monotonic, keeps running through light sleep and never
+// wraps in practice). Reading it costs a few register loads, so the acquisition
+// path stamps each sample directly. Tick-count time is not used for timestamps:
+// it starts later than esp_timer and would not line up with the records.
+typedef uint64_t timebase_us_t;
+
+static inline timebase_us_t timebase_now_us(void) {
+    return (timebase_us_t)esp_timer_get_time();
+}
+
+// 32-bit milliseconds for interval bookkeeping (governor, session index, rate
+// limits). Wraps every 49.7 days - compare with unsigned differences only.
+static inline uint32_t timebase_ms(timebase_us_t time_us) {
+    return (uint32_t)(time_us / 1000);
+}
+
+static inline uint32_t timebase_now_ms(void) {
+    return timebase_ms(timebase_now_us());
+}
+
+// Batched records carry one full time and a 16-bit delta per entry: the
+// signed difference of time_us and base_us in whole milliseconds (what
+// timebase_ms() of each would give). False when it does not fit in +-32.7s -
+// the caller starts a new batch.
+bool timebase_delta_ms(timebase_us_t base_us, timebase_us_t time_us, int16_t *delta_ms);
+
+// Millisecond time of a batch entry (same value as timebase_ms() of its full time)
+static inline uint32_t timebase_delta_to_ms(timebase_us_t base_us, int16_t delta_ms) {
+    return timebase_ms(base_us) + (uint32_t)(int32_t)delta_ms;
+}
+
+#endif // TIMEBASE_H
@@ -0,0 +1,364 @@
+#!/usr/bin/env python3
+"""Download session logs from the row computer over its console serial port.
+
+Speaks the framed protocol of main/storage/session_transfer.h:
+
+    session_download.py /dev/ttyUSB0 list
+    session_download.py /dev/ttyUSB0 get 12 13 -d logs/
+    session_download.py /dev/ttyUSB0 get          # every closed session
+    session_download.py /dev/ttyUSB0 stats -i 5   # telemetry as JSON lines
+    session_download.py /dev/ttyUSB0 config       # runtime configuration
+    session_download.py /dev/ttyUSB0 config stroke_threshold_g=1.8 gov_rest_hold_ms=60000
+
+A file that is already partly on disk is resumed from its current size
+(--restart starts over). Uses pyserial when installed, otherwise a raw POSIX
+tty, which also works on a pty.
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import time
+import zlib
+
+SYNC = b"\xa5\x5a"
+LIST, GET, ACK, ABORT, STATS, CONFIG_GET, CONFIG_SET = 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07
+ENTRIES, DATA, END, ERROR, SNAPSHOT, CONFIG = 0x81, 0x82, 0x83, 0x84, 0x85, 0x86
+FLAG_MORE = 0x01
+FLAG_REWIND = 0x01
+PAYLOAD_MAX = 8 + 8192          # Anything longer is noise, not a frame
+CONFIG_SET_MAX = 192
+
+ERRORS = {0x102: "ESP_ERR_INVALID_ARG", 0x103: "ESP_ERR_INVALID_STATE",
+          0x104: "ESP_ERR_INVALID_SIZE", 0x105: "ESP_ERR_NOT_FOUND", 0x107: "ESP_ERR_TIMEOUT", -1: "ESP_FAIL"}
+
+
+class PosixLink:
+    def __init__(self, path, baud):
+        import termios
+        import tty
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        attrs = termios.tcgetattr(self.fd)
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is not None:
+            attrs[4] = attrs[5] = speed
+        attrs[2] &= ~termios.HUPCL      # Keep DTR/RTS as they are - they reset the board
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        termios.tcflush(self.fd, termios.TCIFLUSH)
+
+    def read(self, timeout):
+        import select
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        return os.read(self.fd, 65536) if ready else b""
+
+    def write(self, data):
+        os.write(self.fd, data)
+
+    def close(self):
+        os.close(self.fd)
+
+
+class SerialLink:
+    def __init__(self, path, baud):
+        import serial
+        self.port = serial.Serial()
+        self.port.port = path
+        self.port.baudrate = baud
+        self.port.dtr = False           # Do not reset the board on open
+        self.port.rts = False
+        self.port.open()
+        self.port.reset_input_buffer()
+
+    def read(self, timeout):
+        self.port.timeout = timeout
+        first = self.port.read(1)
+        return first + self.port.read(self.port.in_waiting) if first else b""
+
+    def write(self, data):
+        self.port.write(data)
+
+    def close(self):
+        self.port.close()
+
+
+def open_link(path, baud):
+    try:
+        return SerialLink(path, baud)
+    except ImportError:
+        return PosixLink(path, baud)
+
+
+class Protocol:
+    def __init__(self, link):
+        self.link = link
+        self.buffer = bytearray()
+        self.bad_frames = 0
+
+    def send(self, kind, payload=b"", flags=0):
+        body = struct.pack("<BBH", kind, flags, len(payload)) + payload
+        self.link.write(SYNC + body + struct.pack("<I", zlib.crc32(body)))
+
+    def _take_frame(self):
+        buf = self.buffer
+        while True:
+            start = buf.find(SYNC)
+            if start < 0:
+                del buf[:max(0, len(buf) - 1)]
+                return None
+            del buf[:start]
+            if len(buf) < 6:
+                return None
+            kind, flags, length = struct.unpack_from("<BBH", buf, 2)
+            if length > PAYLOAD_MAX:
+                del buf[:1]
+                continue
+            total = 6 + length + 4
+            if len(buf) < total:
+                return None
+            (crc,) = struct.unpack_from("<I", buf, 6 + length)
+            if crc != zlib.crc32(bytes(buf[2:6 + length])):
+                self.bad_frames += 1
+                del buf[:1]
+                continue
+            frame = (kind, flags, bytes(buf[6:6 + length]))
+            del buf[:total]
+            return frame
+
+    def receive(self, timeout):
+        """Next intact frame, or None after timeout seconds without one"""
+        deadline = time.monotonic() + timeout
+        while True:
+            frame = self._take_frame()
+            if frame is not None:
+                return frame
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            self.buffer += self.link.read(remaining)
+
+
+def list_sessions(proto, timeout=2.0):
+    proto.send(LIST)
+    sessions = {}
+    while True:
+        frame = proto.receive(timeout)
+        if frame is None:
+            raise TimeoutError("no reply to LIST")
+        kind, flags, payload = frame
+        if kind != ENTRIES:
+            continue
+        for session_id, size in struct.iter_unpack("<II", payload):
+            sessions[session_id] = size
+        if not flags & FLAG_MORE:
+            return dict(sorted(sessions.items()))
+
+
+def decode_snapshot(blob):
+    """Binary stats snapshot (main/utils/stats.h) -> the JSON layout of stats_export()"""
+    magic, version, flags, uptime_ms, count = struct.unpack_from("<HBBIH", blob)
+    if magic != 0x5453 or version != 1:
+        raise IOError("unknown snapshot format %04x v%d" % (magic, version))
+    snapshot = {"uptime_ms": uptime_ms, "counters": {}, "gauges": {}, "histograms": {}}
+    if flags & 0x01:
+        snapshot["truncated"] = True
+    pos = 10
+    for _ in range(count):
+        kind, name_length = struct.unpack_from("<BB", blob, pos)
+        name = blob[pos + 2:pos + 2 + name_length].decode()
+        pos += 2 + name_length
+        if kind == 2:
+            total, value_sum, value_max, mask = struct.unpack_from("<IIIH", blob, pos)
+            pos += 14
+            buckets = []
+            for bucket in range(16):
+                if mask & (1 << bucket):
+                    buckets.append(struct.unpack_from("<I", blob, pos)[0])
+                    pos += 4
+                else:
+                    buckets.append(0)
+            snapshot["histograms"][name] = {"count": total, "sum": value_sum, "max": value_max, "buckets": buckets}
+        else:
+            (value,) = struct.unpack_from("<I" if kind == 0 else "<i", blob, pos)
+            pos += 4
+            snapshot["counters" if kind == 0 else "gauges"][name] = value
+    return snapshot
+
+
+def read_stats(proto, timeout=2.0):
+    proto.send(STATS)
+    while True:
+        frame = proto.receive(timeout)
+        if frame is None:
+            raise TimeoutError("no reply to STATS")
+        if frame[0] == SNAPSHOT:
+            return decode_snapshot(frame[2])
+
+
+def config(proto, assignments=(), timeout=5.0):
+    """Current configuration; assignments ("name=value") are committed together first"""
+    if assignments:
+        text = "\n".join(assignments).encode()
+        if len(text) > CONFIG_SET_MAX:
+            raise IOError("assignments exceed %d bytes - split them" % CONFIG_SET_MAX)
+        proto.send(CONFIG_SET, text)
+    else:
+        proto.send(CONFIG_GET)
+    while True:
+        frame = proto.receive(timeout)
+        if frame is None:
+            raise TimeoutError("no reply to CONFIG")
+        if frame[0] == CONFIG:
+            (err,) = struct.unpack_from("<i", frame[2])
+            fields = json.loads(frame[2][4:].decode()) if len(frame[2]) > 4 else {}
+            return err, fields
+
+
+def print_config(fields):
+    for name, field in fields.items():
+        line = "%-24s %10s %-8s default %s, %s..%s" % (name, field["value"], field["unit"], field["default"],
+                                                       field["min"], field["max"])
+        if field["apply"] == "boot":
+            line += ", at boot"
+        if "stored" in field:
+            line += " (stored %s - restart to apply)" % field["stored"]
+        print(line)
+
+
+def download(proto, session_id, path, window, chunk, restart=False, timeout=0.5, give_up=15.0, quiet=False):
+    offset = 0 if restart or not os.path.exists(path) else os.path.getsize(path)
+    out = open(path, "r+b" if offset else "wb")
+    out.seek(offset)
+    out.truncate()
+
+    def request():
+        proto.send(GET, struct.pack("<IIHH", session_id, expected, window, chunk))
+
+    expected = offset
+    rewound = False
+    started = time.monotonic()
+    progress = started
+    shown = 0.0
+    request()
+    try:
+        while True:
+            frame = proto.receive(timeout)
+            now = time.monotonic()
+            if frame is None:
+                if now - progress > give_up:
+                    raise TimeoutError("session %d stalled at %d bytes" % (session_id, expected))
+                request()               # Lost GET, lost END or a dropped stream: ask again from here
+                continue
+            kind, flags, payload = frame
+            if kind == DATA:
+                sid, at = struct.unpack_from("<II", payload)
+                if sid != session_id:
+                    continue
+                if at == expected:
+                    out.write(payload[8:])
+                    expected += len(payload) - 8
+                    rewound = False
+                    progress = now
+                    proto.send(ACK, struct.pack("<II", session_id, expected))
+                elif at > expected and not rewound:
+                    # A chunk went missing - have the device go back to it once
+                    proto.send(ACK, struct.pack("<II", session_id, expected), FLAG_REWIND)
+                    rewound = True
+                if not quiet and now - shown > 0.5:
+                    shown = now
+                    rate = (expected - offset) / max(now - started, 1e-6)
+                    sys.stderr.write("\rS%04d  %d bytes  %.1f kB/s " % (session_id, expected, rate / 1000))
+            elif kind == END:
+                sid, size = struct.unpack("<II", payload)
+                if sid == session_id:
+                    if size != expected:
+                        raise IOError("session %d ended at %d, have %d bytes" % (session_id, size, expected))
+                    break
+            elif kind == ERROR:
+                sid, err = struct.unpack("<Ii", payload)
+                if sid == session_id:
+                    raise IOError("session %d refused: %s" % (session_id, ERRORS.get(err, hex(err))))
+    finally:
+        out.close()
+
+    elapsed = time.monotonic() - started
+    if not quiet:
+        sys.stderr.write("\rS%04d  %d bytes in %.2f s  %.1f kB/s\n"
+                         % (session_id, expected, elapsed, (expected - offset) / max(elapsed, 1e-6) / 1000))
+    return expected - offset, elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port")
+    parser.add_argument("-b", "--baud", type=int, default=115200, help="console baud rate (sdkconfig)")
+    commands = parser.add_subparsers(dest="command", required=True)
+    commands.add_parser("list", help="list closed sessions on the card")
+    stats = commands.add_parser("stats", help="print the telemetry snapshot as JSON")
+    stats.add_argument("-i", "--interval", type=float, default=0, help="repeat every INTERVAL seconds")
+    conf = commands.add_parser("config", help="show the runtime configuration, or change it")
+    conf.add_argument("assignments", nargs="*", metavar="NAME=VALUE")
+    conf.add_argument("--json", action="store_true", help="print fields as JSON")
+    get = commands.add_parser("get", help="download sessions (all when none are given)")
+    get.add_argument("sessions", type=int, nargs="*")
+    get.add_argument("-d", "--dir", default=".")
+    get.add_argument("-w", "--window", type=int, default=8, help="chunks in flight")
+    get.add_argument("-c", "--chunk", type=int, default=2048, help="bytes per chunk")
+    get.add_argument("--restart", action="store_true", help="do not resume partial files")
+    args = parser.parse_args()
+
+    link = open_link(args.port, args.baud)
+    proto = Protocol(link)
+    try:
+        if args.command == "list":
+            for session_id, size in list_sessions(proto).items():
+                print("S%04d.LOG  %10d bytes" % (session_id, size))
+            return 0
+
+        if args.command == "stats":
+            while True:
+                print(json.dumps(read_stats(proto)), flush=True)
+                if args.interval <= 0:
+                    return 0
+                time.sleep(args.interval)
+
+        if args.command == "config":
+            err, fields = config(proto, args.assignments)
+            if args.json:
+                print(json.dumps(fields, indent=1))
+            else:
+                print_config(fields)
+            if err == 0x107:
+                print("stored, but a task did not reach a safe point - applies with the next change or boot",
+                      file=sys.stderr)
+            elif err != 0:
+                raise IOError("configuration not changed: %s" % ERRORS.get(err, hex(err)))
+            return 0
+
+        ids = args.sessions or list(list_sessions(proto))
+        os.makedirs(args.dir, exist_ok=True)
+        total, elapsed = 0, 0.0
+        for session_id in ids:
+            path = os.path.join(args.dir, "S%04d.LOG" % session_id)
+            size, seconds = download(proto, session_id, path, args.window, args.chunk, args.restart)
+            total += size
+            elapsed += seconds
+        if total > 0 and elapsed > 0:
+            line_rate = args.baud / 10
+            print("%d bytes in %.2f s: %.1f kB/s (%.0f%% of %d baud)"
+                  % (total, elapsed, total / elapsed / 1000, 100 * total / elapsed / line_rate, args.baud))
+        return 0
+    except KeyboardInterrupt:
+        proto.send(ABORT)
+        return 1
+    except (IOError, TimeoutError) as err:
+        print("error: %s" % err, file=sys.stderr)
+        return 1
+    finally:
+        link.close()
+
+
+if __name__ == "__main__":
+    sys.exit(main())